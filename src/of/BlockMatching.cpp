@@ -0,0 +1,663 @@
+/*!
+  \file src/of/BlockMatching.cpp
+  \brief This class implements a block matching method for estimating optical flow, suited to large displacements.
+  \author Douglas Uba
+*/
+
+#include "BlockMatching.h"
+#include "Census.h"
+#include "Config.h"
+#include "Exception.h"
+#include "Image.h"
+#include "Kernels.h"
+#include "Parallel.h"
+#include "Pyramid.h"
+#include "Trace.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+  typedef std::ptrdiff_t Index;
+
+  // Number of lines of each band of the flow interpolation, processed in parallel
+  const std::size_t sg_bandLines = 32;
+
+  // Search patterns, as (dy, dx) steps around the current best displacement
+  const Index sg_largeDiamond[][2] = { { -2, 0 }, { -1, -1 }, { -1, 1 }, { 0, -2 }, { 0, 2 }, { 1, -1 }, { 1, 1 }, { 2, 0 } };
+  const Index sg_largeHexagon[][2] = { { -2, -1 }, { -2, 1 }, { 0, -2 }, { 0, 2 }, { 2, -1 }, { 2, 1 } };
+  const Index sg_smallDiamond[][2] = { { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } };
+
+  // Displacements of a grid of blocks. The positions are the block centers.
+  struct BlockGrid
+  {
+    std::vector<double> lines; // The center line of each block row.
+    std::vector<double> cols;  // The center column of each block column.
+    std::vector<double> u;     // The horizontal displacements. (lines.size() x cols.size())
+    std::vector<double> v;     // The vertical displacements.
+  };
+
+  // Positions of the blocks along one dimension. The last block touches the border.
+  std::vector<std::size_t> GetBlockPositions(std::size_t size, std::size_t blockSize, std::size_t stride)
+  {
+    std::vector<std::size_t> positions;
+
+    if(size < blockSize)
+      return positions;
+
+    for(std::size_t p = 0; p + blockSize <= size; p += stride)
+      positions.push_back(p);
+
+    if(positions.back() != size - blockSize)
+      positions.push_back(size - blockSize);
+
+    return positions;
+  }
+
+  // Cell [i, i + 1] of the given centers that contains coord, and the weight of i + 1. Coordinates outside are clamped.
+  void GetCell(const std::vector<double>& centers, double coord, std::size_t& i, double& w)
+  {
+    if(centers.size() == 1 || coord <= centers.front())
+    {
+      i = 0;
+      w = 0.0;
+      return;
+    }
+
+    if(coord >= centers.back())
+    {
+      i = centers.size() - 2;
+      w = 1.0;
+      return;
+    }
+
+    i = std::upper_bound(centers.begin(), centers.end(), coord) - centers.begin() - 1;
+    w = (coord - centers[i]) / (centers[i + 1] - centers[i]);
+  }
+
+  // Bilinear interpolation of the grid displacements at (y, x)
+  void SampleGrid(const BlockGrid& grid, double y, double x, double& u, double& v)
+  {
+    std::size_t i, j;
+    double wy, wx;
+    GetCell(grid.lines, y, i, wy);
+    GetCell(grid.cols, x, j, wx);
+
+    const std::size_t nc = grid.cols.size();
+    const std::size_t i1 = std::min(i + 1, grid.lines.size() - 1), j1 = std::min(j + 1, nc - 1);
+
+    u = (1.0 - wy) * ((1.0 - wx) * grid.u[i * nc + j] + wx * grid.u[i * nc + j1]) +
+        wy * ((1.0 - wx) * grid.u[i1 * nc + j] + wx * grid.u[i1 * nc + j1]);
+    v = (1.0 - wy) * ((1.0 - wx) * grid.v[i * nc + j] + wx * grid.v[i * nc + j1]) +
+        wy * ((1.0 - wx) * grid.v[i1 * nc + j] + wx * grid.v[i1 * nc + j1]);
+  }
+
+  // Census transforms of the images of one level, for the census costs
+  struct CensusLevel
+  {
+    std::vector<std::uint32_t> a5; // The 5 x 5 census of the first image.
+    std::vector<std::uint32_t> b5; // The 5 x 5 census of the second image.
+    std::vector<std::uint64_t> a7; // The 7 x 7 census of the first image.
+    std::vector<std::uint64_t> b7; // The 7 x 7 census of the second image.
+  };
+
+  // Cost evaluation of one block over its search window, with a cache of the visited displacements
+  class Matcher
+  {
+    public:
+
+      Matcher(const of::KernelTable& table, const std::string& cost, const double* a, const double* b,
+              const CensusLevel& census, const of::Size& size, Index blockSize, Index radius)
+        : m_table(table),
+          m_ncc(cost == of::OF_BM_NCC_COST),
+          m_sad(cost == of::OF_BM_SAD_COST),
+          m_census5(cost == of::OF_BM_CENSUS5_COST),
+          m_census7(cost == of::OF_BM_CENSUS7_COST),
+          m_a(a),
+          m_b(b),
+          m_census(census),
+          m_nlines(size.nlines),
+          m_ncols(size.ncols),
+          m_bs(blockSize),
+          m_radius(radius),
+          m_width(2 * radius + 1),
+          m_cache(m_width * m_width, -1.0),
+          m_evaluations(0)
+      {
+      }
+
+      // Starts the search of the block at (y0, x0), in the window centered at the displacement (sy, sx)
+      void begin(Index y0, Index x0, Index sy, Index sx)
+      {
+        for(std::size_t i = 0; i < m_visited.size(); ++i)
+          m_cache[m_visited[i]] = -1.0;
+
+        m_visited.clear();
+
+        m_y0 = y0;
+        m_x0 = x0;
+        m_sy = sy;
+        m_sx = sx;
+      }
+
+      // Checks if the displacement (dy, dx) is inside the window and keeps the block inside the second image
+      bool isValid(Index dy, Index dx) const
+      {
+        return std::abs(dy - m_sy) <= m_radius && std::abs(dx - m_sx) <= m_radius &&
+               m_y0 + dy >= 0 && m_y0 + dy + m_bs <= m_nlines &&
+               m_x0 + dx >= 0 && m_x0 + dx + m_bs <= m_ncols;
+      }
+
+      // Cost of the displacement (dy, dx). Evaluations may stop above the bound. Invalid displacements cost infinity.
+      double cost(Index dy, Index dx, double bound)
+      {
+        if(!isValid(dy, dx))
+          return std::numeric_limits<double>::infinity();
+
+        const Index k = (dy - m_sy + m_radius) * m_width + dx - m_sx + m_radius;
+
+        // The bound only decreases during a search, so a cached partial cost is still above it
+        if(m_cache[k] < 0.0)
+        {
+          m_cache[k] = evaluate(dy, dx, bound);
+          m_visited.push_back(k);
+        }
+
+        return m_cache[k];
+      }
+
+      // Complete cost of the displacement (dy, dx), which must be valid
+      double exactCost(Index dy, Index dx)
+      {
+        return evaluate(dy, dx, std::numeric_limits<double>::infinity());
+      }
+
+      std::size_t getEvaluations() const
+      {
+        return m_evaluations;
+      }
+
+    private:
+
+      double evaluate(Index dy, Index dx, double bound)
+      {
+        ++m_evaluations;
+
+        const Index ia = m_y0 * m_ncols + m_x0, ib = (m_y0 + dy) * m_ncols + m_x0 + dx;
+
+        if(m_census5)
+          return m_table.blockHamming32(&m_census.a5[ia], &m_census.b5[ib], m_ncols, m_bs, bound);
+
+        if(m_census7)
+          return m_table.blockHamming64(&m_census.a7[ia], &m_census.b7[ib], m_ncols, m_bs, bound);
+
+        const double* a = m_a + m_y0 * m_ncols + m_x0;
+        const double* b = m_b + (m_y0 + dy) * m_ncols + m_x0 + dx;
+
+        if(m_ncc)
+          return m_table.blockNCC(a, b, m_ncols, m_bs);
+
+        return m_sad ? m_table.blockSAD(a, b, m_ncols, m_bs, bound) : m_table.blockSSD(a, b, m_ncols, m_bs, bound);
+      }
+
+    private:
+
+      const of::KernelTable& m_table;
+      bool m_ncc;
+      bool m_sad;
+      bool m_census5;
+      bool m_census7;
+      const double* m_a;
+      const double* m_b;
+      const CensusLevel& m_census;
+      Index m_nlines;
+      Index m_ncols;
+      Index m_bs;
+      Index m_radius;
+      Index m_width;
+      std::vector<double> m_cache;   // Cost of each displacement of the window. (-1: not visited)
+      std::vector<Index> m_visited;  // Visited cache entries.
+      std::size_t m_evaluations;
+      Index m_y0, m_x0, m_sy, m_sx;
+  };
+
+  // Moves (by, bx) with the given pattern while the cost decreases
+  template<std::size_t N>
+  void PatternSearch(Matcher& matcher, const Index (&pattern)[N][2], bool repeat, Index& by, Index& bx, double& best)
+  {
+    for(;;)
+    {
+      Index ny = by, nx = bx;
+
+      for(std::size_t i = 0; i < N; ++i)
+      {
+        const double c = matcher.cost(by + pattern[i][0], bx + pattern[i][1], best);
+        if(c < best)
+        {
+          best = c;
+          ny = by + pattern[i][0];
+          nx = bx + pattern[i][1];
+        }
+      }
+
+      if(ny == by && nx == bx)
+        return;
+
+      by = ny;
+      bx = nx;
+
+      if(!repeat)
+        return;
+    }
+  }
+
+  // Sub-pixel offset of the minimum of the parabola through the costs at -1, 0 and +1
+  double ParabolaOffset(double cm, double c0, double cp)
+  {
+    const double denominator = cm - 2.0 * c0 + cp;
+    if(!(denominator > 0.0))
+      return 0.0;
+
+    return std::max(-0.5, std::min(0.5, 0.5 * (cm - cp) / denominator));
+  }
+
+  // Searches the blocks of a in b, from the seed displacements of the coarser level (if any)
+  void SearchBlocks(const double* a, const double* b, const CensusLevel& census, const of::Size& size,
+                    std::size_t blockSize, std::size_t radius, const std::string& cost, const std::string& search, bool subpixel,
+                    const std::vector<std::size_t>& lines, const std::vector<std::size_t>& cols,
+                    const BlockGrid* seed, BlockGrid& grid, std::size_t& evaluations)
+  {
+    const Index bs = blockSize;
+    const double half = (bs - 1) * 0.5;
+
+    grid.lines.resize(lines.size());
+    grid.cols.resize(cols.size());
+    for(std::size_t i = 0; i < lines.size(); ++i)
+      grid.lines[i] = lines[i] + half;
+    for(std::size_t j = 0; j < cols.size(); ++j)
+      grid.cols[j] = cols[j] + half;
+
+    grid.u.assign(lines.size() * cols.size(), 0.0);
+    grid.v.assign(lines.size() * cols.size(), 0.0);
+
+    const of::KernelTable& table = of::Kernels::get();
+
+    std::vector<std::size_t> rowEvaluations(lines.size(), 0);
+
+    of::Parallel::forEach(lines.size(), [&](std::size_t i)
+    {
+      Matcher matcher(table, cost, a, b, census, size, bs, radius);
+
+      for(std::size_t j = 0; j < cols.size(); ++j)
+      {
+        const Index y0 = lines[i], x0 = cols[j];
+
+        // Seed: the flow of the coarser level at the block center (pixel x is the coarse pixel (x - 1) / 2)
+        double su = 0.0, sv = 0.0;
+        if(seed != 0)
+        {
+          SampleGrid(*seed, (grid.lines[i] - 1.0) * 0.5, (grid.cols[j] - 1.0) * 0.5, su, sv);
+          su *= 2.0;
+          sv *= 2.0;
+        }
+
+        // Integer seed that keeps the block inside the second image
+        const Index sy = std::max(-y0, std::min(Index(size.nlines) - bs - y0, Index(std::floor(sv + 0.5))));
+        const Index sx = std::max(-x0, std::min(Index(size.ncols) - bs - x0, Index(std::floor(su + 0.5))));
+
+        matcher.begin(y0, x0, sy, sx);
+
+        Index by = sy, bx = sx;
+        double best = matcher.cost(by, bx, std::numeric_limits<double>::infinity());
+
+        if(search == of::OF_BM_FULL_SEARCH)
+        {
+          for(Index dy = sy - Index(radius); dy <= sy + Index(radius); ++dy)
+          {
+            for(Index dx = sx - Index(radius); dx <= sx + Index(radius); ++dx)
+            {
+              const double c = matcher.cost(dy, dx, best);
+              if(c < best)
+              {
+                best = c;
+                by = dy;
+                bx = dx;
+              }
+            }
+          }
+        }
+        else
+        {
+          // Predictors: zero motion and the displacement of the left neighbour
+          Index predictors[2][2] = { { 0, 0 }, { sy, sx } };
+          if(j != 0)
+          {
+            predictors[1][0] = Index(std::floor(grid.v[i * cols.size() + j - 1] + 0.5));
+            predictors[1][1] = Index(std::floor(grid.u[i * cols.size() + j - 1] + 0.5));
+          }
+
+          for(std::size_t p = 0; p < 2; ++p)
+          {
+            const double c = matcher.cost(predictors[p][0], predictors[p][1], best);
+            if(c < best)
+            {
+              best = c;
+              by = predictors[p][0];
+              bx = predictors[p][1];
+            }
+          }
+
+          if(search == of::OF_BM_DIAMOND_SEARCH)
+            PatternSearch(matcher, sg_largeDiamond, true, by, bx, best);
+          else
+            PatternSearch(matcher, sg_largeHexagon, true, by, bx, best);
+
+          PatternSearch(matcher, sg_smallDiamond, false, by, bx, best);
+        }
+
+        double u = double(bx), v = double(by);
+
+        if(subpixel)
+        {
+          if(matcher.isValid(by, bx - 1) && matcher.isValid(by, bx + 1))
+            u += ParabolaOffset(matcher.exactCost(by, bx - 1), best, matcher.exactCost(by, bx + 1));
+
+          if(matcher.isValid(by - 1, bx) && matcher.isValid(by + 1, bx))
+            v += ParabolaOffset(matcher.exactCost(by - 1, bx), best, matcher.exactCost(by + 1, bx));
+        }
+
+        grid.u[i * cols.size() + j] = u;
+        grid.v[i * cols.size() + j] = v;
+      }
+
+      rowEvaluations[i] = matcher.getEvaluations();
+    });
+
+    evaluations = 0;
+    for(std::size_t i = 0; i < rowEvaluations.size(); ++i)
+      evaluations += rowEvaluations[i];
+  }
+
+  // 3 x 3 median of each displacement component over the grid, which removes isolated mismatches
+  void MedianFilter(BlockGrid& grid)
+  {
+    const Index nl = grid.lines.size(), nc = grid.cols.size();
+
+    std::vector<double>* components[] = { &grid.u, &grid.v };
+
+    for(std::size_t c = 0; c < 2; ++c)
+    {
+      const std::vector<double> src(*components[c]);
+      std::vector<double>& dst = *components[c];
+
+      for(Index i = 0; i < nl; ++i)
+      {
+        for(Index j = 0; j < nc; ++j)
+        {
+          double values[9];
+          std::size_t n = 0;
+
+          for(Index di = -1; di <= 1; ++di)
+            for(Index dj = -1; dj <= 1; ++dj)
+              if(i + di >= 0 && i + di < nl && j + dj >= 0 && j + dj < nc)
+                values[n++] = src[(i + di) * nc + j + dj];
+
+          std::nth_element(values, values + n / 2, values + n);
+          dst[i * nc + j] = values[n / 2];
+        }
+      }
+    }
+  }
+
+  // Dense flow: bilinear interpolation of the block displacements
+  void InterpolateFlow(const BlockGrid& grid, const of::Size& size, double* u, double* v)
+  {
+    std::vector<std::size_t> cells(size.ncols);
+    std::vector<double> weights(size.ncols);
+    for(std::size_t col = 0; col < size.ncols; ++col)
+      GetCell(grid.cols, double(col), cells[col], weights[col]);
+
+    const std::size_t nc = grid.cols.size();
+    const std::size_t nbands = (size.nlines + sg_bandLines - 1) / sg_bandLines;
+
+    of::Parallel::forEach(nbands, [&](std::size_t band)
+    {
+      const std::size_t last = std::min(size.nlines, (band + 1) * sg_bandLines);
+
+      for(std::size_t lin = band * sg_bandLines; lin < last; ++lin)
+      {
+        std::size_t i;
+        double wy;
+        GetCell(grid.lines, double(lin), i, wy);
+
+        const std::size_t i1 = std::min(i + 1, grid.lines.size() - 1);
+
+        for(std::size_t col = 0; col < size.ncols; ++col)
+        {
+          const std::size_t j = cells[col], j1 = std::min(j + 1, nc - 1);
+          const double wx = weights[col];
+
+          u[lin * size.ncols + col] = (1.0 - wy) * ((1.0 - wx) * grid.u[i * nc + j] + wx * grid.u[i * nc + j1]) +
+                                      wy * ((1.0 - wx) * grid.u[i1 * nc + j] + wx * grid.u[i1 * nc + j1]);
+          v[lin * size.ncols + col] = (1.0 - wy) * ((1.0 - wx) * grid.v[i * nc + j] + wx * grid.v[i * nc + j1]) +
+                                      wy * ((1.0 - wx) * grid.v[i1 * nc + j] + wx * grid.v[i1 * nc + j1]);
+        }
+      }
+    });
+  }
+}
+
+of::BlockMatching::BlockMatching(Image* a, Image* b)
+  : OpticalFlow(a, b),
+    m_blockSize(OF_DEFAULT_BM_BLOCK_SIZE),
+    m_blockStride(0),
+    m_searchRadius(OF_DEFAULT_BM_SEARCH_RADIUS),
+    m_cost(OF_DEFAULT_BM_COST),
+    m_search(OF_DEFAULT_BM_SEARCH),
+    m_coarsestLevel(0),
+    m_subpixel(true)
+{
+}
+
+of::BlockMatching::~BlockMatching()
+{
+}
+
+void of::BlockMatching::compute()
+{
+  m_stats.clear();
+
+  Size size = m_imga->getSize();
+
+  StatsScope scope(m_stats, "compute", size.npixels);
+
+  const std::size_t coarsest = computeCoarsestLevel(size);
+  const std::size_t stride = m_blockStride != 0 ? m_blockStride : std::max<std::size_t>(1, m_blockSize / 2);
+
+  std::unique_ptr<Pyramid> pyra, pyrb;
+  {
+    StatsScope scope(m_stats, "pyramid", size.npixels * 2);
+
+    pyra.reset(new Pyramid(m_imga, coarsest));
+    pyrb.reset(new Pyramid(m_imgb, coarsest));
+
+    // The coarsest level builds the finer ones
+    pyra->getLevel(coarsest);
+    pyrb->getLevel(coarsest);
+  }
+
+  BlockGrid grid;
+
+  for(int level = coarsest; level >= 0; --level)
+  {
+    std::ostringstream levelName;
+    levelName << "level-" << level;
+
+    TraceScope trace(levelName.str(), "level");
+
+    Image* a = pyra->getLevel(level);
+    Image* b = pyrb->getLevel(level);
+
+    const Size lsize = a->getSize();
+
+    const std::vector<std::size_t> lines = GetBlockPositions(lsize.nlines, m_blockSize, stride);
+    const std::vector<std::size_t> cols = GetBlockPositions(lsize.ncols, m_blockSize, stride);
+
+    CensusLevel census;
+    if(m_cost == OF_BM_CENSUS5_COST || m_cost == OF_BM_CENSUS7_COST)
+    {
+      StatsScope scope(m_stats, "census", lsize.npixels * 2);
+
+      if(m_cost == OF_BM_CENSUS5_COST)
+      {
+        Census::transform5x5(a, census.a5);
+        Census::transform5x5(b, census.b5);
+      }
+      else
+      {
+        Census::transform7x7(a, census.a7);
+        Census::transform7x7(b, census.b7);
+      }
+    }
+
+    BlockGrid next;
+    std::size_t evaluations = 0;
+    {
+      StatsScope scope(m_stats, "search", lsize.npixels);
+
+      SearchBlocks(a->getBuffer(), b->getBuffer(), census, lsize, m_blockSize, m_searchRadius, m_cost, m_search, m_subpixel,
+                   lines, cols, grid.u.empty() ? 0 : &grid, next, evaluations);
+
+      MedianFilter(next);
+    }
+
+    grid = next;
+
+    m_stats.addCounter("blocks", grid.u.size());
+    m_stats.addCounter("evaluations", evaluations);
+
+    // The walk has moved past this level
+    pyra->release(level);
+    pyrb->release(level);
+  }
+
+  releaseResults();
+
+  m_u = new Image(size);
+  m_v = new Image(size);
+
+  // Images smaller than a block have no blocks: the flow is zero
+  if(grid.u.empty())
+  {
+    std::fill(m_u->getBuffer(), m_u->getBuffer() + size.npixels, 0.0);
+    std::fill(m_v->getBuffer(), m_v->getBuffer() + size.npixels, 0.0);
+  }
+  else
+  {
+    StatsScope scope(m_stats, "interpolation", size.npixels);
+
+    InterpolateFlow(grid, size, m_u->getBuffer(), m_v->getBuffer());
+  }
+
+  m_stats.setCounter("levels", coarsest + 1);
+}
+
+void of::BlockMatching::setBlockSize(std::size_t n)
+{
+  if(n == 0)
+    throw Exception("The block size must be positive");
+
+  m_blockSize = n;
+}
+
+void of::BlockMatching::setBlockStride(std::size_t n)
+{
+  m_blockStride = n;
+}
+
+void of::BlockMatching::setSearchRadius(std::size_t radius)
+{
+  m_searchRadius = radius;
+}
+
+void of::BlockMatching::setCost(const std::string& name)
+{
+  std::vector<std::string> costs = getCosts();
+  if(std::find(costs.begin(), costs.end(), name) == costs.end())
+    throw Exception("Unknown block matching cost: " + name);
+
+  m_cost = name;
+}
+
+void of::BlockMatching::setSearch(const std::string& name)
+{
+  std::vector<std::string> searches = getSearches();
+  if(std::find(searches.begin(), searches.end(), name) == searches.end())
+    throw Exception("Unknown block matching search: " + name);
+
+  m_search = name;
+}
+
+void of::BlockMatching::setCoarsestLevel(std::size_t level)
+{
+  m_coarsestLevel = level;
+}
+
+void of::BlockMatching::setSubpixelRefinement(bool on)
+{
+  m_subpixel = on;
+}
+
+std::vector<std::string> of::BlockMatching::getCosts()
+{
+  std::vector<std::string> costs;
+  costs.push_back(OF_BM_SAD_COST);
+  costs.push_back(OF_BM_SSD_COST);
+  costs.push_back(OF_BM_NCC_COST);
+  costs.push_back(OF_BM_CENSUS5_COST);
+  costs.push_back(OF_BM_CENSUS7_COST);
+
+  return costs;
+}
+
+std::vector<std::string> of::BlockMatching::getSearches()
+{
+  std::vector<std::string> searches;
+  searches.push_back(OF_BM_FULL_SEARCH);
+  searches.push_back(OF_BM_DIAMOND_SEARCH);
+  searches.push_back(OF_BM_HEXAGON_SEARCH);
+
+  return searches;
+}
+
+std::size_t of::BlockMatching::computeCoarsestLevel(const Size& size) const
+{
+  const std::size_t maxLevels = Pyramid::getMaxNumberOfLevels(size);
+
+  if(m_coarsestLevel != 0)
+    return std::min(m_coarsestLevel, maxLevels);
+
+  // Coarsest level with at least 2 blocks along each dimension (level sizes as in Pyramid::down)
+  std::size_t level = 0;
+  Size lsize = size;
+
+  while(level < maxLevels)
+  {
+    Size next(lsize.nlines * 0.5, lsize.ncols * 0.5);
+
+    if(std::min(next.nlines, next.ncols) < 2 * m_blockSize)
+      break;
+
+    lsize = next;
+    ++level;
+  }
+
+  return level;
+}
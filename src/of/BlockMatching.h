@@ -0,0 +1,180 @@
+/*!
+  \file src/of/BlockMatching.h
+  \brief This class implements a block matching method for estimating optical flow, suited to large displacements.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_BLOCK_MATCHING_H
+#define __OF_INTERNAL_BLOCK_MATCHING_H
+
+#include "OpticalFlow.h"
+
+// STL
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  struct Size;
+
+  // Available matching costs
+  const std::string OF_BM_SAD_COST = "SAD";
+  const std::string OF_BM_SSD_COST = "SSD";
+  const std::string OF_BM_NCC_COST = "NCC";
+  const std::string OF_BM_CENSUS5_COST = "census5";
+  const std::string OF_BM_CENSUS7_COST = "census7";
+
+  // Available search patterns
+  const std::string OF_BM_FULL_SEARCH = "full";
+  const std::string OF_BM_DIAMOND_SEARCH = "diamond";
+  const std::string OF_BM_HEXAGON_SEARCH = "hexagon";
+
+  /*!
+    \class BlockMatching
+
+    \brief This class implements a block matching method for estimating optical flow.
+
+    The first image is divided into a grid of (overlapping) square blocks. Each block is searched in the
+    second image, inside a square window around a seed displacement, minimizing one of the costs:
+      - SAD: sum of absolute differences;
+      - SSD: sum of squared differences;
+      - NCC: one minus the normalized cross correlation. (insensitive to brightness and contrast changes)
+      - census5 and census7: sum of the Hamming distances between the 5 x 5 or 7 x 7 census transforms
+        (see Census). They are insensitive to any monotonic brightness change, and cheap: one XOR and
+        one population count per pixel.
+
+    The search patterns are:
+      - full: every displacement of the window;
+      - diamond: large diamond steps (distance 2) while the cost decreases, then a small diamond (distance 1);
+      - hexagon: large hexagon steps while the cost decreases, then a small diamond. It needs fewer evaluations.
+
+    The pattern searches start from the best of the seed, zero and the displacement of the left neighbour block.
+    SAD, SSD and census evaluations stop as soon as their partial sums exceed the best cost (see KernelTable::blockSAD).
+
+    The search runs coarse to fine over a pyramid: the seed of each block is the flow of the coarser level,
+    so the displacements may reach the search radius times 2^(levels + 1) - 1. The best integer displacement
+    is refined to sub-pixel by fitting a parabola to the costs of its neighbours along each axis. The displacements
+    of each level are filtered by a 3 x 3 median over the grid of blocks, which removes isolated mismatches.
+    The flow of each pixel is interpolated bilinearly from the displacements of the blocks around it.
+
+    The block rows are searched in parallel.
+
+    \note The derivative images (getFx, getFy and getFt) are not computed.
+
+    \note The stats report the stages "pyramid", "census" (census costs only), "search" and "interpolation",
+          and the counters "blocks" and "evaluations" (number of cost evaluations), accumulated over the levels.
+  */
+  class OFEXPORT BlockMatching : public OpticalFlow
+  {
+    public:
+
+      /*!
+        \brief Constructor. It uses the default block size, search radius, cost and search pattern (see Config.h).
+
+        \param a The first image.
+        \param b The second image.
+
+        \note The BlockMatching will not take the ownership of the given images.
+      */
+      BlockMatching(Image* a, Image* b);
+
+      /*! \brief Destructor. */
+      ~BlockMatching();
+
+      void compute();
+
+      /*!
+        \brief This method sets the block size.
+
+        \param n The block size. e.g. (16 = 16 x 16)
+
+        \exception Exception It throws an exception if the size is 0.
+      */
+      void setBlockSize(std::size_t n);
+
+      /*!
+        \brief This method sets the distance between neighbour blocks.
+
+        \param n The distance. 0 means half of the block size.
+      */
+      void setBlockStride(std::size_t n);
+
+      /*!
+        \brief This method sets the search radius, i.e. the window of each level is (2 * radius + 1) x (2 * radius + 1).
+
+        \param radius The search radius, in pixels of each level.
+      */
+      void setSearchRadius(std::size_t radius);
+
+      /*!
+        \brief This method sets the matching cost.
+
+        \param name The cost name. (SAD, SSD, NCC, census5 or census7)
+
+        \exception Exception It throws an exception if the cost is unknown.
+      */
+      void setCost(const std::string& name);
+
+      /*!
+        \brief This method sets the search pattern.
+
+        \param name The search pattern name. (full, diamond or hexagon)
+
+        \exception Exception It throws an exception if the search pattern is unknown.
+      */
+      void setSearch(const std::string& name);
+
+      /*!
+        \brief This method sets the coarsest pyramid level searched.
+
+        \param level The coarsest level. 0 means automatic: the coarsest level whose size is at least 2 blocks.
+      */
+      void setCoarsestLevel(std::size_t level);
+
+      /*!
+        \brief This method enables or disables the sub-pixel refinement.
+
+        \param on True to refine the displacements to sub-pixel (default), false to keep integer displacements.
+      */
+      void setSubpixelRefinement(bool on);
+
+      /*!
+        \brief This method returns the names of the available matching costs.
+
+        \return The names of the available matching costs.
+      */
+      static std::vector<std::string> getCosts();
+
+      /*!
+        \brief This method returns the names of the available search patterns.
+
+        \return The names of the available search patterns.
+      */
+      static std::vector<std::string> getSearches();
+
+    private:
+
+      /*!
+        \brief Internal method that returns the coarsest level searched for the given image size.
+
+        \param size The image size.
+
+        \return The coarsest level.
+      */
+      std::size_t computeCoarsestLevel(const Size& size) const;
+
+    private:
+
+      std::size_t m_blockSize;     //!< The block size.
+      std::size_t m_blockStride;   //!< The distance between neighbour blocks. (0: half of the block size)
+      std::size_t m_searchRadius;  //!< The search radius of each level.
+      std::string m_cost;          //!< The matching cost.
+      std::string m_search;        //!< The search pattern.
+      std::size_t m_coarsestLevel; //!< The coarsest level searched. (0: automatic)
+      bool m_subpixel;             //!< Sub-pixel refinement flag.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_BLOCK_MATCHING_H
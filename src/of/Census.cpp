@@ -0,0 +1,114 @@
+/*!
+  \file src/of/Census.cpp
+  \brief Census transform of images, for matching costs and data terms robust to brightness changes.
+  \author Douglas Uba
+*/
+
+#include "Census.h"
+#include "Exception.h"
+#include "Image.h"
+#include "Kernels.h"
+#include "Parallel.h"
+
+// STL
+#include <cmath>
+
+namespace
+{
+  typedef std::ptrdiff_t Index;
+
+  // Neighbours of the soft census channels, as (dy, dx): corners and edge midpoints of the 5 x 5 window
+  const Index sg_channelOffsets[][2] = { { -2, -2 }, { -2, 0 }, { -2, 2 }, { 0, -2 }, { 0, 2 }, { 2, -2 }, { 2, 0 }, { 2, 2 } };
+
+  const std::size_t sg_nChannels = sizeof(sg_channelOffsets) / sizeof(sg_channelOffsets[0]);
+
+  Index Clamp(Index coord, Index upper)
+  {
+    return coord < 0 ? 0 : (coord >= upper ? upper - 1 : coord);
+  }
+
+  // Difference between the k-th neighbour (clamped) and the center
+  double Difference(const double* data, Index nlines, Index ncols, Index lin, Index col, std::size_t k)
+  {
+    const Index y = Clamp(lin + sg_channelOffsets[k][0], nlines);
+    const Index x = Clamp(col + sg_channelOffsets[k][1], ncols);
+
+    return data[y * ncols + x] - data[lin * ncols + col];
+  }
+}
+
+void of::Census::transform5x5(const Image* image, std::vector<std::uint32_t>& census)
+{
+  census.resize(image->getNPixels());
+  Kernels::census5x5(image->getBuffer(), image->getNLines(), image->getNCols(), &census[0]);
+}
+
+void of::Census::transform7x7(const Image* image, std::vector<std::uint64_t>& census)
+{
+  census.resize(image->getNPixels());
+  Kernels::census7x7(image->getBuffer(), image->getNLines(), image->getNCols(), &census[0]);
+}
+
+std::size_t of::Census::getNumberOfChannels()
+{
+  return sg_nChannels;
+}
+
+of::Image* of::Census::computeContrast(const Image* image, double epsilon)
+{
+  const Index nlines = image->getNLines(), ncols = image->getNCols();
+
+  const double* src = image->getBuffer();
+
+  Image* contrast = new Image(image->getSize());
+  double* dst = contrast->getBuffer();
+
+  Parallel::forEach(nlines, [&](std::size_t lin)
+  {
+    for(Index col = 0; col < ncols; ++col)
+    {
+      double sum = 0.0;
+      for(std::size_t k = 0; k < sg_nChannels; ++k)
+      {
+        const double d = Difference(src, nlines, ncols, lin, col, k);
+        sum += d * d;
+      }
+
+      dst[lin * ncols + col] = std::sqrt(sum / sg_nChannels + epsilon * epsilon);
+    }
+  });
+
+  return contrast;
+}
+
+void of::Census::computeChannel(const Image* image, const Image* contrast, std::size_t k, Image* channel)
+{
+  if(k >= sg_nChannels)
+    throw Exception("Invalid soft census channel");
+
+  const Index nlines = image->getNLines(), ncols = image->getNCols();
+
+  const double* src = image->getBuffer();
+  const double* c = contrast->getBuffer();
+  double* dst = channel->getBuffer();
+
+  Parallel::forEach(nlines, [&](std::size_t lin)
+  {
+    for(Index col = 0; col < ncols; ++col)
+    {
+      const Index i = lin * ncols + col;
+
+      // A flat neighbourhood without regularization has no structure
+      dst[i] = c[i] > 0.0 ? Difference(src, nlines, ncols, lin, col, k) / c[i] : 0.0;
+    }
+  });
+}
+
+std::vector<std::string> of::Census::getDataTerms()
+{
+  std::vector<std::string> terms;
+  terms.push_back(OF_INTENSITY_DATA_TERM);
+  terms.push_back(OF_CENSUS_DATA_TERM);
+
+  return terms;
+}
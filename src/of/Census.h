@@ -0,0 +1,103 @@
+/*!
+  \file src/of/Census.h
+  \brief Census transform of images, for matching costs and data terms robust to brightness changes.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_CENSUS_H
+#define __OF_INTERNAL_CENSUS_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+
+  // Available data terms of Lucas & Kanade
+  const std::string OF_INTENSITY_DATA_TERM = "intensity";
+  const std::string OF_CENSUS_DATA_TERM = "census";
+
+  /*!
+    \class Census
+
+    \brief Census transform of images.
+
+    The census signature of a pixel says which neighbours are darker than it. It depends only on the order of
+    the intensities, so it does not change with gain, offset or any monotonic brightness change between frames
+    (e.g. the diurnal heating of infrared channels).
+
+    Binary census: 5 x 5 (24 bits in a 32-bit word per pixel) or 7 x 7 (48 bits in a 64-bit word per pixel),
+    compared by Hamming distance (see KernelTable::blockHamming32 and blockHamming64). They are the census costs
+    of BlockMatching.
+
+    Soft census channels: the differences between 8 neighbours and the center, divided by the local contrast.
+    The neighbours are the corners and the edge midpoints of the 5 x 5 window. The sign of each channel is a census
+    bit, but the channels are differentiable, so they replace the intensities in the data term of Lucas & Kanade
+    (see LucasKanade::setDataTerm).
+  */
+  class OFEXPORT Census
+  {
+    public:
+
+      /*!
+        \brief This method computes the 5 x 5 census transform of the given image (see KernelTable::census5x5).
+
+        \param image The image.
+        \param census The census words, one per pixel.
+      */
+      static void transform5x5(const Image* image, std::vector<std::uint32_t>& census);
+
+      /*!
+        \brief This method computes the 7 x 7 census transform of the given image (see KernelTable::census7x7).
+
+        \param image The image.
+        \param census The census words, one per pixel.
+      */
+      static void transform7x7(const Image* image, std::vector<std::uint64_t>& census);
+
+      /*!
+        \brief This method returns the number of soft census channels.
+
+        \return The number of soft census channels.
+      */
+      static std::size_t getNumberOfChannels();
+
+      /*!
+        \brief This method computes the local contrast of the soft census channels:
+               the root mean square of the neighbour differences, regularized by epsilon.
+
+        \param image The image.
+        \param epsilon The regularization, in intensity units.
+
+        \return The local contrast. The caller will take the ownership of the returned image.
+      */
+      static Image* computeContrast(const Image* image, double epsilon);
+
+      /*!
+        \brief This method computes one soft census channel, with clamped borders.
+
+        \param image The image.
+        \param contrast The local contrast of the image (see computeContrast).
+        \param k The channel, in [0, getNumberOfChannels()).
+        \param channel The output channel, with the size of the image.
+      */
+      static void computeChannel(const Image* image, const Image* contrast, std::size_t k, Image* channel);
+
+      /*!
+        \brief This method returns the names of the available data terms.
+
+        \return The names of the available data terms.
+      */
+      static std::vector<std::string> getDataTerms();
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_CENSUS_H
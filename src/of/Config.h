@@ -17,6 +17,13 @@
 */
 #define OF_DEFAULT_HS_AUTO_STOP_THRESHOLD 0.001
 
+/*!
+  \def OF_DEFAULT_HS_ALPHA
+
+  \brief Default Horn & Schunck alpha (i.e. smoothness weight) parameter.
+*/
+#define OF_DEFAULT_HS_ALPHA 15.0
+
 /*!
   \def DEFAULT_LK_KERNEL_SIZE
 
@@ -24,6 +31,207 @@
 */
 #define OF_DEFAULT_LK_KERNEL_SIZE 15
 
+/*!
+  \def OF_DEFAULT_LK_WINDOW
+
+  \brief Default Lucas & Kanade window. (box: flat ksize x ksize window, or gaussian)
+*/
+#define OF_DEFAULT_LK_WINDOW "box"
+
+/*!
+  \def OF_DEFAULT_LK_GAUSSIAN_SIGMA
+
+  \brief Default standard deviation of the Lucas & Kanade Gaussian window, in pixels.
+*/
+#define OF_DEFAULT_LK_GAUSSIAN_SIGMA 3.0
+
+/*!
+  \def OF_MIN_GAUSSIAN_SIGMA
+
+  \brief Minimum standard deviation of the recursive Gaussian filter (see RecursiveGaussian).
+*/
+#define OF_MIN_GAUSSIAN_SIGMA 0.5
+
+/*!
+  \def OF_DEFAULT_DIS_PRESET
+
+  \brief Default Dense Inverse Search speed/quality preset.
+*/
+#define OF_DEFAULT_DIS_PRESET "fast"
+
+/*!
+  \def OF_DIS_MIN_UPDATE
+
+  \brief Dense Inverse Search stops the iterations of a patch when its displacement changes less than this value, in pixels.
+*/
+#define OF_DIS_MIN_UPDATE 0.01
+
+/*!
+  \def OF_DIS_MIN_HESSIAN_DET
+
+  \brief Dense Inverse Search keeps the initial displacement of patches whose Hessian determinant is below this fraction of its squared trace
+         (i.e. textureless or one-dimensional patches).
+*/
+#define OF_DIS_MIN_HESSIAN_DET 1e-4
+
+/*!
+  \def OF_DEFAULT_BM_BLOCK_SIZE
+
+  \brief Default block size of Block Matching. e.g. (16 = 16 x 16)
+*/
+#define OF_DEFAULT_BM_BLOCK_SIZE 16
+
+/*!
+  \def OF_DEFAULT_BM_SEARCH_RADIUS
+
+  \brief Default search radius of Block Matching, in pixels of each pyramid level.
+*/
+#define OF_DEFAULT_BM_SEARCH_RADIUS 8
+
+/*!
+  \def OF_DEFAULT_BM_COST
+
+  \brief Default matching cost of Block Matching.
+*/
+#define OF_DEFAULT_BM_COST "SAD"
+
+/*!
+  \def OF_DEFAULT_BM_SEARCH
+
+  \brief Default search pattern of Block Matching.
+*/
+#define OF_DEFAULT_BM_SEARCH "hexagon"
+
+/*!
+  \def OF_DEFAULT_DATA_TERM
+
+  \brief Default data term of Lucas & Kanade. (intensity or census)
+*/
+#define OF_DEFAULT_DATA_TERM "intensity"
+
+/*!
+  \def OF_CENSUS_CONTRAST_EPSILON
+
+  \brief Regularization of the local contrast of the soft census channels, as a fraction of the image range.
+         It keeps the noise of flat regions from being amplified.
+*/
+#define OF_CENSUS_CONTRAST_EPSILON 0.01
+
+/*!
+  \def OF_DEFAULT_PRECISION
+
+  \brief Default arithmetic precision of Lucas & Kanade. (double or fixed)
+*/
+#define OF_DEFAULT_PRECISION "double"
+
+/*!
+  \def OF_FIXED_MAX_BITS
+
+  \brief Maximum number of bits of the fixed-point images. The derivatives (times 4) then fit in 16 bits.
+*/
+#define OF_FIXED_MAX_BITS 12
+
+/*!
+  \def OF_DEFAULT_REGISTRATION
+
+  \brief Default pre-registration of Lucas & Kanade pyramidal, by phase correlation. (none, global or tiles)
+*/
+#define OF_DEFAULT_REGISTRATION "none"
+
+/*!
+  \def OF_DEFAULT_PHASE_CORRELATION_TILE_SIZE
+
+  \brief Default tile size of per-tile phase correlation. Tile windows are powers of two.
+*/
+#define OF_DEFAULT_PHASE_CORRELATION_TILE_SIZE 128
+
+/*!
+  \def OF_PHASE_CORRELATION_MIN_PEAK
+
+  \brief Phase correlation shifts whose peak is below this value are unreliable. Tiles take the global shift instead, and the global shift is not applied.
+*/
+#define OF_PHASE_CORRELATION_MIN_PEAK 0.05
+
+/*!
+  \def OF_DEFAULT_TILE_SIZE
+
+  \brief Default tile size (i.e. number of lines and columns) used by tiled processing.
+*/
+#define OF_DEFAULT_TILE_SIZE 512
+
+/*!
+  \def OF_DEFAULT_TILE_HS_HALO
+
+  \brief Default tile halo used by tiled Horn & Schunck when the number of iterations is not limited.
+*/
+#define OF_DEFAULT_TILE_HS_HALO 32
+
+/*!
+  \def OF_DEFAULT_FLOW_CODEC_SCALE
+
+  \brief Default fixed-point scale used by compressed flow files (.ofz). i.e. 1/64 pixel resolution (KITTI convention).
+*/
+#define OF_DEFAULT_FLOW_CODEC_SCALE 64.0
+
+/*!
+  \def OF_FLOW_UNKNOWN_VALUE
+
+  \brief Value used to represent unknown flow vectors (Middlebury convention).
+*/
+#define OF_FLOW_UNKNOWN_VALUE 1e10
+
+/*!
+  \def OF_CACHE_LINE_SIZE
+
+  \brief Cache line size, in bytes, used to estimate the memory bandwidth from cache misses.
+*/
+#define OF_CACHE_LINE_SIZE 64
+
+/*!
+  \def OF_EVALUATION_OUTLIER_EPE
+
+  \brief Endpoint error, in pixels, above which an estimated flow vector is considered an outlier.
+*/
+#define OF_EVALUATION_OUTLIER_EPE 3.0
+
+/*!
+  \def OF_KERNELS_BAND_PIXELS
+
+  \brief Minimum number of pixels of each band of lines processed in parallel by the image kernels.
+*/
+#define OF_KERNELS_BAND_PIXELS 65536
+
+/*!
+  \def OF_KERNELS_MAX_BANDS
+
+  \brief Maximum number of bands of lines processed in parallel by the image kernels.
+*/
+#define OF_KERNELS_MAX_BANDS 64
+
+/*!
+  \def OF_FFT_FILTER_MIN_KERNEL_AREA
+
+  \brief Minimum kernel area (width x height) for which Image::filter2D uses the FFT. Measured with of-bench (filter2D-direct vs filter2D-fft).
+*/
+#define OF_FFT_FILTER_MIN_KERNEL_AREA 361
+
+/*!
+  \def OF_BOX_SUM_MIN_KERNEL_SIZE
+
+  \brief Minimum window size for which the Lucas & Kanade window sums use running sums (see KernelTable::boxSum).
+         Smaller windows keep the direct sums, which are exact in the order of the original implementation and
+         are compiled for fixed bounds up to 21 x 21. From 23 x 23 the direct sums take the generic path, about
+         18 times slower than the running sums on 1024 x 1024 images (of-bench, windowSum vs boxSum).
+*/
+#define OF_BOX_SUM_MIN_KERNEL_SIZE 23
+
+/*!
+  \def OF_FFT_TILE_SIZE
+
+  \brief Default tile size of the overlap-save FFT convolution. Tiles are enlarged to at least twice the kernel size.
+*/
+#define OF_FFT_TILE_SIZE 256
+
 /** @name DLL/LIB Module
 *  Flags for building Optical Flow as a DLL or as a Static Library
 */
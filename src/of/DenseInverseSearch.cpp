@@ -0,0 +1,488 @@
+/*!
+  \file src/of/DenseInverseSearch.cpp
+
+  \brief This class implements the Dense Inverse Search (DIS) method for estimating optical flow.
+         Reference: T. Kroeger, R. Timofte, D. Dai and L. Van Gool (2016), Fast Optical Flow using Dense Inverse Search.
+                    European Conference on Computer Vision (ECCV), pages 471--488
+                    https://arxiv.org/abs/1603.03590
+
+  \author Douglas Uba
+*/
+
+#include "Config.h"
+#include "DenseInverseSearch.h"
+#include "Exception.h"
+#include "Image.h"
+#include "Kernels.h"
+#include "Parallel.h"
+#include "Pyramid.h"
+#include "Trace.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+  typedef std::ptrdiff_t Index;
+
+  // Number of lines of each band of the densification (and of the flow upsampling), processed in parallel
+  const std::size_t sg_bandLines = 32;
+
+  // Bilinear interpolation at (y, x), clamped to the image
+  inline double Sample(const double* img, Index nlines, Index ncols, double y, double x)
+  {
+    y = y < 0.0 ? 0.0 : (y > nlines - 1 ? nlines - 1 : y);
+    x = x < 0.0 ? 0.0 : (x > ncols - 1 ? ncols - 1 : x);
+
+    const Index y0 = Index(y), x0 = Index(x);
+    const Index y1 = y0 + 1 < nlines ? y0 + 1 : y0;
+    const Index x1 = x0 + 1 < ncols ? x0 + 1 : x0;
+
+    const double ay = y - y0, ax = x - x0;
+
+    return (1.0 - ay) * ((1.0 - ax) * img[y0 * ncols + x0] + ax * img[y0 * ncols + x1]) +
+           ay * ((1.0 - ax) * img[y1 * ncols + x0] + ax * img[y1 * ncols + x1]);
+  }
+
+  // Positions of the patches along one dimension. The last patch touches the border.
+  std::vector<std::size_t> GetPatchPositions(std::size_t size, std::size_t patchSize, std::size_t stride)
+  {
+    std::vector<std::size_t> positions;
+
+    if(size < patchSize)
+      return positions;
+
+    for(std::size_t p = 0; p + patchSize <= size; p += stride)
+      positions.push_back(p);
+
+    if(positions.back() != size - patchSize)
+      positions.push_back(size - patchSize);
+
+    return positions;
+  }
+
+  // Upsamples a flow field by the given factor (a power of two). Pyramid levels are sampled on odd pixels,
+  // so the pixel x of the source is the pixel factor * x + factor - 1 of the destination.
+  void UpsampleFlow(const std::vector<double>& src, const of::Size& srcSize, double factor,
+                    const of::Size& dstSize, std::vector<double>& dst)
+  {
+    dst.resize(dstSize.npixels);
+
+    const std::size_t nbands = (dstSize.nlines + sg_bandLines - 1) / sg_bandLines;
+
+    of::Parallel::forEach(nbands, [&](std::size_t band)
+    {
+      const std::size_t last = std::min(dstSize.nlines, (band + 1) * sg_bandLines);
+
+      for(std::size_t lin = band * sg_bandLines; lin < last; ++lin)
+      {
+        const double y = (lin - factor + 1.0) / factor;
+
+        for(std::size_t col = 0; col < dstSize.ncols; ++col)
+        {
+          const double x = (col - factor + 1.0) / factor;
+          dst[lin * dstSize.ncols + col] = factor * Sample(&src[0], srcSize.nlines, srcSize.ncols, y, x);
+        }
+      }
+    });
+  }
+
+  // Inverse compositional search of the patches of a, in b, from the initial flow (iu, iv)
+  void SearchPatches(const double* a, const double* b, const double* gx, const double* gy, const of::Size& size,
+                     const of::DISPreset& preset, const std::vector<std::size_t>& lines, const std::vector<std::size_t>& cols,
+                     const std::vector<double>& iu, const std::vector<double>& iv,
+                     std::vector<double>& pu, std::vector<double>& pv)
+  {
+    const Index nlines = size.nlines, ncols = size.ncols;
+    const Index ps = preset.patchSize, n = ps * ps;
+
+    pu.resize(lines.size() * cols.size());
+    pv.resize(lines.size() * cols.size());
+
+    of::Parallel::forEach(lines.size(), [&](std::size_t i)
+    {
+      std::vector<double> t(n), tgx(n), tgy(n), s(n);
+
+      for(std::size_t j = 0; j < cols.size(); ++j)
+      {
+        const Index y0 = lines[i], x0 = cols[j];
+
+        // Initial displacement: the flow at the patch center
+        const Index center = (y0 + ps / 2) * ncols + x0 + ps / 2;
+        const double u0 = iu[center], v0 = iv[center];
+
+        double& u = pu[i * cols.size() + j];
+        double& v = pv[i * cols.size() + j];
+
+        u = u0;
+        v = v0;
+
+        // Zero-mean template, its gradients and the (fixed) Hessian
+        double mean = 0.0;
+        for(Index r = 0, k = 0; r < ps; ++r)
+        {
+          for(Index c = 0; c < ps; ++c, ++k)
+          {
+            const Index p = (y0 + r) * ncols + x0 + c;
+            t[k] = a[p];
+            tgx[k] = gx[p];
+            tgy[k] = gy[p];
+            mean += t[k];
+          }
+        }
+
+        mean /= n;
+
+        double h11 = 0.0, h12 = 0.0, h22 = 0.0;
+        for(Index k = 0; k < n; ++k)
+        {
+          t[k] -= mean;
+          h11 += tgx[k] * tgx[k];
+          h12 += tgx[k] * tgy[k];
+          h22 += tgy[k] * tgy[k];
+        }
+
+        const double det = h11 * h22 - h12 * h12;
+
+        // Textureless (or one-dimensional) patch: keep the initial displacement
+        if(det <= OF_DIS_MIN_HESSIAN_DET * (h11 + h22) * (h11 + h22) || h11 + h22 <= 0.0)
+          continue;
+
+        // Zero-mean error of the patch displaced by (du, dv)
+        auto error = [&](double du, double dv, double& bx, double& by)
+        {
+          double smean = 0.0;
+          for(Index r = 0, k = 0; r < ps; ++r)
+          {
+            for(Index c = 0; c < ps; ++c, ++k)
+            {
+              s[k] = Sample(b, nlines, ncols, y0 + r + dv, x0 + c + du);
+              smean += s[k];
+            }
+          }
+
+          smean /= n;
+
+          double e = 0.0;
+          bx = by = 0.0;
+          for(Index k = 0; k < n; ++k)
+          {
+            const double d = s[k] - smean - t[k];
+            e += d * d;
+            bx += tgx[k] * d;
+            by += tgy[k] * d;
+          }
+
+          return e;
+        };
+
+        double bx, by;
+        const double e0 = error(u, v, bx, by);
+
+        for(std::size_t it = 0; it < preset.iterations; ++it)
+        {
+          if(it != 0)
+            error(u, v, bx, by);
+
+          // Inverse compositional update: the increment is solved for the template, then inverted
+          const double du = (h22 * bx - h12 * by) / det;
+          const double dv = (h11 * by - h12 * bx) / det;
+
+          u -= du;
+          v -= dv;
+
+          if(du * du + dv * dv < OF_DIS_MIN_UPDATE * OF_DIS_MIN_UPDATE)
+            break;
+        }
+
+        // Diverged or worse than the initial displacement: the patch keeps the initial one
+        const double moved = (u - u0) * (u - u0) + (v - v0) * (v - v0);
+        if(moved > double(ps * ps) || error(u, v, bx, by) > e0)
+        {
+          u = u0;
+          v = v0;
+        }
+      }
+    });
+  }
+
+  // Dense flow: for each pixel, the average of the displacements of the patches that cover it,
+  // weighted by the inverse of their photometric error on the pixel. Uncovered pixels keep the initial flow.
+  void Densify(const double* a, const double* b, const of::Size& size, std::size_t patchSize,
+               const std::vector<std::size_t>& lines, const std::vector<std::size_t>& cols,
+               const std::vector<double>& pu, const std::vector<double>& pv,
+               std::vector<double>& u, std::vector<double>& v)
+  {
+    const Index nlines = size.nlines, ncols = size.ncols, ps = patchSize;
+
+    const std::size_t nbands = (size.nlines + sg_bandLines - 1) / sg_bandLines;
+
+    of::Parallel::forEach(nbands, [&](std::size_t band)
+    {
+      const Index first = band * sg_bandLines;
+      const Index last = std::min<Index>(nlines, first + sg_bandLines);
+
+      std::vector<double> su((last - first) * ncols, 0.0), sv(su.size(), 0.0), sw(su.size(), 0.0);
+
+      for(std::size_t i = 0; i < lines.size(); ++i)
+      {
+        const Index y0 = lines[i];
+        const Index l0 = std::max(first, y0), l1 = std::min(last, y0 + ps);
+
+        if(l0 >= l1)
+          continue;
+
+        for(std::size_t j = 0; j < cols.size(); ++j)
+        {
+          const Index x0 = cols[j];
+          const double du = pu[i * cols.size() + j], dv = pv[i * cols.size() + j];
+
+          for(Index lin = l0; lin < l1; ++lin)
+          {
+            for(Index col = x0; col < x0 + ps; ++col)
+            {
+              const double d = std::abs(Sample(b, nlines, ncols, lin + dv, col + du) - a[lin * ncols + col]);
+              const double w = 1.0 / std::max(1.0, d);
+
+              const Index k = (lin - first) * ncols + col;
+              su[k] += w * du;
+              sv[k] += w * dv;
+              sw[k] += w;
+            }
+          }
+        }
+      }
+
+      for(Index k = 0; k < Index(su.size()); ++k)
+      {
+        if(sw[k] > 0.0)
+        {
+          u[first * ncols + k] = su[k] / sw[k];
+          v[first * ncols + k] = sv[k] / sw[k];
+        }
+      }
+    });
+  }
+}
+
+of::DenseInverseSearch::DenseInverseSearch(Image* a, Image* b)
+  : OpticalFlow(a, b),
+    m_preset(makePreset(OF_DEFAULT_DIS_PRESET)),
+    m_coarsestLevel(0)
+{
+}
+
+of::DenseInverseSearch::~DenseInverseSearch()
+{
+}
+
+void of::DenseInverseSearch::compute()
+{
+  m_stats.clear();
+
+  Size size = m_imga->getSize();
+
+  StatsScope scope(m_stats, "compute", size.npixels);
+
+  const std::size_t coarsest = computeCoarsestLevel(size);
+  const std::size_t finest = std::min(m_preset.finestLevel, coarsest);
+
+  std::unique_ptr<Pyramid> pyra, pyrb;
+  {
+    StatsScope scope(m_stats, "pyramid", size.npixels * 2);
+
+    pyra.reset(new Pyramid(m_imga, coarsest));
+    pyrb.reset(new Pyramid(m_imgb, coarsest));
+
+    // The coarsest level builds the finer ones
+    pyra->getLevel(coarsest);
+    pyrb->getLevel(coarsest);
+
+    // The levels finer than the finest searched were only needed to build the coarser ones
+    for(std::size_t level = 0; level < finest; ++level)
+    {
+      pyra->release(level);
+      pyrb->release(level);
+    }
+  }
+
+  std::vector<double> u, v;
+  Size flowSize;
+
+  for(int level = coarsest; level >= int(finest); --level)
+  {
+    std::ostringstream levelName;
+    levelName << "level-" << level;
+
+    TraceScope trace(levelName.str(), "level");
+
+    Image* a = pyra->getLevel(level);
+    Image* b = pyrb->getLevel(level);
+
+    const Size lsize = a->getSize();
+
+    // Initial flow: the flow of the coarser level, or zero
+    std::vector<double> iu(lsize.npixels, 0.0), iv(lsize.npixels, 0.0);
+    if(!u.empty())
+    {
+      StatsScope scope(m_stats, "upsample", lsize.npixels * 2);
+
+      UpsampleFlow(u, flowSize, 2.0, lsize, iu);
+      UpsampleFlow(v, flowSize, 2.0, lsize, iv);
+    }
+
+    // Gradients of the first image (the template of each patch)
+    std::vector<double> gx(lsize.npixels), gy(lsize.npixels), gt(lsize.npixels);
+    {
+      StatsScope scope(m_stats, "gradients", lsize.npixels);
+
+      Kernels::derivatives(a->getBuffer(), a->getBuffer(), lsize.nlines, lsize.ncols, &gx[0], &gy[0], &gt[0]);
+    }
+
+    const std::vector<std::size_t> lines = GetPatchPositions(lsize.nlines, m_preset.patchSize, m_preset.patchStride);
+    const std::vector<std::size_t> cols = GetPatchPositions(lsize.ncols, m_preset.patchSize, m_preset.patchStride);
+
+    std::vector<double> pu, pv;
+    {
+      StatsScope scope(m_stats, "search", lsize.npixels);
+
+      SearchPatches(a->getBuffer(), b->getBuffer(), &gx[0], &gy[0], lsize, m_preset, lines, cols, iu, iv, pu, pv);
+    }
+
+    {
+      StatsScope scope(m_stats, "densification", lsize.npixels);
+
+      Densify(a->getBuffer(), b->getBuffer(), lsize, m_preset.patchSize, lines, cols, pu, pv, iu, iv);
+    }
+
+    u.swap(iu);
+    v.swap(iv);
+    flowSize = lsize;
+
+    m_stats.addCounter("patches", pu.size());
+
+    // The walk has moved past this level
+    pyra->release(level);
+    pyrb->release(level);
+  }
+
+  releaseResults();
+
+  m_u = new Image(size);
+  m_v = new Image(size);
+
+  // The finest level searched may be coarser than the images
+  if(finest != 0)
+  {
+    StatsScope scope(m_stats, "upsample", size.npixels * 2);
+
+    std::vector<double> fu, fv;
+    UpsampleFlow(u, flowSize, double(std::size_t(1) << finest), size, fu);
+    UpsampleFlow(v, flowSize, double(std::size_t(1) << finest), size, fv);
+
+    u.swap(fu);
+    v.swap(fv);
+  }
+
+  std::copy(u.begin(), u.end(), m_u->getBuffer());
+  std::copy(v.begin(), v.end(), m_v->getBuffer());
+
+  m_stats.setCounter("levels", coarsest - finest + 1);
+}
+
+void of::DenseInverseSearch::setPreset(const std::string& name)
+{
+  setPreset(makePreset(name));
+}
+
+void of::DenseInverseSearch::setPreset(const DISPreset& preset)
+{
+  if(preset.patchSize == 0 || preset.patchStride == 0)
+    throw Exception("The DIS patch size and stride must be positive");
+
+  m_preset = preset;
+}
+
+const of::DISPreset& of::DenseInverseSearch::getPreset() const
+{
+  return m_preset;
+}
+
+void of::DenseInverseSearch::setCoarsestLevel(std::size_t level)
+{
+  m_coarsestLevel = level;
+}
+
+void of::DenseInverseSearch::setMaxNumberOfIterations(std::size_t n)
+{
+  m_preset.iterations = n;
+}
+
+of::DISPreset of::DenseInverseSearch::makePreset(const std::string& name)
+{
+  DISPreset preset;
+
+  if(name == OF_DIS_ULTRAFAST_PRESET)
+  {
+    preset.patchSize = 8;
+    preset.patchStride = 6;
+    preset.iterations = 12;
+    preset.finestLevel = 2;
+  }
+  else if(name == OF_DIS_FAST_PRESET)
+  {
+    preset.patchSize = 8;
+    preset.patchStride = 4;
+    preset.iterations = 16;
+    preset.finestLevel = 1;
+  }
+  else if(name == OF_DIS_MEDIUM_PRESET)
+  {
+    preset.patchSize = 12;
+    preset.patchStride = 4;
+    preset.iterations = 25;
+    preset.finestLevel = 0;
+  }
+  else
+    throw Exception("Unknown DIS preset: " + name);
+
+  return preset;
+}
+
+std::vector<std::string> of::DenseInverseSearch::getPresets()
+{
+  std::vector<std::string> presets;
+  presets.push_back(OF_DIS_ULTRAFAST_PRESET);
+  presets.push_back(OF_DIS_FAST_PRESET);
+  presets.push_back(OF_DIS_MEDIUM_PRESET);
+
+  return presets;
+}
+
+std::size_t of::DenseInverseSearch::computeCoarsestLevel(const Size& size) const
+{
+  const std::size_t maxLevels = Pyramid::getMaxNumberOfLevels(size);
+
+  if(m_coarsestLevel != 0)
+    return std::min(m_coarsestLevel, maxLevels);
+
+  // Coarsest level with at least 2 patches along each dimension (level sizes as in Pyramid::down)
+  std::size_t level = 0;
+  Size lsize = size;
+
+  while(level < maxLevels)
+  {
+    Size next(lsize.nlines * 0.5, lsize.ncols * 0.5);
+
+    if(std::min(next.nlines, next.ncols) < 2 * m_preset.patchSize)
+      break;
+
+    lsize = next;
+    ++level;
+  }
+
+  return level;
+}
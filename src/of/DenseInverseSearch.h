@@ -0,0 +1,165 @@
+/*!
+  \file src/of/DenseInverseSearch.h
+
+  \brief This class implements the Dense Inverse Search (DIS) method for estimating optical flow.
+         Reference: T. Kroeger, R. Timofte, D. Dai and L. Van Gool (2016), Fast Optical Flow using Dense Inverse Search.
+                    European Conference on Computer Vision (ECCV), pages 471--488
+                    https://arxiv.org/abs/1603.03590
+
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_DENSE_INVERSE_SEARCH_H
+#define __OF_INTERNAL_DENSE_INVERSE_SEARCH_H
+
+#include "OpticalFlow.h"
+
+// STL
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  struct Size;
+
+  // Available Dense Inverse Search presets
+  const std::string OF_DIS_ULTRAFAST_PRESET = "ultrafast";
+  const std::string OF_DIS_FAST_PRESET = "fast";
+  const std::string OF_DIS_MEDIUM_PRESET = "medium";
+
+  /*!
+    \struct DISPreset
+
+    \brief Speed/quality parameters of Dense Inverse Search.
+
+    Presets, from the fastest to the most accurate:
+      - ultrafast: 8 x 8 patches every 6 pixels, 12 iterations, stops at level 2 (1/4 resolution).
+      - fast: 8 x 8 patches every 4 pixels, 16 iterations, stops at level 1 (1/2 resolution). (Default)
+      - medium: 12 x 12 patches every 4 pixels, 25 iterations, stops at level 0 (full resolution).
+  */
+  struct OFEXPORT DISPreset
+  {
+    std::size_t patchSize;   //!< Patch size. e.g. (8 = 8 x 8)
+    std::size_t patchStride; //!< Distance between neighbour patches. Patches overlap if it is less than the patch size.
+    std::size_t iterations;  //!< Maximum number of inverse compositional iterations per patch.
+    std::size_t finestLevel; //!< Finest pyramid level searched. The flow is upsampled from it to the full resolution.
+  };
+
+  /*!
+    \class DenseInverseSearch
+
+    \brief This class implements the Dense Inverse Search (DIS) method for estimating optical flow.
+
+    For each pyramid level, from the coarsest to the finest searched one:
+      - a grid of overlapping patches of the first image is aligned to the second image by
+        inverse compositional Lucas & Kanade, starting from the flow of the coarser level;
+      - the patch displacements are densified: the flow of each pixel is the average of the displacements
+        of the patches that cover it, weighted by their photometric error on that pixel.
+
+    The inverse compositional search keeps the Hessian of each patch fixed, so each iteration costs
+    one bilinear sampling of the patch. The patches are searched in parallel.
+
+    \note The variational refinement of the reference is not implemented.
+
+    \note The derivative images (getFx, getFy and getFt) are not computed.
+
+    \note The stats report the stages "pyramid", "gradients", "search", "densification" and "upsample",
+          accumulated over the levels.
+  */
+  class OFEXPORT DenseInverseSearch : public OpticalFlow
+  {
+    public:
+
+      /*!
+        \brief Constructor. It uses the 'fast' preset and the automatic number of levels.
+
+        \param a The first image.
+        \param b The second image.
+
+        \note The DenseInverseSearch will not take the ownership of the given images.
+      */
+      DenseInverseSearch(Image* a, Image* b);
+
+      /*! \brief Destructor. */
+      ~DenseInverseSearch();
+
+      void compute();
+
+      /*!
+        \brief This method sets the speed/quality parameters from a named preset.
+
+        \param name The preset name. (ultrafast, fast or medium)
+
+        \exception Exception It throws an exception if the preset is unknown.
+      */
+      void setPreset(const std::string& name);
+
+      /*!
+        \brief This method sets the speed/quality parameters.
+
+        \param preset The parameters.
+
+        \exception Exception It throws an exception if the patch size or the patch stride is 0.
+      */
+      void setPreset(const DISPreset& preset);
+
+      /*!
+        \brief This method returns the speed/quality parameters.
+
+        \return The speed/quality parameters.
+      */
+      const DISPreset& getPreset() const;
+
+      /*!
+        \brief This method sets the coarsest pyramid level searched.
+
+        \param level The coarsest level. 0 means automatic: the coarsest level whose size is at least 2 patches.
+      */
+      void setCoarsestLevel(std::size_t level);
+
+      /*!
+        \brief This methods sets the maximum number of iterations per patch, overriding the preset.
+
+        \param n The maximum number of iterations.
+      */
+      void setMaxNumberOfIterations(std::size_t n);
+
+      /*!
+        \brief This method returns the parameters of the given preset.
+
+        \param name The preset name. (ultrafast, fast or medium)
+
+        \exception Exception It throws an exception if the preset is unknown.
+
+        \return The preset parameters.
+      */
+      static DISPreset makePreset(const std::string& name);
+
+      /*!
+        \brief This method returns the names of the available presets.
+
+        \return The names of the available presets.
+      */
+      static std::vector<std::string> getPresets();
+
+    private:
+
+      /*!
+        \brief Internal method that returns the coarsest level searched for the given image size.
+
+        \param size The image size.
+
+        \return The coarsest level.
+      */
+      std::size_t computeCoarsestLevel(const Size& size) const;
+
+    private:
+
+      DISPreset m_preset;          //!< The speed/quality parameters.
+      std::size_t m_coarsestLevel; //!< The coarsest level searched. (0: automatic)
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_DENSE_INVERSE_SEARCH_H
@@ -0,0 +1,109 @@
+/*!
+  \file src/of/Evaluation.cpp
+  \brief This class compares estimated optical flow against ground truth.
+  \author Douglas Uba
+*/
+
+#include "Evaluation.h"
+#include "Exception.h"
+#include "Image.h"
+#include "Parallel.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // Partial sums of a line band
+  struct Sums
+  {
+    Sums() : epe(0.0), ae(0.0), outliers(0), npixels(0) {}
+
+    double epe;
+    double ae;
+    std::size_t outliers;
+    std::size_t npixels;
+  };
+
+  bool IsKnown(double u, double v)
+  {
+    return !std::isnan(u) && !std::isnan(v) && std::abs(u) <= 1e9 && std::abs(v) <= 1e9;
+  }
+}
+
+of::FlowError of::Evaluation::compare(const Image* u, const Image* v, const Image* gu, const Image* gv, std::size_t border)
+{
+  Size size = gu->getSize();
+
+  if(u->getSize() != size || v->getSize() != size || gv->getSize() != size)
+    throw Exception("The flow images must be the same size");
+
+  FlowError error;
+
+  if(2 * border >= size.nlines || 2 * border >= size.ncols)
+    return error;
+
+  std::size_t l0 = border, l1 = size.nlines - border;
+  std::size_t c0 = border, c1 = size.ncols - border;
+
+  // Fixed number of bands (independent of the number of threads)
+  std::size_t nbands = std::min<std::size_t>(64, l1 - l0);
+  std::vector<Sums> sums(nbands);
+
+  Parallel::forEach(nbands, [&](std::size_t band)
+  {
+    Sums& s = sums[band];
+
+    std::size_t first = l0 + band * (l1 - l0) / nbands;
+    std::size_t last = l0 + (band + 1) * (l1 - l0) / nbands;
+
+    for(std::size_t lin = first; lin < last; ++lin)
+    {
+      for(std::size_t col = c0; col < c1; ++col)
+      {
+        std::size_t i = gu->index(lin, col);
+
+        double tu = gu->getPixel(i);
+        double tv = gv->getPixel(i);
+
+        if(!IsKnown(tu, tv))
+          continue;
+
+        double eu = u->getPixel(i);
+        double ev = v->getPixel(i);
+
+        double epe = std::sqrt((eu - tu) * (eu - tu) + (ev - tv) * (ev - tv));
+
+        double cosine = (eu * tu + ev * tv + 1.0) / std::sqrt((eu * eu + ev * ev + 1.0) * (tu * tu + tv * tv + 1.0));
+
+        s.epe += epe;
+        s.ae += std::acos(std::max(-1.0, std::min(1.0, cosine)));
+        s.outliers += epe > OF_EVALUATION_OUTLIER_EPE ? 1 : 0;
+        s.npixels += 1;
+      }
+    }
+  });
+
+  Sums total;
+  for(std::size_t i = 0; i < nbands; ++i)
+  {
+    total.epe += sums[i].epe;
+    total.ae += sums[i].ae;
+    total.outliers += sums[i].outliers;
+    total.npixels += sums[i].npixels;
+  }
+
+  if(total.npixels == 0)
+    return error;
+
+  const double pi = 3.14159265358979323846;
+
+  error.epe = total.epe / total.npixels;
+  error.ae = total.ae / total.npixels * 180.0 / pi;
+  error.outliers = double(total.outliers) / total.npixels;
+  error.npixels = total.npixels;
+
+  return error;
+}
@@ -0,0 +1,72 @@
+/*!
+  \file src/of/Evaluation.h
+  \brief This class compares estimated optical flow against ground truth.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_EVALUATION_H
+#define __OF_INTERNAL_EVALUATION_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+
+  /*!
+    \struct FlowError
+
+    \brief Simple struct that represents the error of an estimated flow.
+  */
+  struct OFEXPORT FlowError
+  {
+    /*! \brief Default constructor. */
+    FlowError() : epe(0.0), ae(0.0), outliers(0.0), npixels(0) {}
+
+    double epe;          //!< Average endpoint error, in pixels.
+    double ae;           //!< Average angular error, in degrees.
+    double outliers;     //!< Fraction of pixels with endpoint error greater than OF_EVALUATION_OUTLIER_EPE.
+    std::size_t npixels; //!< Number of evaluated pixels.
+  };
+
+  /*!
+    \class Evaluation
+
+    \brief This class compares estimated optical flow against ground truth.
+
+    Errors follow the Middlebury evaluation (Baker et al., "A Database and Evaluation Methodology for Optical Flow", 2011):
+      - endpoint error: ||(u, v) - (gu, gv)||;
+      - angular error: the angle between (u, v, 1) and (gu, gv, 1).
+
+    Pixels with unknown ground truth (i.e. NaN or magnitude greater than 1e9, as OF_FLOW_UNKNOWN_VALUE) are ignored.
+
+    \note The sums are computed in parallel, by line bands (see Parallel), and reduced in a fixed order,
+          so the result does not depend on the number of threads.
+  */
+  class OFEXPORT Evaluation
+  {
+    public:
+
+      /*!
+        \brief This method computes the error of the estimated (u,v) against the ground truth (gu,gv).
+
+        \param u The estimated u coordinates.
+        \param v The estimated v coordinates.
+        \param gu The ground truth u coordinates.
+        \param gv The ground truth v coordinates.
+        \param border Number of border pixels that will be ignored.
+
+        \exception Exception It throws an exception if the images have different sizes.
+
+        \return The flow error.
+      */
+      static FlowError compare(const Image* u, const Image* v, const Image* gu, const Image* gv, std::size_t border = 0);
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_EVALUATION_H
@@ -0,0 +1,226 @@
+/*!
+  \file src/of/FFT.cpp
+  \brief Radix-2 fast Fourier transform and FFT-based convolution.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "FFT.h"
+#include "Parallel.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+  typedef std::complex<double> Complex;
+
+  // Complex product without the checks of std::complex operator* for infinities (which are not inlined)
+  inline Complex Multiply(const Complex& a, const Complex& b)
+  {
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+  }
+
+  // Tile size (a power of two) of the overlap-save FFT convolution along one dimension
+  std::size_t GetTileSize(std::size_t ksize, std::size_t size)
+  {
+    // At least twice the kernel size, so that at least half of each tile is valid output
+    std::size_t tile = std::max<std::size_t>(OF_FFT_TILE_SIZE, of::FFT::nextPowerOfTwo(2 * ksize));
+
+    // Never larger than the image (plus the kernel) needs
+    return std::min(tile, of::FFT::nextPowerOfTwo(size));
+  }
+
+}
+
+of::FFT::FFT(std::size_t n)
+  : m_n(n)
+{
+  if(!isPowerOfTwo(n))
+    throw Exception("The FFT size must be a power of two");
+
+  std::size_t nbits = 0;
+  while((std::size_t(1) << nbits) < n)
+    ++nbits;
+
+  m_reversed.resize(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    std::size_t r = 0;
+    for(std::size_t b = 0; b < nbits; ++b)
+      r |= ((i >> b) & 1) << (nbits - 1 - b);
+    m_reversed[i] = r;
+  }
+
+  const double pi = std::acos(-1.0);
+
+  m_twiddles.resize(n / 2);
+  m_itwiddles.resize(n / 2);
+  for(std::size_t k = 0; k < n / 2; ++k)
+  {
+    const double angle = -2.0 * pi * k / n;
+    m_twiddles[k] = Complex(std::cos(angle), std::sin(angle));
+    m_itwiddles[k] = std::conj(m_twiddles[k]);
+  }
+}
+
+of::FFT::~FFT()
+{
+}
+
+std::size_t of::FFT::getSize() const
+{
+  return m_n;
+}
+
+void of::FFT::forward(std::complex<double>* data) const
+{
+  transform(data, m_twiddles);
+}
+
+void of::FFT::inverse(std::complex<double>* data) const
+{
+  transform(data, m_itwiddles);
+
+  const double scale = 1.0 / m_n;
+  for(std::size_t i = 0; i < m_n; ++i)
+    data[i] *= scale;
+}
+
+bool of::FFT::isPowerOfTwo(std::size_t n)
+{
+  return n != 0 && (n & (n - 1)) == 0;
+}
+
+std::size_t of::FFT::nextPowerOfTwo(std::size_t n)
+{
+  std::size_t p = 1;
+  while(p < n)
+    p <<= 1;
+  return p;
+}
+
+void of::FFT::transform2D(std::complex<double>* data, const FFT& rowFFT, const FFT& columnFFT, bool inverse)
+{
+  const std::size_t nlines = columnFFT.getSize(), ncols = rowFFT.getSize();
+
+  for(std::size_t lin = 0; lin < nlines; ++lin)
+    inverse ? rowFFT.inverse(data + lin * ncols) : rowFFT.forward(data + lin * ncols);
+
+  std::vector<Complex> column(nlines);
+
+  for(std::size_t col = 0; col < ncols; ++col)
+  {
+    for(std::size_t lin = 0; lin < nlines; ++lin)
+      column[lin] = data[lin * ncols + col];
+
+    inverse ? columnFFT.inverse(&column[0]) : columnFFT.forward(&column[0]);
+
+    for(std::size_t lin = 0; lin < nlines; ++lin)
+      data[lin * ncols + col] = column[lin];
+  }
+}
+
+void of::FFT::filter2D(const double* src, std::size_t nlines, std::size_t ncols,
+                       const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst)
+{
+  assert(kwidth % 2 == 1 && kheight % 2 == 1);
+
+  if(nlines < kheight || ncols < kwidth)
+    return; // No interior pixels
+
+  const std::size_t rh = kheight / 2, rw = kwidth / 2;
+
+  // Tiles: each one gives (th - kheight + 1) x (tw - kwidth + 1) interior pixels
+  const std::size_t th = GetTileSize(kheight, nlines), tw = GetTileSize(kwidth, ncols);
+  const std::size_t stepLines = th - kheight + 1, stepCols = tw - kwidth + 1;
+  const std::size_t ntl = (nlines - kheight + stepLines) / stepLines;
+  const std::size_t ntc = (ncols - kwidth + stepCols) / stepCols;
+  const std::size_t ntiles = ntl * ntc;
+
+  const FFT rowFFT(tw), columnFFT(th);
+
+  // Spectrum of the flipped kernel: the circular convolution of a tile gives the correlation of Image::filter2D
+  std::vector<Complex> spectrum(th * tw);
+
+  for(std::size_t i = 0; i < kheight; ++i)
+    for(std::size_t j = 0; j < kwidth; ++j)
+      spectrum[i * tw + j] = kernel[(kheight - 1 - i) * kwidth + (kwidth - 1 - j)];
+
+  transform2D(&spectrum[0], rowFFT, columnFFT, false);
+
+  // Two real tiles are transformed at once, as the real and imaginary parts of one complex tile.
+  // The kernel is real, so the parts of the result are the filtered tiles.
+  Parallel::forEach((ntiles + 1) / 2, [&](std::size_t pair)
+  {
+    std::vector<Complex> tile(th * tw);
+
+    const std::size_t tiles[] = { 2 * pair, 2 * pair + 1 };
+
+    for(std::size_t part = 0; part < 2 && tiles[part] < ntiles; ++part)
+    {
+      const std::size_t lin0 = (tiles[part] / ntc) * stepLines, col0 = (tiles[part] % ntc) * stepCols;
+      const std::size_t nl = std::min(th, nlines - lin0), nc = std::min(tw, ncols - col0);
+
+      for(std::size_t lin = 0; lin < nl; ++lin)
+      {
+        const double* in = src + (lin0 + lin) * ncols + col0;
+        Complex* out = &tile[lin * tw];
+
+        for(std::size_t col = 0; col < nc; ++col)
+          out[col] = part == 0 ? Complex(in[col], out[col].imag()) : Complex(out[col].real(), in[col]);
+      }
+    }
+
+    transform2D(&tile[0], rowFFT, columnFFT, false);
+
+    for(std::size_t i = 0; i < tile.size(); ++i)
+      tile[i] = Multiply(tile[i], spectrum[i]);
+
+    transform2D(&tile[0], rowFFT, columnFFT, true);
+
+    // The valid outputs are the tile values (p, q) with p >= kheight - 1 and q >= kwidth - 1,
+    // i.e. the pixel (lin0 + p - rh, col0 + q - rw) of the image.
+    for(std::size_t part = 0; part < 2 && tiles[part] < ntiles; ++part)
+    {
+      const std::size_t lin0 = (tiles[part] / ntc) * stepLines, col0 = (tiles[part] % ntc) * stepCols;
+      const std::size_t nl = std::min(stepLines, nlines - kheight + 1 - lin0);
+      const std::size_t nc = std::min(stepCols, ncols - kwidth + 1 - col0);
+
+      for(std::size_t lin = 0; lin < nl; ++lin)
+      {
+        const Complex* in = &tile[(lin + kheight - 1) * tw + kwidth - 1];
+        double* out = dst + (lin0 + lin + rh) * ncols + col0 + rw;
+
+        for(std::size_t col = 0; col < nc; ++col)
+          out[col] = part == 0 ? in[col].real() : in[col].imag();
+      }
+    }
+  });
+}
+
+void of::FFT::transform(std::complex<double>* data, const std::vector<std::complex<double> >& twiddles) const
+{
+  for(std::size_t i = 0; i < m_n; ++i)
+    if(i < m_reversed[i])
+      std::swap(data[i], data[m_reversed[i]]);
+
+  for(std::size_t len = 2; len <= m_n; len <<= 1)
+  {
+    const std::size_t half = len / 2, step = m_n / len;
+
+    for(std::size_t i = 0; i < m_n; i += len)
+    {
+      for(std::size_t j = 0; j < half; ++j)
+      {
+        const Complex u = data[i + j];
+        const Complex v = Multiply(data[i + j + half], twiddles[j * step]);
+
+        data[i + j] = u + v;
+        data[i + j + half] = u - v;
+      }
+    }
+  }
+}
@@ -0,0 +1,126 @@
+/*!
+  \file src/of/FFT.h
+  \brief Radix-2 fast Fourier transform and FFT-based convolution.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_FFT_H
+#define __OF_INTERNAL_FFT_H
+
+#include "Config.h"
+
+// STL
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace of
+{
+  /*!
+    \class FFT
+
+    \brief Radix-2 fast Fourier transform of a fixed size, and FFT-based 2D convolution.
+
+    The constructor precomputes the twiddle factors and the bit-reversal permutation,
+    so that a FFT object can be reused for many transforms of the same size.
+  */
+  class OFEXPORT FFT
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param n The transform size. It must be a power of two.
+
+        \exception Exception It will throw an exception if n is not a power of two.
+      */
+      FFT(std::size_t n);
+
+      /*! \brief Destructor. */
+      ~FFT();
+
+      /*!
+        \brief This method returns the transform size.
+
+        \return The transform size.
+      */
+      std::size_t getSize() const;
+
+      /*!
+        \brief This method computes the forward transform of the given values, in place.
+
+        \param data The n complex values.
+      */
+      void forward(std::complex<double>* data) const;
+
+      /*!
+        \brief This method computes the inverse transform of the given values, in place. The result is divided by n.
+
+        \param data The n complex values.
+      */
+      void inverse(std::complex<double>* data) const;
+
+      /*!
+        \brief This method checks if the given number is a power of two.
+
+        \param n The number.
+
+        \return True if n is a power of two.
+      */
+      static bool isPowerOfTwo(std::size_t n);
+
+      /*!
+        \brief This method returns the smallest power of two greater than or equal to the given number.
+
+        \param n The number.
+
+        \return The power of two.
+      */
+      static std::size_t nextPowerOfTwo(std::size_t n);
+
+      /*!
+        \brief This method computes the 2D transform of the given values, in place: the rows, then the columns.
+
+        \param data The values, with columnFFT.getSize() lines x rowFFT.getSize() columns.
+        \param rowFFT The transform of the lines.
+        \param columnFFT The transform of the columns.
+        \param inverse True for the inverse transform. (divided by the number of values)
+      */
+      static void transform2D(std::complex<double>* data, const FFT& rowFFT, const FFT& columnFFT, bool inverse);
+
+      /*!
+        \brief This method computes the same correlation of Image::filter2D, using overlap-save FFT tiles.
+
+        Only the interior pixels, i.e. the pixels whose whole kernel window is inside the image, are computed.
+        The other pixels of dst are not modified. The tiles are processed in parallel.
+
+        \param src The input image, with nlines x ncols values.
+        \param nlines The number of lines.
+        \param ncols The number of columns.
+        \param kernel The kernel values, with kwidth x kheight values. The kernel sizes must be odd.
+        \param kwidth The kernel width.
+        \param kheight The kernel height.
+        \param dst The output image, with nlines x ncols values.
+
+        \note The results differ from the direct computation by rounding errors only (about 1e-12, relative to the image values).
+      */
+      static void filter2D(const double* src, std::size_t nlines, std::size_t ncols,
+                           const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst);
+
+    private:
+
+      /*! \brief Computes the transform in place, with the given twiddle factors. */
+      void transform(std::complex<double>* data, const std::vector<std::complex<double> >& twiddles) const;
+
+    private:
+
+      std::size_t m_n;                                    //!< The transform size.
+      std::vector<std::size_t> m_reversed;                //!< The bit-reversal permutation.
+      std::vector<std::complex<double> > m_twiddles;      //!< The forward twiddle factors. (n / 2 values)
+      std::vector<std::complex<double> > m_itwiddles;     //!< The inverse twiddle factors. (n / 2 values)
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_FFT_H
@@ -0,0 +1,91 @@
+/*!
+  \file src/of/FixedPoint.cpp
+  \brief Fixed-point (integer) representation of images, used by the integer fast paths.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "FixedPoint.h"
+#include "Image.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+of::FixedPoint::FixedPoint(const Image* a, const Image* b, std::size_t bits)
+  : m_offset(0.0),
+    m_scale(1.0),
+    m_max(0.0)
+{
+  if(bits == 0 || bits > OF_FIXED_MAX_BITS)
+    throw Exception("The number of fixed-point bits is out of range");
+
+  m_max = double((1 << bits) - 1);
+
+  const std::size_t n = a->getNPixels();
+  if(n == 0)
+    return;
+
+  const double* pa = a->getBuffer();
+  const double* pb = b->getBuffer();
+
+  const double lo = std::min(*std::min_element(pa, pa + n), *std::min_element(pb, pb + b->getNPixels()));
+  const double hi = std::max(*std::max_element(pa, pa + n), *std::max_element(pb, pb + b->getNPixels()));
+
+  m_offset = lo;
+
+  // Largest power of two that keeps the range inside the fixed-point values
+  if(hi > lo)
+    m_scale = std::pow(2.0, std::floor(std::log2(m_max / (hi - lo))));
+
+  if((hi - lo) * m_scale > m_max)
+    m_scale *= 0.5;
+}
+
+double of::FixedPoint::getScale() const
+{
+  return m_scale;
+}
+
+double of::FixedPoint::getOffset() const
+{
+  return m_offset;
+}
+
+void of::FixedPoint::quantize(const Image* image, std::vector<std::int16_t>& values) const
+{
+  const std::size_t n = image->getNPixels();
+  const double* src = image->getBuffer();
+
+  values.resize(n);
+
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    const double q = std::floor((src[i] - m_offset) * m_scale + 0.5);
+    values[i] = std::int16_t(std::max(0.0, std::min(m_max, q)));
+  }
+}
+
+std::size_t of::FixedPoint::getWindowSumBits(std::size_t ksize)
+{
+  const double limit = 2147483647.0;
+
+  for(std::size_t bits = OF_FIXED_MAX_BITS; bits > 0; --bits)
+  {
+    const double derivative = 4.0 * ((1 << bits) - 1);
+    if(double(ksize) * ksize * derivative * derivative <= limit)
+      return bits;
+  }
+
+  return 0;
+}
+
+std::vector<std::string> of::FixedPoint::getPrecisions()
+{
+  std::vector<std::string> precisions;
+  precisions.push_back(OF_DOUBLE_PRECISION);
+  precisions.push_back(OF_FIXED_PRECISION);
+  precisions.push_back(OF_MIXED_PRECISION);
+
+  return precisions;
+}
@@ -0,0 +1,100 @@
+/*!
+  \file src/of/FixedPoint.h
+  \brief Fixed-point (integer) representation of images, used by the integer fast paths.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_FIXED_POINT_H
+#define __OF_INTERNAL_FIXED_POINT_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+
+  // Available arithmetic precisions
+  const std::string OF_DOUBLE_PRECISION = "double";
+  const std::string OF_FIXED_PRECISION = "fixed";
+  const std::string OF_MIXED_PRECISION = "mixed";
+
+  /*!
+    \class FixedPoint
+
+    \brief Fixed-point (integer) representation of a pair of images.
+
+    The values are mapped to q = round((x - offset) * scale), in [0, 2^bits - 1], where the offset is the minimum
+    of both images and the scale is a power of two. Integer images (e.g. 8-bit) are exact while their range fits
+    in the given bits. Wider images (e.g. 16-bit) lose their lowest bits.
+  */
+  class OFEXPORT FixedPoint
+  {
+    public:
+
+      /*!
+        \brief Constructor. It computes the representation from the range of both images.
+
+        \param a The first image.
+        \param b The second image.
+        \param bits The number of bits of the fixed-point values, in [1, OF_FIXED_MAX_BITS].
+
+        \exception Exception It throws an exception if the number of bits is out of range.
+      */
+      FixedPoint(const Image* a, const Image* b, std::size_t bits);
+
+      /*!
+        \brief This method returns the scale. i.e. the number of fixed-point units per intensity unit.
+
+        \return The scale.
+      */
+      double getScale() const;
+
+      /*!
+        \brief This method returns the offset, in intensity units.
+
+        \return The offset.
+      */
+      double getOffset() const;
+
+      /*!
+        \brief This method converts the given image to fixed-point values.
+
+        \param image The image.
+        \param values The fixed-point values, one per pixel.
+      */
+      void quantize(const Image* image, std::vector<std::int16_t>& values) const;
+
+      /*!
+        \brief This method returns the number of bits whose Lucas & Kanade window sums fit in 32 bits.
+               i.e. the largest one, up to OF_FIXED_MAX_BITS, such that ksize^2 * (4 * (2^bits - 1))^2 < 2^31.
+
+        \param ksize The window size.
+
+        \return The number of bits, or 0 if the window is too large.
+      */
+      static std::size_t getWindowSumBits(std::size_t ksize);
+
+      /*!
+        \brief This method returns the names of the available precisions.
+
+        \return The names of the available precisions.
+      */
+      static std::vector<std::string> getPrecisions();
+
+    private:
+
+      double m_offset; //!< The offset, in intensity units.
+      double m_scale;  //!< The scale, a power of two.
+      double m_max;    //!< The largest fixed-point value.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_FIXED_POINT_H
@@ -0,0 +1,496 @@
+/*!
+  \file src/of/FlowFile.cpp
+  \brief This class reads and writes optical flow (u,v) files.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "FlowFile.h"
+#include "Image.h"
+
+// STL
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+  // Magic numbers
+  const char FLO_MAGIC[] = "PIEH";
+  const char OFZ_MAGIC[] = "OFZ1";
+
+  // Size of .ofz header: magic + ncols + nlines + scale + payload size
+  const std::size_t OFZ_HEADER_SIZE = 20;
+
+  // Reserved fixed-point code for unknown flow values
+  const int32_t UNKNOWN_CODE = -32768;
+
+  // Unknown flow threshold (Middlebury convention)
+  const double UNKNOWN_THRESHOLD = 1e9;
+
+  // Golomb-Rice escape: quotients greater or equal to this limit are followed by the raw residual
+  const uint32_t RICE_LIMIT = 24;
+  const uint32_t RICE_RAW_BITS = 17;
+
+  // Adaptive Golomb-Rice context reset (LOCO-I)
+  const uint32_t RICE_RESET = 64;
+
+  void PutInt32(std::vector<unsigned char>& out, uint32_t v)
+  {
+    out.push_back(v & 0xFF);
+    out.push_back((v >> 8) & 0xFF);
+    out.push_back((v >> 16) & 0xFF);
+    out.push_back((v >> 24) & 0xFF);
+  }
+
+  uint32_t GetInt32(const unsigned char* p)
+  {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
+
+  inline unsigned int CountTrailingOnes(uint64_t v)
+  {
+#if defined(__GNUC__)
+    return ~v == 0 ? 64 : __builtin_ctzll(~v);
+#else
+    unsigned int n = 0;
+    while(v & 1) { v >>= 1; ++n; }
+    return n;
+#endif
+  }
+
+  inline int32_t Quantize(double value, double scale)
+  {
+    if(!(std::abs(value) < UNKNOWN_THRESHOLD)) // Note: NaN goes here too
+      return UNKNOWN_CODE;
+
+    double q = std::floor(value * scale + 0.5);
+
+    if(q > 32767.0) return 32767;
+    if(q < -32767.0) return -32767;
+
+    return int32_t(q);
+  }
+
+  inline double Dequantize(int32_t code, double scale)
+  {
+    return code == UNKNOWN_CODE ? OF_FLOW_UNKNOWN_VALUE : code / scale;
+  }
+
+  // LOCO-I median edge detector. a: left, b: up, c: up-left
+  inline int32_t Predict(int32_t a, int32_t b, int32_t c)
+  {
+    int32_t mn = a < b ? a : b;
+    int32_t mx = a < b ? b : a;
+
+    if(c >= mx) return mn;
+    if(c <= mn) return mx;
+
+    return a + b - c;
+  }
+
+  // Prediction for the given column of the current row
+  inline int32_t Predict(const int32_t* cur, const int32_t* prev, std::size_t col, bool firstLine)
+  {
+    if(firstLine)
+      return col == 0 ? 0 : cur[col - 1];
+
+    if(col == 0)
+      return prev[0];
+
+    return Predict(cur[col - 1], prev[col], prev[col - 1]);
+  }
+
+  /*! Adaptive Golomb-Rice parameter estimation (one context for each flow component). */
+  struct RiceContext
+  {
+    RiceContext() : a(4), n(1) {}
+
+    unsigned int k() const
+    {
+      unsigned int k = 0;
+      while((n << k) < a)
+        ++k;
+      return k;
+    }
+
+    void update(uint32_t z)
+    {
+      a += z;
+      if(++n == RICE_RESET)
+      {
+        a >>= 1;
+        n >>= 1;
+      }
+    }
+
+    uint32_t a; //!< Accumulated residuals.
+    uint32_t n; //!< Number of residuals.
+  };
+
+  /*! LSB-first bit writer. */
+  class BitWriter
+  {
+    public:
+
+      explicit BitWriter(std::vector<unsigned char>& out) : m_out(out), m_acc(0), m_nbits(0) {}
+
+      void put(uint32_t value, unsigned int n)
+      {
+        m_acc |= uint64_t(value) << m_nbits;
+        m_nbits += n;
+
+        while(m_nbits >= 8)
+        {
+          m_out.push_back((unsigned char)(m_acc & 0xFF));
+          m_acc >>= 8;
+          m_nbits -= 8;
+        }
+      }
+
+      void flush()
+      {
+        if(m_nbits > 0)
+          m_out.push_back((unsigned char)(m_acc & 0xFF));
+        m_acc = 0;
+        m_nbits = 0;
+      }
+
+    private:
+
+      std::vector<unsigned char>& m_out;
+      uint64_t m_acc;
+      unsigned int m_nbits;
+  };
+
+  /*! LSB-first bit reader. Reading past the end yields zero bits. */
+  class BitReader
+  {
+    public:
+
+      BitReader(const unsigned char* data, std::size_t size) : m_data(data), m_end(data + size), m_acc(0), m_nbits(0) {}
+
+      void refill()
+      {
+        while(m_nbits <= 56 && m_data < m_end)
+        {
+          m_acc |= uint64_t(*m_data++) << m_nbits;
+          m_nbits += 8;
+        }
+      }
+
+      uint64_t bits() const { return m_acc; }
+
+      void skip(unsigned int n) { m_acc >>= n; m_nbits = n > m_nbits ? 0 : m_nbits - n; }
+
+      uint32_t get(unsigned int n)
+      {
+        uint32_t v = uint32_t(m_acc & ((uint64_t(1) << n) - 1));
+        skip(n);
+        return v;
+      }
+
+    private:
+
+      const unsigned char* m_data;
+      const unsigned char* m_end;
+      uint64_t m_acc;
+      unsigned int m_nbits;
+  };
+
+  inline void EncodeResidual(BitWriter& writer, RiceContext& ctx, int32_t r)
+  {
+    uint32_t z = (uint32_t(r) << 1) ^ uint32_t(r >> 31); // zigzag
+
+    unsigned int k = ctx.k();
+    uint32_t q = z >> k;
+
+    if(q < RICE_LIMIT)
+    {
+      writer.put((1u << q) - 1, q + 1); // unary quotient + stop bit
+      writer.put(z & ((1u << k) - 1), k);
+    }
+    else
+    {
+      writer.put((1u << RICE_LIMIT) - 1, RICE_LIMIT); // escape
+      writer.put(z, RICE_RAW_BITS);
+    }
+
+    ctx.update(z);
+  }
+
+  inline int32_t DecodeResidual(BitReader& reader, RiceContext& ctx)
+  {
+    reader.refill();
+
+    unsigned int k = ctx.k();
+    unsigned int q = CountTrailingOnes(reader.bits());
+
+    uint32_t z;
+    if(q < RICE_LIMIT)
+    {
+      reader.skip(q + 1);
+      z = (q << k) | reader.get(k);
+    }
+    else
+    {
+      reader.skip(RICE_LIMIT);
+      z = reader.get(RICE_RAW_BITS);
+    }
+
+    ctx.update(z);
+
+    return int32_t(z >> 1) ^ -int32_t(z & 1); // inverse zigzag
+  }
+}
+
+void of::FlowFile::save(const std::string& path, const Image* u, const Image* v)
+{
+  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file)
+    throw Exception("Could not create the flow file: " + path);
+
+  // Write 'magic number'
+  file.write(FLO_MAGIC, 4);
+
+  // Get (u,v) dimension
+  int32_t nlines = int32_t(u->getNLines());
+  int32_t ncols  = int32_t(u->getNCols());
+
+  // Write number of columns and number of lines
+  file.write((const char*)&ncols, sizeof(int32_t));
+  file.write((const char*)&nlines, sizeof(int32_t));
+
+  const double* ubuffer = u->getBuffer();
+  const double* vbuffer = v->getBuffer();
+
+  // Write values for u and v, interleaved, in row order
+  std::vector<float> row(2 * ncols);
+  for(std::size_t lin = 0, i = 0; lin < std::size_t(nlines); ++lin)
+  {
+    for(std::size_t col = 0; col < std::size_t(ncols); ++col, ++i)
+    {
+      row[2 * col] = float(ubuffer[i]);
+      row[2 * col + 1] = float(vbuffer[i]);
+    }
+    if(ncols != 0)
+      file.write((const char*)&row[0], row.size() * sizeof(float));
+  }
+
+  if(!file)
+    throw Exception("Could not write the flow file: " + path);
+}
+
+of::FlowFileWriter::FlowFileWriter(const std::string& path)
+  : m_path(path)
+{
+}
+
+void of::FlowFileWriter::begin(const Size& size)
+{
+  m_file.open(m_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!m_file)
+    throw Exception("Could not create the flow file: " + m_path);
+
+  // Write 'magic number'
+  m_file.write(FLO_MAGIC, 4);
+
+  // Write number of columns and number of lines
+  int32_t nlines = int32_t(size.nlines);
+  int32_t ncols  = int32_t(size.ncols);
+
+  m_file.write((const char*)&ncols, sizeof(int32_t));
+  m_file.write((const char*)&nlines, sizeof(int32_t));
+
+  m_row.resize(2 * size.ncols);
+}
+
+void of::FlowFileWriter::write(std::size_t /*lin*/, const double* u, const double* v)
+{
+  const std::size_t ncols = m_row.size() / 2;
+
+  for(std::size_t col = 0; col < ncols; ++col)
+  {
+    m_row[2 * col] = float(u[col]);
+    m_row[2 * col + 1] = float(v[col]);
+  }
+
+  if(ncols != 0)
+    m_file.write((const char*)&m_row[0], m_row.size() * sizeof(float));
+}
+
+void of::FlowFileWriter::end()
+{
+  m_file.close();
+
+  if(!m_file)
+    throw Exception("Could not write the flow file: " + m_path);
+}
+
+void of::FlowFile::saveCompressed(const std::string& path, const Image* u, const Image* v, double scale)
+{
+  std::vector<unsigned char> data;
+  encode(u, v, scale, data);
+
+  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!file)
+    throw Exception("Could not create the flow file: " + path);
+
+  file.write((const char*)&data[0], data.size());
+
+  if(!file)
+    throw Exception("Could not write the flow file: " + path);
+}
+
+void of::FlowFile::load(const std::string& path, Image*& u, Image*& v)
+{
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if(!file)
+    throw Exception("Could not open the flow file: " + path);
+
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  if(data.size() >= 4 && std::memcmp(&data[0], OFZ_MAGIC, 4) == 0)
+  {
+    decode(&data[0], data.size(), u, v);
+    return;
+  }
+
+  if(data.size() < 12 || std::memcmp(&data[0], FLO_MAGIC, 4) != 0)
+    throw Exception("Invalid flow file: " + path);
+
+  std::size_t ncols = GetInt32(&data[4]);
+  std::size_t nlines = GetInt32(&data[8]);
+
+  if(data.size() < 12 + nlines * ncols * 2 * sizeof(float))
+    throw Exception("Truncated flow file: " + path);
+
+  u = new Image(nlines, ncols);
+  v = new Image(nlines, ncols);
+
+  const float* values = (const float*)&data[12];
+  double* ubuffer = u->getBuffer();
+  double* vbuffer = v->getBuffer();
+
+  for(std::size_t i = 0; i < nlines * ncols; ++i)
+  {
+    ubuffer[i] = values[2 * i];
+    vbuffer[i] = values[2 * i + 1];
+  }
+}
+
+void of::FlowFile::encode(const Image* u, const Image* v, double scale, std::vector<unsigned char>& out)
+{
+  if(u->getSize() != v->getSize())
+    throw Exception("The (u,v) images must be the same size");
+
+  if(!(scale > 0.0))
+    throw Exception("The flow scale factor must be positive");
+
+  std::size_t nlines = u->getNLines();
+  std::size_t ncols = u->getNCols();
+
+  // Header
+  std::size_t start = out.size();
+  out.insert(out.end(), OFZ_MAGIC, OFZ_MAGIC + 4);
+  PutInt32(out, uint32_t(ncols));
+  PutInt32(out, uint32_t(nlines));
+  float fscale = float(scale);
+  uint32_t iscale; std::memcpy(&iscale, &fscale, sizeof(float));
+  PutInt32(out, iscale);
+  PutInt32(out, 0); // payload size (updated below)
+
+  std::size_t payload = out.size();
+  out.reserve(payload + nlines * ncols); // about 4 bits per component on smooth fields
+
+  // Quantized rows (current and previous) for u and v
+  std::vector<int32_t> rows(4 * ncols, 0);
+  int32_t* ucur = rows.data(); // null (never dereferenced) when ncols == 0
+  int32_t* uprev = ucur + ncols;
+  int32_t* vcur = uprev + ncols;
+  int32_t* vprev = vcur + ncols;
+
+  RiceContext uctx, vctx;
+  BitWriter writer(out);
+
+  const double* ubuffer = u->getBuffer();
+  const double* vbuffer = v->getBuffer();
+
+  for(std::size_t lin = 0; lin < nlines; ++lin)
+  {
+    const double* urow = ubuffer + lin * ncols;
+    const double* vrow = vbuffer + lin * ncols;
+
+    for(std::size_t col = 0; col < ncols; ++col)
+    {
+      ucur[col] = Quantize(urow[col], scale);
+      vcur[col] = Quantize(vrow[col], scale);
+
+      EncodeResidual(writer, uctx, ucur[col] - Predict(ucur, uprev, col, lin == 0));
+      EncodeResidual(writer, vctx, vcur[col] - Predict(vcur, vprev, col, lin == 0));
+    }
+
+    std::swap(ucur, uprev);
+    std::swap(vcur, vprev);
+  }
+
+  writer.flush();
+
+  // Update payload size
+  uint32_t size = uint32_t(out.size() - payload);
+  for(std::size_t i = 0; i < 4; ++i)
+    out[start + 16 + i] = (size >> (8 * i)) & 0xFF;
+}
+
+void of::FlowFile::decode(const unsigned char* data, std::size_t size, Image*& u, Image*& v)
+{
+  if(size < OFZ_HEADER_SIZE || std::memcmp(data, OFZ_MAGIC, 4) != 0)
+    throw Exception("Invalid compressed flow data");
+
+  std::size_t ncols = GetInt32(data + 4);
+  std::size_t nlines = GetInt32(data + 8);
+  uint32_t iscale = GetInt32(data + 12);
+  float fscale; std::memcpy(&fscale, &iscale, sizeof(float));
+  std::size_t payload = GetInt32(data + 16);
+
+  if(!(fscale > 0.0f) || size < OFZ_HEADER_SIZE + payload)
+    throw Exception("Invalid compressed flow data");
+
+  double scale = fscale;
+
+  u = new Image(nlines, ncols);
+  v = new Image(nlines, ncols);
+
+  std::vector<int32_t> rows(4 * ncols, 0);
+  int32_t* ucur = rows.data(); // null (never dereferenced) when ncols == 0
+  int32_t* uprev = ucur + ncols;
+  int32_t* vcur = uprev + ncols;
+  int32_t* vprev = vcur + ncols;
+
+  RiceContext uctx, vctx;
+  BitReader reader(data + OFZ_HEADER_SIZE, payload);
+
+  double* ubuffer = u->getBuffer();
+  double* vbuffer = v->getBuffer();
+
+  for(std::size_t lin = 0; lin < nlines; ++lin)
+  {
+    double* urow = ubuffer + lin * ncols;
+    double* vrow = vbuffer + lin * ncols;
+
+    for(std::size_t col = 0; col < ncols; ++col)
+    {
+      ucur[col] = Predict(ucur, uprev, col, lin == 0) + DecodeResidual(reader, uctx);
+      vcur[col] = Predict(vcur, vprev, col, lin == 0) + DecodeResidual(reader, vctx);
+
+      urow[col] = Dequantize(ucur[col], scale);
+      vrow[col] = Dequantize(vcur[col], scale);
+    }
+
+    std::swap(ucur, uprev);
+    std::swap(vcur, vprev);
+  }
+}
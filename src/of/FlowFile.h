@@ -0,0 +1,156 @@
+/*!
+  \file src/of/FlowFile.h
+  \brief This class reads and writes optical flow (u,v) files.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_FLOW_FILE_H
+#define __OF_INTERNAL_FLOW_FILE_H
+
+#include "Config.h"
+#include "RowSink.h"
+
+// STL
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+
+  /*!
+    \class FlowFile
+
+    \brief This class reads and writes optical flow (u,v) files.
+
+    Two formats are supported:
+
+    - Optical Flow Middlebury (.flo): 32-bit float (u,v) pairs, 8 bytes per pixel.
+      Reference: http://vision.middlebury.edu/flow/code/flow-code/README.txt
+
+    - Compressed flow (.ofz): (u,v) are quantized to 16-bit fixed-point values
+      (i.e. round(u * scale), as in the KITTI convention with scale = 64), predicted
+      from the already decoded neighbours of the same and previous rows (LOCO-I median predictor)
+      and the residuals are written with an adaptive Golomb-Rice entropy coder.
+      Values that are not representable (e.g. Middlebury unknown flow, NaN) are stored as a
+      reserved code and decoded as OF_FLOW_UNKNOWN_VALUE.
+
+      Layout (little-endian):
+        - "OFZ1" magic number;
+        - int32 number of columns;
+        - int32 number of lines;
+        - float32 scale;
+        - uint32 payload size in bytes;
+        - payload: the Golomb-Rice bitstream, (u,v) interleaved, in row order.
+  */
+  class OFEXPORT FlowFile
+  {
+    public:
+
+      /*!
+        \brief This method saves the given (u,v) coordinates to Optical Flow Middlebury (.flo) file.
+
+        \param path The output file path.
+        \param u The u coordinates.
+        \param v The v coordinates.
+
+        \exception Exception It throws an exception if the file could not be written.
+      */
+      static void save(const std::string& path, const Image* u, const Image* v);
+
+      /*!
+        \brief This method saves the given (u,v) coordinates to compressed flow (.ofz) file.
+
+        \param path The output file path.
+        \param u The u coordinates.
+        \param v The v coordinates.
+        \param scale The fixed-point scale factor. Resolution will be 1 / scale pixel
+                     and the representable range will be +-32767 / scale pixels.
+
+        \exception Exception It throws an exception if the file could not be written.
+      */
+      static void saveCompressed(const std::string& path, const Image* u, const Image* v,
+                                 double scale = OF_DEFAULT_FLOW_CODEC_SCALE);
+
+      /*!
+        \brief This method loads (u,v) coordinates from a flow file.
+               The format (.flo or .ofz) is detected from the file magic number.
+
+        \param path The input file path.
+        \param u A pointer that will receive the u coordinates. The caller will take the ownership.
+        \param v A pointer that will receive the v coordinates. The caller will take the ownership.
+
+        \exception Exception It throws an exception if the file could not be read or it is invalid.
+      */
+      static void load(const std::string& path, Image*& u, Image*& v);
+
+      /*!
+        \brief This method encodes the given (u,v) coordinates to compressed flow format (.ofz) in memory.
+
+        \param u The u coordinates.
+        \param v The v coordinates.
+        \param scale The fixed-point scale factor.
+        \param out The output buffer. The encoded data will be appended.
+      */
+      static void encode(const Image* u, const Image* v, double scale, std::vector<unsigned char>& out);
+
+      /*!
+        \brief This method decodes (u,v) coordinates from compressed flow format (.ofz) in memory.
+
+        \param data The encoded data.
+        \param size The encoded data size in bytes.
+        \param u A pointer that will receive the u coordinates. The caller will take the ownership.
+        \param v A pointer that will receive the v coordinates. The caller will take the ownership.
+
+        \exception Exception It throws an exception if the data is invalid.
+      */
+      static void decode(const unsigned char* data, std::size_t size, Image*& u, Image*& v);
+  };
+
+  /*!
+    \class FlowFileWriter
+
+    \brief RowSink that writes the lines to an Optical Flow Middlebury (.flo) file as they arrive.
+           The file is the same of FlowFile::save, without holding the whole flow in memory.
+  */
+  class OFEXPORT FlowFileWriter : public RowSink
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param path The output file path.
+      */
+      explicit FlowFileWriter(const std::string& path);
+
+      /*!
+        \brief This method creates the file and writes its header.
+
+        \param size The size of the flow.
+
+        \exception Exception It throws an exception if the file could not be created.
+      */
+      void begin(const Size& size);
+
+      void write(std::size_t lin, const double* u, const double* v);
+
+      /*!
+        \brief This method closes the file.
+
+        \exception Exception It throws an exception if the file could not be written.
+      */
+      void end();
+
+    private:
+
+      std::string m_path;       //!< The output file path.
+      std::ofstream m_file;     //!< The output file.
+      std::vector<float> m_row; //!< The (u,v) values of a line, interleaved.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_FLOW_FILE_H
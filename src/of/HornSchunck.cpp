@@ -9,14 +9,24 @@
 */
 
 #include "Config.h"
+#include "Exception.h"
+#include "FixedPoint.h"
 #include "HornSchunck.h"
 #include "Image.h"
+#include "Kernels.h"
+#include "RowSink.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 of::HornSchunck::HornSchunck(Image* a, Image* b)
   : OpticalFlow(a, b),
-    m_alpha(15),
+    m_alpha(OF_DEFAULT_HS_ALPHA),
     m_maxIterations(std::string::npos),
-    m_e(OF_DEFAULT_HS_AUTO_STOP_THRESHOLD)
+    m_e(OF_DEFAULT_HS_AUTO_STOP_THRESHOLD),
+    m_precision(OF_DEFAULT_PRECISION)
 {
 }
 
@@ -28,43 +38,49 @@ void of::HornSchunck::compute()
 {
   initialize();
 
+  std::size_t size = m_u->getNPixels();
+
+  StatsScope scope(m_stats, "compute", size);
+
+  if(m_precision == OF_MIXED_PRECISION)
+  {
+    computeMixed();
+    return;
+  }
+
   // Compute derivative images (fx, fy and ft)
   computeDerivativeImages();
 
-  std::size_t size = m_u->getNPixels();
-
   // Local averages
   double* ubar = new double[size];
   double* vbar = new double[size];
 
+  std::size_t it = 0;
+  double sc = 0.0;
+
   // Classical Horn-Schunck method iterations
-  for(std::size_t it = 0; it < m_maxIterations; ++it)
+  for(; it < m_maxIterations; ++it)
   {
+    StatsScope scope(m_stats, "iteration", size);
+
     computeLocalAvg(ubar, m_u);
     computeLocalAvg(vbar, m_v);
 
-    double sc = 0.0;
-
-     // Compute coordinates
-    for(std::size_t i = 0; i < size; ++i)
-    {
-      double t = m_fx->getPixel(i) * ubar[i] + m_fy->getPixel(i) * vbar[i] + m_ft->getPixel(i);
-      t /= m_alpha * m_alpha + m_fx->getPixel(i) * m_fx->getPixel(i) + m_fy->getPixel(i) * m_fy->getPixel(i);
-
-      double u = ubar[i] - m_fx->getPixel(i) * t;
-      double v = vbar[i] - m_fy->getPixel(i) * t;
-
-      sc += (u - m_u->getPixel(i)) * (u - m_u->getPixel(i)) + (v - m_v->getPixel(i)) * (v - m_v->getPixel(i));
-
-      m_u->setPixel(i, u);
-      m_v->setPixel(i, v);
-    }
+    // Compute coordinates
+    sc = Kernels::hsUpdate(m_fx->getBuffer(), m_fy->getBuffer(), m_ft->getBuffer(), ubar, vbar, m_alpha,
+                           size, m_u->getBuffer(), m_v->getBuffer());
 
     // Can stop?
     if(sc / size <= m_e * m_e)
+    {
+      ++it;
       break;
+    }
   }
 
+  m_stats.setCounter("iterations", it);
+  m_stats.setCounter("residual", std::sqrt(sc / size));
+
   delete [] ubar;
   delete [] vbar;
 }
@@ -84,19 +100,173 @@ void  of::HornSchunck::setAutoStopThreshold(double e)
   m_e = e;
 }
 
-void of::HornSchunck::computeLocalAvg(double* avg, Image* coords)
+void of::HornSchunck::setPrecision(const std::string& name)
 {
-  std::size_t i = 0;
-  for(int lin = 0; lin < coords->getNLines(); ++lin)
+  if(name != OF_DOUBLE_PRECISION && name != OF_MIXED_PRECISION)
+    throw Exception("Unknown Horn-Schunck precision: " + name);
+
+  m_precision = name;
+}
+
+void of::HornSchunck::computeMixed()
+{
+  const Size size = m_u->getSize();
+  const std::size_t n = size.npixels;
+
+  std::vector<float> fx(n), fy(n), ft(n);
+  {
+    StatsScope scope(m_stats, "derivatives", n);
+
+    const std::vector<float> a(m_imga->getBuffer(), m_imga->getBuffer() + n);
+    const std::vector<float> b(m_imgb->getBuffer(), m_imgb->getBuffer() + n);
+
+    if(n != 0)
+      Kernels::derivatives(&a[0], &b[0], size.nlines, size.ncols, &fx[0], &fy[0], &ft[0]);
+  }
+
+  std::vector<float> u(n, 0.0f), v(n, 0.0f), ubar(n), vbar(n);
+
+  std::size_t it = 0;
+  double sc = 0.0;
+
+  for(; it < m_maxIterations && n != 0; ++it)
   {
-    for(int col = 0; col < coords->getNCols(); ++col)
+    StatsScope scope(m_stats, "iteration", n);
+
+    Kernels::localAverage(&u[0], size.nlines, size.ncols, &ubar[0]);
+    Kernels::localAverage(&v[0], size.nlines, size.ncols, &vbar[0]);
+
+    sc = Kernels::hsUpdate(&fx[0], &fy[0], &ft[0], &ubar[0], &vbar[0], m_alpha, n, &u[0], &v[0]);
+
+    // Can stop?
+    if(sc / n <= m_e * m_e)
     {
-      avg[i++] = (1.0 / 6.0) * (coords->getPixel(lin, col - 1) + coords->getPixel(lin, col + 1)
-        + coords->getPixel(lin - 1, col) + coords->getPixel( lin + 1, col)) +
-        (1.0 / 12.0) * (coords->getPixel(lin - 1, col - 1)
-        + coords->getPixel(lin - 1, col + 1)
-        + coords->getPixel(lin + 1, col - 1)
-        + coords->getPixel(lin + 1, col + 1));
+      ++it;
+      break;
     }
   }
+
+  std::copy(u.begin(), u.end(), m_u->getBuffer());
+  std::copy(v.begin(), v.end(), m_v->getBuffer());
+  std::copy(fx.begin(), fx.end(), m_fx->getBuffer());
+  std::copy(fy.begin(), fy.end(), m_fy->getBuffer());
+  std::copy(ft.begin(), ft.end(), m_ft->getBuffer());
+
+  m_stats.setCounter("iterations", it);
+  m_stats.setCounter("residual", n == 0 ? 0.0 : std::sqrt(sc / n));
+}
+
+void of::HornSchunck::stream(RowSink& sink)
+{
+  if(m_maxIterations == std::string::npos || m_maxIterations == 0)
+    throw Exception("The streaming Horn-Schunck needs a maximum number of iterations");
+
+  if(m_precision != OF_DOUBLE_PRECISION)
+    throw Exception("The streaming Horn-Schunck needs the double precision");
+
+  m_stats.clear();
+
+  const Size size = m_imga->getSize();
+  const std::size_t nl = size.nlines, nc = size.ncols, n = m_maxIterations;
+
+  const double* a = m_imga->getBuffer();
+  const double* b = m_imgb->getBuffer();
+
+  const KernelTable& table = Kernels::get();
+
+  // Derivatives of the last n lines (slot: line % n)
+  std::vector<double> fx(n * nc), fy(n * nc), ft(n * nc);
+
+  // (u,v) of the last 3 lines of each iteration, stored twice (slots line % 3 and line % 3 + 3),
+  // so that 3 consecutive lines are contiguous. The initial flow is zero.
+  std::vector<double> us(n * 6 * nc), vs(n * 6 * nc), zeros(3 * nc, 0.0);
+  std::vector<double> ubar(3 * nc), vbar(3 * nc);
+
+  double times[3] = { 0.0, 0.0, 0.0 };
+  double sc = 0.0;
+
+  sink.begin(size);
+
+  // At step s, iteration t computes the line s + 1 - t, once iteration t - 1 has computed the next line
+  for(std::size_t s = 0; s + 1 < nl + n && nc != 0; ++s)
+  {
+    double start = Stats::now();
+
+    // The view of the line and the next one clamps as the whole image
+    if(s < nl)
+    {
+      const std::size_t slot = (s % n) * nc;
+      table.derivatives(a + s * nc, b + s * nc, s + 1 < nl ? 2 : 1, nc, &fx[slot], &fy[slot], &ft[slot], 0, 1);
+    }
+
+    double now = Stats::now();
+    times[0] += now - start;
+    start = now;
+
+    for(std::size_t t = 1; t <= n && t <= s + 1; ++t)
+    {
+      const std::size_t lin = s + 1 - t;
+      if(lin >= nl)
+        continue;
+
+      // Lines [l0, l1] of the previous iteration
+      const std::size_t l0 = lin > 0 ? lin - 1 : 0, l1 = lin + 1 < nl ? lin + 1 : nl - 1;
+
+      const double* pu = t == 1 ? &zeros[0] : &us[((t - 2) * 6 + l0 % 3) * nc];
+      const double* pv = t == 1 ? &zeros[0] : &vs[((t - 2) * 6 + l0 % 3) * nc];
+
+      const std::size_t i = lin - l0;
+
+      table.localAverage(pu, l1 - l0 + 1, nc, &ubar[0], i, i + 1);
+      table.localAverage(pv, l1 - l0 + 1, nc, &vbar[0], i, i + 1);
+
+      // Iteration t of the line, updated from iteration t - 1
+      double* ou = &us[((t - 1) * 6 + lin % 3) * nc];
+      double* ov = &vs[((t - 1) * 6 + lin % 3) * nc];
+
+      std::copy(pu + i * nc, pu + (i + 1) * nc, ou);
+      std::copy(pv + i * nc, pv + (i + 1) * nc, ov);
+
+      const std::size_t slot = (lin % n) * nc;
+      const double changes = table.hsUpdate(&fx[slot], &fy[slot], &ft[slot], &ubar[i * nc], &vbar[i * nc], m_alpha, ou, ov, 0, nc);
+
+      std::copy(ou, ou + nc, ou + 3 * nc);
+      std::copy(ov, ov + nc, ov + 3 * nc);
+
+      if(t != n)
+        continue;
+
+      sc += changes;
+
+      now = Stats::now();
+      times[1] += now - start;
+      start = now;
+
+      sink.write(lin, ou, ov);
+
+      now = Stats::now();
+      times[2] += now - start;
+      start = now;
+    }
+
+    times[1] += Stats::now() - start;
+  }
+
+  sink.end();
+
+  if(m_stats.isEnabled())
+  {
+    m_stats.addStage("derivatives", times[0], size.npixels);
+    m_stats.addStage("sweeps", times[1], size.npixels * n);
+    m_stats.addStage("write", times[2], size.npixels);
+  }
+
+  m_stats.setCounter("iterations", n);
+  m_stats.setCounter("residual", size.npixels == 0 ? 0.0 : std::sqrt(sc / size.npixels));
+  m_stats.setCounter("buffer-bytes", (fx.size() * 3 + us.size() * 2 + zeros.size() + ubar.size() * 2) * sizeof(double));
+}
+
+void of::HornSchunck::computeLocalAvg(double* avg, Image* coords)
+{
+  Kernels::localAverage(coords->getBuffer(), coords->getNLines(), coords->getNCols(), avg);
 }
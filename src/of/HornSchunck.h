@@ -13,12 +13,25 @@
 
 #include "OpticalFlow.h"
 
+// STL
+#include <string>
+
 namespace of
 {
+// Forward declarations
+  class RowSink;
+
   /*!
     \class HornSchunck
 
     \brief This class implements the Horn & Schunck method of estimating optical flow.
+
+    The mixed precision keeps the derivatives, the local averages and the flow in float, which halves the
+    memory traffic of each iteration. The sum of the squared changes (the stop criterion) is accumulated in double.
+
+    The streaming mode (see stream) runs the iterations as a wavefront over the lines (temporal blocking): iteration t
+    of a line only needs iteration t - 1 of the line and its two neighbours, so each iteration keeps 3 lines and
+    the memory is O(ncols x iterations) instead of 7 full images.
   */
   class OFEXPORT HornSchunck : public OpticalFlow
   {
@@ -60,15 +73,43 @@ namespace of
       */
       void setAutoStopThreshold(double e);
 
+      /*!
+        \brief This methods sets the arithmetic precision.
+
+        \param name The precision. (double or mixed)
+
+        \exception Exception It throws an exception if the precision is unknown.
+      */
+      void setPrecision(const std::string& name);
+
+      /*!
+        \brief This method computes the flow line by line and writes each line to the given sink, in low memory.
+               The (u,v) lines are the same of compute() with the same number of iterations.
+
+        \param sink The destination of the (u,v) lines.
+
+        \exception Exception It throws an exception if the maximum number of iterations is not set or the precision is not double.
+
+        \note All the iterations are run: the automatic stop needs the changes of whole iterations.
+        \note The flow images and the derivative images (getU, getFx, etc.) are not computed.
+               The stats report the stages "derivatives", "sweeps" and "write", and the counters "iterations",
+               "residual" and "buffer-bytes".
+      */
+      void stream(RowSink& sink);
+
     private:
 
       void computeLocalAvg(double* avg, Image* coords);
 
+      /*! \brief Internal method that computes the flow with float storage and double accumulation. */
+      void computeMixed();
+
     private:
 
       double m_alpha;              //!< Horn-Schunck alpha parameter.
       std::size_t m_maxIterations; //!< Maximum number of iterations.
       double m_e;                  //!< Automatic stop threshold.
+      std::string m_precision;     //!< The arithmetic precision. (double or mixed)
 
   };
 
@@ -6,12 +6,20 @@
 
 // Optical Flow
 #include "Image.h"
+#include "Kernels.h"
+#include "Stats.h"
+#include "Trace.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
 
 of::Image::Image(const Size& size, double noDataValue)
   : m_size(size),
     m_noDataValue(noDataValue)
 {
   m_buffer = new double[m_size.npixels];
+  Stats::trackAllocation(m_size.npixels * sizeof(double));
 }
 
 of::Image::Image(std::size_t nlines, std::size_t ncols, double noDataValue)
@@ -19,6 +27,7 @@ of::Image::Image(std::size_t nlines, std::size_t ncols, double noDataValue)
     m_noDataValue(noDataValue)
 {
   m_buffer = new double[m_size.npixels];
+  Stats::trackAllocation(m_size.npixels * sizeof(double));
 }
 
 of::Image::Image(double* buffer, std::size_t nlines, std::size_t ncols, double noDataValue)
@@ -26,6 +35,8 @@ of::Image::Image(double* buffer, std::size_t nlines, std::size_t ncols, double n
     m_size(nlines, ncols),
     m_noDataValue(noDataValue)
 {
+  // The image takes the buffer ownership
+  Stats::trackAllocation(m_size.npixels * sizeof(double));
 }
 
 of::Image::Image(const Image& rhs)
@@ -33,6 +44,7 @@ of::Image::Image(const Image& rhs)
     m_noDataValue(rhs.m_noDataValue)
 {
   m_buffer = new double[m_size.npixels];
+  Stats::trackAllocation(m_size.npixels * sizeof(double));
 
   for(std::size_t i = 0; i < m_size.npixels; ++i)
     m_buffer[i] = rhs.m_buffer[i];
@@ -41,6 +53,7 @@ of::Image::Image(const Image& rhs)
 of::Image::~Image()
 {
   delete [] m_buffer;
+  Stats::trackRelease(m_size.npixels * sizeof(double));
 }
 
 double* of::Image::getBuffer() const
@@ -123,26 +136,59 @@ std::size_t of::Image::index(const std::size_t&lin, const std::size_t& col) cons
 
 of::Image* of::Image::filter2D(const Kernel& k) const
 {
+  TraceScope trace("Image::filter2D", "filter");
+
   Image* result = new Image(m_size, m_noDataValue);
 
-  for(int lin = 0; lin < m_size.nlines; ++lin) // for each line
-  {
-    for(int col = 0; col < m_size.ncols; ++col) // for each column
-    {
-      double v = 0.0;
+  Kernels::filter2D(m_buffer, m_size.nlines, m_size.ncols, k.values, k.width, k.height, result->m_buffer);
+
+  return result;
+}
+
+of::Image* of::Image::boxFilter(std::size_t ksize) const
+{
+  TraceScope trace("Image::boxFilter", "filter");
+
+  Image* result = new Image(m_size, m_noDataValue);
+
+  Kernels::boxSum(m_buffer, 0, m_size.nlines, m_size.ncols, ksize, result->m_buffer);
+
+  const std::size_t k = ksize / 2 * 2 + 1;
+  const double scale = 1.0 / (k * k);
+
+  for(std::size_t i = 0; i < m_size.npixels; ++i)
+    result->m_buffer[i] *= scale;
 
-      // for each kernel pixel, do convolution
-      for(int lw = -(int(k.height) / 2), lk = 0; lw <= int(k.height) / 2; ++lw, ++lk)
-        for(int cw = -(int(k.width) / 2), ck = 0; cw <= int(k.width) / 2; ++cw, ++ck)
-          v += k.get(lk, ck) * getPixel(lin, lw, col, cw);
+  return result;
+}
 
-      result->setPixel(lin, col, v);
-    }
+of::Image* of::Image::crop(const Region& region) const
+{
+  assert(region.lin + region.nlines <= m_size.nlines && region.col + region.ncols <= m_size.ncols);
+
+  Image* result = new Image(region.getSize(), m_noDataValue);
+
+  for(std::size_t lin = 0; lin < region.nlines; ++lin)
+  {
+    const double* src = m_buffer + index(region.lin + lin, region.col);
+    std::copy(src, src + region.ncols, result->m_buffer + lin * region.ncols);
   }
 
   return result;
 }
 
+void of::Image::paste(const Image* src, const Region& region, std::size_t lin, std::size_t col)
+{
+  assert(region.lin + region.nlines <= src->m_size.nlines && region.col + region.ncols <= src->m_size.ncols);
+  assert(lin + region.nlines <= m_size.nlines && col + region.ncols <= m_size.ncols);
+
+  for(std::size_t l = 0; l < region.nlines; ++l)
+  {
+    const double* from = src->m_buffer + src->index(region.lin + l, region.col);
+    std::copy(from, from + region.ncols, m_buffer + index(lin + l, col));
+  }
+}
+
 of::Image* of::Image::clone() const
 {
   return new Image(*this);
@@ -66,6 +66,32 @@ namespace of
     std::size_t npixels; //!< Number of pixels (nlines * ncols).
   };
 
+  /*!
+    \struct Region
+
+    \brief Simple struct that defines a rectangular region of a two-dimensional image.
+  */
+  struct OFEXPORT Region
+  {
+    /*! \brief Default constructor. */
+    Region() : lin(0), col(0), nlines(0), ncols(0) {}
+
+    /*! \brief Constructor. */
+    Region(std::size_t l, std::size_t c, std::size_t nl, std::size_t nc)
+      : lin(l), col(c), nlines(nl), ncols(nc) {}
+
+    /*! \brief This method returns the region size. */
+    Size getSize() const
+    {
+      return Size(nlines, ncols);
+    }
+
+    std::size_t lin;    //!< The first line.
+    std::size_t col;    //!< The first column.
+    std::size_t nlines; //!< Number of lines.
+    std::size_t ncols;  //!< Number of columns.
+  };
+
   struct OFEXPORT Kernel
   {
     /*! \brief Default constructor. */
@@ -327,9 +353,43 @@ namespace of
         \param kernel The kernel.
 
         \return A new image filtered.
+
+        \note Odd kernels with at least OF_FFT_FILTER_MIN_KERNEL_AREA values are applied with the FFT (see FFT::filter2D),
+              except on the borders. The results differ from the direct computation by rounding errors only.
       */
       Image* filter2D(const Kernel& kernel) const;
 
+      /*!
+        \brief This method applies a box filter (the mean of the ksize x ksize window of each pixel) to this image.
+
+        \param ksize The window size. Even sizes use the next odd size.
+
+        \return A new image filtered.
+
+        \note The borders are clamped. The window sums are running sums (see KernelTable::boxSum): the cost per pixel
+              does not depend on the window size.
+      */
+      Image* boxFilter(std::size_t ksize) const;
+
+      /*!
+        \brief This method copies the given region of this image to a new image.
+
+        \param region The region. It must be inside the image.
+
+        \return A new image with the region values.
+      */
+      Image* crop(const Region& region) const;
+
+      /*!
+        \brief This method copies a region of the given image to this image.
+
+        \param src The source image.
+        \param region The region of the source image that will be copied. It must be inside the source image.
+        \param lin The destination line of the region first pixel.
+        \param col The destination column of the region first pixel.
+      */
+      void paste(const Image* src, const Region& region, std::size_t lin, std::size_t col);
+
       /*!
         \brief Clone method.
       */
@@ -0,0 +1,379 @@
+/*!
+  \file src/of/Kernels.cpp
+  \brief Hot image kernels compiled for several instruction sets, with runtime selection.
+  \author Douglas Uba
+*/
+
+#include "FFT.h"
+#include "Kernels.h"
+#include "KernelsImpl.h"
+#include "Parallel.h"
+
+// STL
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+  // An instruction set variant
+  struct Variant
+  {
+    const char* isa;                      // The instruction set name.
+    const of::KernelTable& (*getTable)(); // Returns the variant kernel table.
+  };
+
+  // Compiled variants, from the most generic to the best one
+  const Variant sg_variants[] =
+  {
+    { "scalar", of::Kernels::getScalar },
+#ifdef OF_HAVE_SSE41_KERNELS
+    { "sse4.1", of::GetSSE41Kernels },
+#endif
+#ifdef OF_HAVE_AVX2_KERNELS
+    { "avx2", of::GetAVX2Kernels },
+#endif
+#ifdef OF_HAVE_AVX512_KERNELS
+    { "avx512", of::GetAVX512Kernels },
+#endif
+  };
+
+  const std::size_t sg_nVariants = sizeof(sg_variants) / sizeof(Variant);
+
+  // Checks if the processor (and the operating system) supports the given instruction set
+  bool IsSupported(const std::string& isa)
+  {
+    if(isa == "scalar")
+      return true;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+
+    if(isa == "sse4.1")
+      return __builtin_cpu_supports("sse4.1") != 0;
+
+    // The avx2 and avx512 variants are also compiled with the population count instruction
+    if(isa == "avx2")
+      return __builtin_cpu_supports("avx2") != 0 && __builtin_cpu_supports("popcnt") != 0;
+
+    if(isa == "avx512")
+      return __builtin_cpu_supports("avx512f") != 0 && __builtin_cpu_supports("popcnt") != 0;
+#endif
+
+    return false;
+  }
+
+  // Best available variant, unless OF_CPU_ISA requests an available one
+  const of::KernelTable& Select()
+  {
+    const char* requested = std::getenv("OF_CPU_ISA");
+    if(requested != 0)
+    {
+      const of::KernelTable* table = of::Kernels::find(requested);
+      if(table != 0)
+        return *table;
+    }
+
+    return *of::Kernels::find(of::Kernels::getAvailable().back());
+  }
+
+  // Number of bands of n units (lines or pixels) with the given number of pixels. It depends only on the size.
+  std::size_t GetNumberOfBands(std::size_t n, std::size_t npixels)
+  {
+    std::size_t nbands = std::min<std::size_t>(npixels / OF_KERNELS_BAND_PIXELS, OF_KERNELS_MAX_BANDS);
+    return std::max<std::size_t>(1, std::min(nbands, n));
+  }
+
+  // Runs f(first, last) over the bands of [0, n), in parallel
+  void ForEachBand(std::size_t n, std::size_t nbands, const std::function<void(std::size_t, std::size_t)>& f)
+  {
+    if(nbands == 1)
+    {
+      f(0, n);
+      return;
+    }
+
+    of::Parallel::forEach(nbands, [&](std::size_t band)
+    {
+      f(band * n / nbands, (band + 1) * n / nbands);
+    });
+  }
+
+  // Checks if filter2D should use the FFT for the interior pixels
+  bool UseFFT(std::size_t nlines, std::size_t ncols, std::size_t kwidth, std::size_t kheight)
+  {
+    return kwidth * kheight >= OF_FFT_FILTER_MIN_KERNEL_AREA && kwidth % 2 == 1 && kheight % 2 == 1 &&
+           nlines >= kheight && ncols >= kwidth;
+  }
+}
+
+const of::KernelTable& of::Kernels::get()
+{
+  static const KernelTable& table = Select();
+  return table;
+}
+
+const of::KernelTable* of::Kernels::find(const std::string& isa)
+{
+  for(std::size_t i = 0; i < sg_nVariants; ++i)
+  {
+    // The variant code must not run on processors without its instruction set
+    if(isa == sg_variants[i].isa && IsSupported(isa))
+      return &sg_variants[i].getTable();
+  }
+
+  return 0;
+}
+
+const of::KernelTable& of::Kernels::getScalar()
+{
+  static const KernelTable table = MakeKernelTable("scalar");
+  return table;
+}
+
+std::vector<std::string> of::Kernels::getAvailable()
+{
+  std::vector<std::string> isas;
+
+  for(std::size_t i = 0; i < sg_nVariants; ++i)
+    if(IsSupported(sg_variants[i].isa))
+      isas.push_back(sg_variants[i].isa);
+
+  return isas;
+}
+
+void of::Kernels::filter2D(const double* src, std::size_t nlines, std::size_t ncols,
+                           const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst)
+{
+  const KernelTable& table = get();
+
+  if(!UseFFT(nlines, ncols, kwidth, kheight))
+  {
+    ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+    {
+      table.filter2D(src, nlines, ncols, kernel, kwidth, kheight, dst, first, last);
+    });
+    return;
+  }
+
+  // Large kernels: the interior comes from the FFT and the borders (reflected) are computed directly
+  FFT::filter2D(src, nlines, ncols, kernel, kwidth, kheight, dst);
+
+  const std::size_t rh = kheight / 2, rw = kwidth / 2;
+
+  table.filter2D(src, nlines, ncols, kernel, kwidth, kheight, dst, 0, rh);
+  table.filter2D(src, nlines, ncols, kernel, kwidth, kheight, dst, nlines - rh, nlines);
+
+  const Filter2DOp op = { src, kernel, Index(kwidth), Index(rh), Index(rw) };
+  const BorderAccess<ReflectBorder> border(nlines, ncols);
+
+  // Left and right borders of the other lines. The bands are sized by the number of kernel products.
+  const std::size_t n = nlines - 2 * rh;
+
+  ForEachBand(n, GetNumberOfBands(n, n * 2 * rw * kwidth * kheight), [&](std::size_t first, std::size_t last)
+  {
+    for(Index lin = Index(rh + first); lin < Index(rh + last); ++lin)
+    {
+      for(Index col = 0; col < Index(rw); ++col)
+      {
+        dst[lin * ncols + col] = SumPixel(op, border, lin, col);
+        dst[lin * ncols + ncols - 1 - col] = SumPixel(op, border, lin, ncols - 1 - col);
+      }
+    }
+  });
+}
+
+void of::Kernels::derivatives(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                              double* fx, double* fy, double* ft)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.derivatives(a, b, nlines, ncols, fx, fy, ft, first, last);
+  });
+}
+
+void of::Kernels::windowSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                            std::size_t ksize, double* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.windowSum(a, b, nlines, ncols, ksize, dst, first, last);
+  });
+}
+
+void of::Kernels::warp(const double* src, const double* u, const double* v, double scale,
+                       std::size_t nlines, std::size_t ncols, double* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.warp(src, u, v, scale, nlines, ncols, dst, first, last);
+  });
+}
+
+void of::Kernels::localAverage(const double* src, std::size_t nlines, std::size_t ncols, double* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.localAverage(src, nlines, ncols, dst, first, last);
+  });
+}
+
+double of::Kernels::hsUpdate(const double* fx, const double* fy, const double* ft,
+                             const double* ubar, const double* vbar, double alpha,
+                             std::size_t n, double* u, double* v)
+{
+  const KernelTable& table = get();
+
+  // Partial sums of fixed bands, added in order
+  std::size_t nbands = GetNumberOfBands(n, n);
+  std::vector<double> sums(nbands, 0.0);
+
+  Parallel::forEach(nbands, [&](std::size_t band)
+  {
+    sums[band] = table.hsUpdate(fx, fy, ft, ubar, vbar, alpha, u, v, band * n / nbands, (band + 1) * n / nbands);
+  });
+
+  double sc = 0.0;
+  for(std::size_t i = 0; i < nbands; ++i)
+    sc += sums[i];
+
+  return sc;
+}
+
+void of::Kernels::census5x5(const double* src, std::size_t nlines, std::size_t ncols, std::uint32_t* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.census5x5(src, nlines, ncols, dst, first, last);
+  });
+}
+
+void of::Kernels::census7x7(const double* src, std::size_t nlines, std::size_t ncols, std::uint64_t* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.census7x7(src, nlines, ncols, dst, first, last);
+  });
+}
+
+void of::Kernels::derivativesFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                                   std::int16_t* fx, std::int16_t* fy, std::int16_t* ft)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.derivativesFixed(a, b, nlines, ncols, fx, fy, ft, first, last);
+  });
+}
+
+void of::Kernels::windowSumFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                                 std::size_t ksize, std::int32_t* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.windowSumFixed(a, b, nlines, ncols, ksize, dst, first, last);
+  });
+}
+
+void of::Kernels::warpFixed(const std::int16_t* src, const double* u, const double* v, double scale,
+                            std::size_t nlines, std::size_t ncols, std::int16_t* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.warpFixed(src, u, v, scale, nlines, ncols, dst, first, last);
+  });
+}
+
+void of::Kernels::derivatives(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                              float* fx, float* fy, float* ft)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.derivativesFloat(a, b, nlines, ncols, fx, fy, ft, first, last);
+  });
+}
+
+void of::Kernels::windowSum(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                            std::size_t ksize, double* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.windowSumFloat(a, b, nlines, ncols, ksize, dst, first, last);
+  });
+}
+
+void of::Kernels::warp(const float* src, const float* u, const float* v, double scale,
+                       std::size_t nlines, std::size_t ncols, float* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.warpFloat(src, u, v, scale, nlines, ncols, dst, first, last);
+  });
+}
+
+void of::Kernels::localAverage(const float* src, std::size_t nlines, std::size_t ncols, float* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.localAverageFloat(src, nlines, ncols, dst, first, last);
+  });
+}
+
+double of::Kernels::hsUpdate(const float* fx, const float* fy, const float* ft,
+                             const float* ubar, const float* vbar, double alpha,
+                             std::size_t n, float* u, float* v)
+{
+  const KernelTable& table = get();
+
+  // Partial sums of fixed bands, added in order
+  std::size_t nbands = GetNumberOfBands(n, n);
+  std::vector<double> sums(nbands, 0.0);
+
+  Parallel::forEach(nbands, [&](std::size_t band)
+  {
+    sums[band] = table.hsUpdateFloat(fx, fy, ft, ubar, vbar, alpha, u, v, band * n / nbands, (band + 1) * n / nbands);
+  });
+
+  double sc = 0.0;
+  for(std::size_t i = 0; i < nbands; ++i)
+    sc += sums[i];
+
+  return sc;
+}
+
+void of::Kernels::boxSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                         std::size_t ksize, double* dst)
+{
+  const KernelTable& table = get();
+
+  ForEachBand(nlines, GetNumberOfBands(nlines, nlines * ncols), [&](std::size_t first, std::size_t last)
+  {
+    table.boxSum(a, b, nlines, ncols, ksize, dst, first, last);
+  });
+}
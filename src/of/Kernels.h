@@ -0,0 +1,280 @@
+/*!
+  \file src/of/Kernels.h
+  \brief Hot image kernels compiled for several instruction sets, with runtime selection.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_KERNELS_H
+#define __OF_INTERNAL_KERNELS_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace of
+{
+  /*!
+    \struct KernelTable
+
+    \brief Table of the hot kernels compiled for one instruction set.
+
+    All buffers are row-major images with nlines x ncols pixels. Pixels outside the image
+    follow the same border strategies of the Image access methods. Each kernel computes only
+    the output lines [first, last) (or the pixels [first, last), for hsUpdate), so that disjoint
+    ranges can run in parallel.
+  */
+  struct OFEXPORT KernelTable
+  {
+    const char* isa; //!< The instruction set name. (scalar, sse4.1, avx2 or avx512)
+
+    /*! \brief Convolution with reflected borders (Image::filter2D). The kernel has kwidth x kheight values. */
+    void (*filter2D)(const double* src, std::size_t nlines, std::size_t ncols,
+                     const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst,
+                     std::size_t first, std::size_t last);
+
+    /*! \brief Derivative images of Horn & Schunck (2 x 2 x 2 cube differences, clamped borders). */
+    void (*derivatives)(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                        double* fx, double* fy, double* ft, std::size_t first, std::size_t last);
+
+    /*!
+      \brief Sums of a * b over ksize x ksize windows, with clamped borders (Lucas & Kanade matrices).
+
+      \note The common window sizes (3, 5, 7, 9, 15 and 21) are compiled for fixed bounds. Other sizes use a generic path.
+            The sums are direct, in a fixed order, and are the reference of boxSum.
+    */
+    void (*windowSum)(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                      std::size_t ksize, double* dst, std::size_t first, std::size_t last);
+
+    /*! \brief Bilinear warp: dst(lin, col) = src(lin - scale * v, col - scale * u), with reflected borders. */
+    void (*warp)(const double* src, const double* u, const double* v, double scale,
+                 std::size_t nlines, std::size_t ncols, double* dst, std::size_t first, std::size_t last);
+
+    /*! \brief Horn & Schunck local averages (3 x 3 weighted neighbourhood, clamped borders). */
+    void (*localAverage)(const double* src, std::size_t nlines, std::size_t ncols, double* dst,
+                         std::size_t first, std::size_t last);
+
+    /*!
+      \brief Horn & Schunck update of (u,v), from the local averages (ubar, vbar).
+
+      \return The sum of the squared changes of (u,v).
+    */
+    double (*hsUpdate)(const double* fx, const double* fy, const double* ft,
+                       const double* ubar, const double* vbar, double alpha,
+                       double* u, double* v, std::size_t first, std::size_t last);
+
+    /*!
+      \brief Sum of absolute differences between the bsize x bsize blocks at a and b (both with ncols columns).
+
+      \note The sum stops at the end of the first block line where it exceeds bound. The partial sum is returned.
+    */
+    double (*blockSAD)(const double* a, const double* b, std::size_t ncols, std::size_t bsize, double bound);
+
+    /*! \brief Sum of squared differences between the bsize x bsize blocks at a and b. It stops as blockSAD. */
+    double (*blockSSD)(const double* a, const double* b, std::size_t ncols, std::size_t bsize, double bound);
+
+    /*! \brief One minus the normalized cross correlation of the bsize x bsize blocks at a and b. (1 if a block is constant) */
+    double (*blockNCC)(const double* a, const double* b, std::size_t ncols, std::size_t bsize);
+
+    /*!
+      \brief Census transform over 5 x 5 windows, with clamped borders. Bit k is set if the k-th neighbour
+             (line-major order, without the center) is less than the center. (24 bits)
+    */
+    void (*census5x5)(const double* src, std::size_t nlines, std::size_t ncols, std::uint32_t* dst,
+                      std::size_t first, std::size_t last);
+
+    /*! \brief Census transform over 7 x 7 windows, as census5x5. (48 bits) */
+    void (*census7x7)(const double* src, std::size_t nlines, std::size_t ncols, std::uint64_t* dst,
+                      std::size_t first, std::size_t last);
+
+    /*! \brief Sum of the Hamming distances between the bsize x bsize blocks of 5 x 5 census at a and b. It stops as blockSAD. */
+    double (*blockHamming32)(const std::uint32_t* a, const std::uint32_t* b, std::size_t ncols, std::size_t bsize, double bound);
+
+    /*! \brief Sum of the Hamming distances between the bsize x bsize blocks of 7 x 7 census at a and b. It stops as blockSAD. */
+    double (*blockHamming64)(const std::uint64_t* a, const std::uint64_t* b, std::size_t ncols, std::size_t bsize, double bound);
+
+    /*!
+      \brief Derivative images of fixed-point images, as derivatives but times 4 (i.e. the sums of the cube differences),
+             so they are exact. The values must be in [0, 4095].
+    */
+    void (*derivativesFixed)(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                             std::int16_t* fx, std::int16_t* fy, std::int16_t* ft, std::size_t first, std::size_t last);
+
+    /*!
+      \brief Sums of a * b over ksize x ksize windows of fixed-point images, with clamped borders (exact, separable).
+             The sums must fit in 32 bits (see FixedPoint::getWindowSumBits).
+    */
+    void (*windowSumFixed)(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                           std::size_t ksize, std::int32_t* dst, std::size_t first, std::size_t last);
+
+    /*!
+      \brief Bilinear warp of a fixed-point image, as warp. The positions are rounded to 1/256 pixel and
+             the interpolation is integer, with rounding. The values must be in [0, 4095].
+    */
+    void (*warpFixed)(const std::int16_t* src, const double* u, const double* v, double scale,
+                      std::size_t nlines, std::size_t ncols, std::int16_t* dst, std::size_t first, std::size_t last);
+
+    /*! \brief derivatives of float images, computed in float. */
+    void (*derivativesFloat)(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                             float* fx, float* fy, float* ft, std::size_t first, std::size_t last);
+
+    /*!
+      \brief windowSum of float images, separable as windowSumFixed. The products are accumulated and stored in double,
+             so the 2 x 2 solves see the sums unrounded.
+    */
+    void (*windowSumFloat)(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                           std::size_t ksize, double* dst, std::size_t first, std::size_t last);
+
+    /*! \brief warp of a float image by a float flow. The positions and the interpolation are computed in double. */
+    void (*warpFloat)(const float* src, const float* u, const float* v, double scale,
+                      std::size_t nlines, std::size_t ncols, float* dst, std::size_t first, std::size_t last);
+
+    /*! \brief localAverage of a float image, computed in float. */
+    void (*localAverageFloat)(const float* src, std::size_t nlines, std::size_t ncols, float* dst,
+                              std::size_t first, std::size_t last);
+
+    /*! \brief hsUpdate of float images, computed in float. The sum of the squared changes is accumulated in double. */
+    double (*hsUpdateFloat)(const float* fx, const float* fy, const float* ft,
+                            const float* ubar, const float* vbar, double alpha,
+                            float* u, float* v, std::size_t first, std::size_t last);
+
+    /*!
+      \brief Sums of a * b (or of a, if b is null) over ksize x ksize windows, with clamped borders, as windowSum,
+             by running sums: O(1) operations per pixel for any window size. The running sums are compensated
+             and count their nonzero terms, so the results differ from windowSum by rounding errors only and
+             the windows without nonzero terms (e.g. flat regions next to texture) sum to exactly zero.
+    */
+    void (*boxSum)(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                   std::size_t ksize, double* dst, std::size_t first, std::size_t last);
+  };
+
+  /*!
+    \class Kernels
+
+    \brief Runtime selection of the hot kernels (convolution, derivatives, window sums, warp, Horn & Schunck sweep,
+           block costs, census transforms, fixed-point Lucas & Kanade and running box sums), with float variants for the
+           mixed precision.
+
+    The kernels are compiled from the same source for each instruction set supported by the compiler
+    (scalar, sse4.1, avx2 and avx512). The best variant supported by the processor is selected on first use.
+    The OF_CPU_ISA environment variable overrides the selection (e.g. OF_CPU_ISA=scalar), as long as the
+    requested variant is available. Otherwise, the automatic selection is used.
+
+    The static methods below run the selected kernels over whole images, in parallel bands of lines.
+    The bands depend only on the image size, so the results never depend on the number of threads.
+
+    \note All variants produce the same results: they keep the scalar order of operations and never fuse multiply-adds.
+
+    \note The Hamming distances use the hardware population count on the avx2 and avx512 variants (POPCNT).
+  */
+  class OFEXPORT Kernels
+  {
+    public:
+
+      /*!
+        \brief This method returns the selected kernel table.
+
+        \return The selected kernel table.
+      */
+      static const KernelTable& get();
+
+      /*!
+        \brief This method returns the kernel table of the given instruction set.
+
+        \param isa The instruction set name.
+
+        \return The kernel table, or a null pointer if the variant was not compiled or is not supported by the processor.
+      */
+      static const KernelTable* find(const std::string& isa);
+
+      /*!
+        \brief This method returns the scalar (reference) kernel table.
+
+        \return The scalar kernel table.
+      */
+      static const KernelTable& getScalar();
+
+      /*!
+        \brief This method returns the instruction sets available on this processor, from the most generic to the best one.
+
+        \return The available instruction set names.
+      */
+      static std::vector<std::string> getAvailable();
+
+      /*! \brief This method runs KernelTable::filter2D over the whole image. */
+      static void filter2D(const double* src, std::size_t nlines, std::size_t ncols,
+                           const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst);
+
+      /*! \brief This method runs KernelTable::derivatives over the whole image. */
+      static void derivatives(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                              double* fx, double* fy, double* ft);
+
+      /*! \brief This method runs KernelTable::windowSum over the whole image. */
+      static void windowSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                            std::size_t ksize, double* dst);
+
+      /*! \brief This method runs KernelTable::warp over the whole image. */
+      static void warp(const double* src, const double* u, const double* v, double scale,
+                       std::size_t nlines, std::size_t ncols, double* dst);
+
+      /*! \brief This method runs KernelTable::localAverage over the whole image. */
+      static void localAverage(const double* src, std::size_t nlines, std::size_t ncols, double* dst);
+
+      /*!
+        \brief This method runs KernelTable::hsUpdate over the n pixels of the images.
+
+        \return The sum of the squared changes of (u,v).
+      */
+      static double hsUpdate(const double* fx, const double* fy, const double* ft,
+                             const double* ubar, const double* vbar, double alpha,
+                             std::size_t n, double* u, double* v);
+
+      /*! \brief This method runs KernelTable::census5x5 over the whole image. */
+      static void census5x5(const double* src, std::size_t nlines, std::size_t ncols, std::uint32_t* dst);
+
+      /*! \brief This method runs KernelTable::census7x7 over the whole image. */
+      static void census7x7(const double* src, std::size_t nlines, std::size_t ncols, std::uint64_t* dst);
+
+      /*! \brief This method runs KernelTable::derivativesFixed over the whole image. */
+      static void derivativesFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                                   std::int16_t* fx, std::int16_t* fy, std::int16_t* ft);
+
+      /*! \brief This method runs KernelTable::windowSumFixed over the whole image. */
+      static void windowSumFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                                 std::size_t ksize, std::int32_t* dst);
+
+      /*! \brief This method runs KernelTable::warpFixed over the whole image. */
+      static void warpFixed(const std::int16_t* src, const double* u, const double* v, double scale,
+                            std::size_t nlines, std::size_t ncols, std::int16_t* dst);
+
+      /*! \brief This method runs KernelTable::derivativesFloat over the whole image. */
+      static void derivatives(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                              float* fx, float* fy, float* ft);
+
+      /*! \brief This method runs KernelTable::windowSumFloat over the whole image. */
+      static void windowSum(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                            std::size_t ksize, double* dst);
+
+      /*! \brief This method runs KernelTable::warpFloat over the whole image. */
+      static void warp(const float* src, const float* u, const float* v, double scale,
+                       std::size_t nlines, std::size_t ncols, float* dst);
+
+      /*! \brief This method runs KernelTable::localAverageFloat over the whole image. */
+      static void localAverage(const float* src, std::size_t nlines, std::size_t ncols, float* dst);
+
+      /*! \brief This method runs KernelTable::hsUpdateFloat over the n pixels of the images, as hsUpdate. */
+      static double hsUpdate(const float* fx, const float* fy, const float* ft,
+                             const float* ubar, const float* vbar, double alpha,
+                             std::size_t n, float* u, float* v);
+
+      /*! \brief This method runs KernelTable::boxSum over the whole image. */
+      static void boxSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                         std::size_t ksize, double* dst);
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_KERNELS_H
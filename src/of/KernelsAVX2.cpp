@@ -0,0 +1,17 @@
+/*!
+  \file src/of/KernelsAVX2.cpp
+  \brief AVX2 variant of the hot image kernels. It is compiled with the AVX2 flags (see Kernels.h).
+  \author Douglas Uba
+*/
+
+#ifdef OF_HAVE_AVX2_KERNELS
+
+#include "KernelsImpl.h"
+
+const of::KernelTable& of::GetAVX2Kernels()
+{
+  static const KernelTable table = MakeKernelTable("avx2");
+  return table;
+}
+
+#endif // OF_HAVE_AVX2_KERNELS
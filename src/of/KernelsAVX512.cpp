@@ -0,0 +1,17 @@
+/*!
+  \file src/of/KernelsAVX512.cpp
+  \brief AVX-512 variant of the hot image kernels. It is compiled with the AVX-512 flags (see Kernels.h).
+  \author Douglas Uba
+*/
+
+#ifdef OF_HAVE_AVX512_KERNELS
+
+#include "KernelsImpl.h"
+
+const of::KernelTable& of::GetAVX512Kernels()
+{
+  static const KernelTable table = MakeKernelTable("avx512");
+  return table;
+}
+
+#endif // OF_HAVE_AVX512_KERNELS
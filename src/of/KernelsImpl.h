@@ -0,0 +1,864 @@
+/*!
+  \file src/of/KernelsImpl.h
+  \brief Source of the hot image kernels, shared by all instruction set variants.
+  \author Douglas Uba
+
+  \note This file is included once by each variant translation unit (Kernels*.cpp), which is compiled
+        with the flags of its instruction set. All definitions have internal linkage, so that each variant
+        keeps its own code. Inline STL templates (e.g. std::min) are avoided on purpose: the linker could
+        keep the copy compiled for a newer instruction set and use it from the other variants.
+
+  \note The neighbourhood kernels are stencil operators (see Stencil.h). All loops keep, for each pixel,
+        the order of operations of the scalar reference. Each kernel processes a range of lines (or pixels)
+        and Kernels runs the ranges in parallel.
+*/
+
+#ifndef __OF_INTERNAL_KERNELS_IMPL_H
+#define __OF_INTERNAL_KERNELS_IMPL_H
+
+#include "Kernels.h"
+#include "Stencil.h"
+
+// STL
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/*!
+  \def OF_KERNELS_BLOCK_SIZE
+
+  \brief Number of pixels processed per block by the kernels that split vectorizable work from serial reductions.
+*/
+#define OF_KERNELS_BLOCK_SIZE 256
+
+/*!
+  \def OF_KERNELS_COST_LANES
+
+  \brief Number of partial sums of the block costs. Each one accumulates a fixed column (modulo the number of lanes),
+         so the sums are vectorized and their order does not depend on the instruction set.
+*/
+#define OF_KERNELS_COST_LANES 8
+
+namespace of
+{
+  // Kernel tables of the instruction set variants, defined by KernelsSSE41.cpp, KernelsAVX2.cpp and KernelsAVX512.cpp.
+  // They must be called only if the processor supports the instruction set (see Kernels::find).
+  const KernelTable& GetSSE41Kernels();
+  const KernelTable& GetAVX2Kernels();
+  const KernelTable& GetAVX512Kernels();
+}
+
+namespace
+{
+  // Image::filter2D: convolution with reflected borders
+  struct Filter2DOp
+  {
+    WindowShape shape() const
+    {
+      return WindowShape(rh, rw);
+    }
+
+    template<class Access>
+    double term(const Access& in, Index lin, Index col, Index dl, Index dc) const
+    {
+      return kernel[(dl + rh) * kwidth + (dc + rw)] * in(src, lin, col, dl, dc);
+    }
+
+    const double* src;    // The input image.
+    const double* kernel; // The kernel values.
+    Index kwidth;         // The kernel width.
+    Index rh;             // The kernel vertical radius.
+    Index rw;             // The kernel horizontal radius.
+  };
+
+  // Lucas & Kanade matrices: sums of a * b over square windows, with clamped borders
+  struct WindowSumOp
+  {
+    WindowShape shape() const
+    {
+      return WindowShape(r, r);
+    }
+
+    template<class Access>
+    double term(const Access& in, Index lin, Index col, Index dl, Index dc) const
+    {
+      return in(a, lin, col, dl, dc) * in(b, lin, col, dl, dc);
+    }
+
+    const double* a; // The first image.
+    const double* b; // The second image.
+    Index r;         // The window radius.
+  };
+
+  // WindowSumOp for a window radius known at compile time
+  template<int R>
+  struct FixedWindowSumOp
+  {
+    FixedShape<R, R, R, R> shape() const
+    {
+      return FixedShape<R, R, R, R>();
+    }
+
+    template<class Access>
+    double term(const Access& in, Index lin, Index col, Index dl, Index dc) const
+    {
+      return in(a, lin, col, dl, dc) * in(b, lin, col, dl, dc);
+    }
+
+    const double* a; // The first image.
+    const double* b; // The second image.
+  };
+
+  // Horn & Schunck derivatives: 2 x 2 x 2 cube differences, with clamped borders. The arithmetic is done in T.
+  template<class T>
+  struct DerivativesOp
+  {
+    FixedShape<0, 1, 0, 1> shape() const
+    {
+      return FixedShape<0, 1, 0, 1>();
+    }
+
+    template<class Access>
+    void pixel(const Access& in, Index lin, Index col) const
+    {
+      const T a00 = in(a, lin, col, 0, 0), a01 = in(a, lin, col, 0, 1);
+      const T a10 = in(a, lin, col, 1, 0), a11 = in(a, lin, col, 1, 1);
+      const T b00 = in(b, lin, col, 0, 0), b01 = in(b, lin, col, 0, 1);
+      const T b10 = in(b, lin, col, 1, 0), b11 = in(b, lin, col, 1, 1);
+
+      const Index i = lin * ncols + col;
+
+      fx[i] = T(1.0 / 4.0) * (a01 - a00 + a11 - a10 + b01 - b00 + b11 - b10);
+      fy[i] = T(1.0 / 4.0) * (a10 - a00 + a11 - a01 + b10 - b00 + b11 - b01);
+      ft[i] = T(1.0 / 4.0) * (b00 - a00 + b01 - a01 + b10 - a10 + b11 - a11);
+    }
+
+    const T* a;  // The first image.
+    const T* b;  // The second image.
+    T* fx;       // The x derivative.
+    T* fy;       // The y derivative.
+    T* ft;       // The t derivative.
+    Index ncols; // The number of columns.
+  };
+
+  // Horn & Schunck local averages: weighted 3 x 3 neighbourhood, with clamped borders. The arithmetic is done in T.
+  template<class T>
+  struct LocalAverageOp
+  {
+    FixedShape<1, 1, 1, 1> shape() const
+    {
+      return FixedShape<1, 1, 1, 1>();
+    }
+
+    template<class Access>
+    void pixel(const Access& in, Index lin, Index col) const
+    {
+      dst[lin * ncols + col] = T(1.0 / 6.0) * (in(src, lin, col, 0, -1) + in(src, lin, col, 0, 1)
+        + in(src, lin, col, -1, 0) + in(src, lin, col, 1, 0)) +
+        T(1.0 / 12.0) * (in(src, lin, col, -1, -1)
+        + in(src, lin, col, -1, 1)
+        + in(src, lin, col, 1, -1)
+        + in(src, lin, col, 1, 1));
+    }
+
+    const T* src; // The input image.
+    T* dst;       // The local averages.
+    Index ncols;  // The number of columns.
+  };
+
+  // Census transform: one bit per neighbour of a (2R + 1) x (2R + 1) window, set if the neighbour is less than the center
+  template<int R, class Word>
+  struct CensusOp
+  {
+    FixedShape<R, R, R, R> shape() const
+    {
+      return FixedShape<R, R, R, R>();
+    }
+
+    template<class Access>
+    void pixel(const Access& in, Index lin, Index col) const
+    {
+      const double center = in(src, lin, col, 0, 0);
+
+      Word word = 0;
+      int bit = 0;
+
+      for(Index dl = -R; dl <= R; ++dl)
+      {
+        for(Index dc = -R; dc <= R; ++dc)
+        {
+          if(dl == 0 && dc == 0)
+            continue;
+
+          word |= Word(in(src, lin, col, dl, dc) < center) << bit;
+          ++bit;
+        }
+      }
+
+      dst[lin * ncols + col] = word;
+    }
+
+    const double* src; // The input image.
+    Word* dst;         // The census words.
+    Index ncols;       // The number of columns.
+  };
+
+  // Number of set bits of x. The avx2 and avx512 variants compile it to the POPCNT instruction.
+  inline unsigned int PopCount(std::uint64_t x)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_popcountll(x));
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+  void Filter2D(const double* src, std::size_t nlines, std::size_t ncols,
+                const double* kernel, std::size_t kwidth, std::size_t kheight, double* dst,
+                std::size_t first, std::size_t last)
+  {
+    Filter2DOp op = { src, kernel, Index(kwidth), Index(kheight) / 2, Index(kwidth) / 2 };
+    ApplySumStencil<ReflectBorder>(op, nlines, ncols, first, last, dst);
+  }
+
+  template<class T>
+  void Derivatives(const T* a, const T* b, std::size_t nlines, std::size_t ncols,
+                   T* fx, T* fy, T* ft, std::size_t first, std::size_t last)
+  {
+    DerivativesOp<T> op = { a, b, fx, fy, ft, Index(ncols) };
+    ApplyStencil<ClampBorder>(op, nlines, ncols, first, last);
+  }
+
+  template<int R>
+  void FixedWindowSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols, double* dst,
+                      std::size_t first, std::size_t last)
+  {
+    FixedWindowSumOp<R> op = { a, b };
+    ApplySumStencil<ClampBorder>(op, nlines, ncols, first, last, dst);
+  }
+
+  void WindowSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                 std::size_t ksize, double* dst, std::size_t first, std::size_t last)
+  {
+    // Common Lucas & Kanade window sizes are specialized
+    switch(ksize)
+    {
+      case 3:
+        return FixedWindowSum<1>(a, b, nlines, ncols, dst, first, last);
+      case 5:
+        return FixedWindowSum<2>(a, b, nlines, ncols, dst, first, last);
+      case 7:
+        return FixedWindowSum<3>(a, b, nlines, ncols, dst, first, last);
+      case 9:
+        return FixedWindowSum<4>(a, b, nlines, ncols, dst, first, last);
+      case 15:
+        return FixedWindowSum<7>(a, b, nlines, ncols, dst, first, last);
+      case 21:
+        return FixedWindowSum<10>(a, b, nlines, ncols, dst, first, last);
+    }
+
+    WindowSumOp op = { a, b, Index(ksize) / 2 };
+    ApplySumStencil<ClampBorder>(op, nlines, ncols, first, last, dst);
+  }
+
+  template<class T>
+  void LocalAverage(const T* src, std::size_t nlines, std::size_t ncols, T* dst,
+                    std::size_t first, std::size_t last)
+  {
+    LocalAverageOp<T> op = { src, dst, Index(ncols) };
+    ApplyStencil<ClampBorder>(op, nlines, ncols, first, last);
+  }
+
+  // The positions and the interpolation are computed in double, for any storage type
+  template<class T>
+  void Warp(const T* OF_RESTRICT src, const T* OF_RESTRICT u, const T* OF_RESTRICT v, double scale,
+            std::size_t nlines, std::size_t ncols, T* OF_RESTRICT dst, std::size_t first, std::size_t last)
+  {
+    const Index nl = nlines, nc = ncols;
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      for(Index col = 0; col < nc; ++col)
+      {
+        const Index i = lin * nc + col;
+
+        // Compute destination pixel
+        const double wlin = lin - scale * v[i];
+        const double wcol = col - scale * u[i];
+
+        // Get pixel part
+        const int fy = int(std::floor(wlin));
+        const int fx = int(std::floor(wcol));
+        const Index y = fy > 0 ? fy : 0;
+        const Index x = fx > 0 ? fx : 0;
+
+        // Get sub-pixel part
+        const double alphay = std::fabs(wlin - y);
+        const double alphax = std::fabs(wcol - x);
+
+        // Neighbours, as Image::getPixel(y, 0|1, x, 0|1)
+        const Index y0 = Clamp(y, nl), y1 = Clamp(Reflect(y, 1, nl), nl);
+        const Index x0 = Clamp(x, nc), x1 = Clamp(Reflect(x, 1, nc), nc);
+
+        // Bilinear interpolation
+        double value = (1.0 - alphax) * (1.0 - alphay) * src[y0 * nc + x0];
+        value += alphax * (1.0 - alphay) * src[y0 * nc + x1];
+        value += (1.0 - alphax) * alphay * src[y1 * nc + x0];
+        value += alphax * alphay * src[y1 * nc + x1];
+
+        dst[i] = T(value);
+      }
+    }
+  }
+
+  // The update is done in T. The sum of the changes is accumulated in double.
+  template<class T>
+  double HSUpdate(const T* OF_RESTRICT fx, const T* OF_RESTRICT fy, const T* OF_RESTRICT ft,
+                  const T* OF_RESTRICT ubar, const T* OF_RESTRICT vbar, double alpha,
+                  T* OF_RESTRICT u, T* OF_RESTRICT v, std::size_t first, std::size_t last)
+  {
+    const T alpha2 = T(alpha * alpha);
+
+    double sc = 0.0;
+
+    // The update is vectorized block by block. The sum of the changes keeps the serial order.
+    double changes[OF_KERNELS_BLOCK_SIZE];
+
+    for(std::size_t block = first; block < last; block += OF_KERNELS_BLOCK_SIZE)
+    {
+      const std::size_t count = last - block < OF_KERNELS_BLOCK_SIZE ? last - block : OF_KERNELS_BLOCK_SIZE;
+
+      for(std::size_t j = 0; j < count; ++j)
+      {
+        const std::size_t i = block + j;
+
+        T t = fx[i] * ubar[i] + fy[i] * vbar[i] + ft[i];
+        t /= alpha2 + fx[i] * fx[i] + fy[i] * fy[i];
+
+        const T nu = ubar[i] - fx[i] * t;
+        const T nv = vbar[i] - fy[i] * t;
+
+        const double du = nu - u[i], dv = nv - v[i];
+        changes[j] = du * du + dv * dv;
+
+        u[i] = nu;
+        v[i] = nv;
+      }
+
+      for(std::size_t j = 0; j < count; ++j)
+        sc += changes[j];
+    }
+
+    return sc;
+  }
+
+  struct AbsoluteDifference
+  {
+    static double apply(double a, double b) { return std::fabs(a - b); }
+  };
+
+  struct SquaredDifference
+  {
+    static double apply(double a, double b) { return (a - b) * (a - b); }
+  };
+
+  // Sum of the differences of two blocks, with one partial sum per lane. It stops once a whole line exceeds the bound.
+  template<class Difference>
+  double BlockDistance(const double* a, const double* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    double lanes[OF_KERNELS_COST_LANES] = { 0.0 };
+
+    const std::size_t nfull = bsize - bsize % OF_KERNELS_COST_LANES;
+
+    double sum = 0.0;
+
+    for(std::size_t lin = 0; lin < bsize; ++lin)
+    {
+      const double* OF_RESTRICT la = a + lin * ncols;
+      const double* OF_RESTRICT lb = b + lin * ncols;
+
+      for(std::size_t col = 0; col < nfull; col += OF_KERNELS_COST_LANES)
+        for(std::size_t k = 0; k < OF_KERNELS_COST_LANES; ++k)
+          lanes[k] += Difference::apply(la[col + k], lb[col + k]);
+
+      for(std::size_t col = nfull; col < bsize; ++col)
+        lanes[col - nfull] += Difference::apply(la[col], lb[col]);
+
+      sum = 0.0;
+      for(std::size_t k = 0; k < OF_KERNELS_COST_LANES; ++k)
+        sum += lanes[k];
+
+      if(sum > bound)
+        return sum;
+    }
+
+    return sum;
+  }
+
+  double BlockSAD(const double* a, const double* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    return BlockDistance<AbsoluteDifference>(a, b, ncols, bsize, bound);
+  }
+
+  double BlockSSD(const double* a, const double* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    return BlockDistance<SquaredDifference>(a, b, ncols, bsize, bound);
+  }
+
+  double BlockNCC(const double* a, const double* b, std::size_t ncols, std::size_t bsize)
+  {
+    // Lanes of the sums of a, b, a * a, b * b and a * b
+    double sa[OF_KERNELS_COST_LANES] = { 0.0 }, sb[OF_KERNELS_COST_LANES] = { 0.0 };
+    double saa[OF_KERNELS_COST_LANES] = { 0.0 }, sbb[OF_KERNELS_COST_LANES] = { 0.0 }, sab[OF_KERNELS_COST_LANES] = { 0.0 };
+
+    const std::size_t nfull = bsize - bsize % OF_KERNELS_COST_LANES;
+
+    for(std::size_t lin = 0; lin < bsize; ++lin)
+    {
+      const double* OF_RESTRICT la = a + lin * ncols;
+      const double* OF_RESTRICT lb = b + lin * ncols;
+
+      for(std::size_t col = 0; col < nfull; col += OF_KERNELS_COST_LANES)
+      {
+        for(std::size_t k = 0; k < OF_KERNELS_COST_LANES; ++k)
+        {
+          sa[k] += la[col + k];
+          sb[k] += lb[col + k];
+          saa[k] += la[col + k] * la[col + k];
+          sbb[k] += lb[col + k] * lb[col + k];
+          sab[k] += la[col + k] * lb[col + k];
+        }
+      }
+
+      for(std::size_t col = nfull; col < bsize; ++col)
+      {
+        sa[col - nfull] += la[col];
+        sb[col - nfull] += lb[col];
+        saa[col - nfull] += la[col] * la[col];
+        sbb[col - nfull] += lb[col] * lb[col];
+        sab[col - nfull] += la[col] * lb[col];
+      }
+    }
+
+    double ta = 0.0, tb = 0.0, taa = 0.0, tbb = 0.0, tab = 0.0;
+    for(std::size_t k = 0; k < OF_KERNELS_COST_LANES; ++k)
+    {
+      ta += sa[k];
+      tb += sb[k];
+      taa += saa[k];
+      tbb += sbb[k];
+      tab += sab[k];
+    }
+
+    const double n = double(bsize * bsize);
+
+    const double va = n * taa - ta * ta;
+    const double vb = n * tbb - tb * tb;
+
+    if(va <= 0.0 || vb <= 0.0)
+      return 1.0;
+
+    return 1.0 - (n * tab - ta * tb) / std::sqrt(va * vb);
+  }
+
+  // Census transform of the lines [first, last). The interior is computed one neighbour at a time for all the pixels
+  // of a line, so the comparisons are vectorized. The other pixels use the clamped stencil.
+  template<int R, class Word>
+  void Census(const double* src, std::size_t nlines, std::size_t ncols, Word* dst, std::size_t first, std::size_t last)
+  {
+    const CensusOp<R, Word> op = { src, dst, Index(ncols) };
+    const BorderAccess<ClampBorder> border(nlines, ncols);
+
+    Index c0, c1;
+    GetInteriorColumns(op.shape(), ncols, c0, c1);
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      if(!IsInteriorLine(op.shape(), lin, nlines))
+      {
+        for(Index col = 0; col < Index(ncols); ++col)
+          op.pixel(border, lin, col);
+
+        continue;
+      }
+
+      for(Index col = 0; col < c0; ++col)
+        op.pixel(border, lin, col);
+
+      for(Index col = c1; col < Index(ncols); ++col)
+        op.pixel(border, lin, col);
+
+      const double* OF_RESTRICT center = src + lin * ncols;
+      Word* OF_RESTRICT out = dst + lin * ncols;
+
+      for(Index col = c0; col < c1; ++col)
+        out[col] = 0;
+
+      int bit = 0;
+
+      for(Index dl = -R; dl <= R; ++dl)
+      {
+        for(Index dc = -R; dc <= R; ++dc)
+        {
+          if(dl == 0 && dc == 0)
+            continue;
+
+          const double* OF_RESTRICT neighbour = src + (lin + dl) * Index(ncols) + dc;
+
+          for(Index col = c0; col < c1; ++col)
+            out[col] |= Word(neighbour[col] < center[col]) << bit;
+
+          ++bit;
+        }
+      }
+    }
+  }
+
+  void Census5x5(const double* src, std::size_t nlines, std::size_t ncols, std::uint32_t* dst,
+                 std::size_t first, std::size_t last)
+  {
+    Census<2>(src, nlines, ncols, dst, first, last);
+  }
+
+  void Census7x7(const double* src, std::size_t nlines, std::size_t ncols, std::uint64_t* dst,
+                 std::size_t first, std::size_t last)
+  {
+    Census<3>(src, nlines, ncols, dst, first, last);
+  }
+
+  // Sum of the Hamming distances of two blocks of census words. It stops once a whole line exceeds the bound.
+  template<class Word>
+  double BlockHamming(const Word* a, const Word* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    std::size_t sum = 0;
+
+    for(std::size_t lin = 0; lin < bsize; ++lin)
+    {
+      const Word* OF_RESTRICT la = a + lin * ncols;
+      const Word* OF_RESTRICT lb = b + lin * ncols;
+
+      for(std::size_t col = 0; col < bsize; ++col)
+        sum += PopCount(la[col] ^ lb[col]);
+
+      if(double(sum) > bound)
+        return double(sum);
+    }
+
+    return double(sum);
+  }
+
+  double BlockHamming32(const std::uint32_t* a, const std::uint32_t* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    return BlockHamming(a, b, ncols, bsize, bound);
+  }
+
+  double BlockHamming64(const std::uint64_t* a, const std::uint64_t* b, std::size_t ncols, std::size_t bsize, double bound)
+  {
+    return BlockHamming(a, b, ncols, bsize, bound);
+  }
+
+  // Sums of the cube differences of one fixed-point pixel, from the columns c and c1 = c + 1 (clamped) of two lines
+  inline void DerivativesFixedPixel(const std::int16_t* a0, const std::int16_t* a1, const std::int16_t* b0, const std::int16_t* b1,
+                                    Index c, Index c1, std::int16_t& fx, std::int16_t& fy, std::int16_t& ft)
+  {
+    fx = std::int16_t(a0[c1] - a0[c] + a1[c1] - a1[c] + b0[c1] - b0[c] + b1[c1] - b1[c]);
+    fy = std::int16_t(a1[c] - a0[c] + a1[c1] - a0[c1] + b1[c] - b0[c] + b1[c1] - b0[c1]);
+    ft = std::int16_t(b0[c] - a0[c] + b0[c1] - a0[c1] + b1[c] - a1[c] + b1[c1] - a1[c1]);
+  }
+
+  void DerivativesFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                        std::int16_t* fx, std::int16_t* fy, std::int16_t* ft, std::size_t first, std::size_t last)
+  {
+    const Index nl = nlines, nc = ncols;
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      const Index l1 = Clamp(lin + 1, nl);
+
+      const std::int16_t* OF_RESTRICT a0 = a + lin * nc;
+      const std::int16_t* OF_RESTRICT a1 = a + l1 * nc;
+      const std::int16_t* OF_RESTRICT b0 = b + lin * nc;
+      const std::int16_t* OF_RESTRICT b1 = b + l1 * nc;
+
+      std::int16_t* OF_RESTRICT ox = fx + lin * nc;
+      std::int16_t* OF_RESTRICT oy = fy + lin * nc;
+      std::int16_t* OF_RESTRICT ot = ft + lin * nc;
+
+      for(Index col = 0; col < nc - 1; ++col)
+        DerivativesFixedPixel(a0, a1, b0, b1, col, col + 1, ox[col], oy[col], ot[col]);
+
+      // The last column is clamped
+      if(nc > 0)
+        DerivativesFixedPixel(a0, a1, b0, b1, nc - 1, nc - 1, ox[nc - 1], oy[nc - 1], ot[nc - 1]);
+    }
+  }
+
+  // Window sums of a * b, separable: vertical sums of the products of each column, then horizontal sums of the
+  // vertical ones, accumulated in Sum and rounded to Out. The order of the sums is the same for all instruction sets.
+  template<class T, class Sum, class Out>
+  void SeparableWindowSum(const T* a, const T* b, std::size_t nlines, std::size_t ncols,
+                          std::size_t ksize, Out* dst, std::size_t first, std::size_t last)
+  {
+    const Index nl = nlines, nc = ncols, r = Index(ksize) / 2;
+
+    if(nc == 0)
+      return;
+
+    // Vertical sums of one line, with r clamped columns on each side, and the horizontal sums
+    Sum* column = new Sum[nc + 2 * r];
+    Sum* row = new Sum[nc];
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      // Not restrict: the clamped columns are written through both pointers
+      Sum* vertical = column + r;
+
+      for(Index col = 0; col < nc; ++col)
+        vertical[col] = 0;
+
+      for(Index dl = -r; dl <= r; ++dl)
+      {
+        const Index l = Clamp(lin + dl, nl);
+
+        const T* OF_RESTRICT la = a + l * nc;
+        const T* OF_RESTRICT lb = b + l * nc;
+
+        for(Index col = 0; col < nc; ++col)
+          vertical[col] += Sum(la[col]) * Sum(lb[col]);
+      }
+
+      for(Index k = 0; k < r; ++k)
+      {
+        column[k] = vertical[0];
+        vertical[nc + k] = vertical[nc - 1];
+      }
+
+      Sum* OF_RESTRICT sums = row;
+
+      for(Index col = 0; col < nc; ++col)
+        sums[col] = 0;
+
+      for(Index dc = 0; dc <= 2 * r; ++dc)
+      {
+        const Sum* OF_RESTRICT shifted = column + dc;
+
+        for(Index col = 0; col < nc; ++col)
+          sums[col] += shifted[col];
+      }
+
+      Out* OF_RESTRICT out = dst + lin * nc;
+
+      for(Index col = 0; col < nc; ++col)
+        out[col] = Out(sums[col]);
+    }
+
+    delete [] column;
+    delete [] row;
+  }
+
+  // Integer sums are exact, so their order does not matter
+  void WindowSumFixed(const std::int16_t* a, const std::int16_t* b, std::size_t nlines, std::size_t ncols,
+                      std::size_t ksize, std::int32_t* dst, std::size_t first, std::size_t last)
+  {
+    SeparableWindowSum<std::int16_t, std::int32_t, std::int32_t>(a, b, nlines, ncols, ksize, dst, first, last);
+  }
+
+  // The products of floats are exact in double
+  void WindowSumFloat(const float* a, const float* b, std::size_t nlines, std::size_t ncols,
+                      std::size_t ksize, double* dst, std::size_t first, std::size_t last)
+  {
+    SeparableWindowSum<float, double, double>(a, b, nlines, ncols, ksize, dst, first, last);
+  }
+
+  // Adds x to the compensated sum (hi, lo): hi + x is split into its rounded value and its exact rounding error
+  // (Knuth's TwoSum), which is accumulated in lo. It needs the IEEE rounding of each operation (no contraction).
+  inline void CompensatedAdd(double& hi, double& lo, double x)
+  {
+    const double sum = hi + x;
+    const double bx = sum - hi;
+    lo += (hi - (sum - bx)) + (x - bx);
+    hi = sum;
+  }
+
+  // Box sums of a * b (Product) or of a, by running sums: the vertical sums of the columns are updated by adding the
+  // entering line and subtracting the leaving one, and the horizontal sums of a line by adding the entering column and
+  // subtracting the leaving one. Each band starts from the direct vertical sums of its first line.
+  // The running sums are compensated, so the rounding errors of the terms that left the window are about eps^2
+  // of their magnitude instead of eps. The nonzero terms of each sum are also counted, and a sum without any is
+  // exactly zero: the flat regions next to texture keep zero window sums (and determinants), as the direct sums.
+  template<bool Product>
+  void RunningBoxSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+                     std::size_t ksize, double* dst, std::size_t first, std::size_t last)
+  {
+    const Index nl = nlines, nc = ncols, r = Index(ksize) / 2, width = nc + 2 * r;
+
+    if(nc == 0 || first >= last)
+      return;
+
+    // Compensated vertical sums of the current line (hi + lo) and their numbers of nonzero terms,
+    // with r clamped columns on each side
+    double* hi = new double[width];
+    double* lo = new double[width];
+    Index* counts = new Index[width];
+
+    // Not restrict: the clamped columns are written through both pointers
+    double* vhi = hi + r;
+    double* vlo = lo + r;
+    Index* nonzero = counts + r;
+
+    for(Index col = 0; col < nc; ++col)
+    {
+      vhi[col] = 0.0;
+      vlo[col] = 0.0;
+      nonzero[col] = 0;
+    }
+
+    for(Index dl = -r; dl <= r; ++dl)
+    {
+      const Index l = Clamp(Index(first) + dl, nl);
+
+      const double* OF_RESTRICT la = a + l * nc;
+      const double* OF_RESTRICT lb = b + l * nc;
+
+      for(Index col = 0; col < nc; ++col)
+      {
+        const double term = Product ? la[col] * lb[col] : la[col];
+        CompensatedAdd(vhi[col], vlo[col], term);
+        nonzero[col] += Index(term != 0.0);
+      }
+    }
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      // The clamped borders enter and leave the same line: nothing changes
+      const Index in = Clamp(lin + r, nl), out = Clamp(lin - r - 1, nl);
+
+      if(lin != Index(first) && in != out)
+      {
+        const double* OF_RESTRICT ia = a + in * nc;
+        const double* OF_RESTRICT ib = b + in * nc;
+        const double* OF_RESTRICT oa = a + out * nc;
+        const double* OF_RESTRICT ob = b + out * nc;
+
+        for(Index col = 0; col < nc; ++col)
+        {
+          const double entering = Product ? ia[col] * ib[col] : ia[col];
+          const double leaving = Product ? oa[col] * ob[col] : oa[col];
+
+          double h = vhi[col], l = vlo[col];
+          CompensatedAdd(h, l, entering);
+          CompensatedAdd(h, l, -leaving);
+
+          nonzero[col] += Index(entering != 0.0) - Index(leaving != 0.0);
+
+          vhi[col] = nonzero[col] != 0 ? h : 0.0;
+          vlo[col] = nonzero[col] != 0 ? l : 0.0;
+        }
+      }
+
+      for(Index k = 0; k < r; ++k)
+      {
+        hi[k] = vhi[0];
+        lo[k] = vlo[0];
+        counts[k] = nonzero[0];
+        vhi[nc + k] = vhi[nc - 1];
+        vlo[nc + k] = vlo[nc - 1];
+        nonzero[nc + k] = nonzero[nc - 1];
+      }
+
+      double* OF_RESTRICT o = dst + lin * nc;
+
+      double shi = 0.0, slo = 0.0;
+      Index columns = 0; // Number of columns of the window with nonzero terms
+
+      for(Index dc = 0; dc <= 2 * r; ++dc)
+      {
+        CompensatedAdd(shi, slo, hi[dc]);
+        slo += lo[dc];
+        columns += Index(counts[dc] != 0);
+      }
+
+      o[0] = shi + slo;
+
+      for(Index col = 1; col < nc; ++col)
+      {
+        const Index e = col + 2 * r, x = col - 1;
+
+        CompensatedAdd(shi, slo, hi[e]);
+        CompensatedAdd(shi, slo, -hi[x]);
+        slo += lo[e] - lo[x];
+
+        columns += Index(counts[e] != 0) - Index(counts[x] != 0);
+
+        if(columns == 0)
+          shi = slo = 0.0;
+
+        o[col] = shi + slo;
+      }
+    }
+
+    delete [] hi;
+    delete [] lo;
+    delete [] counts;
+  }
+
+  void BoxSum(const double* a, const double* b, std::size_t nlines, std::size_t ncols,
+              std::size_t ksize, double* dst, std::size_t first, std::size_t last)
+  {
+    if(b == 0)
+      return RunningBoxSum<false>(a, a, nlines, ncols, ksize, dst, first, last);
+
+    RunningBoxSum<true>(a, b, nlines, ncols, ksize, dst, first, last);
+  }
+
+  void WarpFixed(const std::int16_t* OF_RESTRICT src, const double* OF_RESTRICT u, const double* OF_RESTRICT v, double scale,
+                 std::size_t nlines, std::size_t ncols, std::int16_t* OF_RESTRICT dst, std::size_t first, std::size_t last)
+  {
+    const Index nl = nlines, nc = ncols;
+
+    for(Index lin = first; lin < Index(last); ++lin)
+    {
+      for(Index col = 0; col < nc; ++col)
+      {
+        const Index i = lin * nc + col;
+
+        // Destination pixel, in 1/256 pixel
+        const Index py = Index(std::floor((lin - scale * v[i]) * 256.0 + 0.5));
+        const Index px = Index(std::floor((col - scale * u[i]) * 256.0 + 0.5));
+
+        // Pixel and sub-pixel parts, as Warp: negative positions take the first pixel
+        const Index y = py > 0 ? py >> 8 : 0;
+        const Index x = px > 0 ? px >> 8 : 0;
+        const std::int32_t alphay = std::int32_t(py >= 0 ? py & 255 : (-py < 256 ? -py : 256));
+        const std::int32_t alphax = std::int32_t(px >= 0 ? px & 255 : (-px < 256 ? -px : 256));
+
+        const Index y0 = Clamp(y, nl), y1 = Clamp(Reflect(y, 1, nl), nl);
+        const Index x0 = Clamp(x, nc), x1 = Clamp(Reflect(x, 1, nc), nc);
+
+        // Bilinear interpolation with 16 fractional bits, rounded
+        std::int32_t value = (256 - alphax) * (256 - alphay) * src[y0 * nc + x0];
+        value += alphax * (256 - alphay) * src[y0 * nc + x1];
+        value += (256 - alphax) * alphay * src[y1 * nc + x0];
+        value += alphax * alphay * src[y1 * nc + x1];
+
+        dst[i] = std::int16_t((value + 32768) >> 16);
+      }
+    }
+  }
+
+  of::KernelTable MakeKernelTable(const char* isa)
+  {
+    of::KernelTable table = { isa, Filter2D, Derivatives<double>, WindowSum, Warp<double>, LocalAverage<double>,
+                              HSUpdate<double>, BlockSAD, BlockSSD, BlockNCC,
+                              Census5x5, Census7x7, BlockHamming32, BlockHamming64,
+                              DerivativesFixed, WindowSumFixed, WarpFixed,
+                              Derivatives<float>, WindowSumFloat, Warp<float>, LocalAverage<float>, HSUpdate<float>,
+                              BoxSum };
+    return table;
+  }
+}
+
+#endif // __OF_INTERNAL_KERNELS_IMPL_H
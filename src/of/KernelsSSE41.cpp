@@ -0,0 +1,17 @@
+/*!
+  \file src/of/KernelsSSE41.cpp
+  \brief SSE4.1 variant of the hot image kernels. It is compiled with the SSE4.1 flags (see Kernels.h).
+  \author Douglas Uba
+*/
+
+#ifdef OF_HAVE_SSE41_KERNELS
+
+#include "KernelsImpl.h"
+
+const of::KernelTable& of::GetSSE41Kernels()
+{
+  static const KernelTable table = MakeKernelTable("sse4.1");
+  return table;
+}
+
+#endif // OF_HAVE_SSE41_KERNELS
@@ -9,14 +9,42 @@
   \author Douglas Uba
 */
 
+#include "Census.h"
 #include "Config.h"
+#include "Exception.h"
+#include "FixedPoint.h"
 #include "Image.h"
+#include "Kernels.h"
 #include "LucasKanade.h"
+#include "RecursiveGaussian.h"
+#include "RowSink.h"
+
+// STL
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace
+{
+  // Adds x to the compensated sum (hi, lo), as the running sums of KernelTable::boxSum
+  inline void CompensatedAdd(double& hi, double& lo, double x)
+  {
+    const double sum = hi + x;
+    const double bx = sum - hi;
+    lo += (hi - (sum - bx)) + (x - bx);
+    hi = sum;
+  }
+}
 
 of::LucasKanade::LucasKanade(Image* a, Image* b)
   : OpticalFlow(a, b),
     m_ksize(OF_DEFAULT_LK_KERNEL_SIZE),
-    m_maxIterations(1)
+    m_maxIterations(1),
+    m_dataTerm(OF_DEFAULT_DATA_TERM),
+    m_precision(OF_DEFAULT_PRECISION),
+    m_window(OF_DEFAULT_LK_WINDOW),
+    m_sigma(OF_DEFAULT_LK_GAUSSIAN_SIGMA)
 {
 }
 
@@ -28,6 +56,22 @@ void of::LucasKanade::compute()
 {
   initialize();
 
+  StatsScope scope(m_stats, "compute", m_u->getNPixels());
+
+  const bool intensityBox = m_dataTerm == OF_INTENSITY_DATA_TERM && m_window == OF_BOX_WINDOW;
+
+  if(m_precision == OF_FIXED_PRECISION && intensityBox)
+  {
+    computeFixed();
+    return;
+  }
+
+  if(m_precision == OF_MIXED_PRECISION && intensityBox)
+  {
+    computeMixed();
+    return;
+  }
+
   // Auxiliary arrays
   Size size = m_u->getSize();
   Image* sumfx2 = new Image(size);
@@ -44,24 +88,39 @@ void of::LucasKanade::compute()
     computeDerivativeImages(currentImage, m_imgb);
 
     // Build equation arrays
-    buildMatrix(sumfx2, m_fx, m_fx);
-    buildMatrix(sumfy2, m_fy, m_fy);
-    buildMatrix(sumfxfy, m_fx, m_fy);
-    buildMatrix(sumfxft, m_fx, m_ft);
-    buildMatrix(sumfyft, m_fy, m_ft);
+    if(m_dataTerm == OF_CENSUS_DATA_TERM)
+    {
+      Image* const sums[5] = { sumfx2, sumfy2, sumfxfy, sumfxft, sumfyft };
+      buildCensusMatrices(currentImage, m_imgb, sums);
+    }
+    else
+    {
+      StatsScope scope(m_stats, "window-sums", size.npixels);
 
-    for(std::size_t i = 0; i < size.npixels; ++i)
+      buildMatrix(sumfx2, m_fx, m_fx);
+      buildMatrix(sumfy2, m_fy, m_fy);
+      buildMatrix(sumfxfy, m_fx, m_fy);
+      buildMatrix(sumfxft, m_fx, m_ft);
+      buildMatrix(sumfyft, m_fy, m_ft);
+    }
+
+    // Solve the 2 x 2 system of each pixel
     {
-      double d = sumfx2->getPixel(i) * sumfy2->getPixel(i) - sumfxfy->getPixel(i) * sumfxfy->getPixel(i);
+      StatsScope scope(m_stats, "solve", size.npixels);
 
-      if(d == 0)
-        continue;
+      for(std::size_t i = 0; i < size.npixels; ++i)
+      {
+        double d = sumfx2->getPixel(i) * sumfy2->getPixel(i) - sumfxfy->getPixel(i) * sumfxfy->getPixel(i);
 
-      double u = (sumfxfy->getPixel(i) * sumfyft->getPixel(i) - sumfy2->getPixel(i) * sumfxft->getPixel(i)) / d;
-      double v = (sumfxft->getPixel(i) * sumfxfy->getPixel(i) - sumfx2->getPixel(i) * sumfyft->getPixel(i)) / d;
+        if(d == 0)
+          continue;
 
-      m_u->setPixel(i, m_u->getPixel(i) + u);
-      m_v->setPixel(i, m_v->getPixel(i) + v);
+        double u = (sumfxfy->getPixel(i) * sumfyft->getPixel(i) - sumfy2->getPixel(i) * sumfxft->getPixel(i)) / d;
+        double v = (sumfxft->getPixel(i) * sumfxfy->getPixel(i) - sumfx2->getPixel(i) * sumfyft->getPixel(i)) / d;
+
+        m_u->setPixel(i, m_u->getPixel(i) + u);
+        m_v->setPixel(i, m_v->getPixel(i) + v);
+      }
     }
 
     if(m_maxIterations == 1)
@@ -74,6 +133,11 @@ void of::LucasKanade::compute()
     currentImage = warp(m_imga, m_u, m_v);
   }
 
+  if(currentImage != m_imga)
+    delete currentImage;
+
+  m_stats.setCounter("iterations", m_maxIterations);
+
   delete sumfx2;
   delete sumfy2;
   delete sumfxfy;
@@ -91,21 +155,494 @@ void of::LucasKanade::setMaxNumberOfIterations(std::size_t n)
   m_maxIterations = n;
 }
 
+void of::LucasKanade::setDataTerm(const std::string& name)
+{
+  std::vector<std::string> terms = Census::getDataTerms();
+  if(std::find(terms.begin(), terms.end(), name) == terms.end())
+    throw Exception("Unknown data term: " + name);
+
+  m_dataTerm = name;
+}
+
+void of::LucasKanade::setPrecision(const std::string& name)
+{
+  std::vector<std::string> precisions = FixedPoint::getPrecisions();
+  if(std::find(precisions.begin(), precisions.end(), name) == precisions.end())
+    throw Exception("Unknown precision: " + name);
+
+  m_precision = name;
+}
+
+void of::LucasKanade::setWindow(const std::string& name)
+{
+  std::vector<std::string> windows = RecursiveGaussian::getWindows();
+  if(std::find(windows.begin(), windows.end(), name) == windows.end())
+    throw Exception("Unknown window: " + name);
+
+  m_window = name;
+}
+
+void of::LucasKanade::setGaussianSigma(double sigma)
+{
+  if(!(sigma >= OF_MIN_GAUSSIAN_SIGMA))
+    throw Exception("The Gaussian sigma is too small for the recursive filter");
+
+  m_sigma = sigma;
+}
+
+void of::LucasKanade::computeFixed()
+{
+  const std::size_t bits = FixedPoint::getWindowSumBits(m_ksize);
+  if(bits == 0)
+    throw Exception("The kernel size is too large for the fixed precision");
+
+  const Size size = m_u->getSize();
+  const std::size_t n = size.npixels;
+
+  FixedPoint fixed(m_imga, m_imgb, bits);
+
+  std::vector<std::int16_t> a, b;
+  {
+    StatsScope scope(m_stats, "quantize", n * 2);
+
+    fixed.quantize(m_imga, a);
+    fixed.quantize(m_imgb, b);
+  }
+
+  // Derivatives (times 4) and window sums of fx * fx, fy * fy, fx * fy, fx * ft and fy * ft
+  std::vector<std::int16_t> fx(n), fy(n), ft(n), warped;
+  std::vector<std::int32_t> sums[5];
+  for(std::size_t p = 0; p < 5; ++p)
+    sums[p].resize(n);
+
+  const std::int16_t* current = n == 0 ? 0 : &a[0];
+
+  for(std::size_t it = 0; it < m_maxIterations && n != 0; ++it)
+  {
+    {
+      StatsScope scope(m_stats, "derivatives", n);
+
+      Kernels::derivativesFixed(current, &b[0], size.nlines, size.ncols, &fx[0], &fy[0], &ft[0]);
+    }
+
+    {
+      StatsScope scope(m_stats, "window-sums", n);
+
+      Kernels::windowSumFixed(&fx[0], &fx[0], size.nlines, size.ncols, m_ksize, &sums[0][0]);
+      Kernels::windowSumFixed(&fy[0], &fy[0], size.nlines, size.ncols, m_ksize, &sums[1][0]);
+      Kernels::windowSumFixed(&fx[0], &fy[0], size.nlines, size.ncols, m_ksize, &sums[2][0]);
+      Kernels::windowSumFixed(&fx[0], &ft[0], size.nlines, size.ncols, m_ksize, &sums[3][0]);
+      Kernels::windowSumFixed(&fy[0], &ft[0], size.nlines, size.ncols, m_ksize, &sums[4][0]);
+    }
+
+    // The scale of the derivatives cancels in the solution. The products of the sums fit in 63 bits.
+    {
+      StatsScope scope(m_stats, "solve", n);
+
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        const std::int64_t sxx = sums[0][i], syy = sums[1][i], sxy = sums[2][i], sxt = sums[3][i], syt = sums[4][i];
+
+        const std::int64_t d = sxx * syy - sxy * sxy;
+
+        if(d == 0)
+          continue;
+
+        const double u = double(sxy * syt - syy * sxt) / double(d);
+        const double v = double(sxt * sxy - sxx * syt) / double(d);
+
+        m_u->setPixel(i, m_u->getPixel(i) + u);
+        m_v->setPixel(i, m_v->getPixel(i) + v);
+      }
+    }
+
+    if(m_maxIterations == 1)
+      break;
+
+    // Iterative warp
+    {
+      StatsScope scope(m_stats, "warp", n);
+
+      warped.resize(n);
+      Kernels::warpFixed(&a[0], m_u->getBuffer(), m_v->getBuffer(), 1.0, size.nlines, size.ncols, &warped[0]);
+      current = &warped[0];
+    }
+  }
+
+  // Derivative images, in intensity units
+  const double unit = 1.0 / (4.0 * fixed.getScale());
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    m_fx->setPixel(i, fx[i] * unit);
+    m_fy->setPixel(i, fy[i] * unit);
+    m_ft->setPixel(i, ft[i] * unit);
+  }
+
+  m_stats.setCounter("iterations", m_maxIterations);
+  m_stats.setCounter("fixed-bits", bits);
+}
+
+void of::LucasKanade::computeMixed()
+{
+  const Size size = m_u->getSize();
+  const std::size_t n = size.npixels;
+
+  std::vector<float> a, b;
+  {
+    StatsScope scope(m_stats, "convert", n * 2);
+
+    a.assign(m_imga->getBuffer(), m_imga->getBuffer() + n);
+    b.assign(m_imgb->getBuffer(), m_imgb->getBuffer() + n);
+  }
+
+  std::vector<float> fx(n), fy(n), ft(n), u(n, 0.0f), v(n, 0.0f), warped;
+  std::vector<double> sums[5]; // accumulated in double, as the 2 x 2 solves
+  for(std::size_t p = 0; p < 5; ++p)
+    sums[p].resize(n);
+
+  const float* current = n == 0 ? 0 : &a[0];
+
+  for(std::size_t it = 0; it < m_maxIterations && n != 0; ++it)
+  {
+    {
+      StatsScope scope(m_stats, "derivatives", n);
+
+      Kernels::derivatives(current, &b[0], size.nlines, size.ncols, &fx[0], &fy[0], &ft[0]);
+    }
+
+    {
+      StatsScope scope(m_stats, "window-sums", n);
+
+      Kernels::windowSum(&fx[0], &fx[0], size.nlines, size.ncols, m_ksize, &sums[0][0]);
+      Kernels::windowSum(&fy[0], &fy[0], size.nlines, size.ncols, m_ksize, &sums[1][0]);
+      Kernels::windowSum(&fx[0], &fy[0], size.nlines, size.ncols, m_ksize, &sums[2][0]);
+      Kernels::windowSum(&fx[0], &ft[0], size.nlines, size.ncols, m_ksize, &sums[3][0]);
+      Kernels::windowSum(&fy[0], &ft[0], size.nlines, size.ncols, m_ksize, &sums[4][0]);
+    }
+
+    // The determinant cancels the leading digits of the sums: it is computed in double, from the double sums
+    {
+      StatsScope scope(m_stats, "solve", n);
+
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        const double sxx = sums[0][i], syy = sums[1][i], sxy = sums[2][i], sxt = sums[3][i], syt = sums[4][i];
+
+        const double d = sxx * syy - sxy * sxy;
+
+        if(d == 0)
+          continue;
+
+        u[i] += float((sxy * syt - syy * sxt) / d);
+        v[i] += float((sxt * sxy - sxx * syt) / d);
+      }
+    }
+
+    if(m_maxIterations == 1)
+      break;
+
+    // Iterative warp
+    {
+      StatsScope scope(m_stats, "warp", n);
+
+      warped.resize(n);
+      Kernels::warp(&a[0], &u[0], &v[0], 1.0, size.nlines, size.ncols, &warped[0]);
+      current = &warped[0];
+    }
+  }
+
+  std::copy(u.begin(), u.end(), m_u->getBuffer());
+  std::copy(v.begin(), v.end(), m_v->getBuffer());
+  std::copy(fx.begin(), fx.end(), m_fx->getBuffer());
+  std::copy(fy.begin(), fy.end(), m_fy->getBuffer());
+  std::copy(ft.begin(), ft.end(), m_ft->getBuffer());
+
+  m_stats.setCounter("iterations", m_maxIterations);
+}
+
+void of::LucasKanade::stream(RowSink& sink)
+{
+  if(m_dataTerm != OF_INTENSITY_DATA_TERM || m_precision != OF_DOUBLE_PRECISION || m_window != OF_BOX_WINDOW || m_maxIterations != 1)
+    throw Exception("The streaming Lucas & Kanade needs the intensity data term, the double precision, the box window and one iteration");
+
+  m_stats.clear();
+
+  const Size size = m_imga->getSize();
+  const std::size_t nl = size.nlines, nc = size.ncols, r = m_ksize / 2, k = 2 * r + 1;
+
+  const double* a = m_imga->getBuffer();
+  const double* b = m_imgb->getBuffer();
+
+  const KernelTable& table = Kernels::get();
+
+  // Ring of the products fx * fx, fy * fy, fx * fy, fx * ft and fy * ft of the last k lines (slot: line % k)
+  std::vector<double> products(5 * k * nc);
+  std::vector<double> fx(nc), fy(nc), ft(nc);
+
+  // Running vertical sums of each product (compensated: hi + lo) and their numbers of nonzero terms,
+  // with r clamped columns on each side, and the window sums of a line. As KernelTable::boxSum, a sum
+  // without nonzero terms is exactly zero.
+  const std::size_t width = nc + 2 * r;
+  std::vector<double> vhi(5 * width, 0.0), vlo(5 * width, 0.0), sums(5 * nc);
+  std::vector<std::ptrdiff_t> counts(5 * width, 0);
+  std::vector<double> u(nc), v(nc);
+
+  double times[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+  // Products of the given line. The view of the line and the next one clamps as the whole image.
+  auto computeProducts = [&](std::size_t l)
+  {
+    const double start = Stats::now();
+
+    table.derivatives(a + l * nc, b + l * nc, l + 1 < nl ? 2 : 1, nc, &fx[0], &fy[0], &ft[0], 0, 1);
+
+    double* p = &products[(l % k) * 5 * nc];
+    for(std::size_t col = 0; col < nc; ++col)
+    {
+      p[col] = fx[col] * fx[col];
+      p[nc + col] = fy[col] * fy[col];
+      p[2 * nc + col] = fx[col] * fy[col];
+      p[3 * nc + col] = fx[col] * ft[col];
+      p[4 * nc + col] = fy[col] * ft[col];
+    }
+
+    times[0] += Stats::now() - start;
+  };
+
+  // Adds the products of the given line (in the ring) to the vertical sums, times the given sign
+  auto accumulate = [&](std::size_t l, double sign)
+  {
+    const double* line = &products[(l % k) * 5 * nc];
+    for(std::size_t p = 0; p < 5; ++p)
+    {
+      double* hi = &vhi[p * width + r];
+      double* lo = &vlo[p * width + r];
+      std::ptrdiff_t* nonzero = &counts[p * width + r];
+
+      for(std::size_t col = 0; col < nc; ++col)
+      {
+        const double term = line[p * nc + col];
+
+        double h = hi[col], l = lo[col];
+        CompensatedAdd(h, l, sign * term);
+
+        const std::ptrdiff_t n = nonzero[col] + std::ptrdiff_t(sign) * std::ptrdiff_t(term != 0.0);
+        nonzero[col] = n;
+        hi[col] = n ? h : 0.0;
+        lo[col] = n ? l : 0.0;
+      }
+    }
+  };
+
+  sink.begin(size);
+
+  for(std::size_t lin = 0; lin < nl && nc != 0; ++lin)
+  {
+    double start = Stats::now();
+    const double derivatives = times[0];
+
+    // Window sums: running vertical sums of the ring lines (clamped), then running horizontal sums (clamped)
+    const std::size_t in = std::min(lin + r, nl - 1), out = lin > r ? lin - r - 1 : 0;
+
+    if(lin == 0)
+    {
+      for(std::size_t l = 0; l <= in; ++l)
+        computeProducts(l);
+
+      for(std::size_t dl = 0; dl < k; ++dl)
+        accumulate(std::min(dl > r ? dl - r : 0, nl - 1), 1.0);
+    }
+    else if(in != out)
+    {
+      // The entering line takes the ring slot of the leaving one, which is subtracted first
+      accumulate(out, -1.0);
+
+      if(in == lin + r)
+        computeProducts(in);
+
+      accumulate(in, 1.0);
+    }
+
+    for(std::size_t p = 0; p < 5; ++p)
+    {
+      double* hi = &vhi[p * width];
+      double* lo = &vlo[p * width];
+      std::ptrdiff_t* nonzero = &counts[p * width];
+
+      for(std::size_t c = 0; c < r; ++c)
+      {
+        hi[c] = hi[r];
+        lo[c] = lo[r];
+        nonzero[c] = nonzero[r];
+        hi[r + nc + c] = hi[r + nc - 1];
+        lo[r + nc + c] = lo[r + nc - 1];
+        nonzero[r + nc + c] = nonzero[r + nc - 1];
+      }
+
+      double* sum = &sums[p * nc];
+
+      double shi = 0.0, slo = 0.0;
+      std::ptrdiff_t columns = 0; // Number of columns of the window with nonzero terms
+
+      for(std::size_t dc = 0; dc < k; ++dc)
+      {
+        CompensatedAdd(shi, slo, hi[dc]);
+        slo += lo[dc];
+        columns += std::ptrdiff_t(nonzero[dc] != 0);
+      }
+
+      sum[0] = shi + slo;
+
+      for(std::size_t col = 1; col < nc; ++col)
+      {
+        const std::size_t e = col + 2 * r, x = col - 1;
+
+        CompensatedAdd(shi, slo, hi[e]);
+        CompensatedAdd(shi, slo, -hi[x]);
+        slo += lo[e] - lo[x];
+
+        columns += std::ptrdiff_t(nonzero[e] != 0) - std::ptrdiff_t(nonzero[x] != 0);
+        shi = columns ? shi : 0.0;
+        slo = columns ? slo : 0.0;
+
+        sum[col] = shi + slo;
+      }
+    }
+
+    double now = Stats::now();
+    times[1] += now - start - (times[0] - derivatives);
+    start = now;
+
+    // Solve the 2 x 2 system of each pixel
+    const double* sumfx2 = &sums[0];
+    const double* sumfy2 = &sums[nc];
+    const double* sumfxfy = &sums[2 * nc];
+    const double* sumfxft = &sums[3 * nc];
+    const double* sumfyft = &sums[4 * nc];
+
+    for(std::size_t col = 0; col < nc; ++col)
+    {
+      double d = sumfx2[col] * sumfy2[col] - sumfxfy[col] * sumfxfy[col];
+
+      if(d == 0)
+      {
+        u[col] = v[col] = 0.0;
+        continue;
+      }
+
+      u[col] = (sumfxfy[col] * sumfyft[col] - sumfy2[col] * sumfxft[col]) / d;
+      v[col] = (sumfxft[col] * sumfxfy[col] - sumfx2[col] * sumfyft[col]) / d;
+    }
+
+    now = Stats::now();
+    times[2] += now - start;
+    start = now;
+
+    sink.write(lin, &u[0], &v[0]);
+
+    times[3] += Stats::now() - start;
+  }
+
+  sink.end();
+
+  if(m_stats.isEnabled())
+  {
+    m_stats.addStage("derivatives", times[0], size.npixels);
+    m_stats.addStage("window-sums", times[1], size.npixels);
+    m_stats.addStage("solve", times[2], size.npixels);
+    m_stats.addStage("write", times[3], size.npixels);
+  }
+
+  m_stats.setCounter("iterations", 1);
+  m_stats.setCounter("buffer-bytes", (products.size() + fx.size() * 3 + vhi.size() * 2 + sums.size() + u.size() * 2) * sizeof(double) + counts.size() * sizeof(std::ptrdiff_t));
+}
+
 void of::LucasKanade::buildMatrix(Image* dst, Image* a, Image* b) const
 {
-  for(int lin = 0; lin < dst->getNLines(); ++lin)
+  if(m_window == OF_GAUSSIAN_WINDOW)
   {
-    for(int col = 0; col < dst->getNCols(); ++col)
+    const double* pa = a->getBuffer();
+    const double* pb = b->getBuffer();
+    double* out = dst->getBuffer();
+
+    for(std::size_t i = 0; i < dst->getNPixels(); ++i)
+      out[i] = pa[i] * pb[i];
+
+    RecursiveGaussian(m_sigma).filter(out, dst->getNLines(), dst->getNCols(), out);
+    return;
+  }
+
+  // Large windows use running sums
+  if(m_ksize >= OF_BOX_SUM_MIN_KERNEL_SIZE)
+    Kernels::boxSum(a->getBuffer(), b->getBuffer(), dst->getNLines(), dst->getNCols(), m_ksize, dst->getBuffer());
+  else
+    Kernels::windowSum(a->getBuffer(), b->getBuffer(), dst->getNLines(), dst->getNCols(), m_ksize, dst->getBuffer());
+}
+
+void of::LucasKanade::buildCensusMatrices(Image* a, Image* b, Image* const (&sums)[5]) const
+{
+  const Size size = a->getSize();
+  const std::size_t n = size.npixels;
+
+  // Products of the derivatives, summed over the channels. The window sums are linear, so they are applied once.
+  std::vector<double> products[5];
+  {
+    StatsScope scope(m_stats, "census", n);
+
+    // The contrast regularization follows the range of the first image
+    const double* pa = a->getBuffer();
+    const double range = n == 0 ? 0.0 : *std::max_element(pa, pa + n) - *std::min_element(pa, pa + n);
+    const double epsilon = OF_CENSUS_CONTRAST_EPSILON * range;
+
+    std::unique_ptr<Image> contrastA(Census::computeContrast(a, epsilon));
+    std::unique_ptr<Image> contrastB(Census::computeContrast(b, epsilon));
+
+    Image ca(size), cb(size);
+    std::vector<double> fx(n), fy(n), ft(n);
+
+    for(std::size_t p = 0; p < 5; ++p)
+      products[p].assign(n, 0.0);
+
+    for(std::size_t k = 0; k < Census::getNumberOfChannels(); ++k)
     {
-      double v = 0.0;
+      Census::computeChannel(a, contrastA.get(), k, &ca);
+      Census::computeChannel(b, contrastB.get(), k, &cb);
 
-      // for each window/kernel pixel
-      for(int lw = -(int(m_ksize) / 2); lw <= int(m_ksize) / 2; ++lw)
-        for(int cw = -(int(m_ksize) / 2); cw <= int(m_ksize) / 2; ++cw)
-          //v += a->getPixel(lin, lw, col, cw) * b->getPixel(lin, lw, col, cw);
-          v += a->getPixel(lin + lw, col + cw) * b->getPixel(lin + lw, col + cw);
+      Kernels::derivatives(ca.getBuffer(), cb.getBuffer(), size.nlines, size.ncols, &fx[0], &fy[0], &ft[0]);
 
-      dst->setPixel(lin, col, v);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        products[0][i] += fx[i] * fx[i];
+        products[1][i] += fy[i] * fy[i];
+        products[2][i] += fx[i] * fy[i];
+        products[3][i] += fx[i] * ft[i];
+        products[4][i] += fy[i] * ft[i];
+      }
     }
   }
+
+  StatsScope scope(m_stats, "window-sums", n);
+
+  if(m_window == OF_GAUSSIAN_WINDOW)
+  {
+    const RecursiveGaussian gaussian(m_sigma);
+
+    for(std::size_t p = 0; p < 5; ++p)
+      gaussian.filter(&products[p][0], size.nlines, size.ncols, sums[p]->getBuffer());
+
+    return;
+  }
+
+  if(m_ksize >= OF_BOX_SUM_MIN_KERNEL_SIZE)
+  {
+    for(std::size_t p = 0; p < 5; ++p)
+      Kernels::boxSum(&products[p][0], 0, size.nlines, size.ncols, m_ksize, sums[p]->getBuffer());
+
+    return;
+  }
+
+  const std::vector<double> ones(n, 1.0);
+
+  for(std::size_t p = 0; p < 5; ++p)
+    Kernels::windowSum(&products[p][0], &ones[0], size.nlines, size.ncols, m_ksize, sums[p]->getBuffer());
 }
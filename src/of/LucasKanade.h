@@ -14,12 +14,35 @@
 
 #include "OpticalFlow.h"
 
+// STL
+#include <string>
+
 namespace of
 {
+// Forward declarations
+  class RowSink;
+
   /*!
     \class LucasKanade
 
     \brief This class implements the Lucas & Kanade method of estimating optical flow.
+
+    The data term is the brightness constancy of the intensities, or of the soft census channels
+    (see Census), which are robust to brightness changes between the images.
+
+    The fixed precision runs the intensity data term on integers (see FixedPoint): 16-bit images and derivatives,
+    32-bit window sums and fixed-point warps, so each SIMD register holds 4 times more values than with doubles.
+    The 2 x 2 systems are solved exactly in 64-bit integers, and only the final divisions use doubles.
+    The number of bits of the images depends on the window size, so that the window sums never overflow
+    (e.g. 9 bits for 15 x 15 windows, 11 bits for 5 x 5). 8-bit images are exact; wider ones lose their lowest bits.
+
+    The mixed precision keeps the images, derivatives and flow in float, which halves the memory traffic of each
+    iteration. The window sums are accumulated and kept in double, and the 2 x 2 systems are solved in double.
+
+    The sums of the equations use a flat ksize x ksize window, or a gaussian window computed by recursive filtering.
+
+    The streaming mode (see stream) computes the flow line by line, from a ring buffer of the last ksize lines
+    of derivative products, so its memory is O(ncols x ksize) instead of about 10 full images.
   */
   class OFEXPORT LucasKanade : public OpticalFlow
   {
@@ -44,6 +67,9 @@ namespace of
         \brief This methods sets the kernel size that will be used.
 
         \param size The kernel size. e.g. (5 = 5 x 5)
+
+        \note The sizes 3, 5, 7, 9, 15 and 21 use specialized (faster) window sums. From OF_BOX_SUM_MIN_KERNEL_SIZE,
+              the box window sums use running sums, whose cost does not depend on the size.
       */
       void setKernelSize(std::size_t size);
 
@@ -54,14 +80,95 @@ namespace of
       */
       void setMaxNumberOfIterations(std::size_t n);
 
+      /*!
+        \brief This methods sets the data term.
+
+        \param name The data term. (intensity or census)
+
+        \exception Exception It throws an exception if the data term is unknown.
+
+        \note The census data term sums the equations of the 8 soft census channels, so it computes 8 derivative images instead of one.
+      */
+      void setDataTerm(const std::string& name);
+
+      /*!
+        \brief This methods sets the arithmetic precision.
+
+        \param name The precision. (double, fixed or mixed)
+
+        \exception Exception It throws an exception if the precision is unknown.
+
+        \note The census data term and the gaussian window always use doubles.
+      */
+      void setPrecision(const std::string& name);
+
+      /*!
+        \brief This methods sets the window of the sums of the equations.
+
+        \param name The window. (box: flat kernel size x kernel size window, or gaussian)
+
+        \exception Exception It throws an exception if the window is unknown.
+
+        \note The gaussian window weights the center more than the borders, so smaller windows keep the same
+              robustness. It is computed by recursive filtering (see RecursiveGaussian), whose cost does not depend
+              on sigma, ignores the kernel size and always uses doubles.
+      */
+      void setWindow(const std::string& name);
+
+      /*!
+        \brief This methods sets the standard deviation of the gaussian window.
+
+        \param sigma The standard deviation, in pixels.
+
+        \exception Exception It throws an exception if sigma is less than OF_MIN_GAUSSIAN_SIGMA.
+      */
+      void setGaussianSigma(double sigma);
+
+      /*!
+        \brief This method computes the flow line by line and writes each line to the given sink, in low memory.
+               Each line of (u,v) is the same of compute(), up to the rounding of the window sums.
+
+        \param sink The destination of the (u,v) lines.
+
+        \exception Exception It throws an exception if the data term is not intensity, the precision is not double,
+                              the window is not box or the maximum number of iterations is not 1 (the warps need the whole flow).
+
+        \note The flow images and the derivative images (getU, getFx, etc.) are not computed.
+               The stats report the stages "derivatives", "window-sums", "solve" and "write", and the counter "buffer-bytes".
+      */
+      void stream(RowSink& sink);
+
     private:
 
+      /*!
+        \brief Internal method that computes the flow with fixed-point arithmetic.
+
+        \exception Exception It throws an exception if the window is too large for 32-bit sums.
+      */
+      void computeFixed();
+
+      /*! \brief Internal method that computes the flow with float storage and double accumulation. */
+      void computeMixed();
+
       void buildMatrix(Image* dst, Image* a, Image* b) const;
 
+      /*!
+        \brief Internal method that builds the equation arrays from the soft census channels of the given images.
+
+        \param a The first image.
+        \param b The second image.
+        \param sums The window sums of fx * fx, fy * fy, fx * fy, fx * ft and fy * ft, summed over the channels.
+      */
+      void buildCensusMatrices(Image* a, Image* b, Image* const (&sums)[5]) const;
+
     private:
 
       std::size_t m_ksize;         //!< Kernel size. (Default: 15 x 15)
       std::size_t m_maxIterations; //!< Maximum number of iterations. (Default: 1)
+      std::string m_dataTerm;      //!< The data term. (intensity or census)
+      std::string m_precision;     //!< The arithmetic precision. (double, fixed or mixed)
+      std::string m_window;        //!< The window of the sums. (box or gaussian)
+      double m_sigma;              //!< The standard deviation of the gaussian window.
   };
 
 } // end namespace of
@@ -9,56 +9,130 @@
   \author Douglas Uba
 */
 
+#include "Census.h"
 #include "Config.h"
+#include "Exception.h"
+#include "FixedPoint.h"
 #include "Image.h"
+#include "Kernels.h"
 #include "LucasKanade.h"
 #include "LucasKanadeC2F.h"
+#include "PhaseCorrelation.h"
 #include "Pyramid.h"
+#include "RecursiveGaussian.h"
+#include "Trace.h"
 
 // STL
 #include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
 
 of::LucasKanadeC2F::LucasKanadeC2F(Image* a, Image* b)
   : OpticalFlow(a, b),
     m_ksize(OF_DEFAULT_LK_KERNEL_SIZE),
-    m_maxIterations(1)
+    m_maxIterations(1),
+    m_registration(OF_DEFAULT_REGISTRATION),
+    m_dataTerm(OF_DEFAULT_DATA_TERM),
+    m_precision(OF_DEFAULT_PRECISION),
+    m_window(OF_DEFAULT_LK_WINDOW),
+    m_sigma(OF_DEFAULT_LK_GAUSSIAN_SIGMA)
 {
   m_nLevels = Pyramid::getMaxNumberOfLevels(a);
-  m_pyra = new Pyramid(a, m_nLevels);
-  m_pyrb = new Pyramid(b, m_nLevels);
 }
 
 of::LucasKanadeC2F::LucasKanadeC2F(Image* a, Image* b, std::size_t nLevels)
   : OpticalFlow(a, b),
     m_nLevels(nLevels),
-    m_ksize(15),
-    m_maxIterations(1)
+    m_ksize(OF_DEFAULT_LK_KERNEL_SIZE),
+    m_maxIterations(1),
+    m_registration(OF_DEFAULT_REGISTRATION),
+    m_dataTerm(OF_DEFAULT_DATA_TERM),
+    m_precision(OF_DEFAULT_PRECISION),
+    m_window(OF_DEFAULT_LK_WINDOW),
+    m_sigma(OF_DEFAULT_LK_GAUSSIAN_SIGMA)
 {
-  m_pyra = new Pyramid(a, m_nLevels);
-  m_pyrb = new Pyramid(b, m_nLevels);
 }
 
 of::LucasKanadeC2F::~LucasKanadeC2F()
 {
-  delete m_pyra;
-  delete m_pyrb;
 }
 
 void of::LucasKanadeC2F::compute()
 {
+  m_stats.clear();
+
+  releaseResults();
+
+  StatsScope scope(m_stats, "compute", m_imga->getSize().npixels);
+
+  // Pre-registration: the second image is warped by the phase correlation flow, i.e. b'(x) = b(x + u0)
+  Image* imgb = m_imgb;
+  std::unique_ptr<Image> registered, u0, v0;
+
+  if(m_registration != OF_NO_REGISTRATION)
+  {
+    StatsScope scope(m_stats, "registration", m_imga->getSize().npixels);
+
+    Image* u = 0;
+    Image* v = 0;
+
+    PhaseCorrelation pc;
+    pc.estimateFlow(m_imga, m_imgb, m_registration == OF_TILE_REGISTRATION, u, v);
+
+    u0.reset(u);
+    v0.reset(v);
+
+    registered.reset(new Image(m_imgb->getSize()));
+    Kernels::warp(m_imgb->getBuffer(), u->getBuffer(), v->getBuffer(), -1.0,
+                  m_imgb->getNLines(), m_imgb->getNCols(), registered->getBuffer());
+
+    imgb = registered.get();
+  }
+
+  // The pyramids are refined (warped) level by level, so they are built on each computation.
+  // The coarsest level builds the finer ones; the images themselves are the finest level.
+  Pyramid* pyra = 0;
+  Pyramid* pyrb = 0;
+  {
+    StatsScope scope(m_stats, "pyramid", m_imga->getSize().npixels * 2);
+
+    pyra = new Pyramid(m_imga, m_nLevels);
+    pyrb = new Pyramid(imgb, m_nLevels);
+
+    pyra->getLevel(m_nLevels);
+    pyrb->getLevel(m_nLevels);
+  }
+
   Image* currentU = 0;
   Image* currentV = 0;
 
   for(int level = m_nLevels; level >= 0; --level)
   {
-    Image* a = m_pyra->getLevel(level);
-    Image* b = m_pyrb->getLevel(level);
+    std::ostringstream levelName;
+    levelName << "level-" << level;
+
+    TraceScope trace(levelName.str(), "level");
+
+    Image* a = pyra->getLevel(level);
+    Image* b = pyrb->getLevel(level);
 
     LucasKanade of(a, b);
     of.setKernelSize(m_ksize);
     of.setMaxNumberOfIterations(m_maxIterations);
+    of.setDataTerm(m_dataTerm);
+    of.setPrecision(m_precision);
+    of.setWindow(m_window);
+    of.setGaussianSigma(m_sigma);
+    of.setStatsEnabled(m_stats.isEnabled(), m_stats.isHardwareCountersEnabled());
     of.compute();
 
+    if(m_stats.isEnabled())
+    {
+      // Per level breakdown
+      m_stats.merge(of.getStats(), levelName.str() + "/");
+    }
+
     Image* u = of.getU();
     Image* v = of.getV();
 
@@ -77,29 +151,54 @@ void of::LucasKanadeC2F::compute()
       delete currentU;
       delete currentV;
 
-      Size nextsize = m_pyra->getLevel(level - 1)->getSize();
+      Size nextsize = pyra->getLevel(level - 1)->getSize();
 
       // Upsampling (u,v)
-      currentU = Pyramid::up(u, nextsize);
-      currentV = Pyramid::up(v, nextsize);
+      {
+        StatsScope scope(m_stats, "upsample", nextsize.npixels * 2);
+
+        currentU = Pyramid::up(u, nextsize);
+        currentV = Pyramid::up(v, nextsize);
+      }
 
       // Apply transformation
-      Image* warpForward = warp(m_pyra->getLevel(level - 1), currentU, currentV, true);
-      Image* warpBackward = warp(m_pyrb->getLevel(level - 1), currentU, currentV, false);
+      Image* warpForward = warp(pyra->getLevel(level - 1), currentU, currentV, true);
+      Image* warpBackward = warp(pyrb->getLevel(level - 1), currentU, currentV, false);
 
       // Update pyramids for next iteration
-      m_pyra->updateLevel(level - 1, warpForward);
-      m_pyrb->updateLevel(level - 1, warpBackward);
+      pyra->updateLevel(level - 1, warpForward);
+      pyrb->updateLevel(level - 1, warpBackward);
+
+      // This level is no longer needed
+      pyra->release(level);
+      pyrb->release(level);
     }
     else
     {
-      m_u = currentU;
-      m_v = currentV;
+      // The accumulated flow of the finest level, including its own refinement
+      delete currentU;
+      delete currentV;
+
+      m_u = u->clone();
+      m_v = v->clone();
       m_fx = of.getFx()->clone();
       m_fy = of.getFy()->clone();
       m_ft = of.getFt()->clone();
     }
   }
+
+  delete pyra;
+  delete pyrb;
+
+  // The flow is relative to the registered image
+  if(u0.get() != 0 && m_u != 0)
+  {
+    for(std::size_t i = 0; i < m_u->getNPixels(); ++i)
+    {
+      m_u->setPixel(i, m_u->getPixel(i) + u0->getPixel(i));
+      m_v->setPixel(i, m_v->getPixel(i) + v0->getPixel(i));
+    }
+  }
 }
 
 void of::LucasKanadeC2F::setKernelSize(std::size_t size)
@@ -112,52 +211,59 @@ void of::LucasKanadeC2F::setMaxNumberOfIterations(std::size_t n)
   m_maxIterations = n;
 }
 
-of::Image* of::LucasKanadeC2F::warp(Image* src, Image* u, Image* v, bool isForward) const
+void of::LucasKanadeC2F::setPreRegistration(const std::string& mode)
 {
-  const double noDataWarp = std::numeric_limits<double>::max();
+  std::vector<std::string> registrations = PhaseCorrelation::getRegistrations();
+  if(std::find(registrations.begin(), registrations.end(), mode) == registrations.end())
+    throw Exception("Unknown pre-registration: " + mode);
 
-  Image* warp = new Image(src->getSize());
-  warp->fill(noDataWarp);
+  m_registration = mode;
+}
 
-  // Apply transformation
-  for(int lin = 0; lin < warp->getNLines(); ++lin)
-  {
-    for(int col = 0; col < warp->getNCols(); ++col)
-    {
-      double wlin, wcol;
-      if(isForward)
-      {
-        wlin = lin - v->getPixel(lin, col) * 0.5;
-        wcol = col - u->getPixel(lin, col) * 0.5;
-      }
-      else // Backward
-      {
-        wlin = lin + v->getPixel(lin, col) * 0.5;
-        wcol = col + u->getPixel(lin, col) * 0.5;
-      }
+void of::LucasKanadeC2F::setDataTerm(const std::string& name)
+{
+  std::vector<std::string> terms = Census::getDataTerms();
+  if(std::find(terms.begin(), terms.end(), name) == terms.end())
+    throw Exception("Unknown data term: " + name);
 
-      // Get pixel part (integer)
-      int y = std::max(0, int(std::floor(wlin)));
-      int x = std::max(0, int(std::floor(wcol)));
+  m_dataTerm = name;
+}
 
-      // Get sub-pixel part (double)
-      double alphay = std::abs(wlin - y);
-      double alphax = std::abs(wcol - x);
+void of::LucasKanadeC2F::setPrecision(const std::string& name)
+{
+  std::vector<std::string> precisions = FixedPoint::getPrecisions();
+  if(std::find(precisions.begin(), precisions.end(), name) == precisions.end())
+    throw Exception("Unknown precision: " + name);
 
-      // Bilinear interpolation
-      double a = src->getPixel(y, 0, x, 0);
-      double b = src->getPixel(y, 0, x, 1);
-      double c = src->getPixel(y, 1, x, 0);
-      double d = src->getPixel(y, 1, x, 1);
+  m_precision = name;
+}
 
-      double value = (1.0 - alphax) * (1.0 - alphay) * a;
-      value += alphax * (1.0 - alphay) * b;
-      value += (1.0 - alphax) * alphay * c;
-      value += alphax * alphay * d;
+void of::LucasKanadeC2F::setWindow(const std::string& name)
+{
+  std::vector<std::string> windows = RecursiveGaussian::getWindows();
+  if(std::find(windows.begin(), windows.end(), name) == windows.end())
+    throw Exception("Unknown window: " + name);
 
-      warp->setPixel(lin, col, value);
-    }
-  }
+  m_window = name;
+}
+
+void of::LucasKanadeC2F::setGaussianSigma(double sigma)
+{
+  if(!(sigma >= OF_MIN_GAUSSIAN_SIGMA))
+    throw Exception("The Gaussian sigma is too small for the recursive filter");
+
+  m_sigma = sigma;
+}
+
+of::Image* of::LucasKanadeC2F::warp(Image* src, Image* u, Image* v, bool isForward) const
+{
+  StatsScope scope(m_stats, "warp", src->getSize().npixels);
+
+  Image* warp = new Image(src->getSize());
+
+  // Half of the vectors, forward (lin - v / 2, col - u / 2) or backward (lin + v / 2, col + u / 2)
+  Kernels::warp(src->getBuffer(), u->getBuffer(), v->getBuffer(), isForward ? 0.5 : -0.5,
+                warp->getNLines(), warp->getNCols(), warp->getBuffer());
 
   return warp;
 }
@@ -14,15 +14,26 @@
 
 #include "OpticalFlow.h"
 
+// STL
+#include <string>
+
 namespace of
 {
-// Forward declaration
-  class Pyramid;
-
   /*!
     \class LucasKanadeC2F
 
     \brief This class implements the Lucas & Kanade method of estimating optical flow with pyramids.
+
+    The second image may be pre-registered to the first one by phase correlation (see PhaseCorrelation): a global
+    translation, or per-tile translations. The pyramid then only has to recover the motion left around it,
+    so fewer levels are needed for large displacements. The registration flow is added to the result.
+
+    The census data term (see LucasKanade::setDataTerm) is used on every level, so the pyramid is robust
+    to brightness changes between the images. The precision (see LucasKanade::setPrecision) applies to the
+    estimation of each level. The pyramids, the upsampling and the warps between levels use doubles.
+
+    \note The stats of each pyramid level are reported with the "level-N/" prefix, and the pre-registration
+          as the "registration" stage.
   */
   class OFEXPORT LucasKanadeC2F : public OpticalFlow
   {
@@ -60,6 +71,9 @@ namespace of
         \brief This methods sets the kernel size that will be used.
 
         \param size The kernel size. e.g. (5 = 5 x 5)
+
+        \note The sizes 3, 5, 7, 9, 15 and 21 use specialized (faster) window sums. From OF_BOX_SUM_MIN_KERNEL_SIZE,
+              the box window sums use running sums, whose cost does not depend on the size.
       */
       void setKernelSize(std::size_t size);
 
@@ -70,6 +84,55 @@ namespace of
       */
       void setMaxNumberOfIterations(std::size_t n);
 
+      /*!
+        \brief This methods sets the pre-registration of the second image.
+
+        \param mode The pre-registration. (none, global or tiles)
+
+        \exception Exception It throws an exception if the pre-registration is unknown.
+      */
+      void setPreRegistration(const std::string& mode);
+
+      /*!
+        \brief This methods sets the data term of each level.
+
+        \param name The data term. (intensity or census)
+
+        \exception Exception It throws an exception if the data term is unknown.
+      */
+      void setDataTerm(const std::string& name);
+
+      /*!
+        \brief This methods sets the arithmetic precision of each level.
+
+        \param name The precision. (double, fixed or mixed)
+
+        \exception Exception It throws an exception if the precision is unknown.
+      */
+      void setPrecision(const std::string& name);
+
+      /*!
+        \brief This methods sets the window of the sums of the equations of each level.
+
+        \param name The window. (box: flat kernel size x kernel size window, or gaussian)
+
+        \exception Exception It throws an exception if the window is unknown.
+
+        \note The gaussian window weights the center more than the borders, so smaller windows keep the same
+              robustness. It is computed by recursive filtering (see RecursiveGaussian), whose cost does not depend
+              on sigma, ignores the kernel size and always uses doubles.
+      */
+      void setWindow(const std::string& name);
+
+      /*!
+        \brief This methods sets the standard deviation of the gaussian window of each level.
+
+        \param sigma The standard deviation, in pixels of each level.
+
+        \exception Exception It throws an exception if sigma is less than OF_MIN_GAUSSIAN_SIGMA.
+      */
+      void setGaussianSigma(double sigma);
+
     private:
 
       /*!
@@ -88,10 +151,13 @@ namespace of
     private:
 
       std::size_t m_nLevels;       //!< Number of levels that will be used.
-      Pyramid* m_pyra;             //!< Internal pyramid for image A.
-      Pyramid* m_pyrb;             //!< Internal pyramid for image B.
-      std::size_t m_ksize;         //!< Kernel size. (Default: 5 x 5)
+      std::size_t m_ksize;         //!< Kernel size. (Default: 15 x 15)
       std::size_t m_maxIterations; //!< Maximum number of iterations for each level.
+      std::string m_registration;  //!< Pre-registration of the second image. (none, global or tiles)
+      std::string m_dataTerm;      //!< The data term of each level. (intensity or census)
+      std::string m_precision;     //!< The arithmetic precision of each level. (double, fixed or mixed)
+      std::string m_window;        //!< The window of the sums of each level. (box or gaussian)
+      double m_sigma;              //!< The standard deviation of the gaussian window of each level.
   };
 
 } // end namespace of
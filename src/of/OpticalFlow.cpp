@@ -5,13 +5,14 @@
 */
 
 #include "Exception.h"
+#include "FlowFile.h"
 #include "Image.h"
+#include "Kernels.h"
 #include "OpticalFlow.h"
 
 // STL
 #include <algorithm>
-#include <cstdint>
-#include <fstream>
+#include <cmath>
 
 of::OpticalFlow::OpticalFlow(Image* a, Image* b)
   : m_imga(a),
@@ -30,13 +31,7 @@ of::OpticalFlow::OpticalFlow(Image* a, Image* b)
 
 of::OpticalFlow::~OpticalFlow()
 {
-  delete m_fx;
-  delete m_fy;
-  delete m_ft;
-  delete m_u;
-  delete m_v;
-  delete m_warped;
-  delete m_error;
+  releaseResults();
 }
 
 of::Image* of::OpticalFlow::getU() const
@@ -91,40 +86,33 @@ of::Image* of::OpticalFlow::getError()
 
 void of::OpticalFlow::save(const std::string& path) const
 {
-  std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-
-  // Write 'magic number'
-  const std::string check = "PIEH";
-  file.write(check.c_str(), check.size());
-
-  // Get (u,v) dimension
-  std::size_t nlines = m_u->getNLines();
-  std::size_t ncols  = m_u->getNCols();
-
-  // Write number of columns
-  file.write((const char*)&ncols, sizeof(int32_t));
-
-  // Write number of lines
-  file.write((const char*)&nlines, sizeof(int32_t));
+  FlowFile::save(path, m_u, m_v);
+}
 
-  double* ubuffer = m_u->getBuffer();
-  double* vbuffer = m_v->getBuffer();
+void of::OpticalFlow::saveCompressed(const std::string& path, double scale) const
+{
+  FlowFile::saveCompressed(path, m_u, m_v, scale);
+}
 
-  // Write values for u and v, interleaved, in row order
-  for(std::size_t i = 0; i < nlines * ncols; ++i)
-  {
-    float u = float(ubuffer[i]); float v = float(vbuffer[i]);
-    file.write((const char*)&u, sizeof(float));
-    file.write((const char*)&v, sizeof(float));
-  }
+void of::OpticalFlow::setStatsEnabled(bool enabled, bool hardwareCounters)
+{
+  m_stats.setEnabled(enabled);
+  m_stats.setHardwareCountersEnabled(hardwareCounters);
+}
 
-  file.close();
+const of::Stats& of::OpticalFlow::getStats() const
+{
+  return m_stats;
 }
 
 void of::OpticalFlow::initialize()
 {
   Size size = m_imga->getSize();
 
+  m_stats.clear();
+
+  releaseResults();
+
   // Initialize derivative images
   m_fx = new Image(size);
   m_fy = new Image(size);
@@ -145,6 +133,21 @@ void of::OpticalFlow::initialize()
   }
 }
 
+void of::OpticalFlow::releaseResults()
+{
+  delete m_fx;
+  delete m_fy;
+  delete m_ft;
+  delete m_u;
+  delete m_v;
+  delete m_warped;
+  delete m_error;
+
+  m_fx = m_fy = m_ft = 0;
+  m_u = m_v = 0;
+  m_warped = m_error = 0;
+}
+
 void of::OpticalFlow::computeDerivativeImages()
 {
   computeDerivativeImages(m_imga, m_imgb);
@@ -152,67 +155,20 @@ void of::OpticalFlow::computeDerivativeImages()
 
 void of::OpticalFlow::computeDerivativeImages(Image* a, Image* b)
 {
-  for(std::size_t lin = 0; lin < m_fx->getNLines(); ++lin)
-  {
-    for(std::size_t col = 0; col < m_fx->getNCols(); ++col)
-    {
-      // fx
-      m_fx->setPixel(lin, col, (1.0 / 4.0) *
-        (a->getPixel(lin, col + 1) - a->getPixel(lin, col)
-        + a->getPixel(lin + 1, col + 1) - a->getPixel(lin + 1, col)
-        + b->getPixel(lin, col + 1) - b->getPixel(lin, col)
-        + b->getPixel(lin + 1, col + 1) - b->getPixel(lin + 1, col)));
-      // fy
-      m_fy->setPixel(lin, col, (1.0 / 4.0) *
-        (a->getPixel(lin + 1, col) - a->getPixel(lin, col)
-        + a->getPixel(lin + 1, col + 1) - a->getPixel(lin, col + 1)
-        + b->getPixel(lin + 1, col) - b->getPixel(lin, col)
-        + b->getPixel(lin + 1, col + 1) - b->getPixel(lin, col + 1)));
-      // ft
-      m_ft->setPixel(lin, col, (1.0 / 4.0) *
-        (b->getPixel(lin, col) - a->getPixel(lin, col)
-        + b->getPixel(lin, col + 1) - a->getPixel(lin, col + 1)
-        + b->getPixel(lin + 1, col) - a->getPixel(lin + 1, col)
-        + b->getPixel(lin + 1, col + 1) - a->getPixel(lin + 1, col + 1)));
-    }
-  }
+  StatsScope scope(m_stats, "derivatives", m_fx->getSize().npixels);
+
+  Kernels::derivatives(a->getBuffer(), b->getBuffer(), m_fx->getNLines(), m_fx->getNCols(),
+                       m_fx->getBuffer(), m_fy->getBuffer(), m_ft->getBuffer());
 }
 
 of::Image* of::OpticalFlow::warp(Image* src, Image* u, Image* v) const
 {
+  StatsScope scope(m_stats, "warp", src->getSize().npixels);
+
   Image* warp = new Image(src->getSize(), src->getNoDataValue());
 
-  // Apply transformation
-  for(int lin = 0; lin < warp->getNLines(); ++lin)
-  {
-    for(int col = 0; col < warp->getNCols(); ++col)
-    {
-      // Compute destination pixel
-      double wlin = lin - v->getPixel(lin, col);
-      double wcol = col - u->getPixel(lin, col);
-
-      // Get pixel part
-      int y = std::max(0, int(std::floor(wlin)));
-      int x = std::max(0, int(std::floor(wcol)));
-
-      // Get sub-pixel part
-      double alphay = std::abs(wlin - y);
-      double alphax = std::abs(wcol - x);
-
-      // Bilinear interpolation
-      double a = src->getPixel(y, 0, x, 0);
-      double b = src->getPixel(y, 0, x, 1);
-      double c = src->getPixel(y, 1, x, 0);
-      double d = src->getPixel(y, 1, x, 1);
-
-      double value = (1.0 - alphax) * (1.0 - alphay) * a;
-      value += alphax * (1.0 - alphay) * b;
-      value += (1.0 - alphax) * alphay * c;
-      value += alphax * alphay * d;
-
-      warp->setPixel(lin, col, value);
-    }
-  }
+  Kernels::warp(src->getBuffer(), u->getBuffer(), v->getBuffer(), 1.0,
+                warp->getNLines(), warp->getNCols(), warp->getBuffer());
 
   return warp;
 }
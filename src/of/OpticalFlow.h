@@ -8,6 +8,7 @@
 #define __OF_INTERNAL_OPTICAL_FLOW_H
 
 #include "Config.h"
+#include "Stats.h"
 
 // STL
 #include <string>
@@ -100,6 +101,33 @@ namespace of
       */
       void save(const std::string& path) const;
 
+      /*!
+        \brief This method saves the (u,v) coordinates found to compressed flow (.ofz) file.
+
+        \param path The output file path.
+        \param scale The fixed-point scale factor. i.e. (u,v) resolution will be 1 / scale pixel.
+
+        \note See FlowFile for the format description.
+      */
+      void saveCompressed(const std::string& path, double scale = OF_DEFAULT_FLOW_CODEC_SCALE) const;
+
+      /*!
+        \brief This method enables or disables the collection of per-stage timings and counters.
+
+        \param enabled True to enable the stats collection.
+        \param hardwareCounters True to collect hardware performance counters (cycles, cache misses, etc.) of each stage.
+
+        \note The collection is disabled by default. Each call to compute() clears the previous stats.
+      */
+      void setStatsEnabled(bool enabled, bool hardwareCounters = false);
+
+      /*!
+        \brief This method returns the timings and counters of the last computation.
+
+        \return The timings and counters of the last computation.
+      */
+      const Stats& getStats() const;
+
     protected:
 
       /*!
@@ -107,6 +135,11 @@ namespace of
       */
       void initialize();
 
+      /*!
+        \brief Internal method that deletes the results of a previous computation: derivative, flow, warped and error images.
+      */
+      void releaseResults();
+
       /*!
         \brief Internal method that computes the derivative images
                necessary to optical flow algorithms.
@@ -147,6 +180,7 @@ namespace of
       Image* m_v;      //!< The v coordinates image.
       Image* m_warped; //!< The warped image.
       Image* m_error;  //!< The error image.
+      mutable Stats m_stats; //!< The timings and counters of the last computation.
   };
 } // end namespace of
 
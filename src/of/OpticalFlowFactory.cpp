@@ -0,0 +1,166 @@
+/*!
+  \file src/of/OpticalFlowFactory.cpp
+  \brief This class creates optical flow methods from a set of parameters.
+  \author Douglas Uba
+*/
+
+#include "BlockMatching.h"
+#include "Census.h"
+#include "DenseInverseSearch.h"
+#include "Exception.h"
+#include "FixedPoint.h"
+#include "HornSchunck.h"
+#include "LucasKanade.h"
+#include "LucasKanadeC2F.h"
+#include "OpticalFlowFactory.h"
+#include "PhaseCorrelation.h"
+#include "Pyramid.h"
+#include "RecursiveGaussian.h"
+#include "TiledOpticalFlow.h"
+
+// STL
+#include <algorithm>
+
+of::OpticalFlow* of::OpticalFlowFactory::make(Image* a, Image* b, const Parameters& params)
+{
+  if(params.tileSize != 0)
+    return new TiledOpticalFlow(a, b, params);
+
+  if(params.method == OF_HS_METHOD)
+  {
+    if(params.alpha <= 0.0)
+      throw Exception("The Horn-Schunck alpha parameter must be positive");
+
+    if(params.precision != OF_DOUBLE_PRECISION && params.precision != OF_MIXED_PRECISION)
+      throw Exception("Unknown Horn-Schunck precision: " + params.precision);
+
+    HornSchunck* hs = new HornSchunck(a, b);
+    hs->setAlpha(params.alpha);
+    hs->setPrecision(params.precision);
+    hs->setAutoStopThreshold(params.autoStopThreshold);
+    if(params.maxIterations != 0)
+      hs->setMaxNumberOfIterations(params.maxIterations);
+
+    return hs;
+  }
+
+  if(params.method == OF_DIS_METHOD)
+  {
+    if(params.nLevels > Pyramid::getMaxNumberOfLevels(a))
+      throw Exception("The number of pyramid levels is greater than the maximum allowed by the image size");
+
+    DISPreset preset = DenseInverseSearch::makePreset(params.preset);
+
+    DenseInverseSearch* dis = new DenseInverseSearch(a, b);
+    dis->setPreset(preset);
+    dis->setCoarsestLevel(params.nLevels);
+    if(params.maxIterations != 0)
+      dis->setMaxNumberOfIterations(params.maxIterations);
+
+    return dis;
+  }
+
+  if(params.method == OF_BM_METHOD)
+  {
+    if(params.nLevels > Pyramid::getMaxNumberOfLevels(a))
+      throw Exception("The number of pyramid levels is greater than the maximum allowed by the image size");
+
+    if(params.blockSize == 0)
+      throw Exception("The block size must be positive");
+
+    std::vector<std::string> costs = BlockMatching::getCosts();
+    if(std::find(costs.begin(), costs.end(), params.cost) == costs.end())
+      throw Exception("Unknown block matching cost: " + params.cost);
+
+    std::vector<std::string> searches = BlockMatching::getSearches();
+    if(std::find(searches.begin(), searches.end(), params.search) == searches.end())
+      throw Exception("Unknown block matching search: " + params.search);
+
+    BlockMatching* bm = new BlockMatching(a, b);
+    bm->setBlockSize(params.blockSize);
+    bm->setSearchRadius(params.searchRadius);
+    bm->setCost(params.cost);
+    bm->setSearch(params.search);
+    bm->setCoarsestLevel(params.nLevels);
+
+    return bm;
+  }
+
+  if(params.kernelSize == 0 || params.kernelSize % 2 == 0)
+    throw Exception("The kernel size must be an odd positive number");
+
+  std::vector<std::string> terms = Census::getDataTerms();
+  if((params.method == OF_LK_METHOD || params.method == OF_LKC2F_METHOD) &&
+     std::find(terms.begin(), terms.end(), params.dataTerm) == terms.end())
+    throw Exception("Unknown data term: " + params.dataTerm);
+
+  std::vector<std::string> precisions = FixedPoint::getPrecisions();
+  if((params.method == OF_LK_METHOD || params.method == OF_LKC2F_METHOD) &&
+     std::find(precisions.begin(), precisions.end(), params.precision) == precisions.end())
+    throw Exception("Unknown precision: " + params.precision);
+
+  std::vector<std::string> windows = RecursiveGaussian::getWindows();
+  if((params.method == OF_LK_METHOD || params.method == OF_LKC2F_METHOD) &&
+     std::find(windows.begin(), windows.end(), params.window) == windows.end())
+    throw Exception("Unknown window: " + params.window);
+
+  if((params.method == OF_LK_METHOD || params.method == OF_LKC2F_METHOD) &&
+     params.window == OF_GAUSSIAN_WINDOW && !(params.sigma >= OF_MIN_GAUSSIAN_SIGMA))
+    throw Exception("The Gaussian sigma is too small for the recursive filter");
+
+  if((params.method == OF_LK_METHOD || params.method == OF_LKC2F_METHOD) &&
+     params.precision == OF_FIXED_PRECISION && FixedPoint::getWindowSumBits(params.kernelSize) == 0)
+    throw Exception("The kernel size is too large for the fixed precision");
+
+  if(params.method == OF_LK_METHOD)
+  {
+    LucasKanade* lk = new LucasKanade(a, b);
+    lk->setKernelSize(params.kernelSize);
+    lk->setDataTerm(params.dataTerm);
+    lk->setPrecision(params.precision);
+    lk->setWindow(params.window);
+    if(params.window == OF_GAUSSIAN_WINDOW)
+      lk->setGaussianSigma(params.sigma);
+    if(params.maxIterations != 0)
+      lk->setMaxNumberOfIterations(params.maxIterations);
+
+    return lk;
+  }
+
+  if(params.method == OF_LKC2F_METHOD)
+  {
+    if(params.nLevels > Pyramid::getMaxNumberOfLevels(a))
+      throw Exception("The number of pyramid levels is greater than the maximum allowed by the image size");
+
+    std::vector<std::string> registrations = PhaseCorrelation::getRegistrations();
+    if(std::find(registrations.begin(), registrations.end(), params.registration) == registrations.end())
+      throw Exception("Unknown pre-registration: " + params.registration);
+
+    LucasKanadeC2F* lkc2f = params.nLevels == 0 ? new LucasKanadeC2F(a, b) : new LucasKanadeC2F(a, b, params.nLevels);
+    lkc2f->setKernelSize(params.kernelSize);
+    lkc2f->setPreRegistration(params.registration);
+    lkc2f->setDataTerm(params.dataTerm);
+    lkc2f->setPrecision(params.precision);
+    lkc2f->setWindow(params.window);
+    if(params.window == OF_GAUSSIAN_WINDOW)
+      lkc2f->setGaussianSigma(params.sigma);
+    if(params.maxIterations != 0)
+      lkc2f->setMaxNumberOfIterations(params.maxIterations);
+
+    return lkc2f;
+  }
+
+  throw Exception("Unknown optical flow method: " + params.method);
+}
+
+std::vector<std::string> of::OpticalFlowFactory::getMethods()
+{
+  std::vector<std::string> methods;
+  methods.push_back(OF_HS_METHOD);
+  methods.push_back(OF_LK_METHOD);
+  methods.push_back(OF_LKC2F_METHOD);
+  methods.push_back(OF_DIS_METHOD);
+  methods.push_back(OF_BM_METHOD);
+
+  return methods;
+}
@@ -0,0 +1,114 @@
+/*!
+  \file src/of/OpticalFlowFactory.h
+  \brief This class creates optical flow methods from a set of parameters.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_OPTICAL_FLOW_FACTORY_H
+#define __OF_INTERNAL_OPTICAL_FLOW_FACTORY_H
+
+#include "Config.h"
+
+// STL
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+  class OpticalFlow;
+
+  // Available methods
+  const std::string OF_HS_METHOD = "HS";
+  const std::string OF_LK_METHOD = "LK";
+  const std::string OF_LKC2F_METHOD = "LKC2F";
+  const std::string OF_DIS_METHOD = "DIS";
+  const std::string OF_BM_METHOD = "BM";
+
+  /*!
+    \struct Parameters
+
+    \brief Tuning parameters of the optical flow methods.
+           Each method uses only the parameters that make sense to it.
+  */
+  struct OFEXPORT Parameters
+  {
+    /*! \brief Constructor. It initializes all parameters with the default values. */
+    Parameters()
+      : method(OF_LKC2F_METHOD),
+        kernelSize(OF_DEFAULT_LK_KERNEL_SIZE),
+        maxIterations(0),
+        nLevels(0),
+        alpha(OF_DEFAULT_HS_ALPHA),
+        autoStopThreshold(OF_DEFAULT_HS_AUTO_STOP_THRESHOLD),
+        tileSize(0),
+        halo(0),
+        preset(OF_DEFAULT_DIS_PRESET),
+        blockSize(OF_DEFAULT_BM_BLOCK_SIZE),
+        searchRadius(OF_DEFAULT_BM_SEARCH_RADIUS),
+        cost(OF_DEFAULT_BM_COST),
+        search(OF_DEFAULT_BM_SEARCH),
+        registration(OF_DEFAULT_REGISTRATION),
+        dataTerm(OF_DEFAULT_DATA_TERM),
+        precision(OF_DEFAULT_PRECISION),
+        window(OF_DEFAULT_LK_WINDOW),
+        sigma(OF_DEFAULT_LK_GAUSSIAN_SIGMA)
+    {
+    }
+
+    std::string method;        //!< The method name. (HS, LK, LKC2F, DIS or BM)
+    std::size_t kernelSize;    //!< Window/kernel size used by LK and LKC2F. e.g. (5 = 5 x 5)
+    std::size_t maxIterations; //!< Maximum number of iterations. (0: method default, i.e. HS until auto stop, LK/LKC2F 1 per level, DIS per patch from the preset)
+    std::size_t nLevels;       //!< Number of pyramid levels used by LKC2F, or coarsest level searched by DIS and BM. (0: LKC2F maximum number of levels, DIS/BM automatic)
+    double alpha;              //!< Horn-Schunck alpha parameter.
+    double autoStopThreshold;  //!< Horn-Schunck threshold for automatic stopping.
+    std::size_t tileSize;      //!< Tile size of tiled processing. (0: the whole image is processed at once)
+    std::size_t halo;          //!< Tile halo of tiled processing. (0: computed from the method parameters)
+    std::string preset;        //!< Speed/quality preset used by DIS. (ultrafast, fast or medium)
+    std::size_t blockSize;     //!< Block size used by BM. e.g. (16 = 16 x 16)
+    std::size_t searchRadius;  //!< Search radius used by BM, in pixels of each pyramid level.
+    std::string cost;          //!< Matching cost used by BM. (SAD, SSD, NCC, census5 or census7)
+    std::string search;        //!< Search pattern used by BM. (full, diamond or hexagon)
+    std::string registration;  //!< Pre-registration of the second image by phase correlation, used by LKC2F. (none, global or tiles)
+    std::string dataTerm;      //!< Data term used by LK and LKC2F. (intensity or census)
+    std::string precision;     //!< Arithmetic precision used by LK, LKC2F (double, fixed or mixed) and HS (double or mixed).
+    std::string window;        //!< Window of the equation sums used by LK and LKC2F. (box or gaussian)
+    double sigma;              //!< Standard deviation of the gaussian window used by LK and LKC2F, in pixels.
+  };
+
+  /*!
+    \class OpticalFlowFactory
+
+    \brief This class creates optical flow methods from a set of parameters.
+  */
+  class OFEXPORT OpticalFlowFactory
+  {
+    public:
+
+      /*!
+        \brief This method creates and configures the method indicated by the given parameters.
+
+        \param a The first image.
+        \param b The second image.
+        \param params The method parameters.
+
+        \note If params.tileSize is not 0, the method will be wrapped by a TiledOpticalFlow.
+
+        \exception Exception It throws an exception if the method is unknown or a parameter is invalid.
+
+        \return The configured method. The caller will take the ownership.
+      */
+      static OpticalFlow* make(Image* a, Image* b, const Parameters& params);
+
+      /*!
+        \brief This method returns the names of the available methods.
+
+        \return The names of the available methods.
+      */
+      static std::vector<std::string> getMethods();
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_OPTICAL_FLOW_FACTORY_H
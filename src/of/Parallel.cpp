@@ -0,0 +1,205 @@
+/*!
+  \file src/of/Parallel.cpp
+  \brief Utilities for parallel execution of independent tasks.
+  \author Douglas Uba
+*/
+
+#include "Parallel.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  std::atomic<std::size_t> sg_nThreads(0);  // Number of threads (0: hardware threads)
+  thread_local bool tl_inParallel = false;   // Is the current thread running a parallel task?
+
+  // A forEach call: its tasks are taken by the calling thread and by up to 'helpers' pool workers
+  struct Job
+  {
+    const std::function<void(std::size_t)>* task; // The task function.
+    std::size_t n;                                 // The number of tasks.
+    std::atomic<std::size_t> next;                 // The next task to be taken.
+    std::size_t helpers;                           // The number of workers that can still join (guarded by the pool mutex).
+    std::size_t active;                            // The number of workers running the job (guarded by the pool mutex).
+    std::exception_ptr error;                      // The first exception thrown by a task.
+    std::mutex errorMutex;
+
+    // Runs tasks until there are no more
+    void run()
+    {
+      for(std::size_t i = next++; i < n; i = next++)
+      {
+        try
+        {
+          (*task)(i);
+        }
+        catch(...)
+        {
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if(!error)
+            error = std::current_exception();
+          next = n; // cancel remaining tasks
+        }
+      }
+    }
+  };
+
+  // Persistent worker threads, created on demand and shared by all forEach calls
+  class Pool
+  {
+    public:
+
+      Pool()
+        : m_stop(false)
+      {
+      }
+
+      ~Pool()
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stop = true;
+        }
+
+        m_jobAvailable.notify_all();
+
+        for(std::size_t i = 0; i < m_workers.size(); ++i)
+          m_workers[i].join();
+      }
+
+      // Runs the job on the calling thread and on up to job.helpers workers
+      void run(Job& job)
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+
+          while(m_workers.size() < job.helpers)
+            m_workers.push_back(std::thread(&Pool::work, this));
+
+          m_jobs.push_back(&job);
+        }
+
+        m_jobAvailable.notify_all();
+
+        tl_inParallel = true;
+        job.run();
+        tl_inParallel = false;
+
+        // No more workers can join; wait for the ones still running a task
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        std::deque<Job*>::iterator it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+        if(it != m_jobs.end())
+          m_jobs.erase(it);
+
+        m_jobDone.wait(lock, [&job] { return job.active == 0; });
+      }
+
+    private:
+
+      void work()
+      {
+        tl_inParallel = true;
+
+        bool named = false;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while(true)
+        {
+          m_jobAvailable.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+          if(m_stop)
+            return;
+
+          Job* job = m_jobs.front();
+          if(--job->helpers == 0)
+            m_jobs.pop_front();
+
+          ++job->active;
+
+          lock.unlock();
+
+          // Tracing may be enabled after the worker was created
+          if(!named && of::Trace::isEnabled())
+          {
+            of::Trace::setThreadName("of::Parallel worker");
+            named = true;
+          }
+
+          // Counted in the stages of the other threads (see PerfCounters)
+          of::PerfCounters::attachWorker();
+
+          job->run();
+
+          lock.lock();
+
+          if(--job->active == 0)
+            m_jobDone.notify_all();
+        }
+      }
+
+    private:
+
+      std::vector<std::thread> m_workers;
+      std::deque<Job*> m_jobs;
+      bool m_stop;
+      std::mutex m_mutex;
+      std::condition_variable m_jobAvailable;
+      std::condition_variable m_jobDone;
+  };
+
+  Pool& GetPool()
+  {
+    static Pool pool;
+    return pool;
+  }
+}
+
+void of::Parallel::setNumberOfThreads(std::size_t n)
+{
+  sg_nThreads = n;
+}
+
+std::size_t of::Parallel::getNumberOfThreads()
+{
+  std::size_t n = sg_nThreads;
+  if(n == 0)
+    n = std::max(1u, std::thread::hardware_concurrency());
+
+  return n;
+}
+
+void of::Parallel::forEach(std::size_t n, const std::function<void(std::size_t)>& task)
+{
+  std::size_t nThreads = std::min(getNumberOfThreads(), n);
+
+  if(nThreads <= 1 || tl_inParallel)
+  {
+    for(std::size_t i = 0; i < n; ++i)
+      task(i);
+    return;
+  }
+
+  Job job;
+  job.task = &task;
+  job.n = n;
+  job.next = 0;
+  job.helpers = nThreads - 1;
+  job.active = 0;
+
+  GetPool().run(job);
+
+  if(job.error)
+    std::rethrow_exception(job.error);
+}
@@ -0,0 +1,62 @@
+/*!
+  \file src/of/Parallel.h
+  \brief Utilities for parallel execution of independent tasks.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_PARALLEL_H
+#define __OF_INTERNAL_PARALLEL_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+#include <functional>
+
+namespace of
+{
+  /*!
+    \class Parallel
+
+    \brief Utilities for parallel execution of independent tasks.
+
+    \note Nested calls (i.e. forEach called from a task) are executed serially by the calling thread,
+          so that the number of running threads never exceeds getNumberOfThreads().
+
+    \note The worker threads are created on demand, once, and reused by all calls. Concurrent calls
+          (e.g. from several application threads) share them.
+  */
+  class OFEXPORT Parallel
+  {
+    public:
+
+      /*!
+        \brief This method sets the number of threads used by the library.
+
+        \param n The number of threads. 0 means the number of hardware threads.
+      */
+      static void setNumberOfThreads(std::size_t n);
+
+      /*!
+        \brief This method returns the number of threads used by the library.
+
+        \return The number of threads used by the library.
+      */
+      static std::size_t getNumberOfThreads();
+
+      /*!
+        \brief This method executes task(i), for i in [0, n), using up to getNumberOfThreads() threads.
+               The calling thread takes part in the execution.
+
+        \param n The number of tasks.
+        \param task The task function.
+
+        \note If a task throws an exception, the remaining tasks are cancelled and
+              the first exception is rethrown by the calling thread.
+      */
+      static void forEach(std::size_t n, const std::function<void(std::size_t)>& task);
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_PARALLEL_H
@@ -0,0 +1,236 @@
+/*!
+  \file src/of/PerfCounters.cpp
+  \brief This class reads hardware performance counters of the current thread and of the Parallel workers.
+  \author Douglas Uba
+*/
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+
+// Linux
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+  const int sg_nEvents = 5;
+
+  class ThreadCounters;
+
+  // Has a thread read its counters? Until then, the Parallel workers do not open theirs.
+  std::atomic<bool> sg_requested(false);
+
+  // Counters of the Parallel workers, summed by the reads of the other threads
+  struct Workers
+  {
+    std::mutex mutex;
+    std::vector<const ThreadCounters*> counters;
+  };
+
+  // Never destroyed: the workers of a static pool may still unregister at exit
+  Workers& GetWorkers()
+  {
+    static Workers* workers = new Workers;
+    return *workers;
+  }
+
+  // Opened counters of a thread. Events are read as a single group, so they cover the same interval.
+  class ThreadCounters
+  {
+    public:
+
+      ThreadCounters()
+        : m_leader(-1),
+          m_nOpened(0),
+          m_worker(false)
+      {
+        const std::uint32_t types[sg_nEvents] =
+        {
+          PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+        };
+
+        const std::uint64_t configs[sg_nEvents] =
+        {
+          PERF_COUNT_HW_CPU_CYCLES,
+          PERF_COUNT_HW_INSTRUCTIONS,
+          PERF_COUNT_HW_CACHE_REFERENCES,
+          PERF_COUNT_HW_CACHE_MISSES,
+          PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+        };
+
+        for(int i = 0; i < sg_nEvents; ++i)
+        {
+          m_fds[i] = -1;
+          m_slots[i] = -1;
+
+          perf_event_attr attr;
+          std::memset(&attr, 0, sizeof(attr));
+          attr.size = sizeof(attr);
+          attr.type = types[i];
+          attr.config = configs[i];
+          attr.disabled = (m_leader == -1) ? 1 : 0;
+          attr.exclude_kernel = 1;
+          attr.exclude_hv = 1;
+          attr.read_format = PERF_FORMAT_GROUP;
+
+          // Current thread, any CPU
+          int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, m_leader, 0));
+          if(fd == -1)
+          {
+            // Without cycles there is nothing to report
+            if(m_leader == -1)
+              return;
+
+            continue; // e.g. event not supported by the processor
+          }
+
+          if(m_leader == -1)
+            m_leader = fd;
+
+          m_fds[i] = fd;
+          m_slots[i] = m_nOpened++;
+        }
+
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+
+      ~ThreadCounters()
+      {
+        if(m_worker)
+        {
+          Workers& workers = GetWorkers();
+          std::lock_guard<std::mutex> lock(workers.mutex);
+          workers.counters.erase(std::find(workers.counters.begin(), workers.counters.end(), this));
+        }
+
+        for(int i = 0; i < sg_nEvents; ++i)
+          if(m_fds[i] != -1)
+            close(m_fds[i]);
+      }
+
+      bool isOpen() const
+      {
+        return m_leader != -1;
+      }
+
+      bool isWorker() const
+      {
+        return m_worker;
+      }
+
+      // Makes these counters part of the reads of the other threads
+      void attach()
+      {
+        if(m_worker || m_leader == -1)
+          return;
+
+        Workers& workers = GetWorkers();
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        workers.counters.push_back(this);
+
+        m_worker = true;
+      }
+
+      bool read(of::HardwareCounters& counters) const
+      {
+        if(m_leader == -1)
+          return false;
+
+        // Group layout: number of events followed by their values
+        std::uint64_t values[1 + sg_nEvents];
+        ssize_t size = ::read(m_leader, values, sizeof(std::uint64_t) * (1 + m_nOpened));
+        if(size != static_cast<ssize_t>(sizeof(std::uint64_t) * (1 + m_nOpened)))
+          return false;
+
+        std::uint64_t* fields[sg_nEvents] =
+        {
+          &counters.cycles, &counters.instructions, &counters.cacheReferences, &counters.cacheMisses, &counters.llcReadMisses
+        };
+
+        for(int i = 0; i < sg_nEvents; ++i)
+          *fields[i] = m_slots[i] == -1 ? 0 : values[1 + m_slots[i]];
+
+        return true;
+      }
+
+    private:
+
+      int m_leader;            // Group leader file descriptor (cycles).
+      int m_fds[sg_nEvents];   // File descriptor of each event (-1: not opened).
+      int m_slots[sg_nEvents]; // Position of each event on the group read (-1: not opened).
+      int m_nOpened;           // Number of opened events.
+      bool m_worker;           // Are these counters of a Parallel worker?
+  };
+
+  ThreadCounters& GetThreadCounters()
+  {
+    thread_local ThreadCounters tl_counters;
+    return tl_counters;
+  }
+}
+
+bool of::PerfCounters::isAvailable()
+{
+  return GetThreadCounters().isOpen();
+}
+
+bool of::PerfCounters::read(HardwareCounters& counters)
+{
+  sg_requested = true;
+
+  const ThreadCounters& own = GetThreadCounters();
+
+  if(!own.read(counters))
+    return false;
+
+  // A worker runs its nested parallel calls serially: its own counters cover them
+  if(own.isWorker())
+    return true;
+
+  Workers& workers = GetWorkers();
+  std::lock_guard<std::mutex> lock(workers.mutex);
+
+  for(std::size_t i = 0; i < workers.counters.size(); ++i)
+  {
+    HardwareCounters worker;
+    if(workers.counters[i]->read(worker))
+      counters += worker;
+  }
+
+  return true;
+}
+
+void of::PerfCounters::attachWorker()
+{
+  if(sg_requested)
+    GetThreadCounters().attach();
+}
+
+#else // Hardware counters are supported on Linux only
+
+bool of::PerfCounters::isAvailable()
+{
+  return false;
+}
+
+bool of::PerfCounters::read(HardwareCounters& /*counters*/)
+{
+  return false;
+}
+
+void of::PerfCounters::attachWorker()
+{
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*!
+  \file src/of/PerfCounters.h
+  \brief This class reads hardware performance counters of the current thread and of the Parallel workers.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_PERF_COUNTERS_H
+#define __OF_INTERNAL_PERF_COUNTERS_H
+
+#include "Config.h"
+
+// STL
+#include <cstdint>
+
+namespace of
+{
+  /*!
+    \struct HardwareCounters
+
+    \brief Simple struct that represents hardware performance counter values.
+
+    \note A counter that is not supported by the processor stays zero.
+  */
+  struct OFEXPORT HardwareCounters
+  {
+    /*! \brief Default constructor. */
+    HardwareCounters() : cycles(0), instructions(0), cacheReferences(0), cacheMisses(0), llcReadMisses(0) {}
+
+    /*! \brief Accumulates the given counter values. */
+    HardwareCounters& operator+=(const HardwareCounters& rhs)
+    {
+      cycles += rhs.cycles;
+      instructions += rhs.instructions;
+      cacheReferences += rhs.cacheReferences;
+      cacheMisses += rhs.cacheMisses;
+      llcReadMisses += rhs.llcReadMisses;
+      return *this;
+    }
+
+    /*! \brief Returns the counter values accumulated since the given values. */
+    HardwareCounters operator-(const HardwareCounters& rhs) const
+    {
+      HardwareCounters diff;
+      diff.cycles = cycles - rhs.cycles;
+      diff.instructions = instructions - rhs.instructions;
+      diff.cacheReferences = cacheReferences - rhs.cacheReferences;
+      diff.cacheMisses = cacheMisses - rhs.cacheMisses;
+      diff.llcReadMisses = llcReadMisses - rhs.llcReadMisses;
+      return diff;
+    }
+
+    std::uint64_t cycles;          //!< CPU cycles.
+    std::uint64_t instructions;    //!< Retired instructions.
+    std::uint64_t cacheReferences; //!< Last level cache references.
+    std::uint64_t cacheMisses;     //!< Last level cache misses.
+    std::uint64_t llcReadMisses;   //!< Last level cache read misses. i.e. cache lines read from the memory.
+  };
+
+  /*!
+    \class PerfCounters
+
+    \brief This class reads hardware performance counters of the current thread and of the Parallel workers.
+
+    On Linux, the counters are opened with perf_event_open (user space only) the first time a thread
+    reads them and they are kept running until the thread exits. Once any thread has read its counters,
+    each Parallel worker opens its own before its next job, and the reads of the other threads add them,
+    so the stages count the work of the parallel kernels too.
+
+    \note The workers are shared: while several computations run concurrently (e.g. the of-estimation pipeline),
+          the counts of each stage include the work that the workers did for the others.
+
+    \note The counters are unavailable on other systems, on most containers and virtual machines,
+          and when /proc/sys/kernel/perf_event_paranoid forbids them. In that case read() returns false.
+  */
+  class OFEXPORT PerfCounters
+  {
+    public:
+
+      /*!
+        \brief This method returns if the hardware counters are available for the current thread.
+
+        \return True if the hardware counters are available.
+      */
+      static bool isAvailable();
+
+      /*!
+        \brief This method reads the counter values of the current thread plus the ones of the Parallel workers.
+               A worker reads only its own counters.
+
+        \param counters The counter values, accumulated since the counters were opened.
+
+        \return False if the hardware counters are unavailable. True otherwise.
+      */
+      static bool read(HardwareCounters& counters);
+
+      /*!
+        \brief This method opens the counters of the calling Parallel worker and adds them to the reads of the
+               other threads, once any thread has read its counters. It is called by the workers before each job.
+      */
+      static void attachWorker();
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_PERF_COUNTERS_H
@@ -0,0 +1,324 @@
+/*!
+  \file src/of/PhaseCorrelation.cpp
+  \brief This class estimates translations between images by FFT phase correlation.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "FFT.h"
+#include "Image.h"
+#include "Parallel.h"
+#include "PhaseCorrelation.h"
+#include "TiledOpticalFlow.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace
+{
+  typedef std::complex<double> Complex;
+
+  // Largest power of two less than or equal to n (n > 0)
+  std::size_t FloorPowerOfTwo(std::size_t n)
+  {
+    std::size_t p = of::FFT::nextPowerOfTwo(n);
+    return p == n ? p : p / 2;
+  }
+
+  // Window of the given size centered on the region, moved inside the image if needed
+  of::Region GetWindow(const of::Region& region, std::size_t nlines, std::size_t ncols, const of::Size& image)
+  {
+    const std::size_t cl = region.lin + region.nlines / 2, cc = region.col + region.ncols / 2;
+
+    std::size_t lin = cl > nlines / 2 ? cl - nlines / 2 : 0;
+    std::size_t col = cc > ncols / 2 ? cc - ncols / 2 : 0;
+
+    lin = std::min(lin, image.nlines - nlines);
+    col = std::min(col, image.ncols - ncols);
+
+    return of::Region(lin, col, nlines, ncols);
+  }
+
+  // Hann window of n values
+  std::vector<double> HannWindow(std::size_t n)
+  {
+    const double pi = std::acos(-1.0);
+
+    std::vector<double> w(n, 1.0);
+    for(std::size_t i = 0; i < n && n > 1; ++i)
+      w[i] = 0.5 - 0.5 * std::cos(2.0 * pi * i / (n - 1));
+
+    return w;
+  }
+
+  // Sub-pixel offset of a correlation peak c0 from its neighbours at -1 and +1. The peak of a translation is a sampled
+  // (Dirichlet) sinc, whose highest neighbour c1 gives the offset c1 / (c1 + c0) (Foroosh et al., 2002)
+  double PeakOffset(double cm, double c0, double cp)
+  {
+    const double c1 = std::max(cm, cp);
+    if(!(c1 > 0.0) || !(c0 > 0.0))
+      return 0.0;
+
+    const double offset = c1 / (c1 + c0);
+
+    return cp >= cm ? offset : -offset;
+  }
+
+  // Phase correlation of the given window (power of two sizes) of the images
+  of::Shift Correlate(const of::Image* a, const of::Image* b, const of::Region& window, bool hann)
+  {
+    const std::size_t nl = window.nlines, nc = window.ncols, ncols = a->getNCols();
+
+    const double* pa = a->getBuffer() + window.lin * ncols + window.col;
+    const double* pb = b->getBuffer() + window.lin * ncols + window.col;
+
+    double ma = 0.0, mb = 0.0;
+    for(std::size_t lin = 0; lin < nl; ++lin)
+    {
+      for(std::size_t col = 0; col < nc; ++col)
+      {
+        ma += pa[lin * ncols + col];
+        mb += pb[lin * ncols + col];
+      }
+    }
+
+    ma /= nl * nc;
+    mb /= nl * nc;
+
+    const std::vector<double> wl = hann ? HannWindow(nl) : std::vector<double>(nl, 1.0);
+    const std::vector<double> wc = hann ? HannWindow(nc) : std::vector<double>(nc, 1.0);
+
+    // Both windows are transformed at once, as the real and imaginary parts of one complex window
+    std::vector<Complex> z(nl * nc);
+    for(std::size_t lin = 0; lin < nl; ++lin)
+    {
+      for(std::size_t col = 0; col < nc; ++col)
+      {
+        const double w = wl[lin] * wc[col];
+        z[lin * nc + col] = Complex(w * (pa[lin * ncols + col] - ma), w * (pb[lin * ncols + col] - mb));
+      }
+    }
+
+    const of::FFT rowFFT(nc), columnFFT(nl);
+    of::FFT::transform2D(&z[0], rowFFT, columnFFT, false);
+
+    // Normalized cross power spectrum A * conj(B) / |A * conj(B)|, where A(k) = (Z(k) + conj(Z(-k))) / 2
+    // and B(k) = (Z(k) - conj(Z(-k))) / 2i are the spectra of the real windows
+    std::vector<Complex> r(nl * nc);
+    for(std::size_t ky = 0; ky < nl; ++ky)
+    {
+      for(std::size_t kx = 0; kx < nc; ++kx)
+      {
+        const Complex zk = z[ky * nc + kx];
+        const Complex zm = std::conj(z[((nl - ky) % nl) * nc + (nc - kx) % nc]);
+
+        const Complex fa = 0.5 * (zk + zm);
+        const Complex fb = Complex(0.0, -0.5) * (zk - zm);
+
+        const Complex cross = fa * std::conj(fb);
+        const double magnitude = std::abs(cross);
+
+        r[ky * nc + kx] = magnitude > 1e-20 ? cross / magnitude : Complex(0.0, 0.0);
+      }
+    }
+
+    of::FFT::transform2D(&r[0], rowFFT, columnFFT, true);
+
+    std::size_t py = 0, px = 0;
+    for(std::size_t i = 1; i < r.size(); ++i)
+    {
+      if(r[i].real() > r[py * nc + px].real())
+      {
+        py = i / nc;
+        px = i % nc;
+      }
+    }
+
+    const double c0 = r[py * nc + px].real();
+
+    of::Shift shift;
+    shift.peak = std::max(0.0, std::min(1.0, c0));
+
+    // Circular neighbours of the peak
+    double x = double(px) + PeakOffset(r[py * nc + (px + nc - 1) % nc].real(), c0, r[py * nc + (px + 1) % nc].real());
+    double y = double(py) + PeakOffset(r[((py + nl - 1) % nl) * nc + px].real(), c0, r[((py + 1) % nl) * nc + px].real());
+
+    // Peaks past the half of the window are negative. The peak is at minus the shift of b.
+    shift.u = px > nc / 2 ? nc - x : -x;
+    shift.v = py > nl / 2 ? nl - y : -y;
+
+    return shift;
+  }
+
+  // Cell [i, i + 1] of the given centers that contains coord, and the weight of i + 1. Coordinates outside are clamped.
+  void GetCell(const std::vector<double>& centers, double coord, std::size_t& i, double& w)
+  {
+    if(centers.size() == 1 || coord <= centers.front())
+    {
+      i = 0;
+      w = 0.0;
+      return;
+    }
+
+    if(coord >= centers.back())
+    {
+      i = centers.size() - 2;
+      w = 1.0;
+      return;
+    }
+
+    i = std::upper_bound(centers.begin(), centers.end(), coord) - centers.begin() - 1;
+    w = (coord - centers[i]) / (centers[i + 1] - centers[i]);
+  }
+}
+
+of::PhaseCorrelation::PhaseCorrelation()
+  : m_window(true),
+    m_tileSize(OF_DEFAULT_PHASE_CORRELATION_TILE_SIZE)
+{
+}
+
+of::PhaseCorrelation::~PhaseCorrelation()
+{
+}
+
+void of::PhaseCorrelation::setWindowEnabled(bool on)
+{
+  m_window = on;
+}
+
+void of::PhaseCorrelation::setTileSize(std::size_t size)
+{
+  if(size < 8)
+    throw Exception("The phase correlation tile size must be at least 8");
+
+  m_tileSize = size;
+}
+
+of::Shift of::PhaseCorrelation::estimate(const Image* a, const Image* b) const
+{
+  return estimate(a, b, Region(0, 0, a->getNLines(), a->getNCols()));
+}
+
+of::Shift of::PhaseCorrelation::estimate(const Image* a, const Image* b, const Region& region) const
+{
+  if(a->getNLines() != b->getNLines() || a->getNCols() != b->getNCols())
+    throw Exception("The images must have the same size");
+
+  if(region.nlines < 2 || region.ncols < 2)
+    throw Exception("The phase correlation region must be at least 2 x 2");
+
+  if(region.lin + region.nlines > a->getNLines() || region.col + region.ncols > a->getNCols())
+    throw Exception("The phase correlation region must be inside the images");
+
+  const Region window = GetWindow(region, FloorPowerOfTwo(region.nlines), FloorPowerOfTwo(region.ncols), a->getSize());
+
+  return Correlate(a, b, window, m_window);
+}
+
+std::vector<of::Shift> of::PhaseCorrelation::estimateTiles(const Image* a, const Image* b, std::vector<Region>& tiles) const
+{
+  if(a->getNLines() != b->getNLines() || a->getNCols() != b->getNCols())
+    throw Exception("The images must have the same size");
+
+  const Size size = a->getSize();
+
+  std::vector<Tile> grid = TiledOpticalFlow::computeTiles(size, m_tileSize, 0);
+
+  tiles.resize(grid.size());
+  for(std::size_t i = 0; i < grid.size(); ++i)
+    tiles[i] = grid[i].inner;
+
+  // Windows of the tile size (or of the image, if smaller), centered on each tile
+  const std::size_t nl = FloorPowerOfTwo(std::min(m_tileSize, size.nlines));
+  const std::size_t nc = FloorPowerOfTwo(std::min(m_tileSize, size.ncols));
+
+  std::vector<Shift> shifts(tiles.size());
+
+  if(nl < 2 || nc < 2)
+    return shifts;
+
+  Parallel::forEach(tiles.size(), [&](std::size_t i)
+  {
+    shifts[i] = Correlate(a, b, GetWindow(tiles[i], nl, nc, size), m_window);
+  });
+
+  return shifts;
+}
+
+void of::PhaseCorrelation::estimateFlow(const Image* a, const Image* b, bool tiled, Image*& u, Image*& v) const
+{
+  const Size size = a->getSize();
+
+  // An unreliable global translation (e.g. of rotations or local motions) is not applied
+  Shift global = estimate(a, b);
+  if(global.peak < OF_PHASE_CORRELATION_MIN_PEAK)
+    global = Shift();
+
+  u = new Image(size);
+  v = new Image(size);
+
+  if(!tiled)
+  {
+    u->fill(global.u);
+    v->fill(global.v);
+    return;
+  }
+
+  std::vector<Region> tiles;
+  std::vector<Shift> shifts = estimateTiles(a, b, tiles);
+
+  for(std::size_t i = 0; i < shifts.size(); ++i)
+  {
+    if(shifts[i].peak < OF_PHASE_CORRELATION_MIN_PEAK)
+      shifts[i] = global;
+  }
+
+  // Tile centers: the tiles are a row-major grid
+  std::vector<double> lines, cols;
+  for(std::size_t i = 0; i < tiles.size(); ++i)
+  {
+    if(tiles[i].lin == tiles[0].lin)
+      cols.push_back(tiles[i].col + (tiles[i].ncols - 1) * 0.5);
+    if(tiles[i].col == tiles[0].col)
+      lines.push_back(tiles[i].lin + (tiles[i].nlines - 1) * 0.5);
+  }
+
+  const std::size_t nc = cols.size();
+
+  Parallel::forEach(size.nlines, [&](std::size_t lin)
+  {
+    std::size_t i, j;
+    double wy, wx;
+    GetCell(lines, double(lin), i, wy);
+
+    const std::size_t i1 = std::min(i + 1, lines.size() - 1);
+
+    for(std::size_t col = 0; col < size.ncols; ++col)
+    {
+      GetCell(cols, double(col), j, wx);
+
+      const std::size_t j1 = std::min(j + 1, nc - 1);
+
+      const Shift& s00 = shifts[i * nc + j];
+      const Shift& s01 = shifts[i * nc + j1];
+      const Shift& s10 = shifts[i1 * nc + j];
+      const Shift& s11 = shifts[i1 * nc + j1];
+
+      u->setPixel(lin * size.ncols + col, (1.0 - wy) * ((1.0 - wx) * s00.u + wx * s01.u) + wy * ((1.0 - wx) * s10.u + wx * s11.u));
+      v->setPixel(lin * size.ncols + col, (1.0 - wy) * ((1.0 - wx) * s00.v + wx * s01.v) + wy * ((1.0 - wx) * s10.v + wx * s11.v));
+    }
+  });
+}
+
+std::vector<std::string> of::PhaseCorrelation::getRegistrations()
+{
+  std::vector<std::string> registrations;
+  registrations.push_back(OF_NO_REGISTRATION);
+  registrations.push_back(OF_GLOBAL_REGISTRATION);
+  registrations.push_back(OF_TILE_REGISTRATION);
+
+  return registrations;
+}
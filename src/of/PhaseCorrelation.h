@@ -0,0 +1,148 @@
+/*!
+  \file src/of/PhaseCorrelation.h
+  \brief This class estimates translations between images by FFT phase correlation.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_PHASE_CORRELATION_H
+#define __OF_INTERNAL_PHASE_CORRELATION_H
+
+#include "Config.h"
+
+// STL
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+  struct Region;
+
+  // Available pre-registrations
+  const std::string OF_NO_REGISTRATION = "none";
+  const std::string OF_GLOBAL_REGISTRATION = "global";
+  const std::string OF_TILE_REGISTRATION = "tiles";
+
+  /*!
+    \struct Shift
+
+    \brief Translation between two images: b(lin + v, col + u) ~ a(lin, col), i.e. the optical flow convention.
+  */
+  struct OFEXPORT Shift
+  {
+    /*! \brief Constructor. */
+    Shift() : u(0.0), v(0.0), peak(0.0) {}
+
+    double u;    //!< Horizontal shift, in pixels.
+    double v;    //!< Vertical shift, in pixels.
+    double peak; //!< Height of the normalized correlation peak, in [0, 1]. Low values mean unreliable shifts.
+  };
+
+  /*!
+    \class PhaseCorrelation
+
+    \brief This class estimates translations between images by FFT phase correlation.
+
+    The windows of both images (the largest power of two sizes inside the region, centered) have their mean
+    removed and are tapered by a Hann window, which suppresses the border discontinuities of the periodic
+    transform. The normalized cross power spectrum is transformed back, and its highest peak gives the shift.
+    The shift is refined to sub-pixel by fitting a parabola to the peak and its neighbours along each axis.
+
+    Shifts are found up to half of the window size. The tiles are processed in parallel.
+  */
+  class OFEXPORT PhaseCorrelation
+  {
+    public:
+
+      /*! \brief Constructor. It uses the Hann window and the default tile size (see Config.h). */
+      PhaseCorrelation();
+
+      /*! \brief Destructor. */
+      ~PhaseCorrelation();
+
+      /*!
+        \brief This method enables or disables the Hann window.
+
+        \param on True to taper the windows (default).
+      */
+      void setWindowEnabled(bool on);
+
+      /*!
+        \brief This method sets the tile size of per-tile estimation.
+
+        \param size The tile size.
+
+        \exception Exception It throws an exception if the size is less than 8.
+      */
+      void setTileSize(std::size_t size);
+
+      /*!
+        \brief This method estimates the translation between the whole images.
+
+        \param a The first image.
+        \param b The second image, with the same size.
+
+        \exception Exception It throws an exception if the images are smaller than 2 x 2 or their sizes differ.
+
+        \return The translation.
+      */
+      Shift estimate(const Image* a, const Image* b) const;
+
+      /*!
+        \brief This method estimates the translation between the given region of the images.
+
+        \param a The first image.
+        \param b The second image, with the same size.
+        \param region The region. It must be inside the images.
+
+        \exception Exception It throws an exception if the region is smaller than 2 x 2 or the image sizes differ.
+
+        \return The translation.
+      */
+      Shift estimate(const Image* a, const Image* b, const Region& region) const;
+
+      /*!
+        \brief This method estimates the translation of each tile of the images. (see TiledOpticalFlow::computeTiles)
+
+        \param a The first image.
+        \param b The second image, with the same size.
+        \param tiles The tiles, in row-major order.
+
+        \exception Exception It throws an exception if the image sizes differ.
+
+        \return The translation of each tile.
+      */
+      std::vector<Shift> estimateTiles(const Image* a, const Image* b, std::vector<Region>& tiles) const;
+
+      /*!
+        \brief This method creates a dense flow from the global translation or from the tile translations.
+
+        Tile translations are interpolated bilinearly between the tile centers. Unreliable tiles
+        (see OF_PHASE_CORRELATION_MIN_PEAK) take the global translation, and an unreliable global
+        translation is replaced by zero.
+
+        \param a The first image.
+        \param b The second image, with the same size.
+        \param tiled True to use the tile translations, false to use the global translation.
+        \param u The horizontal flow. The caller will take the ownership.
+        \param v The vertical flow. The caller will take the ownership.
+      */
+      void estimateFlow(const Image* a, const Image* b, bool tiled, Image*& u, Image*& v) const;
+
+      /*!
+        \brief This method returns the names of the available pre-registrations of the pyramidal methods.
+
+        \return The names of the available pre-registrations. (none, global and tiles)
+      */
+      static std::vector<std::string> getRegistrations();
+
+    private:
+
+      bool m_window;          //!< Hann window flag.
+      std::size_t m_tileSize; //!< The tile size of per-tile estimation.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_PHASE_CORRELATION_H
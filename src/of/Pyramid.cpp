@@ -4,8 +4,10 @@
   \author Douglas Uba
 */
 
+#include "Exception.h"
 #include "Image.h"
 #include "Pyramid.h"
+#include "Trace.h"
 
 // STL
 #include <algorithm>
@@ -17,32 +19,74 @@ of::Kernel of::Pyramid::sm_gkUp;
 of::Pyramid::Initializer of::Pyramid::sm_initializer;
 
 of::Pyramid::Pyramid(Image* image, std::size_t nLevels)
+  : m_image(image),
+    m_pyramid(nLevels + 1, 0),
+    m_released(nLevels + 1, false)
 {
-  m_pyramid.resize(nLevels + 1);
-
-  // Add the first level (i.e. the original image)
-  m_pyramid[0] = image->clone();
-
-  build();
+  // The first level is the original image itself
+  m_pyramid[0] = image;
 }
 
 of::Pyramid::~Pyramid()
 {
   for(std::size_t i = 0; i < m_pyramid.size(); ++i)
-    delete m_pyramid[i];
+    destroy(i);
 }
 
 const std::vector<of::Image*>& of::Pyramid::getLevels() const
 {
+  getLevel(m_pyramid.size() - 1);
+
+  for(std::size_t i = 0; i < m_pyramid.size(); ++i)
+  {
+    if(m_released[i])
+      throw Exception("The pyramid level was released");
+  }
+
   return m_pyramid;
 }
 
 of::Image* of::Pyramid::getLevel(std::size_t i) const
 {
   assert(i < m_pyramid.size());
+
+  if(m_pyramid[i] != 0)
+    return m_pyramid[i];
+
+  // Closest finer level built
+  std::size_t built = i;
+  while(m_pyramid[built] == 0)
+  {
+    if(m_released[built])
+      throw Exception("The pyramid level was released");
+
+    --built;
+  }
+
+  TraceScope trace("Pyramid", "pyramid");
+
+  for(std::size_t level = built + 1; level <= i; ++level)
+    m_pyramid[level] = down(m_pyramid[level - 1]);
+
   return m_pyramid[i];
 }
 
+bool of::Pyramid::isBuilt(std::size_t i) const
+{
+  assert(i < m_pyramid.size());
+  return m_pyramid[i] != 0;
+}
+
+void of::Pyramid::release(std::size_t i)
+{
+  assert(i < m_pyramid.size());
+
+  destroy(i);
+
+  m_pyramid[i] = 0;
+  m_released[i] = true;
+}
+
 std::size_t of::Pyramid::getNLevels() const
 {
   return m_pyramid.size();
@@ -52,13 +96,16 @@ void of::Pyramid::updateLevel(std::size_t i, Image* image)
 {
   assert(i < m_pyramid.size());
 
-  delete m_pyramid[i];
+  destroy(i);
 
   m_pyramid[i] = image;
+  m_released[i] = false;
 }
 
 of::Image* of::Pyramid::down(Image* image)
 {
+  TraceScope trace("Pyramid::down", "pyramid");
+
   // Apply gaussian kernel for downsampling
   Image* gaussian = image->filter2D(sm_gkDown);
 
@@ -77,6 +124,8 @@ of::Image* of::Pyramid::down(Image* image)
 
 of::Image* of::Pyramid::up(Image* image, const Size& size)
 {
+  TraceScope trace("Pyramid::up", "pyramid");
+
   Size isize = size;
 
   if(size.isNull())
@@ -102,9 +151,14 @@ of::Image* of::Pyramid::up(Image* image, const Size& size)
 }
 
 std::size_t of::Pyramid::getMaxNumberOfLevels(Image* image)
+{
+  return getMaxNumberOfLevels(image->getSize());
+}
+
+std::size_t of::Pyramid::getMaxNumberOfLevels(const Size& imageSize)
 {
   std::size_t levels = 0;
-  std::size_t size = std::min(image->getNLines(), image->getNCols()) * 0.5;
+  std::size_t size = std::min(imageSize.nlines, imageSize.ncols) * 0.5;
 
   while(size >= 2)
   {
@@ -115,10 +169,10 @@ std::size_t of::Pyramid::getMaxNumberOfLevels(Image* image)
   return levels;
 }
 
-void of::Pyramid::build()
+void of::Pyramid::destroy(std::size_t i)
 {
-  for(std::size_t i = 1; i < m_pyramid.size(); ++i)
-    m_pyramid[i] = down(m_pyramid[i - 1]);
+  if(m_pyramid[i] != m_image)
+    delete m_pyramid[i];
 }
 
 of::Pyramid::Initializer::Initializer()
@@ -8,32 +8,36 @@
 #define __OF_INTERNAL_PYRAMID_H
 
 #include "Config.h"
+#include "Image.h"
 
 // STL
 #include <vector>
 
 namespace of
 {
-// Forward declarations
-  class Image;
-  struct Kernel;
 
   /*!
     \class Pyramid
 
     \brief This class represents an image hierarchical pyramid.
+
+    The levels are built on demand: the level 0 is the given image itself (it is not copied), and each coarser
+    level is downsampled from the finer one on its first access. The levels that are no longer needed
+    (e.g. the coarser ones, once a coarse to fine walk has moved past them) can be released.
+
+    \note The levels are built on the calling thread. A pyramid must not be accessed by several threads at once.
   */
   class OFEXPORT Pyramid
   {
     public:
 
       /*!
-        \brief Constructor.
+        \brief Constructor. No level is built.
 
         \param image The image that will be used to build the hierarchical pyramid.
         \param nLevels The pyramid number of levels.
-        
-        \note The Pyramid will not take the ownership of the given image.
+
+        \note The Pyramid will not take the ownership of the given image. The image must outlive the pyramid.
       */
       Pyramid(Image* image, std::size_t nLevels);
 
@@ -41,21 +45,44 @@ namespace of
       ~Pyramid();
 
       /*!
-        \brief This method returns all levels of hierarchical pyramid.
+        \brief This method returns all levels of hierarchical pyramid. The levels not built yet are built.
+
+        \exception Exception It throws an exception if a level was released.
 
         \return All levels of hierarchical pyramid.
       */
       const std::vector<Image*>& getLevels() const;
 
       /*!
-        \brief This method returns the i-th level of the hierarchical pyramid.
+        \brief This method returns the i-th level of the hierarchical pyramid. It is built (from the closest finer level
+               built) on first access.
 
         \param i The requested level.
 
+        \exception Exception It throws an exception if the level, or a finer level needed to build it, was released.
+
         \return The i-th level of the hierarchical pyramid.
       */
       Image* getLevel(std::size_t i) const;
 
+      /*!
+        \brief This method returns if the i-th level is built.
+
+        \param i The level index.
+
+        \return True if the level is built and not released. False otherwise.
+      */
+      bool isBuilt(std::size_t i) const;
+
+      /*!
+        \brief This method releases the i-th level. The level cannot be accessed anymore.
+
+        \param i The level index.
+
+        \note The given image (level 0) is never deleted: releasing it only forgets it.
+      */
+      void release(std::size_t i);
+
       /*!
         \brief This method returns the pyramid number of levels.
 
@@ -67,7 +94,9 @@ namespace of
         \brief This method updates the i-th level of the hierarchical pyramid.
 
         \param i The level index.
-        \param image The new level value.
+        \param image The new level value. The Pyramid takes its ownership.
+
+        \note The coarser levels not built yet will be built from the new level.
       */
       void updateLevel(std::size_t i, Image* image);
 
@@ -98,12 +127,23 @@ namespace of
       */
       static std::size_t getMaxNumberOfLevels(Image* image);
 
+      /*!
+        \brief This method computes the maximum number of hierarchical levels based on the given image size.
+
+        \param size The image size.
+
+        \return The maximum number of hierarchical levels based on the given image size.
+      */
+      static std::size_t getMaxNumberOfLevels(const Size& size);
+
     private:
 
       /*!
-        \brief Internal method that builds the hierarchical pyramid.
+        \brief Internal method that deletes the i-th level, unless it is the given image.
+
+        \param i The level index.
       */
-      void build();
+      void destroy(std::size_t i);
 
       /*!
         \brief Static initializer for static members of this class.
@@ -112,10 +152,12 @@ namespace of
 
     private:
 
-      std::vector<Image*> m_pyramid;      //!< The hierarchical pyramid.
-      static Kernel sm_gkDown;            //!< The gaussian kernel used on downsampling process.
-      static Kernel sm_gkUp;              //!< The gaussian kernel used on upsampling process.
-      static Initializer sm_initializer;  //!< Static initializer for gaussian kernels.
+      Image* m_image;                         //!< The given image (level 0), not owned.
+      mutable std::vector<Image*> m_pyramid;  //!< The hierarchical pyramid. (null: not built yet, or released)
+      std::vector<bool> m_released;           //!< The released levels.
+      static Kernel sm_gkDown;                //!< The gaussian kernel used on downsampling process.
+      static Kernel sm_gkUp;                  //!< The gaussian kernel used on upsampling process.
+      static Initializer sm_initializer;      //!< Static initializer for gaussian kernels.
   };
 
 } // end namespace of
@@ -0,0 +1,130 @@
+/*!
+  \file src/of/RecursiveGaussian.cpp
+  \brief Gaussian smoothing by recursive (IIR) filtering, used by the Gaussian windows of Lucas & Kanade.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "Parallel.h"
+#include "RecursiveGaussian.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Number of columns of each band of the vertical passes
+  const std::size_t ColumnBand = 256;
+
+  // Causal and anti-causal passes over a line, in place
+  void FilterLine(double* line, std::size_t n, double gain, const double* c)
+  {
+    double w1 = line[0], w2 = w1, w3 = w1;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+      const double w = gain * line[i] + c[0] * w1 + c[1] * w2 + c[2] * w3;
+      line[i] = w;
+      w3 = w2; w2 = w1; w1 = w;
+    }
+
+    double y1 = line[n - 1], y2 = y1, y3 = y1;
+    for(std::size_t i = n; i-- > 0;)
+    {
+      const double y = gain * line[i] + c[0] * y1 + c[1] * y2 + c[2] * y3;
+      line[i] = y;
+      y3 = y2; y2 = y1; y1 = y;
+    }
+  }
+
+  // Causal and anti-causal passes over the columns [c0, c1), a line at a time
+  void FilterColumns(const double* src, std::size_t nlines, std::size_t ncols, std::size_t c0, std::size_t c1,
+                     double gain, const double* c, double* dst)
+  {
+    const std::size_t n = c1 - c0;
+
+    // The values before the first line (and after the last one) are the border values
+    std::vector<double> border(src + c0, src + c1);
+
+    for(std::size_t lin = 0; lin < nlines; ++lin)
+    {
+      const double* in = src + lin * ncols + c0;
+      const double* p1 = lin >= 1 ? dst + (lin - 1) * ncols + c0 : &border[0];
+      const double* p2 = lin >= 2 ? dst + (lin - 2) * ncols + c0 : &border[0];
+      const double* p3 = lin >= 3 ? dst + (lin - 3) * ncols + c0 : &border[0];
+
+      double* out = dst + lin * ncols + c0;
+
+      for(std::size_t col = 0; col < n; ++col)
+        out[col] = gain * in[col] + c[0] * p1[col] + c[1] * p2[col] + c[2] * p3[col];
+    }
+
+    std::copy(dst + (nlines - 1) * ncols + c0, dst + (nlines - 1) * ncols + c1, border.begin());
+
+    for(std::size_t lin = nlines; lin-- > 0;)
+    {
+      const double* n1 = lin + 1 < nlines ? dst + (lin + 1) * ncols + c0 : &border[0];
+      const double* n2 = lin + 2 < nlines ? dst + (lin + 2) * ncols + c0 : &border[0];
+      const double* n3 = lin + 3 < nlines ? dst + (lin + 3) * ncols + c0 : &border[0];
+
+      double* out = dst + lin * ncols + c0;
+
+      for(std::size_t col = 0; col < n; ++col)
+        out[col] = gain * out[col] + c[0] * n1[col] + c[1] * n2[col] + c[2] * n3[col];
+    }
+  }
+}
+
+of::RecursiveGaussian::RecursiveGaussian(double sigma)
+  : m_sigma(sigma)
+{
+  if(!(sigma >= OF_MIN_GAUSSIAN_SIGMA))
+    throw Exception("The Gaussian sigma is too small for the recursive filter");
+
+  // Young and van Vliet (1995), equations 11b and 8c
+  const double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+  const double q2 = q * q, q3 = q2 * q;
+
+  const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+  const double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+  const double b2 = -(1.4281 * q2 + 1.26661 * q3);
+  const double b3 = 0.422205 * q3;
+
+  m_coefs[0] = b1 / b0;
+  m_coefs[1] = b2 / b0;
+  m_coefs[2] = b3 / b0;
+  m_gain = 1.0 - (m_coefs[0] + m_coefs[1] + m_coefs[2]);
+}
+
+double of::RecursiveGaussian::getSigma() const
+{
+  return m_sigma;
+}
+
+void of::RecursiveGaussian::filter(const double* src, std::size_t nlines, std::size_t ncols, double* dst) const
+{
+  if(nlines == 0 || ncols == 0)
+    return;
+
+  // The bands and lines are independent, so the results do not depend on the number of threads
+  const std::size_t nbands = (ncols + ColumnBand - 1) / ColumnBand;
+
+  Parallel::forEach(nbands, [&](std::size_t band)
+  {
+    FilterColumns(src, nlines, ncols, band * ColumnBand, std::min(ncols, (band + 1) * ColumnBand), m_gain, m_coefs, dst);
+  });
+
+  Parallel::forEach(nlines, [&](std::size_t lin)
+  {
+    FilterLine(dst + lin * ncols, ncols, m_gain, m_coefs);
+  });
+}
+
+std::vector<std::string> of::RecursiveGaussian::getWindows()
+{
+  std::vector<std::string> windows;
+  windows.push_back(OF_BOX_WINDOW);
+  windows.push_back(OF_GAUSSIAN_WINDOW);
+
+  return windows;
+}
@@ -0,0 +1,86 @@
+/*!
+  \file src/of/RecursiveGaussian.h
+
+  \brief Gaussian smoothing by recursive (IIR) filtering, used by the Gaussian windows of Lucas & Kanade.
+         Reference: I. T. Young and L. J. van Vliet (1995), Recursive implementation of the Gaussian filter.
+                    Signal Processing, vol 44, pages 139--151
+
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_RECURSIVE_GAUSSIAN_H
+#define __OF_INTERNAL_RECURSIVE_GAUSSIAN_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace of
+{
+  // Available Lucas & Kanade windows
+  const std::string OF_BOX_WINDOW = "box";
+  const std::string OF_GAUSSIAN_WINDOW = "gaussian";
+
+  /*!
+    \class RecursiveGaussian
+
+    \brief Gaussian smoothing by the recursive filter of Young and van Vliet.
+
+    Each direction is filtered by a third order causal pass followed by an anti-causal one, so the cost is
+    about 14 operations per pixel and direction, whatever the sigma. The columns are filtered first, a line at
+    a time, then each line. The passes start from the border values (the steady state of a constant signal),
+    which approximates clamped borders.
+
+    \note The impulse response is within 10% of the peak of the sampled Gaussian (5% from sigma = 2),
+          with slightly heavier tails.
+  */
+  class OFEXPORT RecursiveGaussian
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param sigma The Gaussian standard deviation, in pixels.
+
+        \exception Exception It throws an exception if sigma is less than OF_MIN_GAUSSIAN_SIGMA.
+      */
+      explicit RecursiveGaussian(double sigma);
+
+      /*!
+        \brief This method returns the Gaussian standard deviation.
+
+        \return The Gaussian standard deviation, in pixels.
+      */
+      double getSigma() const;
+
+      /*!
+        \brief This method smooths the given image. The image can be filtered in place (src == dst).
+
+        \param src The image values.
+        \param nlines The image number of lines.
+        \param ncols The image number of columns.
+        \param dst The smoothed values.
+      */
+      void filter(const double* src, std::size_t nlines, std::size_t ncols, double* dst) const;
+
+      /*!
+        \brief This method returns the names of the available Lucas & Kanade windows.
+
+        \return The names of the available windows.
+      */
+      static std::vector<std::string> getWindows();
+
+    private:
+
+      double m_sigma;    //!< The Gaussian standard deviation.
+      double m_gain;     //!< The gain of the input, B.
+      double m_coefs[3]; //!< The feedback coefficients b1 / b0, b2 / b0 and b3 / b0.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_RECURSIVE_GAUSSIAN_H
@@ -0,0 +1,40 @@
+/*!
+  \file src/of/RowSink.cpp
+  \brief Destinations of the (u,v) lines computed by the streaming methods.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "Image.h"
+#include "RowSink.h"
+
+// STL
+#include <algorithm>
+
+of::RowSink::~RowSink()
+{
+}
+
+of::ImageRowSink::ImageRowSink(Image* u, Image* v)
+  : m_u(u),
+    m_v(v)
+{
+}
+
+void of::ImageRowSink::begin(const Size& size)
+{
+  if(m_u->getSize() != size || m_v->getSize() != size)
+    throw Exception("The (u,v) images must have the size of the flow");
+}
+
+void of::ImageRowSink::write(std::size_t lin, const double* u, const double* v)
+{
+  const std::size_t ncols = m_u->getNCols();
+
+  std::copy(u, u + ncols, m_u->getBuffer() + lin * ncols);
+  std::copy(v, v + ncols, m_v->getBuffer() + lin * ncols);
+}
+
+void of::ImageRowSink::end()
+{
+}
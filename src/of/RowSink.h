@@ -0,0 +1,95 @@
+/*!
+  \file src/of/RowSink.h
+  \brief Destinations of the (u,v) lines computed by the streaming methods.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_ROW_SINK_H
+#define __OF_INTERNAL_ROW_SINK_H
+
+#include "Config.h"
+
+// STL
+#include <cstddef>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+  struct Size;
+
+  /*!
+    \class RowSink
+
+    \brief Destination of the (u,v) lines of a streaming computation (see LucasKanade::stream and HornSchunck::stream).
+
+    The lines are written once each, in increasing order, between begin and end.
+  */
+  class OFEXPORT RowSink
+  {
+    public:
+
+      /*! \brief Destructor. */
+      virtual ~RowSink();
+
+      /*!
+        \brief This method is called before the first line.
+
+        \param size The size of the flow.
+      */
+      virtual void begin(const Size& size) = 0;
+
+      /*!
+        \brief This method receives a line of the flow.
+
+        \param lin The line index.
+        \param u The u coordinates of the line.
+        \param v The v coordinates of the line.
+      */
+      virtual void write(std::size_t lin, const double* u, const double* v) = 0;
+
+      /*! \brief This method is called after the last line. */
+      virtual void end() = 0;
+  };
+
+  /*!
+    \class ImageRowSink
+
+    \brief RowSink that copies the lines to (u,v) images.
+  */
+  class OFEXPORT ImageRowSink : public RowSink
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param u The u image.
+        \param v The v image.
+
+        \note The ImageRowSink will not take the ownership of the given images.
+      */
+      ImageRowSink(Image* u, Image* v);
+
+      /*!
+        \brief This method checks the size of the images.
+
+        \param size The size of the flow.
+
+        \exception Exception It throws an exception if the images do not have the given size.
+      */
+      void begin(const Size& size);
+
+      void write(std::size_t lin, const double* u, const double* v);
+
+      void end();
+
+    private:
+
+      Image* m_u; //!< The u image.
+      Image* m_v; //!< The v image.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_ROW_SINK_H
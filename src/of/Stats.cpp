@@ -0,0 +1,211 @@
+/*!
+  \file src/of/Stats.cpp
+  \brief This class collects timings and counters of optical flow computations.
+  \author Douglas Uba
+*/
+
+#include "Stats.h"
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+  thread_local std::size_t tl_allocatedBytes = 0; // Bytes of images allocated by the current thread
+  std::atomic<std::size_t> sg_liveBytes(0);        // Bytes of images alive
+  std::atomic<std::size_t> sg_peakBytes(0);        // Peak of live bytes
+
+  std::string Quote(const std::string& str)
+  {
+    std::string quoted = "\"";
+    for(std::size_t i = 0; i < str.size(); ++i)
+    {
+      if(str[i] == '"' || str[i] == '\\')
+        quoted += '\\';
+      quoted += str[i];
+    }
+    return quoted + "\"";
+  }
+}
+
+of::Stats::Stats()
+  : m_enabled(false),
+    m_hardwareCounters(false)
+{
+}
+
+void of::Stats::setEnabled(bool enabled)
+{
+  m_enabled = enabled;
+}
+
+bool of::Stats::isEnabled() const
+{
+  return m_enabled;
+}
+
+void of::Stats::setHardwareCountersEnabled(bool enabled)
+{
+  m_hardwareCounters = enabled;
+}
+
+bool of::Stats::isHardwareCountersEnabled() const
+{
+  return m_hardwareCounters;
+}
+
+void of::Stats::clear()
+{
+  m_stages.clear();
+  m_index.clear();
+  m_counters.clear();
+}
+
+void of::Stats::addStage(const std::string& stage, double seconds, std::size_t pixels, std::size_t bytes,
+                         const HardwareCounters& counters)
+{
+  std::map<std::string, std::size_t>::iterator it = m_index.find(stage);
+  if(it == m_index.end())
+  {
+    it = m_index.insert(std::make_pair(stage, m_stages.size())).first;
+    m_stages.push_back(std::make_pair(stage, StageStats()));
+  }
+
+  StageStats& s = m_stages[it->second].second;
+  s.calls += 1;
+  s.seconds += seconds;
+  s.pixels += pixels;
+  s.bytes += bytes;
+  s.counters += counters;
+}
+
+void of::Stats::setCounter(const std::string& name, double value)
+{
+  m_counters[name] = value;
+}
+
+void of::Stats::addCounter(const std::string& name, double value)
+{
+  m_counters[name] += value;
+}
+
+void of::Stats::merge(const Stats& stats, const std::string& prefix)
+{
+  for(std::size_t i = 0; i < stats.m_stages.size(); ++i)
+  {
+    const StageStats& s = stats.m_stages[i].second;
+
+    addStage(prefix + stats.m_stages[i].first, s.seconds, s.pixels, s.bytes, s.counters);
+
+    // addStage counts one call
+    m_stages[m_index[prefix + stats.m_stages[i].first]].second.calls += s.calls - 1;
+  }
+
+  for(std::map<std::string, double>::const_iterator it = stats.m_counters.begin(); it != stats.m_counters.end(); ++it)
+    addCounter(prefix + it->first, it->second);
+}
+
+const std::vector<std::pair<std::string, of::StageStats> >& of::Stats::getStages() const
+{
+  return m_stages;
+}
+
+of::StageStats of::Stats::getStage(const std::string& stage) const
+{
+  std::map<std::string, std::size_t>::const_iterator it = m_index.find(stage);
+  if(it == m_index.end())
+    return StageStats();
+
+  return m_stages[it->second].second;
+}
+
+const std::map<std::string, double>& of::Stats::getCounters() const
+{
+  return m_counters;
+}
+
+std::string of::Stats::toJSON() const
+{
+  std::ostringstream json;
+  json.precision(9);
+
+  json << "{\n  \"stages\": [";
+
+  for(std::size_t i = 0; i < m_stages.size(); ++i)
+  {
+    const StageStats& s = m_stages[i].second;
+
+    json << (i == 0 ? "\n" : ",\n")
+         << "    {\"name\": " << Quote(m_stages[i].first)
+         << ", \"calls\": " << s.calls
+         << ", \"seconds\": " << s.seconds
+         << ", \"pixels\": " << s.pixels
+         << ", \"mpixels_per_second\": " << s.getThroughput()
+         << ", \"bytes\": " << s.bytes;
+
+    if(s.counters.cycles > 0)
+    {
+      json << ", \"cycles\": " << s.counters.cycles
+           << ", \"instructions\": " << s.counters.instructions
+           << ", \"ipc\": " << s.getIPC()
+           << ", \"cache_references\": " << s.counters.cacheReferences
+           << ", \"cache_misses\": " << s.counters.cacheMisses
+           << ", \"llc_read_misses\": " << s.counters.llcReadMisses
+           << ", \"read_bandwidth_gbps\": " << s.getReadBandwidth();
+    }
+
+    json << "}";
+  }
+
+  json << (m_stages.empty() ? "" : "\n  ") << "],\n  \"counters\": {";
+
+  for(std::map<std::string, double>::const_iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+    json << (it == m_counters.begin() ? "\n" : ",\n") << "    " << Quote(it->first) << ": " << it->second;
+
+  json << (m_counters.empty() ? "" : "\n  ") << "}\n}\n";
+
+  return json.str();
+}
+
+double of::Stats::now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::size_t of::Stats::getAllocatedBytes()
+{
+  return tl_allocatedBytes;
+}
+
+void of::Stats::trackAllocation(std::size_t bytes)
+{
+  tl_allocatedBytes += bytes;
+
+  std::size_t live = sg_liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+  std::size_t peak = sg_peakBytes.load(std::memory_order_relaxed);
+  while(live > peak && !sg_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    ;
+}
+
+void of::Stats::trackRelease(std::size_t bytes)
+{
+  sg_liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::size_t of::Stats::getLiveBytes()
+{
+  return sg_liveBytes.load(std::memory_order_relaxed);
+}
+
+std::size_t of::Stats::getPeakBytes()
+{
+  return sg_peakBytes.load(std::memory_order_relaxed);
+}
+
+void of::Stats::resetPeakBytes()
+{
+  sg_peakBytes.store(sg_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
@@ -0,0 +1,300 @@
+/*!
+  \file src/of/Stats.h
+  \brief This class collects timings and counters of optical flow computations.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_STATS_H
+#define __OF_INTERNAL_STATS_H
+
+#include "Config.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+// STL
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace of
+{
+  /*!
+    \struct StageStats
+
+    \brief Simple struct that accumulates the measures of a computation stage.
+  */
+  struct OFEXPORT StageStats
+  {
+    /*! \brief Default constructor. */
+    StageStats() : calls(0), seconds(0.0), pixels(0), bytes(0) {}
+
+    /*! \brief This method returns the stage throughput in megapixels per second. */
+    double getThroughput() const
+    {
+      return seconds > 0.0 ? pixels / seconds * 1e-6 : 0.0;
+    }
+
+    /*! \brief This method returns the instructions per cycle (0 if the hardware counters were not collected). */
+    double getIPC() const
+    {
+      return counters.cycles > 0 ? double(counters.instructions) / counters.cycles : 0.0;
+    }
+
+    /*! \brief This method returns the memory read bandwidth, in GB/s, estimated from the last level cache read misses. */
+    double getReadBandwidth() const
+    {
+      return seconds > 0.0 ? counters.llcReadMisses * double(OF_CACHE_LINE_SIZE) / seconds * 1e-9 : 0.0;
+    }
+
+    std::size_t calls;         //!< Number of times the stage was executed.
+    double seconds;            //!< Wall time spent on the stage.
+    std::size_t pixels;        //!< Number of pixels processed by the stage.
+    std::size_t bytes;         //!< Bytes of images allocated by the stage.
+    HardwareCounters counters; //!< Hardware counters of the stage. See Stats::setHardwareCountersEnabled().
+  };
+
+  /*!
+    \class Stats
+
+    \brief This class collects timings and counters of optical flow computations.
+
+    Stages are identified by name (e.g. "derivatives", "level-2/window-sums") and kept in the
+    order they were first executed. Counters hold scalar results (e.g. "iterations", "residual").
+
+    \note Stats are disabled by default. When disabled, StatsScope does not even read the clock.
+
+    \note Allocated bytes are the sizes of the images created by the current thread. See getAllocatedBytes().
+          The live and peak bytes of images are tracked for the whole process. See getPeakBytes().
+  */
+  class OFEXPORT Stats
+  {
+    public:
+
+      /*! \brief Constructor. */
+      Stats();
+
+      /*!
+        \brief This method enables or disables the stats collection.
+
+        \param enabled True to enable the stats collection.
+      */
+      void setEnabled(bool enabled);
+
+      /*!
+        \brief This method returns if the stats collection is enabled.
+
+        \return True if the stats collection is enabled.
+      */
+      bool isEnabled() const;
+
+      /*!
+        \brief This method enables or disables the hardware performance counters of each stage.
+
+        \param enabled True to collect the hardware counters (when the stats collection is enabled).
+
+        \note If the counters are unavailable (see PerfCounters), the stages are reported without them.
+      */
+      void setHardwareCountersEnabled(bool enabled);
+
+      /*!
+        \brief This method returns if the hardware performance counters collection is enabled.
+
+        \return True if the hardware performance counters collection is enabled.
+      */
+      bool isHardwareCountersEnabled() const;
+
+      /*! \brief This method removes all collected stages and counters. */
+      void clear();
+
+      /*!
+        \brief This method accumulates a measure of the given stage.
+
+        \param stage The stage name.
+        \param seconds The wall time.
+        \param pixels The number of pixels processed.
+        \param bytes The number of bytes allocated.
+        \param counters The hardware counters.
+      */
+      void addStage(const std::string& stage, double seconds, std::size_t pixels, std::size_t bytes = 0,
+                    const HardwareCounters& counters = HardwareCounters());
+
+      /*!
+        \brief This method sets the value of the given counter.
+
+        \param name The counter name.
+        \param value The counter value.
+      */
+      void setCounter(const std::string& name, double value);
+
+      /*!
+        \brief This method adds a value to the given counter.
+
+        \param name The counter name.
+        \param value The value that will be added.
+      */
+      void addCounter(const std::string& name, double value);
+
+      /*!
+        \brief This method accumulates all stages and counters of the given stats.
+
+        \param stats The stats that will be accumulated.
+        \param prefix A prefix added to the stage and counter names. e.g. "level-2/"
+      */
+      void merge(const Stats& stats, const std::string& prefix = "");
+
+      /*!
+        \brief This method returns the stages in execution order.
+
+        \return The stages in execution order.
+      */
+      const std::vector<std::pair<std::string, StageStats> >& getStages() const;
+
+      /*!
+        \brief This method returns the measures of the given stage.
+
+        \param stage The stage name.
+
+        \return The measures of the given stage (zeros if the stage was not executed).
+      */
+      StageStats getStage(const std::string& stage) const;
+
+      /*!
+        \brief This method returns the counters.
+
+        \return The counters.
+      */
+      const std::map<std::string, double>& getCounters() const;
+
+      /*!
+        \brief This method serializes the stats to JSON.
+
+        \return The stats as a JSON object.
+      */
+      std::string toJSON() const;
+
+      /*!
+        \brief This method returns the current time, in seconds, of a monotonic clock.
+
+        \return The current time in seconds.
+      */
+      static double now();
+
+      /*!
+        \brief This method returns the number of bytes of images allocated by the current thread so far.
+
+        \return The number of bytes of images allocated by the current thread.
+      */
+      static std::size_t getAllocatedBytes();
+
+      /*!
+        \brief This method registers an allocation of the current thread.
+
+        \param bytes The number of bytes allocated.
+      */
+      static void trackAllocation(std::size_t bytes);
+
+      /*!
+        \brief This method registers a release of previously allocated bytes.
+
+        \param bytes The number of bytes released.
+      */
+      static void trackRelease(std::size_t bytes);
+
+      /*!
+        \brief This method returns the number of bytes of the images currently alive, in all threads.
+
+        \return The number of bytes of the images currently alive.
+      */
+      static std::size_t getLiveBytes();
+
+      /*!
+        \brief This method returns the largest number of bytes of images alive at the same time since the last resetPeakBytes().
+
+        \return The peak number of bytes of images.
+      */
+      static std::size_t getPeakBytes();
+
+      /*! \brief This method restarts the peak tracking from the current live bytes. */
+      static void resetPeakBytes();
+
+    private:
+
+      bool m_enabled;                                            //!< Is the stats collection enabled?
+      bool m_hardwareCounters;                                   //!< Is the hardware counters collection enabled?
+      std::vector<std::pair<std::string, StageStats> > m_stages; //!< The stages in execution order.
+      std::map<std::string, std::size_t> m_index;                //!< Stage name to position.
+      std::map<std::string, double> m_counters;                  //!< The counters.
+  };
+
+  /*!
+    \class StatsScope
+
+    \brief Measures the wall time and allocations of a scope as a stage of the given stats.
+
+    The scope is also recorded on the timeline (category "stage"), if the tracing is enabled. See Trace.
+  */
+  class StatsScope
+  {
+    public:
+
+      /*!
+        \brief Constructor. It starts the measure, if the stats are enabled.
+
+        \param stats The stats that will receive the measure.
+        \param stage The stage name.
+        \param pixels The number of pixels processed by the stage.
+      */
+      StatsScope(Stats& stats, const char* stage, std::size_t pixels)
+        : m_trace(stage, "stage"),
+          m_stats(stats.isEnabled() ? &stats : 0),
+          m_stage(stage),
+          m_pixels(pixels),
+          m_start(0.0),
+          m_bytes(0),
+          m_counting(false)
+      {
+        if(m_stats)
+        {
+          m_bytes = Stats::getAllocatedBytes();
+          m_counting = m_stats->isHardwareCountersEnabled() && PerfCounters::read(m_counters);
+          m_start = Stats::now();
+        }
+      }
+
+      /*! \brief Destructor. It finishes the measure. */
+      ~StatsScope()
+      {
+        if(m_stats)
+        {
+          double seconds = Stats::now() - m_start;
+
+          HardwareCounters counters;
+          if(m_counting && PerfCounters::read(counters))
+            counters = counters - m_counters;
+
+          m_stats->addStage(m_stage, seconds, m_pixels, Stats::getAllocatedBytes() - m_bytes, counters);
+        }
+      }
+
+    private:
+
+      StatsScope(const StatsScope&);
+      StatsScope& operator=(const StatsScope&);
+
+    private:
+
+      TraceScope m_trace;   //!< The timeline event of the scope.
+      Stats* m_stats;       //!< The stats (null if disabled).
+      const char* m_stage;  //!< The stage name.
+      std::size_t m_pixels; //!< The number of pixels processed.
+      double m_start;       //!< The start time.
+      std::size_t m_bytes;  //!< The allocated bytes at start.
+      bool m_counting;      //!< Are the hardware counters being collected?
+      HardwareCounters m_counters; //!< The hardware counters at start.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_STATS_H
@@ -0,0 +1,330 @@
+/*!
+  \file src/of/Stencil.h
+  \brief Generic execution of stencil operators: border handling, cache tiling and vectorizable interior spans.
+  \author Douglas Uba
+
+  A stencil operator computes each output pixel from a neighbourhood (the shape) of the input images.
+  The engine splits the lines it is given into border pixels, whose neighbours are mapped inside the image
+  by a border strategy, and interior spans, where the whole shape is inside the image and neighbours are
+  read directly. Operators are written once, against an access functor, and get both paths.
+
+  \note The definitions have internal linkage, for the same reason of KernelsImpl.h: each instruction set
+        variant that includes this file must keep its own code.
+
+  \note The engine is serial. Callers thread it by giving disjoint bands of lines (see Kernels).
+*/
+
+#ifndef __OF_INTERNAL_STENCIL_H
+#define __OF_INTERNAL_STENCIL_H
+
+// STL
+#include <cstddef>
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define OF_RESTRICT __restrict__
+#elif defined(_MSC_VER)
+  #define OF_RESTRICT __restrict
+#else
+  #define OF_RESTRICT
+#endif
+
+/*!
+  \def OF_STENCIL_BLOCK_COLS
+
+  \brief Number of interior columns accumulated at once by sum stencils. The block of output values stays in the L1 cache.
+*/
+#define OF_STENCIL_BLOCK_COLS 512
+
+namespace
+{
+  typedef std::ptrdiff_t Index;
+
+  inline Index Clamp(Index coord, Index upper)
+  {
+    return coord < 0 ? 0 : (coord >= upper ? upper - 1 : coord);
+  }
+
+  inline Index Reflect(Index coord, Index delta, Index upper)
+  {
+    return (coord + delta < 0 || coord + delta >= upper) ? coord - delta : coord + delta;
+  }
+
+  // Border strategy of Image::getPixel(lin, col): neighbours are clamped to the image
+  struct ClampBorder
+  {
+    static Index map(Index coord, Index delta, Index upper)
+    {
+      return Clamp(coord + delta, upper);
+    }
+  };
+
+  // Border strategy of Image::getPixel(lin, dl, col, dc): neighbours are reflected around the center, then clamped
+  struct ReflectBorder
+  {
+    static Index map(Index coord, Index delta, Index upper)
+    {
+      return Clamp(Reflect(coord, delta, upper), upper);
+    }
+  };
+
+  // Neighbour access near the borders
+  template<class Border>
+  struct BorderAccess
+  {
+    BorderAccess(Index nl, Index nc) : nlines(nl), ncols(nc) {}
+
+    template<class T>
+    T operator()(const T* data, Index lin, Index col, Index dl, Index dc) const
+    {
+      return data[Border::map(lin, dl, nlines) * ncols + Border::map(col, dc, ncols)];
+    }
+
+    Index nlines;
+    Index ncols;
+  };
+
+  // Neighbour access in the interior
+  struct DirectAccess
+  {
+    explicit DirectAccess(Index nc) : ncols(nc) {}
+
+    template<class T>
+    T operator()(const T* data, Index lin, Index col, Index dl, Index dc) const
+    {
+      return data[(lin + dl) * ncols + col + dc];
+    }
+
+    Index ncols;
+  };
+
+  // Neighbour access in the interior, for a single neighbour of all pixels of a line (see ApplySumStencil)
+  struct NeighbourAccess
+  {
+    explicit NeighbourAccess(Index o) : offset(o) {}
+
+    template<class T>
+    T operator()(const T* data, Index /*lin*/, Index col, Index /*dl*/, Index /*dc*/) const
+    {
+      return data[offset + col];
+    }
+
+    Index offset; // (lin + dl) * ncols + dc
+  };
+
+  // Shape known at compile time: lines [-Top, Bottom] and columns [-Left, Right] around the center
+  template<int Top, int Bottom, int Left, int Right>
+  struct FixedShape
+  {
+    Index top() const { return Top; }
+    Index bottom() const { return Bottom; }
+    Index left() const { return Left; }
+    Index right() const { return Right; }
+  };
+
+  // Centered window known at runtime: (2 * rh + 1) lines x (2 * rw + 1) columns
+  struct WindowShape
+  {
+    WindowShape(Index h, Index w) : rh(h), rw(w) {}
+
+    Index top() const { return rh; }
+    Index bottom() const { return rh; }
+    Index left() const { return rw; }
+    Index right() const { return rw; }
+
+    Index rh;
+    Index rw;
+  };
+
+  // Interior columns [c0, c1) of the given shape, i.e. the shape is inside the image horizontally
+  template<class Shape>
+  void GetInteriorColumns(const Shape& shape, Index ncols, Index& c0, Index& c1)
+  {
+    c0 = shape.left() < ncols ? shape.left() : ncols;
+    c1 = ncols - shape.right() > c0 ? ncols - shape.right() : c0;
+  }
+
+  // Checks if the shape is inside the image vertically
+  template<class Shape>
+  bool IsInteriorLine(const Shape& shape, Index lin, Index nlines)
+  {
+    return lin - shape.top() >= 0 && lin + shape.bottom() < nlines;
+  }
+
+  /*
+    Applies a pointwise stencil to the lines [first, last). The operator computes (and stores) the outputs of one pixel:
+
+      Shape shape() const;
+      template<class Access> void pixel(const Access& in, Index lin, Index col) const;
+
+    The operator is taken by value: a local copy cannot alias the outputs, so its members stay in registers.
+  */
+  template<class Border, class Op>
+  void ApplyStencil(const Op op, Index nlines, Index ncols, Index first, Index last)
+  {
+    const BorderAccess<Border> border(nlines, ncols);
+    const DirectAccess direct(ncols);
+
+    Index c0, c1;
+    GetInteriorColumns(op.shape(), ncols, c0, c1);
+
+    for(Index lin = first; lin < last; ++lin)
+    {
+      if(!IsInteriorLine(op.shape(), lin, nlines))
+      {
+        for(Index col = 0; col < ncols; ++col)
+          op.pixel(border, lin, col);
+
+        continue;
+      }
+
+      for(Index col = 0; col < c0; ++col)
+        op.pixel(border, lin, col);
+
+      for(Index col = c0; col < c1; ++col)
+        op.pixel(direct, lin, col);
+
+      for(Index col = c1; col < ncols; ++col)
+        op.pixel(border, lin, col);
+    }
+  }
+
+  // Sum of the terms of a sum stencil for one pixel, in line-major order of the neighbours
+  template<class Op, class Access>
+  double SumPixel(const Op& op, const Access& in, Index lin, Index col)
+  {
+    double v = 0.0;
+
+    for(Index dl = -op.shape().top(); dl <= op.shape().bottom(); ++dl)
+      for(Index dc = -op.shape().left(); dc <= op.shape().right(); ++dc)
+        v += op.term(in, lin, col, dl, dc);
+
+    return v;
+  }
+
+  // Adds the terms of the neighbour (dl, dc) to the outputs of the columns [b0, b1). The outputs do not alias the inputs.
+  template<class Op>
+  void AccumulateTerms(const Op& op, Index ncols, Index lin, Index dl, Index dc,
+                       Index b0, Index b1, double* OF_RESTRICT out)
+  {
+    const NeighbourAccess in((lin + dl) * ncols + dc);
+
+    for(Index col = b0; col < b1; ++col)
+      out[col] += op.term(in, lin, col, dl, dc);
+  }
+
+  // Adds the terms of the neighbours (dl, dc) and (dl, dc + 1), in this order. Each output is loaded and stored once.
+  template<class Op>
+  void AccumulateTermPairs(const Op& op, Index ncols, Index lin, Index dl, Index dc,
+                           Index b0, Index b1, double* OF_RESTRICT out)
+  {
+    const NeighbourAccess in0((lin + dl) * ncols + dc);
+    const NeighbourAccess in1((lin + dl) * ncols + dc + 1);
+
+    for(Index col = b0; col < b1; ++col)
+      out[col] = out[col] + op.term(in0, lin, col, dl, dc) + op.term(in1, lin, col, dl, dc + 1);
+  }
+
+  // Interior columns [c0, c1) of a line, for shapes known at runtime: neighbour by neighbour over blocks of columns
+  template<class Op, class Shape>
+  void SumInterior(const Op& op, const Shape& shape, Index ncols, Index lin, Index c0, Index c1, double* out)
+  {
+    for(Index b0 = c0; b0 < c1; b0 += OF_STENCIL_BLOCK_COLS)
+    {
+      const Index b1 = c1 - b0 > OF_STENCIL_BLOCK_COLS ? b0 + OF_STENCIL_BLOCK_COLS : c1;
+
+      for(Index col = b0; col < b1; ++col)
+        out[col] = 0.0;
+
+      for(Index dl = -shape.top(); dl <= shape.bottom(); ++dl)
+      {
+        Index dc = -shape.left();
+
+        for(; dc < shape.right(); dc += 2)
+          AccumulateTermPairs(op, ncols, lin, dl, dc, b0, b1, out);
+
+        if(dc == shape.right())
+          AccumulateTerms(op, ncols, lin, dl, dc, b0, b1, out);
+      }
+    }
+  }
+
+  // Adds the terms of the neighbours (dl, -Left) ... (dl, Right), in this order. The neighbour loop is unrolled,
+  // so each output is loaded and stored once per line of the shape and the partial sums stay in registers.
+  template<class Op, int Left, int Right>
+  void AccumulateTermLine(const Op& op, const DirectAccess& in, Index lin, Index dl,
+                          Index b0, Index b1, double* OF_RESTRICT out)
+  {
+    for(Index col = b0; col < b1; ++col)
+    {
+      double v = out[col];
+
+      for(Index dc = -Left; dc <= Right; ++dc)
+        v += op.term(in, lin, col, dl, dc);
+
+      out[col] = v;
+    }
+  }
+
+  // Interior columns [c0, c1) of a line, for shapes known at compile time: a whole line of neighbours at a time
+  template<class Op, int Top, int Bottom, int Left, int Right>
+  void SumInterior(const Op& op, const FixedShape<Top, Bottom, Left, Right>& /*shape*/, Index ncols, Index lin,
+                   Index c0, Index c1, double* out)
+  {
+    const DirectAccess direct(ncols);
+
+    for(Index b0 = c0; b0 < c1; b0 += OF_STENCIL_BLOCK_COLS)
+    {
+      const Index b1 = c1 - b0 > OF_STENCIL_BLOCK_COLS ? b0 + OF_STENCIL_BLOCK_COLS : c1;
+
+      for(Index col = b0; col < b1; ++col)
+        out[col] = 0.0;
+
+      for(Index dl = -Top; dl <= Bottom; ++dl)
+        AccumulateTermLine<Op, Left, Right>(op, direct, lin, dl, b0, b1, out);
+    }
+  }
+
+  /*
+    Applies a sum stencil to the lines [first, last): dst(lin, col) is the sum of the operator terms over the shape,
+    in line-major order of the neighbours (dl, dc).
+
+      Shape shape() const;
+      template<class Access> double term(const Access& in, Index lin, Index col, Index dl, Index dc) const;
+
+    A term reads its inputs only at the neighbour (lin + dl, col + dc). With a runtime shape, the interior is
+    accumulated over blocks of columns, two neighbours of a line at a time, so that the inner loop runs over
+    contiguous pixels. With a compile-time shape (FixedShape), a whole line of neighbours is summed at a
+    time, in registers. The sum order of each pixel is always the same of the border path.
+  */
+  template<class Border, class Op>
+  void ApplySumStencil(const Op op, Index nlines, Index ncols, Index first, Index last, double* dst)
+  {
+    const BorderAccess<Border> border(nlines, ncols);
+
+    Index c0, c1;
+    GetInteriorColumns(op.shape(), ncols, c0, c1);
+
+    for(Index lin = first; lin < last; ++lin)
+    {
+      double* out = dst + lin * ncols;
+
+      if(!IsInteriorLine(op.shape(), lin, nlines))
+      {
+        for(Index col = 0; col < ncols; ++col)
+          out[col] = SumPixel(op, border, lin, col);
+
+        continue;
+      }
+
+      for(Index col = 0; col < c0; ++col)
+        out[col] = SumPixel(op, border, lin, col);
+
+      SumInterior(op, op.shape(), ncols, lin, c0, c1, out);
+
+      for(Index col = c1; col < ncols; ++col)
+        out[col] = SumPixel(op, border, lin, col);
+    }
+  }
+}
+
+#endif // __OF_INTERNAL_STENCIL_H
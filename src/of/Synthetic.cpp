@@ -0,0 +1,194 @@
+/*!
+  \file src/of/Synthetic.cpp
+  \brief This class generates image pairs with known (ground truth) optical flow.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "Image.h"
+#include "Synthetic.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Pseudo-random value in [0, 1] of an integer lattice point
+  double Hash(int x, int y, unsigned int seed)
+  {
+    unsigned int h = static_cast<unsigned int>(x) * 73856093u ^ static_cast<unsigned int>(y) * 19349663u ^ seed * 83492791u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return (h & 0xFFFF) / 65535.0;
+  }
+
+  // Smoothly interpolated lattice noise with values in [0, 1]
+  double ValueNoise(double x, double y, double cell, unsigned int seed)
+  {
+    x /= cell;
+    y /= cell;
+
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+
+    double fx = x - x0;
+    double fy = y - y0;
+
+    // Smoothstep weights
+    fx = fx * fx * (3.0 - 2.0 * fx);
+    fy = fy * fy * (3.0 - 2.0 * fy);
+
+    double a = Hash(x0, y0, seed) + fx * (Hash(x0 + 1, y0, seed) - Hash(x0, y0, seed));
+    double b = Hash(x0, y0 + 1, seed) + fx * (Hash(x0 + 1, y0 + 1, seed) - Hash(x0, y0 + 1, seed));
+
+    return a + fy * (b - a);
+  }
+
+  // Continuous texture value, in [-1, 1], at the given position
+  double Texture(double x, double y)
+  {
+    double v = 0.30 * std::sin(0.11 * x) * std::cos(0.07 * y)
+             + 0.20 * std::sin(0.031 * x + 0.047 * y)
+             + 0.50 * (ValueNoise(x, y, 16.0, 1) - 0.5)
+             + 0.35 * (ValueNoise(x, y, 6.0, 2) - 0.5)
+             + 0.20 * (ValueNoise(x, y, 3.0, 3) - 0.5);
+
+    return std::max(-1.0, std::min(1.0, v));
+  }
+}
+
+of::Image* of::Synthetic::makeTexture(const Size& size, const Image* u, const Image* v)
+{
+  Image* image = new Image(size);
+
+  for(std::size_t lin = 0; lin < size.nlines; ++lin)
+  {
+    for(std::size_t col = 0; col < size.ncols; ++col)
+    {
+      double x = col - (u ? u->getPixel(lin, col) : 0.0);
+      double y = lin - (v ? v->getPixel(lin, col) : 0.0);
+
+      image->setPixel(lin, col, 127.5 + 127.5 * Texture(x, y));
+    }
+  }
+
+  return image;
+}
+
+void of::Synthetic::makeFlow(const std::string& model, const Size& size, double magnitude, Image*& u, Image*& v)
+{
+  std::vector<std::string> models = getMotionModels();
+  if(std::find(models.begin(), models.end(), model) == models.end())
+    throw Exception("Unknown motion model: " + model);
+
+  u = new Image(size);
+  v = new Image(size);
+
+  // Image center and the largest distance to it
+  double cx = (size.ncols - 1) * 0.5;
+  double cy = (size.nlines - 1) * 0.5;
+  double radius = std::max(1.0, std::sqrt(cx * cx + cy * cy));
+
+  // Vortex core radius (where the displacement is the largest)
+  double sigma = std::max(1.0, std::min(size.nlines, size.ncols) / 6.0);
+
+  // Foreground layer: the central rectangle with half of the image size
+  double fl0 = size.nlines * 0.25, fl1 = size.nlines * 0.75;
+  double fc0 = size.ncols * 0.25, fc1 = size.ncols * 0.75;
+
+  for(std::size_t lin = 0; lin < size.nlines; ++lin)
+  {
+    for(std::size_t col = 0; col < size.ncols; ++col)
+    {
+      double dx = col - cx;
+      double dy = lin - cy;
+
+      double du = 0.0, dv = 0.0;
+
+      if(model == OF_TRANSLATION_MOTION)
+      {
+        du = 0.8 * magnitude;
+        dv = 0.6 * magnitude;
+      }
+      else if(model == OF_ROTATION_MOTION)
+      {
+        // b(p) = a(R(-theta) p): points of a rotate by theta around the center
+        double theta = 2.0 * std::asin(std::min(1.0, magnitude / (2.0 * radius)));
+        double c = std::cos(theta), s = std::sin(theta);
+        du = dx - (c * dx + s * dy);
+        dv = dy - (-s * dx + c * dy);
+      }
+      else if(model == OF_ZOOM_MOTION)
+      {
+        double scale = magnitude / radius;
+        du = scale * dx;
+        dv = scale * dy;
+      }
+      else if(model == OF_VORTEX_MOTION)
+      {
+        // Tangential speed m * (r / sigma) * exp(1/2 - r^2 / (2 sigma^2)), the largest (m) at r = sigma
+        double f = magnitude / sigma * std::exp(0.5 - (dx * dx + dy * dy) / (2.0 * sigma * sigma));
+        du = -f * dy;
+        dv = f * dx;
+      }
+      else if(model == OF_SHEAR_MOTION)
+      {
+        du = magnitude * dy / std::max(1.0, cy);
+      }
+      else // OF_LAYERS_MOTION
+      {
+        bool foreground = lin >= fl0 && lin < fl1 && col >= fc0 && col < fc1;
+        du = foreground ? magnitude * 0.8 : -magnitude * 0.25;
+        dv = foreground ? magnitude * 0.6 : magnitude * 0.1;
+      }
+
+      u->setPixel(lin, col, du);
+      v->setPixel(lin, col, dv);
+    }
+  }
+}
+
+of::Image* of::Synthetic::warp(const Image* a, const Image* u, const Image* v)
+{
+  Size size = a->getSize();
+  Image* b = new Image(size);
+
+  for(std::size_t lin = 0; lin < size.nlines; ++lin)
+  {
+    for(std::size_t col = 0; col < size.ncols; ++col)
+    {
+      // Clamp the source position to the image
+      double y = std::max(0.0, std::min(double(size.nlines - 1), lin - v->getPixel(lin, col)));
+      double x = std::max(0.0, std::min(double(size.ncols - 1), col - u->getPixel(lin, col)));
+
+      int y0 = static_cast<int>(y);
+      int x0 = static_cast<int>(x);
+
+      double fy = y - y0;
+      double fx = x - x0;
+
+      double p00 = a->getPixel(y0, x0);
+      double p01 = a->getPixel(y0, x0 + 1);
+      double p10 = a->getPixel(y0 + 1, x0);
+      double p11 = a->getPixel(y0 + 1, x0 + 1);
+
+      b->setPixel(lin, col, (1.0 - fy) * ((1.0 - fx) * p00 + fx * p01) + fy * ((1.0 - fx) * p10 + fx * p11));
+    }
+  }
+
+  return b;
+}
+
+std::vector<std::string> of::Synthetic::getMotionModels()
+{
+  std::vector<std::string> models;
+  models.push_back(OF_TRANSLATION_MOTION);
+  models.push_back(OF_ROTATION_MOTION);
+  models.push_back(OF_ZOOM_MOTION);
+  models.push_back(OF_VORTEX_MOTION);
+  models.push_back(OF_SHEAR_MOTION);
+  models.push_back(OF_LAYERS_MOTION);
+
+  return models;
+}
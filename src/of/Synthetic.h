@@ -0,0 +1,97 @@
+/*!
+  \file src/of/Synthetic.h
+  \brief This class generates image pairs with known (ground truth) optical flow.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_SYNTHETIC_H
+#define __OF_INTERNAL_SYNTHETIC_H
+
+#include "Config.h"
+
+// STL
+#include <string>
+#include <vector>
+
+namespace of
+{
+// Forward declarations
+  class Image;
+  struct Size;
+
+  // Available motion models
+  const std::string OF_TRANSLATION_MOTION = "translation";
+  const std::string OF_ROTATION_MOTION = "rotation";
+  const std::string OF_ZOOM_MOTION = "zoom";
+  const std::string OF_VORTEX_MOTION = "vortex";
+  const std::string OF_SHEAR_MOTION = "shear";
+  const std::string OF_LAYERS_MOTION = "layers";
+
+  /*!
+    \class Synthetic
+
+    \brief This class generates image pairs with known (ground truth) optical flow.
+
+    The flow follows the convention of the OpticalFlow methods: it is defined on the grid of the second image
+    and b(lin, col) = a(lin - v(lin, col), col - u(lin, col)).
+
+    Motion models (the magnitude is the largest displacement, in pixels):
+      - translation: constant displacement;
+      - rotation: rotation around the image center;
+      - zoom: scaling around the image center;
+      - vortex: rotation with Gaussian falloff (Rankine-like vortex) around the image center;
+      - shear: horizontal displacement proportional to the line;
+      - layers: a rectangular foreground layer moving over a background with a different motion
+                (i.e. flow discontinuities and occlusions).
+  */
+  class OFEXPORT Synthetic
+  {
+    public:
+
+      /*!
+        \brief This method creates a procedural texture (sinusoids plus value noise) with values in [0, 255].
+
+        \param size The image size.
+        \param u Optional u displacements. If given, the texture is sampled at (col - u, lin - v), without interpolation errors.
+        \param v Optional v displacements.
+
+        \return The texture image. The caller will take the ownership.
+      */
+      static Image* makeTexture(const Size& size, const Image* u = 0, const Image* v = 0);
+
+      /*!
+        \brief This method creates the ground truth (u,v) of the given motion model.
+
+        \param model The motion model. e.g. OF_ROTATION_MOTION
+        \param size The image size.
+        \param magnitude The largest displacement, in pixels.
+        \param u A pointer that will receive the u coordinates. The caller will take the ownership.
+        \param v A pointer that will receive the v coordinates. The caller will take the ownership.
+
+        \exception Exception It throws an exception if the model is unknown.
+      */
+      static void makeFlow(const std::string& model, const Size& size, double magnitude, Image*& u, Image*& v);
+
+      /*!
+        \brief This method creates the second image of a pair from the first one and the ground truth (u,v).
+               i.e. b(lin, col) = a(lin - v, col - u), with bilinear interpolation and clamped borders.
+
+        \param a The first image.
+        \param u The u coordinates.
+        \param v The v coordinates.
+
+        \return The second image. The caller will take the ownership.
+      */
+      static Image* warp(const Image* a, const Image* u, const Image* v);
+
+      /*!
+        \brief This method returns the available motion models.
+
+        \return The available motion models.
+      */
+      static std::vector<std::string> getMotionModels();
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_SYNTHETIC_H
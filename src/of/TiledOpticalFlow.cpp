@@ -0,0 +1,215 @@
+/*!
+  \file src/of/TiledOpticalFlow.cpp
+  \brief This class computes optical flow of large images by splitting them into tiles.
+  \author Douglas Uba
+*/
+
+#include "BlockMatching.h"
+#include "Census.h"
+#include "DenseInverseSearch.h"
+#include "Exception.h"
+#include "Parallel.h"
+#include "Pyramid.h"
+#include "RecursiveGaussian.h"
+#include "TiledOpticalFlow.h"
+#include "Trace.h"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+of::TiledOpticalFlow::TiledOpticalFlow(Image* a, Image* b, const Parameters& params)
+  : OpticalFlow(a, b),
+    m_params(resolve(params))
+{
+}
+
+of::TiledOpticalFlow::~TiledOpticalFlow()
+{
+}
+
+void of::TiledOpticalFlow::compute()
+{
+  Size size = m_imga->getSize();
+
+  m_stats.clear();
+
+  StatsScope scope(m_stats, "compute", size.npixels);
+
+  releaseResults();
+
+  m_u = new Image(size);
+  m_v = new Image(size);
+
+  std::vector<Tile> tiles = computeTiles(size, m_params.tileSize, m_params.halo);
+
+  std::mutex mutex; // Protects the stats merge
+
+  Parallel::forEach(tiles.size(), [&](std::size_t i)
+  {
+    const Tile& tile = tiles[i];
+
+    std::ostringstream tileName;
+    tileName << "tile-" << i;
+
+    TraceScope trace(tileName.str(), "tile");
+
+    std::unique_ptr<Image> a(m_imga->crop(tile.outer));
+    std::unique_ptr<Image> b(m_imgb->crop(tile.outer));
+
+    std::unique_ptr<OpticalFlow> of(OpticalFlowFactory::make(a.get(), b.get(), getTileParameters(m_params, tile)));
+    of->setStatsEnabled(m_stats.isEnabled(), m_stats.isHardwareCountersEnabled());
+    of->compute();
+
+    if(m_stats.isEnabled())
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      m_stats.merge(of->getStats(), "tiles/");
+    }
+
+    // Stitch the tile interior
+    Region interior(tile.inner.lin - tile.outer.lin, tile.inner.col - tile.outer.col, tile.inner.nlines, tile.inner.ncols);
+
+    m_u->paste(of->getU(), interior, tile.inner.lin, tile.inner.col);
+    m_v->paste(of->getV(), interior, tile.inner.lin, tile.inner.col);
+  });
+}
+
+const of::Parameters& of::TiledOpticalFlow::getParameters() const
+{
+  return m_params;
+}
+
+of::Parameters of::TiledOpticalFlow::resolve(const Parameters& params)
+{
+  Parameters resolved = params;
+
+  if(resolved.tileSize == 0)
+    resolved.tileSize = OF_DEFAULT_TILE_SIZE;
+
+  if((resolved.method == OF_LKC2F_METHOD || resolved.method == OF_DIS_METHOD || resolved.method == OF_BM_METHOD) && resolved.nLevels == 0)
+  {
+    // Deepest pyramid whose halo does not exceed half of the tile
+    std::size_t maxLevels = Pyramid::getMaxNumberOfLevels(Size(resolved.tileSize, resolved.tileSize));
+
+    for(std::size_t levels = 1; levels <= maxLevels; ++levels)
+    {
+      Parameters candidate = resolved;
+      candidate.nLevels = levels;
+      candidate.halo = 0;
+
+      if(computeHalo(candidate) > resolved.tileSize / 2)
+        break;
+
+      resolved.nLevels = levels;
+    }
+  }
+
+  if(resolved.halo == 0)
+    resolved.halo = computeHalo(resolved);
+
+  return resolved;
+}
+
+std::size_t of::TiledOpticalFlow::computeHalo(const Parameters& params)
+{
+  if(params.halo != 0)
+    return params.halo;
+
+  if(params.method == OF_HS_METHOD)
+  {
+    // Each iteration propagates the flow by one pixel (plus the derivative stencil)
+    if(params.maxIterations == 0)
+      return OF_DEFAULT_TILE_HS_HALO;
+
+    return params.maxIterations + 1;
+  }
+
+  if(params.method == OF_DIS_METHOD)
+  {
+    // Dense Inverse Search support: a patch (plus its displacement, up to a patch) at the coarsest level
+    std::size_t patchSize = DenseInverseSearch::makePreset(params.preset).patchSize;
+    return (2 * patchSize + 2) << params.nLevels;
+  }
+
+  if(params.method == OF_BM_METHOD)
+  {
+    // Block matching support: a block plus the search window (and the census window) at the coarsest level
+    std::size_t census = params.cost == OF_BM_CENSUS7_COST ? 3 : (params.cost == OF_BM_CENSUS5_COST ? 2 : 0);
+    return (params.blockSize + params.searchRadius + census + 2) << params.nLevels;
+  }
+
+  // Lucas & Kanade support: window half-size (3 sigmas of the gaussian window) plus the derivative stencil
+  // (and the census channels), for each iteration
+  std::size_t iterations = std::max<std::size_t>(params.maxIterations, 1);
+  std::size_t stencil = params.dataTerm == OF_CENSUS_DATA_TERM ? 3 : 1;
+  std::size_t half = params.window == OF_GAUSSIAN_WINDOW ? std::size_t(std::ceil(3.0 * params.sigma)) : params.kernelSize / 2;
+  std::size_t reach = (half + stencil) * iterations + 1;
+
+  if(params.method == OF_LK_METHOD)
+    return reach;
+
+  // LKC2F: the support of the coarsest level (plus the 5 x 5 pyramid filters) scaled to the finest one
+  return (reach + 2) << params.nLevels;
+}
+
+std::vector<of::Tile> of::TiledOpticalFlow::computeTiles(const Size& size, std::size_t tileSize, std::size_t halo)
+{
+  if(tileSize == 0)
+    throw Exception("The tile size must be positive");
+
+  std::size_t ntl = std::max<std::size_t>(1, (size.nlines + tileSize - 1) / tileSize);
+  std::size_t ntc = std::max<std::size_t>(1, (size.ncols + tileSize - 1) / tileSize);
+
+  std::vector<Tile> tiles;
+  tiles.reserve(ntl * ntc);
+
+  for(std::size_t i = 0; i < ntl; ++i)
+  {
+    std::size_t l0 = i * size.nlines / ntl;
+    std::size_t l1 = (i + 1) * size.nlines / ntl;
+
+    for(std::size_t j = 0; j < ntc; ++j)
+    {
+      std::size_t c0 = j * size.ncols / ntc;
+      std::size_t c1 = (j + 1) * size.ncols / ntc;
+
+      std::size_t ol0 = l0 > halo ? l0 - halo : 0;
+      std::size_t oc0 = c0 > halo ? c0 - halo : 0;
+      std::size_t ol1 = std::min(size.nlines, l1 + halo);
+      std::size_t oc1 = std::min(size.ncols, c1 + halo);
+
+      Tile tile;
+      tile.inner = Region(l0, c0, l1 - l0, c1 - c0);
+      tile.outer = Region(ol0, oc0, ol1 - ol0, oc1 - oc0);
+
+      tiles.push_back(tile);
+    }
+  }
+
+  return tiles;
+}
+
+of::Parameters of::TiledOpticalFlow::getTileParameters(const Parameters& params, const Tile& tile)
+{
+  Parameters tileParams = params;
+  tileParams.tileSize = 0;
+  tileParams.halo = 0;
+
+  if(tileParams.method == OF_DIS_METHOD || tileParams.method == OF_BM_METHOD)
+    tileParams.nLevels = std::min(tileParams.nLevels, Pyramid::getMaxNumberOfLevels(tile.outer.getSize()));
+
+  if(tileParams.method == OF_LKC2F_METHOD)
+  {
+    tileParams.nLevels = std::min(tileParams.nLevels, Pyramid::getMaxNumberOfLevels(tile.outer.getSize()));
+
+    // A pyramid without levels is the plain Lucas & Kanade
+    if(tileParams.nLevels == 0)
+      tileParams.method = OF_LK_METHOD;
+  }
+
+  return tileParams;
+}
@@ -0,0 +1,127 @@
+/*!
+  \file src/of/TiledOpticalFlow.h
+  \brief This class computes optical flow of large images by splitting them into tiles.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_TILED_OPTICAL_FLOW_H
+#define __OF_INTERNAL_TILED_OPTICAL_FLOW_H
+
+#include "Image.h"
+#include "OpticalFlow.h"
+#include "OpticalFlowFactory.h"
+
+// STL
+#include <vector>
+
+namespace of
+{
+  /*!
+    \struct Tile
+
+    \brief Simple struct that defines a tile of tiled processing.
+  */
+  struct OFEXPORT Tile
+  {
+    Region outer; //!< The tile region including the halo, clipped to the image. i.e. the pixels read by the tile.
+    Region inner; //!< The tile interior. i.e. the pixels written by the tile.
+  };
+
+  /*!
+    \class TiledOpticalFlow
+
+    \brief This class computes optical flow of large images by splitting them into tiles.
+
+    Each tile is extended by a halo and processed independently (and in parallel, see Parallel)
+    by the method indicated by the parameters. Only the tile interiors are stitched into the result.
+    The halo is sized from the method support (window size, iterations and pyramid levels),
+    so the interiors do not see the tile borders. The working memory is bounded by the tile size
+    and the number of threads, not by the image size.
+
+    \note Lucas & Kanade with a single iteration gives the same result as the whole image processing.
+          Horn & Schunck and Lucas & Kanade C2F propagate information beyond any finite halo,
+          so results are close to, but not the same as, the whole image processing.
+
+    \note When the number of pyramid levels is not informed, LKC2F uses the deepest pyramid
+          whose halo does not exceed half of the tile size.
+
+    \note The derivative images are not kept. i.e. getFx(), getFy() and getFt() return null.
+
+    \note The stats of the tiles are accumulated with the "tiles/" prefix. Their times are summed
+          over the threads, so they may exceed the wall time of the "compute" stage.
+  */
+  class OFEXPORT TiledOpticalFlow : public OpticalFlow
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param a The first image.
+        \param b The second image.
+        \param params The method parameters. If params.tileSize is 0, OF_DEFAULT_TILE_SIZE will be used.
+
+        \note The TiledOpticalFlow will not take the ownership of the given images.
+      */
+      TiledOpticalFlow(Image* a, Image* b, const Parameters& params);
+
+      /*! \brief Destructor. */
+      ~TiledOpticalFlow();
+
+      void compute();
+
+      /*!
+        \brief This method returns the parameters used, with tile size, halo and pyramid levels resolved.
+
+        \return The parameters used.
+      */
+      const Parameters& getParameters() const;
+
+      /*!
+        \brief This method resolves the tile size, halo and pyramid levels of the given parameters.
+
+        \param params The method parameters.
+
+        \return The parameters ready to tiled processing.
+      */
+      static Parameters resolve(const Parameters& params);
+
+      /*!
+        \brief This method computes the halo needed by the given method parameters.
+
+        \param params The method parameters.
+
+        \return The halo size in pixels.
+      */
+      static std::size_t computeHalo(const Parameters& params);
+
+      /*!
+        \brief This method splits an image into tiles of about the same size.
+
+        \param size The image size.
+        \param tileSize The maximum tile size.
+        \param halo The halo size.
+
+        \return The tiles in row order.
+      */
+      static std::vector<Tile> computeTiles(const Size& size, std::size_t tileSize, std::size_t halo);
+
+      /*!
+        \brief This method returns the parameters that will be used to process the given tile.
+               i.e. the number of pyramid levels is limited by the tile size.
+
+        \param params The resolved parameters.
+        \param tile The tile.
+
+        \return The parameters of the tile method.
+      */
+      static Parameters getTileParameters(const Parameters& params, const Tile& tile);
+
+    private:
+
+      Parameters m_params; //!< The resolved method parameters.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_TILED_OPTICAL_FLOW_H
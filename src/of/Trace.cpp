@@ -0,0 +1,207 @@
+/*!
+  \file src/of/Trace.cpp
+  \brief This class records a timeline of computations in Chrome trace-event format.
+  \author Douglas Uba
+*/
+
+#include "Exception.h"
+#include "Trace.h"
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+  struct Event
+  {
+    std::string name;     // The event name.
+    const char* category; // The event category.
+    char phase;           // 'B' (begin) or 'E' (end).
+    double ts;            // Timestamp in microseconds.
+  };
+
+  struct ThreadBuffer
+  {
+    std::size_t tid;           // Thread identifier on the timeline.
+    std::string name;          // Thread name.
+    std::vector<Event> events; // Events recorded by the thread.
+  };
+
+  struct Registry
+  {
+    Registry() : epoch(std::chrono::steady_clock::now()) {}
+
+    std::mutex mutex;                                   // Protects the buffers list.
+    std::vector<std::shared_ptr<ThreadBuffer> > buffers; // Buffers of all threads (kept after the threads exit).
+    std::chrono::steady_clock::time_point epoch;        // Timeline origin.
+  };
+
+  std::atomic<bool> sg_enabled(false);
+
+  Registry& GetRegistry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  ThreadBuffer& GetThreadBuffer()
+  {
+    thread_local std::shared_ptr<ThreadBuffer> tl_buffer;
+
+    if(!tl_buffer)
+    {
+      Registry& registry = GetRegistry();
+
+      std::lock_guard<std::mutex> lock(registry.mutex);
+
+      tl_buffer = std::make_shared<ThreadBuffer>();
+      tl_buffer->tid = registry.buffers.size() + 1;
+      tl_buffer->events.reserve(1024);
+
+      registry.buffers.push_back(tl_buffer);
+    }
+
+    return *tl_buffer;
+  }
+
+  void Record(const std::string& name, const char* category, char phase)
+  {
+    Event e = { name, category, phase,
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - GetRegistry().epoch).count() };
+
+    GetThreadBuffer().events.push_back(e);
+  }
+
+  std::string Quote(const std::string& str)
+  {
+    std::string quoted = "\"";
+    for(std::size_t i = 0; i < str.size(); ++i)
+    {
+      if(str[i] == '"' || str[i] == '\\')
+        quoted += '\\';
+      quoted += str[i];
+    }
+    return quoted + "\"";
+  }
+}
+
+void of::Trace::setEnabled(bool enabled)
+{
+  if(enabled)
+    GetRegistry(); // the timeline starts now
+
+  sg_enabled = enabled;
+}
+
+bool of::Trace::isEnabled()
+{
+  return sg_enabled.load(std::memory_order_relaxed);
+}
+
+void of::Trace::begin(const std::string& name, const char* category)
+{
+  if(isEnabled())
+    Record(name, category, 'B');
+}
+
+void of::Trace::end(const std::string& name, const char* category)
+{
+  if(isEnabled())
+    Record(name, category, 'E');
+}
+
+void of::Trace::setThreadName(const std::string& name)
+{
+  if(isEnabled())
+    GetThreadBuffer().name = name;
+}
+
+void of::Trace::clear()
+{
+  Registry& registry = GetRegistry();
+
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  for(std::size_t i = 0; i < registry.buffers.size(); ++i)
+    registry.buffers[i]->events.clear();
+}
+
+void of::Trace::save(const std::string& path)
+{
+  std::ofstream file(path.c_str());
+  if(!file)
+    throw Exception("Could not create the trace file: " + path);
+
+  file.precision(15);
+
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  Registry& registry = GetRegistry();
+
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  bool first = true;
+
+  for(std::size_t i = 0; i < registry.buffers.size(); ++i)
+  {
+    const ThreadBuffer& buffer = *registry.buffers[i];
+
+    if(!buffer.name.empty())
+    {
+      file << (first ? "\n" : ",\n")
+           << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.tid
+           << ", \"args\": {\"name\": " << Quote(buffer.name) << "}}";
+      first = false;
+    }
+
+    for(std::size_t j = 0; j < buffer.events.size(); ++j)
+    {
+      const Event& e = buffer.events[j];
+
+      file << (first ? "\n" : ",\n")
+           << "{\"name\": " << Quote(e.name) << ", \"cat\": " << Quote(e.category)
+           << ", \"ph\": \"" << e.phase << "\", \"ts\": " << e.ts
+           << ", \"pid\": 1, \"tid\": " << buffer.tid << "}";
+      first = false;
+    }
+  }
+
+  file << "\n]}\n";
+
+  if(!file)
+    throw Exception("Could not write the trace file: " + path);
+}
+
+of::TraceScope::TraceScope(const char* name, const char* category)
+  : m_enabled(Trace::isEnabled()),
+    m_category(category)
+{
+  if(m_enabled)
+  {
+    m_name = name;
+    Record(m_name, m_category, 'B');
+  }
+}
+
+of::TraceScope::TraceScope(const std::string& name, const char* category)
+  : m_enabled(Trace::isEnabled()),
+    m_category(category)
+{
+  if(m_enabled)
+  {
+    m_name = name;
+    Record(m_name, m_category, 'B');
+  }
+}
+
+of::TraceScope::~TraceScope()
+{
+  // Close the event even if the tracing was disabled in the meantime
+  if(m_enabled)
+    Record(m_name, m_category, 'E');
+}
@@ -0,0 +1,126 @@
+/*!
+  \file src/of/Trace.h
+  \brief This class records a timeline of computations in Chrome trace-event format.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_INTERNAL_TRACE_H
+#define __OF_INTERNAL_TRACE_H
+
+#include "Config.h"
+
+// STL
+#include <string>
+
+namespace of
+{
+  /*!
+    \class Trace
+
+    \brief This class records a timeline of computations in Chrome trace-event format.
+
+    When enabled, begin/end events of stages, pyramid levels, tiles and threads are appended to
+    a buffer owned by the calling thread (no locks are taken, except once per thread to register its buffer).
+    The timeline is written by save() and can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+
+    \note Tracing is disabled by default. When disabled, each instrumented scope costs a single atomic load.
+
+    \note save() and clear() must not be called while traced computations are running.
+  */
+  class OFEXPORT Trace
+  {
+    public:
+
+      /*!
+        \brief This method enables or disables the tracing.
+
+        \param enabled True to enable the tracing.
+      */
+      static void setEnabled(bool enabled);
+
+      /*!
+        \brief This method returns if the tracing is enabled.
+
+        \return True if the tracing is enabled.
+      */
+      static bool isEnabled();
+
+      /*!
+        \brief This method records the begin of an event on the current thread.
+
+        \param name The event name.
+        \param category The event category. e.g. "stage", "level", "tile"
+      */
+      static void begin(const std::string& name, const char* category);
+
+      /*!
+        \brief This method records the end of an event on the current thread.
+
+        \param name The event name.
+        \param category The event category.
+      */
+      static void end(const std::string& name, const char* category);
+
+      /*!
+        \brief This method names the current thread on the timeline.
+
+        \param name The thread name. e.g. "decode"
+      */
+      static void setThreadName(const std::string& name);
+
+      /*! \brief This method discards all recorded events. */
+      static void clear();
+
+      /*!
+        \brief This method writes the recorded events as Chrome trace-event JSON.
+
+        \param path The output file path.
+
+        \exception Exception It throws an exception if the file could not be written.
+      */
+      static void save(const std::string& path);
+  };
+
+  /*!
+    \class TraceScope
+
+    \brief Records the begin and end events of a scope, if the tracing is enabled.
+  */
+  class OFEXPORT TraceScope
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param name The event name.
+        \param category The event category.
+      */
+      TraceScope(const char* name, const char* category);
+
+      /*!
+        \brief Constructor.
+
+        \param name The event name.
+        \param category The event category.
+      */
+      TraceScope(const std::string& name, const char* category);
+
+      /*! \brief Destructor. */
+      ~TraceScope();
+
+    private:
+
+      TraceScope(const TraceScope&);
+      TraceScope& operator=(const TraceScope&);
+
+    private:
+
+      bool m_enabled;         //!< Was the begin event recorded?
+      std::string m_name;     //!< The event name.
+      const char* m_category; //!< The event category.
+  };
+
+} // end namespace of
+
+#endif // __OF_INTERNAL_TRACE_H
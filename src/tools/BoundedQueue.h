@@ -0,0 +1,115 @@
+/*!
+  \file tools/BoundedQueue.h
+  \brief A thread-safe FIFO queue with bounded capacity used to connect pipeline stages.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_TOOLS_BOUNDED_QUEUE_H
+#define __OF_TOOLS_BOUNDED_QUEUE_H
+
+// STL
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace of
+{
+  /*!
+    \class BoundedQueue
+
+    \brief A thread-safe FIFO queue with bounded capacity used to connect pipeline stages.
+
+    Producers block on push() while the queue is full and consumers block on pop() while it is empty.
+    After close() is called, push() discards the items and pop() drains the remaining ones
+    and then returns false, so that stages can shut down in order.
+  */
+  template<class T>
+  class BoundedQueue
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param capacity The maximum number of items that can be queued.
+      */
+      explicit BoundedQueue(std::size_t capacity)
+        : m_capacity(capacity == 0 ? 1 : capacity),
+          m_closed(false)
+      {
+      }
+
+      /*!
+        \brief This method adds an item to the queue, waiting while the queue is full.
+
+        \param item The item.
+
+        \return False if the queue was closed (i.e. the item was discarded). True otherwise.
+      */
+      bool push(T item)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+
+        if(m_closed)
+          return false;
+
+        m_items.push_back(std::move(item));
+
+        m_notEmpty.notify_one();
+
+        return true;
+      }
+
+      /*!
+        \brief This method removes an item from the queue, waiting while the queue is empty.
+
+        \param item The removed item.
+
+        \return False if the queue was closed and there are no more items. True otherwise.
+      */
+      bool pop(T& item)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+
+        if(m_items.empty())
+          return false;
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+
+        m_notFull.notify_one();
+
+        return true;
+      }
+
+      /*!
+        \brief This method closes the queue and wakes up all waiting producers and consumers.
+      */
+      void close()
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_closed = true;
+
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+      }
+
+    private:
+
+      std::size_t m_capacity;             //!< The maximum number of queued items.
+      bool m_closed;                      //!< A flag that indicates if the queue was closed.
+      std::deque<T> m_items;              //!< The queued items.
+      std::mutex m_mutex;                 //!< Mutex that protects the queue state.
+      std::condition_variable m_notEmpty; //!< Signaled when an item is pushed.
+      std::condition_variable m_notFull;  //!< Signaled when an item is popped.
+  };
+
+} // end namespace of
+
+#endif // __OF_TOOLS_BOUNDED_QUEUE_H
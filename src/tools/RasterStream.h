@@ -0,0 +1,280 @@
+/*!
+  \file tools/RasterStream.h
+  \brief Out-of-core raster access: a block cached GDAL reader and an incremental GDAL writer.
+  \author Douglas Uba
+*/
+
+#ifndef __OF_TOOLS_RASTER_STREAM_H
+#define __OF_TOOLS_RASTER_STREAM_H
+
+// Optical Flow
+#include "../of/Exception.h"
+#include "../of/Image.h"
+
+// GDAL/OGR
+#include <gdal_priv.h>
+
+// STL
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Maximum number of pixels of a cached block. Larger GDAL blocks (e.g. whole-image strips) are read as row bands.
+#define OF_STREAM_MAX_BLOCK_PIXELS (1 << 20)
+
+namespace of
+{
+  /*!
+    \class RasterReader
+
+    \brief This class reads regions of the first band of a raster without loading the whole raster.
+
+    Values are pulled on demand, in GDAL blocks (or row bands, if the GDAL block is too large),
+    into a least-recently-used cache with bounded size. Regions are assembled from the cached blocks.
+
+    \note The reader is thread-safe.
+  */
+  class RasterReader
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param path The raster path.
+        \param cacheSize The maximum cache size in bytes.
+      */
+      RasterReader(const std::string& path, std::size_t cacheSize)
+        : m_dataset(0),
+          m_band(0)
+      {
+        m_dataset = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+        if(m_dataset == 0)
+          throw Exception("Could not open the image: " + path);
+
+        m_band = m_dataset->GetRasterBand(1);
+        m_size = Size(m_dataset->GetRasterYSize(), m_dataset->GetRasterXSize());
+
+        int blockCols = 0, blockLines = 0;
+        m_band->GetBlockSize(&blockCols, &blockLines);
+
+        m_blockCols = std::min<std::size_t>(std::max(blockCols, 1), m_size.ncols);
+        m_blockLines = std::min<std::size_t>(std::max(blockLines, 1), m_size.nlines);
+
+        // Use row bands (of the block width) for huge blocks
+        if(m_blockLines * m_blockCols > OF_STREAM_MAX_BLOCK_PIXELS)
+        {
+          m_blockCols = std::min<std::size_t>(m_blockCols, OF_STREAM_MAX_BLOCK_PIXELS);
+          m_blockLines = std::max<std::size_t>(1, OF_STREAM_MAX_BLOCK_PIXELS / m_blockCols);
+        }
+
+        m_capacity = std::max<std::size_t>(1, cacheSize / (m_blockLines * m_blockCols * sizeof(double)));
+      }
+
+      /*! \brief Destructor. */
+      ~RasterReader()
+      {
+        GDALClose(m_dataset);
+      }
+
+      /*!
+        \brief This method returns the raster size.
+
+        \return The raster size.
+      */
+      const Size& getSize() const
+      {
+        return m_size;
+      }
+
+      /*!
+        \brief This method reads the given region.
+
+        \param region The region. It must be inside the raster.
+
+        \return A new image with the region values. The caller will take the ownership.
+      */
+      Image* read(const Region& region)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Image* image = new Image(region.getSize());
+
+        std::size_t bl0 = region.lin / m_blockLines;
+        std::size_t bl1 = (region.lin + region.nlines - 1) / m_blockLines;
+        std::size_t bc0 = region.col / m_blockCols;
+        std::size_t bc1 = (region.col + region.ncols - 1) / m_blockCols;
+
+        for(std::size_t bl = bl0; bl <= bl1; ++bl)
+        {
+          for(std::size_t bc = bc0; bc <= bc1; ++bc)
+          {
+            const Block& block = getBlock(BlockKey(bl, bc));
+
+            // Intersection between block and region
+            std::size_t l0 = std::max(region.lin, block.region.lin);
+            std::size_t l1 = std::min(region.lin + region.nlines, block.region.lin + block.region.nlines);
+            std::size_t c0 = std::max(region.col, block.region.col);
+            std::size_t c1 = std::min(region.col + region.ncols, block.region.col + block.region.ncols);
+
+            for(std::size_t lin = l0; lin < l1; ++lin)
+            {
+              const double* src = &block.values[(lin - block.region.lin) * block.region.ncols + (c0 - block.region.col)];
+              std::copy(src, src + (c1 - c0), image->getBuffer() + image->index(lin - region.lin, c0 - region.col));
+            }
+          }
+        }
+
+        return image;
+      }
+
+    private:
+
+      typedef std::pair<std::size_t, std::size_t> BlockKey; // (block line, block column)
+
+      struct Block
+      {
+        Region region;                        // The block region.
+        std::vector<double> values;           // The block values.
+        std::list<BlockKey>::iterator usage;  // Position on the usage list.
+      };
+
+      const Block& getBlock(const BlockKey& key)
+      {
+        std::map<BlockKey, Block>::iterator it = m_blocks.find(key);
+        if(it != m_blocks.end())
+        {
+          // Mark as most recently used
+          m_usage.splice(m_usage.begin(), m_usage, it->second.usage);
+          return it->second;
+        }
+
+        // Evict the least recently used blocks
+        while(m_blocks.size() >= m_capacity)
+        {
+          m_blocks.erase(m_usage.back());
+          m_usage.pop_back();
+        }
+
+        Block& block = m_blocks[key];
+
+        block.region.lin = key.first * m_blockLines;
+        block.region.col = key.second * m_blockCols;
+        block.region.nlines = std::min(m_blockLines, m_size.nlines - block.region.lin);
+        block.region.ncols = std::min(m_blockCols, m_size.ncols - block.region.col);
+        block.values.resize(block.region.nlines * block.region.ncols);
+
+        CPLErr err = m_band->RasterIO(GF_Read, block.region.col, block.region.lin, block.region.ncols, block.region.nlines,
+                                      &block.values[0], block.region.ncols, block.region.nlines, GDT_Float64, 0, 0);
+
+        m_usage.push_front(key);
+        block.usage = m_usage.begin();
+
+        if(err != CE_None)
+        {
+          m_blocks.erase(key);
+          m_usage.pop_front();
+          throw Exception("Could not read the image block");
+        }
+
+        return block;
+      }
+
+    private:
+
+      GDALDataset* m_dataset;             //!< The raster dataset.
+      GDALRasterBand* m_band;             //!< The raster band that will be read.
+      Size m_size;                        //!< The raster size.
+      std::size_t m_blockLines;           //!< Number of lines of a cached block.
+      std::size_t m_blockCols;            //!< Number of columns of a cached block.
+      std::size_t m_capacity;             //!< Maximum number of cached blocks.
+      std::map<BlockKey, Block> m_blocks; //!< The cached blocks.
+      std::list<BlockKey> m_usage;        //!< Cached blocks, most recently used first.
+      std::mutex m_mutex;                 //!< Mutex that protects the reader state.
+  };
+
+  /*!
+    \class FlowRasterWriter
+
+    \brief This class writes (u,v) coordinates, region by region, to a tiled GeoTIFF with two Float32 bands.
+
+    \note The writer is thread-safe.
+  */
+  class FlowRasterWriter
+  {
+    public:
+
+      /*!
+        \brief Constructor.
+
+        \param path The output path.
+        \param size The raster size.
+      */
+      FlowRasterWriter(const std::string& path, const Size& size)
+        : m_dataset(0)
+      {
+        char** options = 0;
+        options = CSLSetNameValue(options, "TILED", "YES");
+        options = CSLSetNameValue(options, "BLOCKXSIZE", "256");
+        options = CSLSetNameValue(options, "BLOCKYSIZE", "256");
+        options = CSLSetNameValue(options, "BIGTIFF", "IF_SAFER");
+
+        GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+        if(driver != 0)
+          m_dataset = driver->Create(path.c_str(), size.ncols, size.nlines, 2, GDT_Float32, options);
+
+        CSLDestroy(options);
+
+        if(m_dataset == 0)
+          throw Exception("Could not create the output file: " + path);
+
+        m_dataset->GetRasterBand(1)->SetDescription("u");
+        m_dataset->GetRasterBand(2)->SetDescription("v");
+      }
+
+      /*! \brief Destructor. */
+      ~FlowRasterWriter()
+      {
+        GDALClose(m_dataset);
+      }
+
+      /*!
+        \brief This method writes a region of the given (u,v) coordinates.
+
+        \param u The u coordinates.
+        \param v The v coordinates.
+        \param region The region of (u,v) that will be written.
+        \param lin The output line of the region first pixel.
+        \param col The output column of the region first pixel.
+      */
+      void write(const Image* u, const Image* v, const Region& region, std::size_t lin, std::size_t col)
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const Image* images[2] = { u, v };
+
+        for(int i = 0; i < 2; ++i)
+        {
+          double* first = images[i]->getBuffer() + images[i]->index(region.lin, region.col);
+
+          CPLErr err = m_dataset->GetRasterBand(i + 1)->RasterIO(GF_Write, col, lin, region.ncols, region.nlines,
+                                                                 first, region.ncols, region.nlines, GDT_Float64,
+                                                                 sizeof(double), images[i]->getNCols() * sizeof(double));
+          if(err != CE_None)
+            throw Exception("Could not write the (u,v) region");
+        }
+      }
+
+    private:
+
+      GDALDataset* m_dataset; //!< The output dataset.
+      std::mutex m_mutex;     //!< Mutex that protects the output dataset.
+  };
+
+} // end namespace of
+
+#endif // __OF_TOOLS_RASTER_STREAM_H
@@ -0,0 +1,1420 @@
+/*!
+  \file tools/of-bench.cpp
+  \brief Optical Flow Benchmark Command Line Tool.
+  \author Douglas Uba
+*/
+
+// Optical Flow
+#include "../of/BlockMatching.h"
+#include "../of/Census.h"
+#include "../of/DenseInverseSearch.h"
+#include "../of/Evaluation.h"
+#include "../of/Exception.h"
+#include "../of/FFT.h"
+#include "../of/FixedPoint.h"
+#include "../of/HornSchunck.h"
+#include "../of/Image.h"
+#include "../of/Kernels.h"
+#include "../of/LucasKanade.h"
+#include "../of/LucasKanadeC2F.h"
+#include "../of/OpticalFlow.h"
+#include "../of/OpticalFlowFactory.h"
+#include "../of/Parallel.h"
+#include "../of/PhaseCorrelation.h"
+#include "../of/Pyramid.h"
+#include "../of/RecursiveGaussian.h"
+#include "../of/RowSink.h"
+#include "../of/Stats.h"
+#include "../of/Synthetic.h"
+
+#ifdef OF_BENCH_HAVE_GDAL
+// GDAL/OGR
+#include <gdal_priv.h>
+#endif
+
+// TCLAP
+#include <tclap/CmdLine.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef OF_BENCH_DATA_DIR
+#define OF_BENCH_DATA_DIR "data/input"
+#endif
+
+// Available suites
+const std::string OF_MICRO_SUITE = "micro";
+const std::string OF_MACRO_SUITE = "macro";
+const std::string OF_DATA_SUITE = "data";
+const std::string OF_ACCURACY_SUITE = "accuracy";
+
+// Accuracy case of a translation under a brightness change (see ChangeBrightness)
+const std::string OF_BRIGHTNESS_CASE = "translation+brightness";
+
+// Result of a benchmark
+struct Result
+{
+  std::string suite;       // The suite name.
+  std::string name;        // The benchmark name.
+  of::Size size;           // The image size.
+  std::size_t repetitions; // Number of repetitions.
+  double best;             // Best time in seconds.
+  double median;           // Median time in seconds.
+  bool hasError;           // Was the accuracy measured?
+  of::FlowError error;     // Error against the ground truth (accuracy suite).
+
+  double getThroughput() const
+  {
+    return best > 0.0 ? size.npixels / best * 1e-6 : 0.0;
+  }
+};
+
+// Runs the benchmarks and keeps their results
+class Bench
+{
+  public:
+
+    Bench(std::size_t repetitions, const std::string& filter)
+      : m_repetitions(std::max<std::size_t>(1, repetitions)),
+        m_filter(filter)
+    {
+    }
+
+    // Runs a benchmark. The function executes one repetition and returns its time in seconds
+    void run(const std::string& suite, const std::string& name, const of::Size& size, const std::function<double()>& f)
+    {
+      runAccuracy(suite, name, size, [&](of::FlowError*) { return f(); }, false);
+    }
+
+    // Runs a benchmark that also measures the error against the ground truth (of the last repetition)
+    void runAccuracy(const std::string& suite, const std::string& name, const of::Size& size,
+                     const std::function<double(of::FlowError*)>& f, bool hasError = true)
+    {
+      if(!m_filter.empty() && name.find(m_filter) == std::string::npos)
+        return;
+
+      of::FlowError error;
+
+      std::vector<double> times;
+      for(std::size_t i = 0; i < m_repetitions; ++i)
+        times.push_back(f(hasError ? &error : 0));
+
+      std::sort(times.begin(), times.end());
+
+      Result r = { suite, name, size, m_repetitions, times.front(), times[times.size() / 2], hasError, error };
+      m_results.push_back(r);
+
+      std::cout << std::left << std::setw(9) << suite << std::setw(28) << name
+                << std::right << std::setw(12) << (Convert2String(size.nlines) + "x" + Convert2String(size.ncols))
+                << std::fixed << std::setprecision(6) << std::setw(14) << r.best
+                << std::setw(14) << r.median
+                << std::setprecision(2) << std::setw(12) << r.getThroughput();
+
+      if(hasError)
+        std::cout << std::setprecision(4) << std::setw(10) << error.epe << std::setw(10) << error.ae;
+
+      std::cout << std::endl;
+    }
+
+    void printHeader() const
+    {
+      std::cout << std::left << std::setw(9) << "suite" << std::setw(28) << "benchmark"
+                << std::right << std::setw(12) << "size" << std::setw(14) << "best (s)"
+                << std::setw(14) << "median (s)" << std::setw(12) << "Mpixel/s"
+                << std::setw(10) << "EPE" << std::setw(10) << "AE (deg)" << std::endl;
+    }
+
+    std::string toJSON() const
+    {
+      std::ostringstream json;
+      json.precision(9);
+
+      json << "{\n  \"repetitions\": " << m_repetitions
+           << ",\n  \"threads\": " << of::Parallel::getNumberOfThreads()
+           << ",\n  \"isa\": \"" << of::Kernels::get().isa << "\""
+           << ",\n  \"results\": [";
+
+      for(std::size_t i = 0; i < m_results.size(); ++i)
+      {
+        const Result& r = m_results[i];
+
+        json << (i == 0 ? "\n" : ",\n")
+             << "    {\"suite\": \"" << r.suite << "\", \"name\": \"" << r.name << "\""
+             << ", \"nlines\": " << r.size.nlines << ", \"ncols\": " << r.size.ncols
+             << ", \"best_seconds\": " << r.best << ", \"median_seconds\": " << r.median
+             << ", \"mpixels_per_second\": " << r.getThroughput();
+
+        if(r.hasError)
+          json << ", \"epe\": " << r.error.epe << ", \"ae\": " << r.error.ae << ", \"outliers\": " << r.error.outliers;
+
+        json << "}";
+      }
+
+      json << (m_results.empty() ? "" : "\n  ") << "]\n}\n";
+
+      return json.str();
+    }
+
+    static std::string Convert2String(std::size_t i)
+    {
+      std::ostringstream strs; strs << i;
+      return strs.str();
+    }
+
+  private:
+
+    std::size_t m_repetitions;
+    std::string m_filter;
+    std::vector<Result> m_results;
+};
+
+// Measures the wall time of the given function
+double Time(const std::function<void()>& f)
+{
+  double start = of::Stats::now();
+  f();
+  return of::Stats::now() - start;
+}
+
+// Synthetic pair: procedural texture translated by the given magnitude
+void MakePair(const of::Size& size, double magnitude, std::unique_ptr<of::Image>& a, std::unique_ptr<of::Image>& b)
+{
+  of::Image* u = 0;
+  of::Image* v = 0;
+  of::Synthetic::makeFlow(of::OF_TRANSLATION_MOTION, size, magnitude, u, v);
+
+  std::unique_ptr<of::Image> gu(u), gv(v);
+
+  a.reset(of::Synthetic::makeTexture(size));
+  b.reset(of::Synthetic::makeTexture(size, u, v));
+}
+
+// Exposes the protected kernels of the base class
+class KernelBench : public of::OpticalFlow
+{
+  public:
+
+    KernelBench(of::Image* a, of::Image* b)
+      : OpticalFlow(a, b)
+    {
+      initialize();
+    }
+
+    void compute()
+    {
+      computeDerivativeImages();
+    }
+
+    of::Image* warpA(of::Image* u, of::Image* v) const
+    {
+      return warp(m_imga, u, v);
+    }
+};
+
+// Kernel level benchmarks on a single image size
+void RunMicro(Bench& bench, const of::Size& size)
+{
+  std::unique_ptr<of::Image> a, b;
+  MakePair(size, 0.5, a, b);
+
+  // 5 x 5 binomial kernel, as used by the pyramids
+  const double binomial[5] = { 1.0, 4.0, 6.0, 4.0, 1.0 };
+  of::Kernel kernel(5);
+  for(std::size_t i = 0; i < 5; ++i)
+    for(std::size_t j = 0; j < 5; ++j)
+      kernel.set(i, j, binomial[i] * binomial[j] / 256.0);
+
+  bench.run(OF_MICRO_SUITE, "filter2D-5x5", size, [&]() {
+    of::Image* result = 0;
+    double t = Time([&]() { result = a->filter2D(kernel); });
+    delete result;
+    return t;
+  });
+
+  // Direct and FFT paths of filter2D for larger kernels. Their crossover gives OF_FFT_FILTER_MIN_KERNEL_AREA.
+  const std::size_t largeKernelSizes[] = { 9, 17, 31 };
+
+  for(std::size_t i = 0; i < sizeof(largeKernelSizes) / sizeof(std::size_t); ++i)
+  {
+    const std::size_t ksize = largeKernelSizes[i];
+    std::vector<double> large(ksize * ksize, 1.0 / (ksize * ksize));
+    std::vector<double> result(size.npixels);
+
+    std::ostringstream direct; direct << "filter2D-direct-" << ksize << "x" << ksize;
+
+    bench.run(OF_MICRO_SUITE, direct.str(), size, [&]() {
+      return Time([&]() {
+        const std::size_t nbands = (size.nlines + 63) / 64;
+        of::Parallel::forEach(nbands, [&](std::size_t band) {
+          of::Kernels::get().filter2D(a->getBuffer(), size.nlines, size.ncols, &large[0], ksize, ksize, &result[0],
+                                      band * 64, std::min(size.nlines, band * 64 + 64));
+        });
+      });
+    });
+
+    std::ostringstream fft; fft << "filter2D-fft-" << ksize << "x" << ksize;
+
+    bench.run(OF_MICRO_SUITE, fft.str(), size, [&]() {
+      return Time([&]() { of::FFT::filter2D(a->getBuffer(), size.nlines, size.ncols, &large[0], ksize, ksize, &result[0]); });
+    });
+  }
+
+  bench.run(OF_MICRO_SUITE, "Pyramid::down", size, [&]() {
+    of::Image* result = 0;
+    double t = Time([&]() { result = of::Pyramid::down(a.get()); });
+    delete result;
+    return t;
+  });
+
+  std::unique_ptr<of::Image> half(of::Pyramid::down(a.get()));
+
+  bench.run(OF_MICRO_SUITE, "Pyramid::up", size, [&]() {
+    of::Image* result = 0;
+    double t = Time([&]() { result = of::Pyramid::up(half.get(), size); });
+    delete result;
+    return t;
+  });
+
+  KernelBench kernels(a.get(), b.get());
+
+  bench.run(OF_MICRO_SUITE, "computeDerivativeImages", size, [&]() {
+    return Time([&]() { kernels.compute(); });
+  });
+
+  std::unique_ptr<of::Image> u(new of::Image(size));
+  std::unique_ptr<of::Image> v(new of::Image(size));
+  u->fill(0.5);
+  v->fill(-0.25);
+
+  bench.run(OF_MICRO_SUITE, "warp", size, [&]() {
+    of::Image* result = 0;
+    double t = Time([&]() { result = kernels.warpA(u.get(), v.get()); });
+    delete result;
+    return t;
+  });
+
+  // buildMatrix is private: it is measured by the window-sums stage (5 buildMatrix calls) of a LK run.
+  // 7 and 15 use compile-time window sizes, 17 uses the generic path.
+  const std::size_t windowSizes[] = { 7, 15, 17 };
+
+  for(std::size_t i = 0; i < sizeof(windowSizes) / sizeof(std::size_t); ++i)
+  {
+    const std::size_t ksize = windowSizes[i];
+    std::ostringstream name; name << "buildMatrix-" << ksize << "x" << ksize;
+
+    bench.run(OF_MICRO_SUITE, name.str(), size, [&]() {
+      of::LucasKanade lk(a.get(), b.get());
+      lk.setKernelSize(ksize);
+      lk.setStatsEnabled(true);
+      lk.compute();
+      return lk.getStats().getStage("window-sums").seconds / 5.0;
+    });
+  }
+
+  // Direct window sums against running box sums (see OF_BOX_SUM_MIN_KERNEL_SIZE)
+  const std::size_t boxSizes[] = { 3, 5, 7, 15, 21, 23, 31 };
+  std::vector<double> sum(size.npixels);
+
+  for(std::size_t i = 0; i < sizeof(boxSizes) / sizeof(std::size_t); ++i)
+  {
+    const std::size_t ksize = boxSizes[i];
+    std::ostringstream direct, box;
+    direct << "windowSum-" << ksize << "x" << ksize;
+    box << "boxSum-" << ksize << "x" << ksize;
+
+    bench.run(OF_MICRO_SUITE, direct.str(), size, [&]() {
+      return Time([&]() { of::Kernels::windowSum(a->getBuffer(), b->getBuffer(), size.nlines, size.ncols, ksize, &sum[0]); });
+    });
+
+    bench.run(OF_MICRO_SUITE, box.str(), size, [&]() {
+      return Time([&]() { of::Kernels::boxSum(a->getBuffer(), b->getBuffer(), size.nlines, size.ncols, ksize, &sum[0]); });
+    });
+  }
+
+  // Gaussian windows: the cost of the recursive filter does not depend on sigma
+  const double sigmas[] = { 1.0, 4.0 };
+
+  for(std::size_t i = 0; i < sizeof(sigmas) / sizeof(double); ++i)
+  {
+    std::ostringstream name; name << "recursiveGaussian-" << sigmas[i];
+
+    bench.run(OF_MICRO_SUITE, name.str(), size, [&]() {
+      const of::RecursiveGaussian gaussian(sigmas[i]);
+      return Time([&]() { gaussian.filter(a->getBuffer(), size.nlines, size.ncols, &sum[0]); });
+    });
+  }
+
+  bench.run(OF_MICRO_SUITE, "buildMatrix-gaussian", size, [&]() {
+    of::LucasKanade lk(a.get(), b.get());
+    lk.setWindow(of::OF_GAUSSIAN_WINDOW);
+    lk.setStatsEnabled(true);
+    lk.compute();
+    return lk.getStats().getStage("window-sums").seconds / 5.0;
+  });
+
+  // Block costs of block matching: one evaluation of each 16 x 16 block of the image, without early termination
+  const char* costs[] = { "blockSAD-16x16", "blockSSD-16x16", "blockNCC-16x16" };
+
+  for(std::size_t c = 0; c < sizeof(costs) / sizeof(costs[0]); ++c)
+  {
+    bench.run(OF_MICRO_SUITE, costs[c], size, [&]() {
+      const of::KernelTable& table = of::Kernels::get();
+      const std::size_t bs = 16;
+      double sum = 0.0;
+
+      double t = Time([&]() {
+        for(std::size_t lin = 0; lin + bs <= size.nlines; lin += bs)
+        {
+          for(std::size_t col = 0; col + bs <= size.ncols; col += bs)
+          {
+            const double* pa = a->getBuffer() + lin * size.ncols + col;
+            const double* pb = b->getBuffer() + lin * size.ncols + col;
+
+            if(c == 0)
+              sum += table.blockSAD(pa, pb, size.ncols, bs, std::numeric_limits<double>::infinity());
+            else if(c == 1)
+              sum += table.blockSSD(pa, pb, size.ncols, bs, std::numeric_limits<double>::infinity());
+            else
+              sum += table.blockNCC(pa, pb, size.ncols, bs);
+          }
+        }
+      });
+
+      // Keeps the evaluations from being optimized out
+      if(sum < 0.0)
+        std::cerr << sum << std::endl;
+
+      return t;
+    });
+  }
+
+  // Census transforms, and the Hamming costs of each 16 x 16 block of the image
+  std::vector<std::uint32_t> census5a, census5b;
+  std::vector<std::uint64_t> census7a, census7b;
+
+  bench.run(OF_MICRO_SUITE, "census5x5", size, [&]() {
+    return Time([&]() { of::Census::transform5x5(a.get(), census5a); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "census7x7", size, [&]() {
+    return Time([&]() { of::Census::transform7x7(a.get(), census7a); });
+  });
+
+  of::Census::transform5x5(a.get(), census5a);
+  of::Census::transform5x5(b.get(), census5b);
+  of::Census::transform7x7(a.get(), census7a);
+  of::Census::transform7x7(b.get(), census7b);
+
+  const char* hammingCosts[] = { "blockHamming32-16x16", "blockHamming64-16x16" };
+
+  for(std::size_t c = 0; c < sizeof(hammingCosts) / sizeof(hammingCosts[0]); ++c)
+  {
+    bench.run(OF_MICRO_SUITE, hammingCosts[c], size, [&]() {
+      const of::KernelTable& table = of::Kernels::get();
+      const std::size_t bs = 16;
+      double sum = 0.0;
+
+      double t = Time([&]() {
+        for(std::size_t lin = 0; lin + bs <= size.nlines; lin += bs)
+        {
+          for(std::size_t col = 0; col + bs <= size.ncols; col += bs)
+          {
+            const std::size_t i = lin * size.ncols + col;
+
+            if(c == 0)
+              sum += table.blockHamming32(&census5a[i], &census5b[i], size.ncols, bs, std::numeric_limits<double>::infinity());
+            else
+              sum += table.blockHamming64(&census7a[i], &census7b[i], size.ncols, bs, std::numeric_limits<double>::infinity());
+          }
+        }
+      });
+
+      // Keeps the evaluations from being optimized out
+      if(sum < 0.0)
+        std::cerr << sum << std::endl;
+
+      return t;
+    });
+  }
+
+  // Fixed-point Lucas & Kanade kernels, over 9-bit images (the largest that keeps 15 x 15 sums in 32 bits)
+  std::vector<std::int16_t> qa, qb, qfx(size.npixels), qfy(size.npixels), qft(size.npixels), qw(size.npixels);
+  std::vector<std::int32_t> qsum(size.npixels);
+  {
+    of::FixedPoint fixed(a.get(), b.get(), of::FixedPoint::getWindowSumBits(15));
+    fixed.quantize(a.get(), qa);
+    fixed.quantize(b.get(), qb);
+  }
+
+  bench.run(OF_MICRO_SUITE, "derivativesFixed", size, [&]() {
+    return Time([&]() { of::Kernels::derivativesFixed(&qa[0], &qb[0], size.nlines, size.ncols, &qfx[0], &qfy[0], &qft[0]); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "windowSumFixed-15x15", size, [&]() {
+    return Time([&]() { of::Kernels::windowSumFixed(&qfx[0], &qft[0], size.nlines, size.ncols, 15, &qsum[0]); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "warpFixed", size, [&]() {
+    return Time([&]() { of::Kernels::warpFixed(&qa[0], u->getBuffer(), v->getBuffer(), 1.0, size.nlines, size.ncols, &qw[0]); });
+  });
+
+  // Float kernels of the mixed precision
+  std::vector<float> fa(a->getBuffer(), a->getBuffer() + size.npixels), fb(b->getBuffer(), b->getBuffer() + size.npixels);
+  std::vector<float> fu(size.npixels, 0.5f), fv(size.npixels, -0.25f), fdx(size.npixels), fdy(size.npixels), fdt(size.npixels);
+  std::vector<float> fout(size.npixels);
+  std::vector<double> dout(size.npixels);
+
+  bench.run(OF_MICRO_SUITE, "derivativesFloat", size, [&]() {
+    return Time([&]() { of::Kernels::derivatives(&fa[0], &fb[0], size.nlines, size.ncols, &fdx[0], &fdy[0], &fdt[0]); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "windowSumFloat-15x15", size, [&]() {
+    return Time([&]() { of::Kernels::windowSum(&fdx[0], &fdt[0], size.nlines, size.ncols, 15, &dout[0]); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "warpFloat", size, [&]() {
+    return Time([&]() { of::Kernels::warp(&fa[0], &fu[0], &fv[0], 1.0, size.nlines, size.ncols, &fout[0]); });
+  });
+
+  // Global translation of the whole image (largest power of two window)
+  bench.run(OF_MICRO_SUITE, "phaseCorrelation", size, [&]() {
+    of::PhaseCorrelation pc;
+    return Time([&]() { pc.estimate(a.get(), b.get()); });
+  });
+
+  // One Horn & Schunck sweep (local averages plus update), from the iteration stage
+  bench.run(OF_MICRO_SUITE, "HS-sweep", size, [&]() {
+    of::HornSchunck hs(a.get(), b.get());
+    hs.setMaxNumberOfIterations(10);
+    hs.setAutoStopThreshold(0.0);
+    hs.setStatsEnabled(true);
+    hs.compute();
+    of::StageStats s = hs.getStats().getStage("iteration");
+    return s.seconds / s.calls;
+  });
+
+  bench.run(OF_MICRO_SUITE, "HS-sweep-mixed", size, [&]() {
+    of::HornSchunck hs(a.get(), b.get());
+    hs.setMaxNumberOfIterations(10);
+    hs.setAutoStopThreshold(0.0);
+    hs.setPrecision(of::OF_MIXED_PRECISION);
+    hs.setStatsEnabled(true);
+    hs.compute();
+    of::StageStats s = hs.getStats().getStage("iteration");
+    return s.seconds / s.calls;
+  });
+
+  // Row streaming into images, with the memory of a few lines
+  bench.run(OF_MICRO_SUITE, "LK-stream", size, [&]() {
+    of::Image su(size), sv(size);
+    of::ImageRowSink sink(&su, &sv);
+    of::LucasKanade lk(a.get(), b.get());
+    return Time([&]() { lk.stream(sink); });
+  });
+
+  bench.run(OF_MICRO_SUITE, "HS-stream-10", size, [&]() {
+    of::Image su(size), sv(size);
+    of::ImageRowSink sink(&su, &sv);
+    of::HornSchunck hs(a.get(), b.get());
+    hs.setMaxNumberOfIterations(10);
+    return Time([&]() { hs.stream(sink); });
+  });
+}
+
+// A benchmarked method configuration
+struct Configuration
+{
+  std::string name;      // The configuration name. (the method name, plus the DIS preset, the BM search pattern or cost,
+                         // the LKC2F registration or data term, or the precision)
+  of::Parameters params; // The method parameters.
+};
+
+// Returns the configurations of the end-to-end benchmarks: each method, each DIS preset, each BM search pattern,
+// the BM census costs, each LKC2F pre-registration, the LKC2F census data term, the fixed and mixed precisions,
+// and the LK / LKC2F gaussian windows
+std::vector<Configuration> GetConfigurations(std::size_t hsIterations)
+{
+  std::vector<Configuration> configurations;
+
+  std::vector<std::string> methods = of::OpticalFlowFactory::getMethods();
+
+  for(std::size_t i = 0; i < methods.size(); ++i)
+  {
+    Configuration configuration;
+    configuration.name = methods[i];
+    configuration.params.method = methods[i];
+
+    // Fixed amount of work, independent of convergence
+    if(configuration.params.method == of::OF_HS_METHOD)
+    {
+      configuration.params.maxIterations = hsIterations;
+      configuration.params.autoStopThreshold = 0.0;
+    }
+
+    if(configuration.params.method == of::OF_BM_METHOD)
+    {
+      std::vector<std::string> searches = of::BlockMatching::getSearches();
+
+      for(std::size_t j = 0; j < searches.size(); ++j)
+      {
+        configuration.name = methods[i] + "-" + searches[j];
+        configuration.params.search = searches[j];
+        configurations.push_back(configuration);
+      }
+
+      const std::string census[] = { of::OF_BM_CENSUS5_COST, of::OF_BM_CENSUS7_COST };
+
+      for(std::size_t j = 0; j < 2; ++j)
+      {
+        configuration.name = methods[i] + "-" + census[j];
+        configuration.params.search = OF_DEFAULT_BM_SEARCH;
+        configuration.params.cost = census[j];
+        configurations.push_back(configuration);
+      }
+
+      continue;
+    }
+
+    if(configuration.params.method == of::OF_LKC2F_METHOD)
+    {
+      std::vector<std::string> registrations = of::PhaseCorrelation::getRegistrations();
+
+      for(std::size_t j = 0; j < registrations.size(); ++j)
+      {
+        configuration.name = methods[i] + (registrations[j] == of::OF_NO_REGISTRATION ? "" : "-" + registrations[j]);
+        configuration.params.registration = registrations[j];
+        configurations.push_back(configuration);
+      }
+
+      configuration.name = methods[i] + "-" + of::OF_CENSUS_DATA_TERM;
+      configuration.params.registration = OF_DEFAULT_REGISTRATION;
+      configuration.params.dataTerm = of::OF_CENSUS_DATA_TERM;
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_FIXED_PRECISION;
+      configuration.params.dataTerm = OF_DEFAULT_DATA_TERM;
+      configuration.params.precision = of::OF_FIXED_PRECISION;
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_MIXED_PRECISION;
+      configuration.params.precision = of::OF_MIXED_PRECISION;
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_GAUSSIAN_WINDOW;
+      configuration.params.precision = OF_DEFAULT_PRECISION;
+      configuration.params.window = of::OF_GAUSSIAN_WINDOW;
+      configurations.push_back(configuration);
+
+      continue;
+    }
+
+    if(configuration.params.method == of::OF_LK_METHOD)
+    {
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_FIXED_PRECISION;
+      configuration.params.precision = of::OF_FIXED_PRECISION;
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_MIXED_PRECISION;
+      configuration.params.precision = of::OF_MIXED_PRECISION;
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_GAUSSIAN_WINDOW;
+      configuration.params.precision = OF_DEFAULT_PRECISION;
+      configuration.params.window = of::OF_GAUSSIAN_WINDOW;
+      configurations.push_back(configuration);
+
+      continue;
+    }
+
+    if(configuration.params.method == of::OF_HS_METHOD)
+    {
+      configurations.push_back(configuration);
+
+      configuration.name = methods[i] + "-" + of::OF_MIXED_PRECISION;
+      configuration.params.precision = of::OF_MIXED_PRECISION;
+      configurations.push_back(configuration);
+
+      continue;
+    }
+
+    if(configuration.params.method != of::OF_DIS_METHOD)
+    {
+      configurations.push_back(configuration);
+      continue;
+    }
+
+    std::vector<std::string> presets = of::DenseInverseSearch::getPresets();
+
+    for(std::size_t j = 0; j < presets.size(); ++j)
+    {
+      configuration.name = methods[i] + "-" + presets[j];
+      configuration.params.preset = presets[j];
+      configurations.push_back(configuration);
+    }
+  }
+
+  return configurations;
+}
+
+// Runs all methods over the given pair
+void RunMethods(Bench& bench, const std::string& suite, const std::string& label, of::Image* a, of::Image* b, std::size_t hsIterations)
+{
+  std::vector<Configuration> configurations = GetConfigurations(hsIterations);
+
+  for(std::size_t i = 0; i < configurations.size(); ++i)
+  {
+    const of::Parameters& params = configurations[i].params;
+
+    bench.run(suite, label + configurations[i].name, a->getSize(), [&]() {
+      std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(a, b, params));
+      return Time([&]() { of->compute(); });
+    });
+  }
+}
+
+// End-to-end benchmarks over synthetic sizes
+void RunMacro(Bench& bench, std::size_t minSize, std::size_t maxSize, std::size_t hsIterations)
+{
+  for(std::size_t n = minSize; n <= maxSize; n *= 2)
+  {
+    of::Size size(n, n);
+
+    std::unique_ptr<of::Image> a, b;
+    MakePair(size, 1.5, a, b);
+
+    RunMethods(bench, OF_MACRO_SUITE, "", a.get(), b.get(), hsIterations);
+  }
+}
+
+// Brightness change between frames, as the diurnal heating of infrared channels: a gain that grows
+// from 1.2 (left) to 1.5 (right), plus an offset
+void ChangeBrightness(of::Image* image)
+{
+  const std::size_t nlines = image->getNLines(), ncols = image->getNCols();
+
+  for(std::size_t lin = 0; lin < nlines; ++lin)
+  {
+    for(std::size_t col = 0; col < ncols; ++col)
+    {
+      const double gain = 1.2 + 0.3 * col / std::max<std::size_t>(ncols - 1, 1);
+      image->setPixel(lin * ncols + col, gain * image->getPixel(lin * ncols + col) + 20.0);
+    }
+  }
+}
+
+// Accuracy and speed of each method over each synthetic motion model (e.g. for Pareto charts),
+// and over a translation with a brightness change. The fixed and mixed precisions are also compared with double.
+void RunAccuracy(Bench& bench, const of::Size& size, double magnitude, std::size_t hsIterations)
+{
+  // Ignore the borders, where the methods have no support
+  const std::size_t border = 8;
+
+  std::vector<std::string> models = of::Synthetic::getMotionModels();
+  models.push_back(OF_BRIGHTNESS_CASE);
+
+  std::vector<Configuration> configurations = GetConfigurations(hsIterations);
+
+  for(std::size_t i = 0; i < models.size(); ++i)
+  {
+    const bool brightness = models[i] == OF_BRIGHTNESS_CASE;
+
+    of::Image* u = 0;
+    of::Image* v = 0;
+    of::Synthetic::makeFlow(brightness ? of::OF_TRANSLATION_MOTION : models[i], size, magnitude, u, v);
+
+    std::unique_ptr<of::Image> gu(u), gv(v);
+    std::unique_ptr<of::Image> a(of::Synthetic::makeTexture(size));
+    std::unique_ptr<of::Image> b(of::Synthetic::makeTexture(size, u, v));
+
+    if(brightness)
+      ChangeBrightness(b.get());
+
+    for(std::size_t j = 0; j < configurations.size(); ++j)
+    {
+      const of::Parameters& params = configurations[j].params;
+
+      bench.runAccuracy(OF_ACCURACY_SUITE, models[i] + "/" + configurations[j].name, size, [&](of::FlowError* error) {
+        std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(a.get(), b.get(), params));
+        double t = Time([&]() { of->compute(); });
+        *error = of::Evaluation::compare(of->getU(), of->getV(), gu.get(), gv.get(), border);
+        return t;
+      });
+
+      if(params.precision == OF_DEFAULT_PRECISION)
+        continue;
+
+      // Reduced precisions are also compared with the flow of the same method in double precision
+      of::Parameters baseline = params;
+      baseline.precision = OF_DEFAULT_PRECISION;
+
+      std::unique_ptr<of::OpticalFlow> reference(of::OpticalFlowFactory::make(a.get(), b.get(), baseline));
+      reference->compute();
+
+      bench.runAccuracy(OF_ACCURACY_SUITE, models[i] + "/" + configurations[j].name + "-vs-double", size, [&](of::FlowError* error) {
+        std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(a.get(), b.get(), params));
+        double t = Time([&]() { of->compute(); });
+        *error = of::Evaluation::compare(of->getU(), of->getV(), reference->getU(), reference->getV(), border);
+        return t;
+      });
+    }
+  }
+}
+
+#ifdef OF_BENCH_HAVE_GDAL
+// Reads the first band of the given image path
+of::Image* ReadImage(const std::string& path)
+{
+  GDALDataset* dataset = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+  if(dataset == 0)
+    throw of::Exception("Could not open the image: " + path);
+
+  std::size_t nlines = dataset->GetRasterYSize();
+  std::size_t ncols = dataset->GetRasterXSize();
+
+  of::Image* image = new of::Image(nlines, ncols);
+  CPLErr err = dataset->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, ncols, nlines, image->getBuffer(), ncols, nlines, GDT_Float64, 0, 0);
+
+  GDALClose(dataset);
+
+  if(err != CE_None)
+  {
+    delete image;
+    throw of::Exception("Could not read the image: " + path);
+  }
+
+  return image;
+}
+#endif
+
+// End-to-end benchmarks over the bundled images
+void RunData(Bench& bench, const std::string& dir, std::size_t hsIterations)
+{
+#ifdef OF_BENCH_HAVE_GDAL
+  GDALAllRegister();
+
+  std::unique_ptr<of::Image> a(ReadImage(dir + "/satellitea.tif"));
+  std::unique_ptr<of::Image> b(ReadImage(dir + "/satelliteb.tif"));
+
+  RunMethods(bench, OF_DATA_SUITE, "satellite/", a.get(), b.get(), hsIterations);
+#else
+  (void)bench; (void)hsIterations;
+
+  std::cout << "- Data suite skipped: of-bench was built without GDAL (" << dir << ")" << std::endl;
+#endif
+}
+
+// Largest difference between the reference and the given values, relative to the largest reference value
+double Difference(const std::vector<double>& reference, const std::vector<double>& values)
+{
+  double scale = 1.0, diff = 0.0;
+  for(std::size_t i = 0; i < reference.size(); ++i)
+  {
+    scale = std::max(scale, std::abs(reference[i]));
+    diff = std::max(diff, std::abs(reference[i] - values[i]));
+  }
+
+  return diff / scale;
+}
+
+// Values of the given image
+std::vector<double> Values(const of::Image* image)
+{
+  return std::vector<double>(image->getBuffer(), image->getBuffer() + image->getNPixels());
+}
+
+// Checks the kernels of each available instruction set, and the parallel execution of the selected one,
+// against the scalar reference, over sizes that exercise the borders
+bool VerifyKernels()
+{
+  const char* kernels[] = { "filter2D", "derivatives", "windowSum", "warp", "localAverage", "hsUpdate", "blockCosts", "census", "fixed", "float", "boxSum" };
+  const std::size_t nKernels = sizeof(kernels) / sizeof(kernels[0]);
+
+  const std::size_t sizes[][2] = { { 1, 1 }, { 2, 3 }, { 5, 4 }, { 17, 9 }, { 64, 67 }, { 131, 200 }, { 515, 517 } };
+  const std::size_t kernelSizes[][2] = { { 3, 3 }, { 5, 5 }, { 7, 3 } };
+  const std::size_t windowSizes[] = { 3, 7, 11, 15, 21 };
+  const std::size_t largeKernelSizes[][2] = { { 19, 19 }, { 21, 31 }, { 41, 23 } };
+  const std::size_t blockSizes[] = { 1, 5, 8, 13, 16 };
+  const std::size_t fixedWindowSizes[] = { 3, 7, 15 };
+  const double scales[] = { 1.0, 0.5, -0.5 };
+
+  const double tolerance = 1e-12;
+
+  const of::KernelTable& reference = of::Kernels::getScalar();
+
+  std::cout << "- Selected kernels: " << of::Kernels::get().isa << std::endl;
+  std::cout << std::left << std::setw(10) << "isa" << std::setw(16) << "kernel" << std::right
+            << std::setw(16) << "max rel. diff" << std::setw(10) << "status" << std::endl;
+
+  bool ok = true;
+
+  std::vector<std::string> isas = of::Kernels::getAvailable();
+  isas.push_back("parallel");
+
+  double sumError = 0.0;
+  double fftError = 0.0;
+  double boxError = 0.0;
+
+  for(std::size_t t = 0; t < isas.size(); ++t)
+  {
+    const bool parallel = isas[t] == "parallel";
+    const of::KernelTable& table = parallel ? of::Kernels::get() : *of::Kernels::find(isas[t]);
+
+    std::vector<double> errors(nKernels, 0.0);
+
+    for(std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+      const std::size_t nlines = sizes[s][0], ncols = sizes[s][1], n = nlines * ncols;
+
+      // Deterministic pseudo-random inputs
+      std::vector<double> a(n), b(n), u(n), v(n), fx(n), fy(n), ft(n);
+      unsigned int seed = 12345u + static_cast<unsigned int>(s);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        seed = seed * 1664525u + 1013904223u; a[i] = (seed >> 8) % 25600 / 100.0;
+        seed = seed * 1664525u + 1013904223u; b[i] = (seed >> 8) % 25600 / 100.0;
+        seed = seed * 1664525u + 1013904223u; u[i] = (seed >> 8) % 6001 / 1000.0 - 3.0;
+        seed = seed * 1664525u + 1013904223u; v[i] = (seed >> 8) % 6001 / 1000.0 - 3.0;
+      }
+
+      std::vector<double> r1(n), r2(n), r3(n), o1(n), o2(n), o3(n);
+
+      for(std::size_t k = 0; k < sizeof(kernelSizes) / sizeof(kernelSizes[0]); ++k)
+      {
+        std::vector<double> kernel(kernelSizes[k][0] * kernelSizes[k][1]);
+        for(std::size_t i = 0; i < kernel.size(); ++i)
+          kernel[i] = (i + 1.0) / kernel.size();
+
+        reference.filter2D(&a[0], nlines, ncols, &kernel[0], kernelSizes[k][0], kernelSizes[k][1], &r1[0], 0, nlines);
+        if(parallel)
+          of::Kernels::filter2D(&a[0], nlines, ncols, &kernel[0], kernelSizes[k][0], kernelSizes[k][1], &o1[0]);
+        else
+          table.filter2D(&a[0], nlines, ncols, &kernel[0], kernelSizes[k][0], kernelSizes[k][1], &o1[0], 0, nlines);
+        errors[0] = std::max(errors[0], Difference(r1, o1));
+      }
+
+      reference.derivatives(&a[0], &b[0], nlines, ncols, &r1[0], &r2[0], &r3[0], 0, nlines);
+      if(parallel)
+        of::Kernels::derivatives(&a[0], &b[0], nlines, ncols, &o1[0], &o2[0], &o3[0]);
+      else
+        table.derivatives(&a[0], &b[0], nlines, ncols, &o1[0], &o2[0], &o3[0], 0, nlines);
+      errors[1] = std::max(errors[1], std::max(Difference(r1, o1), std::max(Difference(r2, o2), Difference(r3, o3))));
+
+      fx = r1; fy = r2; ft = r3;
+
+      for(std::size_t k = 0; k < sizeof(windowSizes) / sizeof(windowSizes[0]); ++k)
+      {
+        reference.windowSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &r1[0], 0, nlines);
+        if(parallel)
+          of::Kernels::windowSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &o1[0]);
+        else
+          table.windowSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &o1[0], 0, nlines);
+        errors[2] = std::max(errors[2], Difference(r1, o1));
+      }
+
+      // The running sums of the bands start on different lines: the parallel ones are compared with the direct sums
+      for(std::size_t k = 0; k < sizeof(windowSizes) / sizeof(windowSizes[0]); ++k)
+      {
+        if(parallel)
+        {
+          reference.windowSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &r1[0], 0, nlines);
+          of::Kernels::boxSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &o1[0]);
+          boxError = std::max(boxError, Difference(r1, o1));
+
+          const std::vector<double> ones(n, 1.0);
+          reference.windowSum(&fx[0], &ones[0], nlines, ncols, windowSizes[k], &r1[0], 0, nlines);
+          of::Kernels::boxSum(&fx[0], 0, nlines, ncols, windowSizes[k], &o1[0]);
+          boxError = std::max(boxError, Difference(r1, o1));
+          continue;
+        }
+
+        reference.boxSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &r1[0], 0, nlines);
+        table.boxSum(&fx[0], &fy[0], nlines, ncols, windowSizes[k], &o1[0], 0, nlines);
+        errors[10] = std::max(errors[10], Difference(r1, o1));
+
+        reference.boxSum(&fx[0], 0, nlines, ncols, windowSizes[k], &r1[0], 0, nlines);
+        table.boxSum(&fx[0], 0, nlines, ncols, windowSizes[k], &o1[0], 0, nlines);
+        errors[10] = std::max(errors[10], Difference(r1, o1));
+      }
+
+      for(std::size_t k = 0; k < sizeof(scales) / sizeof(scales[0]); ++k)
+      {
+        reference.warp(&a[0], &u[0], &v[0], scales[k], nlines, ncols, &r1[0], 0, nlines);
+        if(parallel)
+          of::Kernels::warp(&a[0], &u[0], &v[0], scales[k], nlines, ncols, &o1[0]);
+        else
+          table.warp(&a[0], &u[0], &v[0], scales[k], nlines, ncols, &o1[0], 0, nlines);
+        errors[3] = std::max(errors[3], Difference(r1, o1));
+      }
+
+      reference.localAverage(&u[0], nlines, ncols, &r1[0], 0, nlines);
+      if(parallel)
+        of::Kernels::localAverage(&u[0], nlines, ncols, &o1[0]);
+      else
+        table.localAverage(&u[0], nlines, ncols, &o1[0], 0, nlines);
+      errors[4] = std::max(errors[4], Difference(r1, o1));
+
+      std::vector<double> ubar(r1);
+      reference.localAverage(&v[0], nlines, ncols, &r1[0], 0, nlines);
+      std::vector<double> vbar(r1);
+
+      r1 = u; r2 = v; o1 = u; o2 = v;
+      std::vector<double> rsc(1, reference.hsUpdate(&fx[0], &fy[0], &ft[0], &ubar[0], &vbar[0], 15.0, &r1[0], &r2[0], 0, n));
+      std::vector<double> osc(1, parallel ? of::Kernels::hsUpdate(&fx[0], &fy[0], &ft[0], &ubar[0], &vbar[0], 15.0, n, &o1[0], &o2[0])
+                                          : table.hsUpdate(&fx[0], &fy[0], &ft[0], &ubar[0], &vbar[0], 15.0, &o1[0], &o2[0], 0, n));
+
+      // The parallel sum of the changes is made of partial sums: it is compared with a tolerance
+      errors[5] = std::max(errors[5], std::max(parallel ? 0.0 : Difference(rsc, osc), std::max(Difference(r1, o1), Difference(r2, o2))));
+      sumError = std::max(sumError, Difference(rsc, osc));
+
+      // Census words (at most 48 bits) are exact as doubles
+      std::vector<std::uint32_t> r5a(n), r5b(n), o5(n);
+      std::vector<std::uint64_t> r7a(n), r7b(n), o7(n);
+
+      reference.census5x5(&a[0], nlines, ncols, &r5a[0], 0, nlines);
+      reference.census5x5(&b[0], nlines, ncols, &r5b[0], 0, nlines);
+      reference.census7x7(&a[0], nlines, ncols, &r7a[0], 0, nlines);
+      reference.census7x7(&b[0], nlines, ncols, &r7b[0], 0, nlines);
+
+      if(parallel)
+      {
+        of::Kernels::census5x5(&a[0], nlines, ncols, &o5[0]);
+        of::Kernels::census7x7(&a[0], nlines, ncols, &o7[0]);
+      }
+      else
+      {
+        table.census5x5(&a[0], nlines, ncols, &o5[0], 0, nlines);
+        table.census7x7(&a[0], nlines, ncols, &o7[0], 0, nlines);
+      }
+
+      errors[7] = std::max(errors[7], Difference(std::vector<double>(r5a.begin(), r5a.end()), std::vector<double>(o5.begin(), o5.end())));
+      errors[7] = std::max(errors[7], Difference(std::vector<double>(r7a.begin(), r7a.end()), std::vector<double>(o7.begin(), o7.end())));
+
+      // Fixed-point kernels are exact. 9-bit inputs keep the 15 x 15 window sums in 32 bits.
+      std::vector<std::int16_t> qa(n), qb(n), rfx(n), rfy(n), rft(n), ofx(n), ofy(n), oft(n), rw(n), ow(n);
+      std::vector<std::int32_t> rs(n), os(n);
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        qa[i] = std::int16_t(a[i] * 2.0);
+        qb[i] = std::int16_t(b[i] * 2.0);
+      }
+
+      reference.derivativesFixed(&qa[0], &qb[0], nlines, ncols, &rfx[0], &rfy[0], &rft[0], 0, nlines);
+      if(parallel)
+        of::Kernels::derivativesFixed(&qa[0], &qb[0], nlines, ncols, &ofx[0], &ofy[0], &oft[0]);
+      else
+        table.derivativesFixed(&qa[0], &qb[0], nlines, ncols, &ofx[0], &ofy[0], &oft[0], 0, nlines);
+
+      bool fixedOk = rfx == ofx && rfy == ofy && rft == oft;
+
+      for(std::size_t k = 0; k < sizeof(fixedWindowSizes) / sizeof(fixedWindowSizes[0]); ++k)
+      {
+        reference.windowSumFixed(&rfx[0], &rft[0], nlines, ncols, fixedWindowSizes[k], &rs[0], 0, nlines);
+        if(parallel)
+          of::Kernels::windowSumFixed(&rfx[0], &rft[0], nlines, ncols, fixedWindowSizes[k], &os[0]);
+        else
+          table.windowSumFixed(&rfx[0], &rft[0], nlines, ncols, fixedWindowSizes[k], &os[0], 0, nlines);
+        fixedOk = fixedOk && rs == os;
+      }
+
+      for(std::size_t k = 0; k < sizeof(scales) / sizeof(scales[0]); ++k)
+      {
+        reference.warpFixed(&qa[0], &u[0], &v[0], scales[k], nlines, ncols, &rw[0], 0, nlines);
+        if(parallel)
+          of::Kernels::warpFixed(&qa[0], &u[0], &v[0], scales[k], nlines, ncols, &ow[0]);
+        else
+          table.warpFixed(&qa[0], &u[0], &v[0], scales[k], nlines, ncols, &ow[0], 0, nlines);
+        fixedOk = fixedOk && rw == ow;
+      }
+
+      errors[8] = std::max(errors[8], fixedOk ? 0.0 : 1.0);
+
+      // Float kernels keep the order of operations of the scalar reference, as the double ones
+      std::vector<float> fa(a.begin(), a.end()), fb(b.begin(), b.end()), fu(u.begin(), u.end()), fv(v.begin(), v.end());
+      std::vector<float> f1(n), f2(n), f3(n), g1(n), g2(n), g3(n);
+      std::vector<double> rf, gf;
+
+      reference.derivativesFloat(&fa[0], &fb[0], nlines, ncols, &f1[0], &f2[0], &f3[0], 0, nlines);
+      if(parallel)
+        of::Kernels::derivatives(&fa[0], &fb[0], nlines, ncols, &g1[0], &g2[0], &g3[0]);
+      else
+        table.derivativesFloat(&fa[0], &fb[0], nlines, ncols, &g1[0], &g2[0], &g3[0], 0, nlines);
+      rf.insert(rf.end(), f1.begin(), f1.end()); rf.insert(rf.end(), f2.begin(), f2.end()); rf.insert(rf.end(), f3.begin(), f3.end());
+      gf.insert(gf.end(), g1.begin(), g1.end()); gf.insert(gf.end(), g2.begin(), g2.end()); gf.insert(gf.end(), g3.begin(), g3.end());
+
+      const std::vector<float> fdx(f1), fdt(f3);
+
+      for(std::size_t k = 0; k < sizeof(windowSizes) / sizeof(windowSizes[0]); ++k)
+      {
+        std::vector<double> rs(n), gs(n);
+        reference.windowSumFloat(&fdx[0], &fdt[0], nlines, ncols, windowSizes[k], &rs[0], 0, nlines);
+        if(parallel)
+          of::Kernels::windowSum(&fdx[0], &fdt[0], nlines, ncols, windowSizes[k], &gs[0]);
+        else
+          table.windowSumFloat(&fdx[0], &fdt[0], nlines, ncols, windowSizes[k], &gs[0], 0, nlines);
+        rf.insert(rf.end(), rs.begin(), rs.end());
+        gf.insert(gf.end(), gs.begin(), gs.end());
+      }
+
+      for(std::size_t k = 0; k < sizeof(scales) / sizeof(scales[0]); ++k)
+      {
+        reference.warpFloat(&fa[0], &fu[0], &fv[0], scales[k], nlines, ncols, &f1[0], 0, nlines);
+        if(parallel)
+          of::Kernels::warp(&fa[0], &fu[0], &fv[0], scales[k], nlines, ncols, &g1[0]);
+        else
+          table.warpFloat(&fa[0], &fu[0], &fv[0], scales[k], nlines, ncols, &g1[0], 0, nlines);
+        rf.insert(rf.end(), f1.begin(), f1.end());
+        gf.insert(gf.end(), g1.begin(), g1.end());
+      }
+
+      reference.localAverageFloat(&fu[0], nlines, ncols, &f1[0], 0, nlines);
+      if(parallel)
+        of::Kernels::localAverage(&fu[0], nlines, ncols, &g1[0]);
+      else
+        table.localAverageFloat(&fu[0], nlines, ncols, &g1[0], 0, nlines);
+      rf.insert(rf.end(), f1.begin(), f1.end());
+      gf.insert(gf.end(), g1.begin(), g1.end());
+
+      const std::vector<float> fubar(f1);
+      reference.localAverageFloat(&fv[0], nlines, ncols, &f2[0], 0, nlines);
+      const std::vector<float> fvbar(f2);
+
+      f1 = fu; f2 = fv; g1 = fu; g2 = fv;
+      const double frsc = reference.hsUpdateFloat(&fdx[0], &fdt[0], &fdt[0], &fubar[0], &fvbar[0], 15.0, &f1[0], &f2[0], 0, n);
+      const double fosc = parallel ? of::Kernels::hsUpdate(&fdx[0], &fdt[0], &fdt[0], &fubar[0], &fvbar[0], 15.0, n, &g1[0], &g2[0])
+                                   : table.hsUpdateFloat(&fdx[0], &fdt[0], &fdt[0], &fubar[0], &fvbar[0], 15.0, &g1[0], &g2[0], 0, n);
+      rf.insert(rf.end(), f1.begin(), f1.end()); rf.insert(rf.end(), f2.begin(), f2.end());
+      gf.insert(gf.end(), g1.begin(), g1.end()); gf.insert(gf.end(), g2.begin(), g2.end());
+      if(!parallel)
+      {
+        rf.push_back(frsc);
+        gf.push_back(fosc);
+      }
+
+      errors[9] = std::max(errors[9], Difference(rf, gf));
+
+      // Block costs between the top-left block of a and the bottom-right block of b, complete and stopped early
+      for(std::size_t k = 0; k < sizeof(blockSizes) / sizeof(blockSizes[0]); ++k)
+      {
+        const std::size_t bs = blockSizes[k];
+        if(bs > nlines || bs > ncols)
+          continue;
+
+        const double* pa = &a[0];
+        const double* pb = &b[(nlines - bs) * ncols + ncols - bs];
+        const double inf = std::numeric_limits<double>::infinity();
+
+        std::vector<double> rc, oc;
+        rc.push_back(reference.blockSAD(pa, pb, ncols, bs, inf));
+        rc.push_back(reference.blockSAD(pa, pb, ncols, bs, rc[0] * 0.5));
+        rc.push_back(reference.blockSSD(pa, pb, ncols, bs, inf));
+        rc.push_back(reference.blockSSD(pa, pb, ncols, bs, rc[2] * 0.5));
+        rc.push_back(reference.blockNCC(pa, pb, ncols, bs));
+
+        oc.push_back(table.blockSAD(pa, pb, ncols, bs, inf));
+        oc.push_back(table.blockSAD(pa, pb, ncols, bs, rc[0] * 0.5));
+        oc.push_back(table.blockSSD(pa, pb, ncols, bs, inf));
+        oc.push_back(table.blockSSD(pa, pb, ncols, bs, rc[2] * 0.5));
+        oc.push_back(table.blockNCC(pa, pb, ncols, bs));
+
+        const std::size_t ib = (nlines - bs) * ncols + ncols - bs;
+
+        rc.push_back(reference.blockHamming32(&r5a[0], &r5b[ib], ncols, bs, inf));
+        rc.push_back(reference.blockHamming32(&r5a[0], &r5b[ib], ncols, bs, rc[5] * 0.5));
+        rc.push_back(reference.blockHamming64(&r7a[0], &r7b[ib], ncols, bs, inf));
+        rc.push_back(reference.blockHamming64(&r7a[0], &r7b[ib], ncols, bs, rc[7] * 0.5));
+
+        oc.push_back(table.blockHamming32(&r5a[0], &r5b[ib], ncols, bs, inf));
+        oc.push_back(table.blockHamming32(&r5a[0], &r5b[ib], ncols, bs, rc[5] * 0.5));
+        oc.push_back(table.blockHamming64(&r7a[0], &r7b[ib], ncols, bs, inf));
+        oc.push_back(table.blockHamming64(&r7a[0], &r7b[ib], ncols, bs, rc[7] * 0.5));
+
+        errors[6] = std::max(errors[6], Difference(rc, oc));
+      }
+
+      // Large kernels use the FFT in the interior: they are compared with a tolerance
+      if(parallel)
+      {
+        for(std::size_t k = 0; k < sizeof(largeKernelSizes) / sizeof(largeKernelSizes[0]); ++k)
+        {
+          std::vector<double> kernel(largeKernelSizes[k][0] * largeKernelSizes[k][1]);
+          for(std::size_t i = 0; i < kernel.size(); ++i)
+            kernel[i] = (i % 7 + 1.0) / kernel.size();
+
+          reference.filter2D(&a[0], nlines, ncols, &kernel[0], largeKernelSizes[k][0], largeKernelSizes[k][1], &r1[0], 0, nlines);
+          of::Kernels::filter2D(&a[0], nlines, ncols, &kernel[0], largeKernelSizes[k][0], largeKernelSizes[k][1], &o1[0]);
+          fftError = std::max(fftError, Difference(r1, o1));
+        }
+      }
+    }
+
+    for(std::size_t k = 0; k < nKernels; ++k)
+    {
+      bool passed = errors[k] <= tolerance;
+      ok = ok && passed;
+
+      std::cout << std::left << std::setw(10) << isas[t] << std::setw(16) << kernels[k] << std::right
+                << std::scientific << std::setprecision(3) << std::setw(16) << errors[k]
+                << std::setw(10) << (passed ? "OK" : "FAILED") << std::endl;
+    }
+  }
+
+  // Row streaming of the selected variant, against the whole image computation
+  double streamError = 0.0;
+  {
+    std::unique_ptr<of::Image> a, b;
+    MakePair(of::Size(67, 53), 1.5, a, b);
+
+    of::Image su(a->getSize()), sv(a->getSize());
+    of::ImageRowSink sink(&su, &sv);
+
+    of::LucasKanade lk(a.get(), b.get());
+    lk.compute();
+    lk.stream(sink);
+
+    streamError = std::max(Difference(Values(lk.getU()), Values(&su)), Difference(Values(lk.getV()), Values(&sv)));
+
+    of::HornSchunck hs(a.get(), b.get());
+    hs.setMaxNumberOfIterations(7);
+    hs.setAutoStopThreshold(0.0);
+    hs.compute();
+    hs.stream(sink);
+
+    streamError = std::max(streamError, Difference(Values(hs.getU()), Values(&su)));
+    streamError = std::max(streamError, Difference(Values(hs.getV()), Values(&sv)));
+  }
+
+  // Coarse to fine Lucas & Kanade: the result includes the solve of the finest level. With a single level it is
+  // the Lucas & Kanade flow, and on a translation the refined flow is far closer than the upsampled coarse one
+  double levelError = 0.0, c2fEPE = 0.0;
+  {
+    const of::Size size(128, 128);
+
+    of::Image* u = 0;
+    of::Image* v = 0;
+    of::Synthetic::makeFlow(of::OF_TRANSLATION_MOTION, size, 1.5, u, v);
+
+    std::unique_ptr<of::Image> gu(u), gv(v);
+    std::unique_ptr<of::Image> a(of::Synthetic::makeTexture(size));
+    std::unique_ptr<of::Image> b(of::Synthetic::makeTexture(size, u, v));
+
+    of::LucasKanade lk(a.get(), b.get());
+    lk.compute();
+
+    of::LucasKanadeC2F single(a.get(), b.get(), 0);
+    single.compute();
+
+    if(single.getU() == 0 || single.getV() == 0)
+      levelError = std::numeric_limits<double>::infinity();
+    else
+      levelError = std::max(Difference(Values(lk.getU()), Values(single.getU())), Difference(Values(lk.getV()), Values(single.getV())));
+
+    of::LucasKanadeC2F c2f(a.get(), b.get());
+    c2f.compute();
+
+    c2fEPE = of::Evaluation::compare(c2f.getU(), c2f.getV(), gu.get(), gv.get(), 8).epe;
+  }
+
+  // Flat region next to texture: the running sums must not keep the rounding errors of the textured lines
+  double flatFlow = 0.0;
+  {
+    const std::size_t nlines = 160, ncols = 97, k = 25, flat = nlines / 2 + 2 * k;
+
+    std::unique_ptr<of::Image> a, b;
+    MakePair(of::Size(nlines, ncols), 0.5, a, b);
+
+    for(std::size_t i = nlines / 2 * ncols; i < nlines * ncols; ++i)
+    {
+      a->setPixel(i, 7.0);
+      b->setPixel(i, 7.0);
+    }
+
+    // Box sums of the squared differences to the flat value
+    std::vector<double> d(nlines * ncols), sums(nlines * ncols), rsums(nlines * ncols);
+    for(std::size_t i = 0; i < d.size(); ++i)
+      d[i] = a->getPixel(i) - 7.0;
+
+    of::Kernels::boxSum(&d[0], &d[0], nlines, ncols, k, &sums[0]);
+    of::Kernels::getScalar().boxSum(&d[0], &d[0], nlines, ncols, k, &rsums[0], 0, nlines);
+
+    std::vector<std::vector<double> > results;
+    results.push_back(sums);
+    results.push_back(rsums);
+
+    for(std::size_t census = 0; census < 2; ++census)
+    {
+      for(std::size_t iterations = 1; iterations <= 3; iterations += 2)
+      {
+        of::LucasKanade lk(a.get(), b.get());
+        lk.setKernelSize(k);
+        lk.setMaxNumberOfIterations(iterations);
+        if(census)
+          lk.setDataTerm(of::OF_CENSUS_DATA_TERM);
+        lk.compute();
+
+        results.push_back(Values(lk.getU()));
+        results.push_back(Values(lk.getV()));
+      }
+    }
+
+    of::Image su(a->getSize()), sv(a->getSize());
+    of::ImageRowSink sink(&su, &sv);
+
+    of::LucasKanade lk(a.get(), b.get());
+    lk.setKernelSize(k);
+    lk.stream(sink);
+
+    results.push_back(Values(&su));
+    results.push_back(Values(&sv));
+
+    for(std::size_t r = 0; r < results.size(); ++r)
+      for(std::size_t i = flat * ncols; i < nlines * ncols; ++i)
+        flatFlow = std::max(flatFlow, std::abs(results[r][i]));
+  }
+
+  std::cout << "- Parallel HS sum of changes, max rel. diff: " << sumError << std::endl;
+  std::cout << "- FFT filter2D (large kernels), max rel. diff: " << fftError << std::endl;
+  std::cout << "- Parallel boxSum against windowSum, max rel. diff: " << boxError << std::endl;
+  std::cout << "- Row streaming LK / HS, max rel. diff: " << streamError << std::endl;
+  std::cout << "- LKC2F single level against LK, max rel. diff: " << levelError << std::endl;
+  std::cout << "- LKC2F translation EPE (finest level solve): " << c2fEPE << std::endl;
+  std::cout << "- Running box sums on a flat region next to texture, max abs. value: " << flatFlow << std::endl;
+
+  std::cout.unsetf(std::ios::floatfield);
+
+  return ok && sumError <= 1e-9 && fftError <= 1e-9 && boxError <= 1e-9 && streamError <= 1e-9 &&
+         levelError <= 1e-9 && c2fEPE <= 0.1 && flatFlow == 0.0;
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("Optical Flow Benchmark Command Line Tool", ' ', "1.0");
+
+    std::vector<std::string> suites;
+    suites.push_back("all");
+    suites.push_back(OF_MICRO_SUITE);
+    suites.push_back(OF_MACRO_SUITE);
+    suites.push_back(OF_DATA_SUITE);
+    suites.push_back(OF_ACCURACY_SUITE);
+    TCLAP::ValuesConstraint<std::string> suitesConstraint(suites);
+
+    TCLAP::ValueArg<std::string> suiteArg("s", "suite", "Benchmark suite", false, "all", &suitesConstraint);
+
+    TCLAP::ValueArg<std::string> filterArg("", "filter", "Run only the benchmarks whose name contains this text", false, "", "string");
+
+    TCLAP::ValueArg<std::size_t> repetitionsArg("r", "repetitions", "Number of repetitions of each benchmark (best and median are reported)",
+                                                false, 3, "integer");
+
+    TCLAP::ValueArg<std::size_t> microSizeArg("", "micro-size", "Image size (n x n) of the micro benchmarks", false, 1024, "integer");
+
+    TCLAP::ValueArg<std::size_t> minSizeArg("", "min-size", "Smallest image size (n x n) of the macro benchmarks", false, 256, "integer");
+
+    TCLAP::ValueArg<std::size_t> maxSizeArg("", "max-size", "Largest image size (n x n) of the macro benchmarks. Sizes double from min-size, up to 8192",
+                                            false, 1024, "integer");
+
+    TCLAP::ValueArg<std::size_t> hsIterationsArg("", "hs-iterations", "Number of Horn & Schunck iterations of the end-to-end benchmarks",
+                                                 false, 100, "integer");
+
+    TCLAP::ValueArg<std::size_t> accuracySizeArg("", "accuracy-size", "Image size (n x n) of the accuracy benchmarks", false, 256, "integer");
+
+    TCLAP::ValueArg<double> magnitudeArg("", "magnitude", "Largest displacement, in pixels, of the synthetic motions of the accuracy benchmarks",
+                                         false, 2.0, "double");
+
+    TCLAP::ValueArg<std::size_t> threadsArg("t", "threads", "Number of threads used by the library. 0: hardware threads", false, 0, "integer");
+
+    TCLAP::ValueArg<std::string> dataDirArg("d", "data", "Directory of the bundled images (satellitea.tif and satelliteb.tif)",
+                                            false, OF_BENCH_DATA_DIR, "string");
+
+    TCLAP::ValueArg<std::string> jsonArg("j", "json", "Path of the JSON results, for tracking regressions between versions", false, "", "string");
+
+    TCLAP::SwitchArg verifyArg("", "verify", "Check the kernels of each available instruction set against the scalar reference and exit", false);
+
+    cmd.add(verifyArg);
+    cmd.add(jsonArg);
+    cmd.add(dataDirArg);
+    cmd.add(threadsArg);
+    cmd.add(magnitudeArg);
+    cmd.add(accuracySizeArg);
+    cmd.add(hsIterationsArg);
+    cmd.add(maxSizeArg);
+    cmd.add(minSizeArg);
+    cmd.add(microSizeArg);
+    cmd.add(repetitionsArg);
+    cmd.add(filterArg);
+    cmd.add(suiteArg);
+
+    cmd.parse(argc, argv);
+
+    if(minSizeArg.getValue() < 16 || maxSizeArg.getValue() > 8192)
+      throw of::Exception("Wrong parameters 'min-size' and 'max-size': sizes must be in [16, 8192]");
+
+    if(verifyArg.getValue())
+      return VerifyKernels() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    of::Parallel::setNumberOfThreads(threadsArg.getValue());
+
+    std::cout << "- Kernels: " << of::Kernels::get().isa << std::endl;
+
+    Bench bench(repetitionsArg.getValue(), filterArg.getValue());
+    bench.printHeader();
+
+    std::string suite = suiteArg.getValue();
+
+    if(suite == "all" || suite == OF_MICRO_SUITE)
+      RunMicro(bench, of::Size(microSizeArg.getValue(), microSizeArg.getValue()));
+
+    if(suite == "all" || suite == OF_MACRO_SUITE)
+      RunMacro(bench, minSizeArg.getValue(), maxSizeArg.getValue(), hsIterationsArg.getValue());
+
+    if(suite == "all" || suite == OF_DATA_SUITE)
+      RunData(bench, dataDirArg.getValue(), hsIterationsArg.getValue());
+
+    if(suite == "all" || suite == OF_ACCURACY_SUITE)
+      RunAccuracy(bench, of::Size(accuracySizeArg.getValue(), accuracySizeArg.getValue()), magnitudeArg.getValue(), hsIterationsArg.getValue());
+
+    if(!jsonArg.getValue().empty())
+    {
+      std::ofstream file(jsonArg.getValue().c_str());
+      if(!file)
+        throw of::Exception("Could not create the JSON file: " + jsonArg.getValue());
+
+      file << bench.toJSON();
+
+      std::cout << "- JSON results: " << jsonArg.getValue() << std::endl;
+    }
+  }
+  catch(TCLAP::ArgException& e)
+  {
+    std::cerr << std::endl << "Argument exception: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(const of::Exception& e)
+  {
+    std::cerr << std::endl << "An exception has occurred: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(...)
+  {
+    std::cerr << std::endl << "An unexpected exception has occurred!" << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -5,11 +5,23 @@
 */
 
 // Optical Flow
+#include "../of/BlockMatching.h"
+#include "../of/Census.h"
+#include "../of/DenseInverseSearch.h"
 #include "../of/Exception.h"
+#include "../of/FixedPoint.h"
+#include "../of/FlowFile.h"
 #include "../of/Image.h"
-#include "../of/HornSchunck.h"
-#include "../of/LucasKanade.h"
-#include "../of/LucasKanadeC2F.h"
+#include "../of/OpticalFlow.h"
+#include "../of/OpticalFlowFactory.h"
+#include "../of/Parallel.h"
+#include "../of/PhaseCorrelation.h"
+#include "../of/RecursiveGaussian.h"
+#include "../of/Stats.h"
+#include "../of/TiledOpticalFlow.h"
+#include "../of/Trace.h"
+#include "BoundedQueue.h"
+#include "RasterStream.h"
 
 // GDAL/OGR
 #include <gdal_priv.h>
@@ -18,9 +30,17 @@
 #include <tclap/CmdLine.h>
 
 // STL
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiter)
@@ -43,10 +63,488 @@ std::string Convert2String(std::size_t i)
   return strs.str();
 }
 
-// Available methods
-const std::string OF_HS_METHOD = "HS";
-const std::string OF_LK_METHOD = "LK";
-const std::string OF_LKC2F_METHOD = "LKC2F";
+// Available output formats
+const std::string OF_FLO_FORMAT = "flo";
+const std::string OF_OFZ_FORMAT = "ofz";
+const std::string OF_TIF_FORMAT = "tif";
+
+// Reads the first band of the given image path
+of::Image* ReadImage(const std::string& path)
+{
+  GDALDataset* dataset = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+  if(dataset == 0)
+    throw of::Exception("Could not open the image: " + path);
+
+  // Retrieve dimensions
+  std::size_t nlines = dataset->GetRasterYSize();
+  std::size_t ncols = dataset->GetRasterXSize();
+
+  // Read buffer
+  double* buffer = new double[nlines * ncols];
+  CPLErr err = dataset->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, ncols, nlines, buffer, ncols, nlines, GDT_Float64, 0, 0);
+
+  // Close! GDAL is used only to read image data
+  GDALClose(dataset);
+
+  if(err != CE_None)
+  {
+    delete [] buffer;
+    throw of::Exception("Could not read the image: " + path);
+  }
+
+  // Encapsulate buffer
+  return new of::Image(buffer, nlines, ncols);
+}
+
+// Configuration file values (key = value)
+typedef std::map<std::string, std::string> Config;
+
+std::string Trim(const std::string& str)
+{
+  std::size_t first = str.find_first_not_of(" \t\r");
+  if(first == std::string::npos)
+    return "";
+
+  return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Reads a configuration file. Lines are 'key = value', where key is a long argument name. '#' starts a comment.
+void ReadConfig(const std::string& path, Config& config)
+{
+  std::ifstream file(path.c_str());
+  if(!file)
+    throw of::Exception("Could not open the configuration file: " + path);
+
+  std::string line;
+  for(std::size_t n = 1; std::getline(file, line); ++n)
+  {
+    line = Trim(line.substr(0, line.find('#')));
+    if(line.empty())
+      continue;
+
+    std::size_t pos = line.find('=');
+    if(pos == std::string::npos)
+      throw of::Exception("Wrong configuration file line " + Convert2String(n) + ": expected 'key = value'");
+
+    config[Trim(line.substr(0, pos))] = Trim(line.substr(pos + 1));
+  }
+}
+
+// Gets an argument value. The command line has precedence over the configuration file.
+template<class T>
+T GetValue(TCLAP::ValueArg<T>& arg, const Config& config)
+{
+  Config::const_iterator it = config.find(arg.getName());
+  if(arg.isSet() || it == config.end())
+    return arg.getValue();
+
+  T value;
+  std::istringstream is(it->second);
+  if(!(is >> value) || !(is >> std::ws).eof())
+    throw of::Exception("Wrong configuration value for '" + it->first + "': " + it->second);
+
+  return value;
+}
+
+template<>
+std::string GetValue(TCLAP::ValueArg<std::string>& arg, const Config& config)
+{
+  Config::const_iterator it = config.find(arg.getName());
+  if(arg.isSet() || it == config.end())
+    return arg.getValue();
+
+  return it->second;
+}
+
+bool GetValue(TCLAP::SwitchArg& arg, const Config& config)
+{
+  Config::const_iterator it = config.find(arg.getName());
+  if(arg.isSet() || it == config.end())
+    return arg.getValue();
+
+  if(it->second == "true" || it->second == "1")
+    return true;
+
+  if(it->second == "false" || it->second == "0")
+    return false;
+
+  throw of::Exception("Wrong configuration value for '" + it->first + "': " + it->second);
+}
+
+// Saves (u,v) using the given format
+void SaveFlow(const std::string& path, const std::string& format, double scale, const of::Image* u, const of::Image* v)
+{
+  if(format == OF_OFZ_FORMAT)
+    of::FlowFile::saveCompressed(path, u, v, scale);
+  else if(format == OF_TIF_FORMAT)
+    of::FlowRasterWriter(path, u->getSize()).write(u, v, of::Region(0, 0, u->getNLines(), u->getNCols()), 0, 0);
+  else
+    of::FlowFile::save(path, u, v);
+}
+
+// Estimation settings
+struct Settings
+{
+  of::Parameters params;  // The method and its tuning parameters.
+  std::string outputDir;  // The output directory.
+  std::string format;     // The output file format.
+  double scale;           // The fixed-point scale of compressed output.
+  std::size_t nThreads;   // Number of compute workers (i.e. pairs computed concurrently).
+  std::size_t readAhead;  // Number of image pairs decoded ahead of the compute workers.
+  bool stream;            // Stream images from disk, tile by tile, instead of loading them.
+  std::size_t cacheSize;  // Image cache size of streaming, in bytes.
+  bool stats;             // Save per-stage timings and counters of each pair.
+  bool perfCounters;      // Add hardware performance counters to the stats.
+};
+
+std::string GetOutputPath(const Settings& settings, std::size_t pair)
+{
+  return settings.outputDir + "uv-" + Convert2String(pair + 1) + "." + settings.format;
+}
+
+std::string GetStatsPath(const Settings& settings, std::size_t pair)
+{
+  return settings.outputDir + "stats-" + Convert2String(pair + 1) + ".json";
+}
+
+// Saves the stats (JSON) of a pair
+void SaveStats(const std::string& path, const std::string& json)
+{
+  std::ofstream file(path.c_str());
+  if(!file)
+    throw of::Exception("Could not create the stats file: " + path);
+
+  file << json;
+
+  std::cout << "- Stats file: " << path << std::endl;
+}
+
+/*
+  Out-of-core estimation: images are never loaded as a whole. For each pair, tiles (with halo)
+  are read from block caches of bounded size, computed in parallel and their interiors are written
+  incrementally to a tiled GeoTIFF. The memory usage depends on the cache and tile sizes only.
+*/
+void RunStreaming(const std::vector<std::string>& paths, const Settings& settings)
+{
+  of::Parameters params = of::TiledOpticalFlow::resolve(settings.params);
+
+  for(std::size_t i = 0; i < paths.size() - 1; ++i) // for each image pair
+  {
+    std::string uvfile = GetOutputPath(settings, i);
+
+    of::TraceScope trace("pair-" + Convert2String(i + 1), "pipeline");
+
+    std::cout << "- Image A: " << paths[i] << std::endl;
+    std::cout << "- Image B: " << paths[i + 1] << std::endl;
+
+    of::RasterReader readera(paths[i], settings.cacheSize / 2);
+    of::RasterReader readerb(paths[i + 1], settings.cacheSize / 2);
+
+    if(readera.getSize() != readerb.getSize())
+      throw of::Exception("The images must be the same size");
+
+    of::FlowRasterWriter writer(uvfile, readera.getSize());
+
+    std::vector<of::Tile> tiles = of::TiledOpticalFlow::computeTiles(readera.getSize(), params.tileSize, params.halo);
+
+    // Tile stats are summed over the threads
+    of::Stats stats;
+    stats.setEnabled(settings.stats);
+    std::mutex statsMutex;
+
+    double start = of::Stats::now();
+
+    of::Parallel::forEach(tiles.size(), [&](std::size_t t)
+    {
+      const of::Tile& tile = tiles[t];
+
+      of::TraceScope trace("tile-" + Convert2String(t), "tile");
+
+      of::Stats tileStats;
+      tileStats.setEnabled(settings.stats);
+      tileStats.setHardwareCountersEnabled(settings.perfCounters);
+
+      std::unique_ptr<of::Image> a, b;
+      {
+        of::StatsScope scope(tileStats, "read", tile.outer.getSize().npixels * 2);
+
+        a.reset(readera.read(tile.outer));
+        b.reset(readerb.read(tile.outer));
+      }
+
+      std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(a.get(), b.get(), of::TiledOpticalFlow::getTileParameters(params, tile)));
+      of->setStatsEnabled(settings.stats, settings.perfCounters);
+      of->compute();
+
+      of::Region interior(tile.inner.lin - tile.outer.lin, tile.inner.col - tile.outer.col, tile.inner.nlines, tile.inner.ncols);
+
+      {
+        of::StatsScope scope(tileStats, "write", interior.getSize().npixels);
+
+        writer.write(of->getU(), of->getV(), interior, tile.inner.lin, tile.inner.col);
+      }
+
+      if(settings.stats)
+      {
+        tileStats.merge(of->getStats());
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.merge(tileStats, "tiles/");
+      }
+    });
+
+    std::cout << "- Result file (u,v): " << uvfile << std::endl;
+
+    if(settings.stats)
+    {
+      stats.addStage("total", of::Stats::now() - start, readera.getSize().npixels);
+      SaveStats(GetStatsPath(settings, i), stats.toJSON());
+    }
+  }
+}
+
+/*
+  Producer/consumer estimation pipeline:
+
+    decode (1 thread) -> [pairs] -> compute (N threads) -> [results] -> write (1 thread, ordered)
+
+  Each image is decoded exactly once and shared by the two pairs that use it.
+  The queues are bounded, so at most 'readAhead' pairs wait for the workers and
+  at most 'nThreads' results wait for the writer. A worker only starts a pair that
+  is less than 2 * 'nThreads' pairs after the next one to be written, so a slow
+  pair also bounds the results the writer holds to restore the input order.
+*/
+class Pipeline
+{
+  public:
+
+    Pipeline(const std::vector<std::string>& paths, const Settings& settings)
+      : m_paths(paths),
+        m_settings(settings),
+        m_pairs(settings.readAhead),
+        m_results(settings.nThreads),
+        m_window(2 * settings.nThreads),
+        m_next(0),
+        m_stopped(false)
+    {
+    }
+
+    void run()
+    {
+      std::vector<std::thread> threads;
+
+      threads.push_back(std::thread(&Pipeline::decode, this));
+
+      for(std::size_t i = 0; i < m_settings.nThreads; ++i)
+        threads.push_back(std::thread(&Pipeline::compute, this));
+
+      std::thread writer(&Pipeline::write, this);
+
+      for(std::size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+      // All workers are done: no more results
+      m_results.close();
+
+      writer.join();
+
+      if(m_error)
+        std::rethrow_exception(m_error);
+    }
+
+  private:
+
+    typedef std::shared_ptr<of::Image> Frame;
+
+    struct Pair
+    {
+      std::size_t index;
+      Frame a;
+      Frame b;
+    };
+
+    struct Result
+    {
+      std::size_t index;
+      std::shared_ptr<of::Image> u;
+      std::shared_ptr<of::Image> v;
+      std::string stats; // JSON, if requested
+    };
+
+    // Decode stage: reads each image once and emits consecutive pairs
+    void decode()
+    {
+      of::Trace::setThreadName("decode");
+
+      try
+      {
+        Frame previous;
+
+        for(std::size_t i = 0; i < m_paths.size(); ++i)
+        {
+          Frame current;
+          {
+            of::TraceScope trace("decode image-" + Convert2String(i + 1), "pipeline");
+            current.reset(ReadImage(m_paths[i]));
+          }
+
+          if(previous)
+          {
+            Pair pair = { i - 1, previous, current };
+            if(!m_pairs.push(pair))
+              return;
+          }
+
+          previous = current;
+        }
+      }
+      catch(...)
+      {
+        fail(std::current_exception());
+      }
+
+      m_pairs.close();
+    }
+
+    // Compute stage: estimates the flow of independent pairs concurrently
+    void compute()
+    {
+      of::Trace::setThreadName("compute");
+
+      try
+      {
+        Pair pair;
+        while(m_pairs.pop(pair))
+        {
+          // Keeps the results waiting for an earlier pair (and so the writer reorder buffer) bounded
+          if(!waitWindow(pair.index))
+            return;
+
+          of::TraceScope trace("compute pair-" + Convert2String(pair.index + 1), "pipeline");
+
+          std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(pair.a.get(), pair.b.get(), m_settings.params));
+          of->setStatsEnabled(m_settings.stats, m_settings.perfCounters);
+
+          // Execute!
+          of->compute();
+
+          // Keep only (u,v) and release the frames as soon as possible
+          Result result = { pair.index, std::shared_ptr<of::Image>(of->getU()->clone()), std::shared_ptr<of::Image>(of->getV()->clone()),
+                            m_settings.stats ? of->getStats().toJSON() : std::string() };
+
+          of.reset();
+          pair = Pair();
+
+          if(!m_results.push(result))
+            return;
+        }
+      }
+      catch(...)
+      {
+        fail(std::current_exception());
+      }
+    }
+
+    // Write stage: saves the results in the input order
+    void write()
+    {
+      of::Trace::setThreadName("write");
+
+      try
+      {
+        std::map<std::size_t, Result> pending;
+        std::size_t next = 0;
+
+        Result result;
+        while(m_results.pop(result))
+        {
+          pending[result.index] = result;
+
+          while(!pending.empty() && pending.begin()->first == next)
+          {
+            const Result& r = pending.begin()->second;
+
+            of::TraceScope trace("write pair-" + Convert2String(next + 1), "pipeline");
+
+            std::string uvfile = GetOutputPath(m_settings, next);
+
+            std::cout << "- Image A: " << m_paths[next] << std::endl;
+            std::cout << "- Image B: " << m_paths[next + 1] << std::endl;
+            std::cout << "- Result file (u,v): " << uvfile << std::endl;
+
+            // Save result as (.flo), (.ofz) or (.tif) file
+            SaveFlow(uvfile, m_settings.format, m_settings.scale, r.u.get(), r.v.get());
+
+            if(m_settings.stats)
+              SaveStats(GetStatsPath(m_settings, next), r.stats);
+
+            pending.erase(pending.begin());
+            ++next;
+
+            advance(next);
+          }
+        }
+      }
+      catch(...)
+      {
+        fail(std::current_exception());
+      }
+    }
+
+    // Waits until the given pair is within the window of pairs after the next one to be written
+    bool waitWindow(std::size_t index)
+    {
+      std::unique_lock<std::mutex> lock(m_windowMutex);
+      m_windowCondition.wait(lock, [&] { return m_stopped || index < m_next + m_window; });
+
+      return !m_stopped;
+    }
+
+    // Moves the window after a result is written
+    void advance(std::size_t next)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_windowMutex);
+        m_next = next;
+      }
+
+      m_windowCondition.notify_all();
+    }
+
+    // Keeps the first error and stops all stages
+    void fail(std::exception_ptr error)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        if(!m_error)
+          m_error = error;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_windowMutex);
+        m_stopped = true;
+      }
+
+      m_windowCondition.notify_all();
+
+      m_pairs.close();
+      m_results.close();
+    }
+
+  private:
+
+    const std::vector<std::string>& m_paths;
+    const Settings& m_settings;
+    of::BoundedQueue<Pair> m_pairs;
+    of::BoundedQueue<Result> m_results;
+    const std::size_t m_window;                 // Maximum distance between a computed pair and the next one to be written
+    std::size_t m_next;                         // Index of the next pair to be written
+    bool m_stopped;                             // An error stopped the stages
+    std::mutex m_windowMutex;
+    std::condition_variable m_windowCondition;
+    std::exception_ptr m_error;
+    std::mutex m_errorMutex;
+};
 
 int main(int argc, char** argv)
 {
@@ -56,24 +554,169 @@ int main(int argc, char** argv)
     TCLAP::CmdLine cmd("A tool to estimate optical flow given a set of consecutive images", ' ', "1.0.0");
 
     // Define images path argument
-    TCLAP::ValueArg<std::string> imagesPathArg("i", "images", "Paths of consecutive images comma separated. e.g. path-1,path-2,path-n", true, "", "string");
+    TCLAP::ValueArg<std::string> imagesPathArg("i", "images", "Paths of consecutive images comma separated. e.g. path-1,path-2,path-n", false, "", "string");
 
     // Define method options
-    std::vector<std::string> methods;
-    methods.push_back(OF_HS_METHOD);
-    methods.push_back(OF_LK_METHOD);
-    methods.push_back(OF_LKC2F_METHOD);
+    std::vector<std::string> methods = of::OpticalFlowFactory::getMethods();
     TCLAP::ValuesConstraint<std::string> allowedMethods(methods);
 
     // Define method argument
-    TCLAP::ValueArg<std::string> methodArg("m", "method", "The method that will be used", false, OF_LKC2F_METHOD, &allowedMethods);
+    TCLAP::ValueArg<std::string> methodArg("m", "method", "The method that will be used", false, of::OF_LKC2F_METHOD, &allowedMethods);
 
     // Define output directory argument
     TCLAP::ValueArg<std::string> outputDirArg("o", "output", "Path to output directory that will contain the results. \
-                                                              Each output file (.flo) contains the coordinates of flow vectors at instant t+1",
-                                                              true, "", "string");
+                                                              Each output file (.flo, .ofz or .tif, see --format) contains the coordinates of flow vectors at instant t+1",
+                                                              false, "", "string");
+
+    // Define output format options
+    std::vector<std::string> formats;
+    formats.push_back(OF_FLO_FORMAT);
+    formats.push_back(OF_OFZ_FORMAT);
+    formats.push_back(OF_TIF_FORMAT);
+    TCLAP::ValuesConstraint<std::string> allowedFormats(formats);
+
+    // Define output format argument
+    TCLAP::ValueArg<std::string> formatArg("f", "format", "The output file format: Middlebury (.flo), compressed 16-bit fixed-point (.ofz) or GeoTIFF with (u,v) bands (.tif)",
+                                           false, OF_FLO_FORMAT, &allowedFormats);
+
+    // Define fixed-point scale argument
+    TCLAP::ValueArg<double> scaleArg("s", "scale", "The fixed-point scale used by compressed (.ofz) output. i.e. (u,v) resolution is 1/scale pixel",
+                                     false, OF_DEFAULT_FLOW_CODEC_SCALE, "double");
+
+    // Define number of threads argument
+    std::size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    TCLAP::ValueArg<std::size_t> threadsArg("t", "threads", "Number of threads. Pairs are computed concurrently and the remaining threads are used by each pair. Default: number of hardware threads",
+                                            false, hardwareThreads, "integer");
+
+    // Define read-ahead argument
+    TCLAP::ValueArg<std::size_t> readAheadArg("r", "read-ahead", "Number of image pairs decoded ahead of the computation. Bounds the memory usage",
+                                              false, 2, "integer");
+
+    // Define method parameters arguments
+    of::Parameters defaults;
+
+    TCLAP::ValueArg<std::size_t> kernelSizeArg("k", "kernel-size", "LK/LKC2F window size. e.g. 5 = 5 x 5 (odd number)",
+                                               false, defaults.kernelSize, "integer");
+
+    TCLAP::ValueArg<std::size_t> iterationsArg("n", "iterations", "Maximum number of iterations (per level on LKC2F, per patch on DIS). 0: method default",
+                                               false, defaults.maxIterations, "integer");
+
+    TCLAP::ValueArg<std::size_t> levelsArg("l", "levels", "LKC2F number of pyramid levels (DIS/BM coarsest level). 0: maximum number of levels allowed by the image size (DIS/BM automatic)",
+                                           false, defaults.nLevels, "integer");
+
+    TCLAP::ValueArg<double> alphaArg("a", "alpha", "HS alpha (smoothness weight) parameter",
+                                     false, defaults.alpha, "double");
+
+    TCLAP::ValueArg<double> thresholdArg("e", "threshold", "HS threshold for automatic stopping",
+                                         false, defaults.autoStopThreshold, "double");
+
+    std::vector<std::string> presets = of::DenseInverseSearch::getPresets();
+    TCLAP::ValuesConstraint<std::string> allowedPresets(presets);
+
+    TCLAP::ValueArg<std::string> presetArg("", "dis-preset", "DIS speed/quality preset: ultrafast, fast or medium (see DenseInverseSearch.h)",
+                                           false, defaults.preset, &allowedPresets);
+
+    TCLAP::ValueArg<std::size_t> blockSizeArg("", "block-size", "BM block size. e.g. 16 = 16 x 16",
+                                              false, defaults.blockSize, "integer");
+
+    TCLAP::ValueArg<std::size_t> searchRadiusArg("", "search-radius", "BM search radius, in pixels of each pyramid level",
+                                                 false, defaults.searchRadius, "integer");
+
+    std::vector<std::string> costs = of::BlockMatching::getCosts();
+    TCLAP::ValuesConstraint<std::string> allowedCosts(costs);
+
+    TCLAP::ValueArg<std::string> costArg("", "bm-cost", "BM matching cost: SAD, SSD, NCC, census5 or census7 (see BlockMatching.h)",
+                                         false, defaults.cost, &allowedCosts);
+
+    std::vector<std::string> searches = of::BlockMatching::getSearches();
+    TCLAP::ValuesConstraint<std::string> allowedSearches(searches);
+
+    TCLAP::ValueArg<std::string> searchArg("", "bm-search", "BM search pattern: full, diamond or hexagon (see BlockMatching.h)",
+                                           false, defaults.search, &allowedSearches);
+
+    std::vector<std::string> registrations = of::PhaseCorrelation::getRegistrations();
+    TCLAP::ValuesConstraint<std::string> allowedRegistrations(registrations);
+
+    TCLAP::ValueArg<std::string> registrationArg("", "registration", "LKC2F pre-registration of the second image by phase correlation: \
+                                                                    none, global (translation) or tiles (per-tile translations)",
+                                                 false, defaults.registration, &allowedRegistrations);
+
+    std::vector<std::string> terms = of::Census::getDataTerms();
+    TCLAP::ValuesConstraint<std::string> allowedTerms(terms);
+
+    TCLAP::ValueArg<std::string> dataTermArg("", "data-term", "LK and LKC2F data term: intensity or census (robust to brightness changes, see Census.h)",
+                                             false, defaults.dataTerm, &allowedTerms);
+
+    std::vector<std::string> precisions = of::FixedPoint::getPrecisions();
+    TCLAP::ValuesConstraint<std::string> allowedPrecisions(precisions);
+
+    TCLAP::ValueArg<std::string> precisionArg("", "precision", "Arithmetic precision: double, fixed (LK and LKC2F integer path) or mixed (float storage, for HS, LK and LKC2F)",
+                                              false, defaults.precision, &allowedPrecisions);
+
+    std::vector<std::string> windows = of::RecursiveGaussian::getWindows();
+    TCLAP::ValuesConstraint<std::string> allowedWindows(windows);
+
+    TCLAP::ValueArg<std::string> windowArg("", "window", "LK and LKC2F window of the equation sums: box (kernel-size) or gaussian (sigma, recursive filter)",
+                                           false, defaults.window, &allowedWindows);
+
+    TCLAP::ValueArg<double> sigmaArg("", "sigma", "LK and LKC2F gaussian window standard deviation, in pixels",
+                                     false, defaults.sigma, "double");
+
+    TCLAP::ValueArg<std::size_t> tileSizeArg("", "tile-size", "Tile size of tiled processing. Bounds the working memory on large images. 0: no tiling",
+                                             false, defaults.tileSize, "integer");
+
+    TCLAP::ValueArg<std::size_t> haloArg("", "halo", "Tile halo of tiled processing. 0: computed from the method parameters",
+                                         false, defaults.halo, "integer");
+
+    TCLAP::SwitchArg streamArg("", "stream", "Stream images from disk tile by tile (see --tile-size and --cache-size) instead of loading them. \
+                                              Allows images larger than the memory. Requires the 'tif' output format");
+
+    TCLAP::ValueArg<std::size_t> cacheSizeArg("", "cache-size", "Image cache size of streaming, in megabytes",
+                                              false, 256, "integer");
+
+    TCLAP::SwitchArg statsArg("", "stats", "Save the per-stage timings and counters of each pair as JSON (stats-N.json) in the output directory");
+
+    TCLAP::SwitchArg perfCountersArg("", "perf-counters", "Add hardware performance counters (cycles, IPC, cache misses, memory bandwidth) \
+                                                          to the stats (Linux only). Implies --stats");
+
+    TCLAP::ValueArg<std::string> traceArg("", "trace", "Path of a timeline (Chrome trace-event JSON) of the stages, levels, tiles and threads. \
+                                                      Open it in Perfetto (https://ui.perfetto.dev)",
+                                                      false, "", "string");
+
+    // Define configuration file argument
+    TCLAP::ValueArg<std::string> configArg("c", "config", "Path to a configuration file with 'key = value' lines, \
+                                                          where key is any long argument name (e.g. 'kernel-size = 7'). \
+                                                          Command line arguments have precedence",
+                                                          false, "", "string");
 
     // Add the arguments
+    cmd.add(configArg);
+    cmd.add(traceArg);
+    cmd.add(perfCountersArg);
+    cmd.add(statsArg);
+    cmd.add(cacheSizeArg);
+    cmd.add(streamArg);
+    cmd.add(haloArg);
+    cmd.add(tileSizeArg);
+    cmd.add(sigmaArg);
+    cmd.add(windowArg);
+    cmd.add(precisionArg);
+    cmd.add(dataTermArg);
+    cmd.add(registrationArg);
+    cmd.add(searchArg);
+    cmd.add(costArg);
+    cmd.add(searchRadiusArg);
+    cmd.add(blockSizeArg);
+    cmd.add(presetArg);
+    cmd.add(thresholdArg);
+    cmd.add(alphaArg);
+    cmd.add(levelsArg);
+    cmd.add(iterationsArg);
+    cmd.add(kernelSizeArg);
+    cmd.add(readAheadArg);
+    cmd.add(threadsArg);
+    cmd.add(scaleArg);
+    cmd.add(formatArg);
     cmd.add(outputDirArg);
     cmd.add(methodArg);
     cmd.add(imagesPathArg);
@@ -81,13 +724,118 @@ int main(int argc, char** argv)
     // Parse the given input parameters from agv array
     cmd.parse(argc, argv);
 
+    // Read the configuration file, if any
+    Config config;
+    if(configArg.isSet())
+      ReadConfig(configArg.getValue(), config);
+
+    // Check configuration keys
+    std::vector<TCLAP::Arg*> args;
+    args.push_back(&imagesPathArg); args.push_back(&methodArg); args.push_back(&outputDirArg);
+    args.push_back(&formatArg); args.push_back(&scaleArg); args.push_back(&threadsArg);
+    args.push_back(&readAheadArg); args.push_back(&kernelSizeArg); args.push_back(&iterationsArg);
+    args.push_back(&levelsArg); args.push_back(&alphaArg); args.push_back(&thresholdArg);
+    args.push_back(&presetArg); args.push_back(&blockSizeArg); args.push_back(&searchRadiusArg);
+    args.push_back(&costArg); args.push_back(&searchArg); args.push_back(&registrationArg); args.push_back(&dataTermArg);
+    args.push_back(&precisionArg); args.push_back(&windowArg); args.push_back(&sigmaArg);
+    args.push_back(&tileSizeArg); args.push_back(&haloArg); args.push_back(&streamArg); args.push_back(&cacheSizeArg); args.push_back(&statsArg);
+    args.push_back(&traceArg); args.push_back(&perfCountersArg);
+
+    for(Config::const_iterator it = config.begin(); it != config.end(); ++it)
+    {
+      std::size_t i = 0;
+      while(i < args.size() && args[i]->getName() != it->first)
+        ++i;
+
+      if(i == args.size())
+        throw of::Exception("Unknown configuration key: " + it->first);
+    }
+
     // Get the set of image paths separately
     std::vector<std::string> paths;
-    Tokenize(imagesPathArg.getValue(), paths, ",");
+    Tokenize(GetValue(imagesPathArg, config), paths, ",");
 
     if(paths.size() < 2)
       throw of::Exception("Wrong parameter 'images': inform at least two consecutive images");
 
+    Settings settings;
+    settings.params.method = GetValue(methodArg, config);
+    settings.params.kernelSize = GetValue(kernelSizeArg, config);
+    settings.params.maxIterations = GetValue(iterationsArg, config);
+    settings.params.nLevels = GetValue(levelsArg, config);
+    settings.params.alpha = GetValue(alphaArg, config);
+    settings.params.autoStopThreshold = GetValue(thresholdArg, config);
+    settings.params.tileSize = GetValue(tileSizeArg, config);
+    settings.params.halo = GetValue(haloArg, config);
+    settings.params.preset = GetValue(presetArg, config);
+    settings.params.blockSize = GetValue(blockSizeArg, config);
+    settings.params.searchRadius = GetValue(searchRadiusArg, config);
+    settings.params.cost = GetValue(costArg, config);
+    settings.params.search = GetValue(searchArg, config);
+    settings.params.registration = GetValue(registrationArg, config);
+    settings.params.dataTerm = GetValue(dataTermArg, config);
+    settings.params.precision = GetValue(precisionArg, config);
+    settings.params.window = GetValue(windowArg, config);
+    settings.params.sigma = GetValue(sigmaArg, config);
+    settings.outputDir = GetValue(outputDirArg, config);
+    settings.format = GetValue(formatArg, config);
+    settings.scale = GetValue(scaleArg, config);
+    settings.nThreads = GetValue(threadsArg, config);
+    settings.readAhead = GetValue(readAheadArg, config);
+    settings.stream = GetValue(streamArg, config);
+    settings.cacheSize = GetValue(cacheSizeArg, config) << 20;
+    settings.perfCounters = GetValue(perfCountersArg, config);
+    settings.stats = settings.perfCounters || GetValue(statsArg, config);
+
+    if(settings.perfCounters && !of::PerfCounters::isAvailable())
+    {
+      std::cerr << "Warning: hardware performance counters are unavailable (see /proc/sys/kernel/perf_event_paranoid). "
+                << "Stats will contain timings only." << std::endl;
+    }
+
+    std::string tracePath = GetValue(traceArg, config);
+
+    if(std::find(methods.begin(), methods.end(), settings.params.method) == methods.end())
+      throw of::Exception("Wrong parameter 'method': " + settings.params.method);
+
+    if(std::find(presets.begin(), presets.end(), settings.params.preset) == presets.end())
+      throw of::Exception("Wrong parameter 'dis-preset': " + settings.params.preset);
+
+    if(std::find(costs.begin(), costs.end(), settings.params.cost) == costs.end())
+      throw of::Exception("Wrong parameter 'bm-cost': " + settings.params.cost);
+
+    if(std::find(searches.begin(), searches.end(), settings.params.search) == searches.end())
+      throw of::Exception("Wrong parameter 'bm-search': " + settings.params.search);
+
+    if(std::find(registrations.begin(), registrations.end(), settings.params.registration) == registrations.end())
+      throw of::Exception("Wrong parameter 'registration': " + settings.params.registration);
+
+    if(std::find(terms.begin(), terms.end(), settings.params.dataTerm) == terms.end())
+      throw of::Exception("Wrong parameter 'data-term': " + settings.params.dataTerm);
+
+    if(std::find(precisions.begin(), precisions.end(), settings.params.precision) == precisions.end())
+      throw of::Exception("Wrong parameter 'precision': " + settings.params.precision);
+
+    if(std::find(windows.begin(), windows.end(), settings.params.window) == windows.end())
+      throw of::Exception("Wrong parameter 'window': " + settings.params.window);
+
+    if(std::find(formats.begin(), formats.end(), settings.format) == formats.end())
+      throw of::Exception("Wrong parameter 'format': " + settings.format);
+
+    if(settings.outputDir.empty())
+      throw of::Exception("Wrong parameter 'output': inform the output directory");
+
+    if(settings.nThreads == 0)
+      throw of::Exception("Wrong parameter 'threads': inform at least one thread");
+
+    if(settings.stream && settings.format != OF_TIF_FORMAT)
+      throw of::Exception("Wrong parameter 'format': streaming requires the 'tif' output format");
+
+    // Split the threads between concurrent pairs and the library (e.g. tiles of a pair)
+    std::size_t nThreads = settings.nThreads;
+    settings.nThreads = settings.stream ? 1 : std::min(nThreads, paths.size() - 1);
+    of::Parallel::setNumberOfThreads(std::max<std::size_t>(1, nThreads / settings.nThreads));
+
     // Everything is ok! Let's run the process
 
     // GDAL initialization
@@ -95,58 +843,26 @@ int main(int argc, char** argv)
 
     std::cout << "Processing..." << std::endl;
 
-    std::string method = methodArg.getValue();
-
-    for(std::size_t i = 0; i < paths.size() - 1; ++i) // for each image pair
-    {
-      std::cout << "- Image A: " << paths[i] << std::endl;
-      std::cout << "- Image B: " << paths[i + 1] << std::endl;
-
-      // Open input images
-      GDALDataset* gDatasetA = (GDALDataset*)GDALOpen(paths[i].c_str(), GA_ReadOnly);
-      GDALDataset* gDatasetB = (GDALDataset*)GDALOpen(paths[i + 1].c_str(), GA_ReadOnly);
-
-      // Retrieve dimensions
-      std::size_t nlines = gDatasetA->GetRasterYSize();
-      std::size_t ncols = gDatasetA->GetRasterXSize();
-      std::size_t size = nlines * ncols;
-
-      // Read buffers
-      double* buffera = new double[size];
-      double* bufferb = new double[size];
-      gDatasetA->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, ncols, nlines, buffera, ncols, nlines, GDT_Float64, 0, 0);
-      gDatasetB->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, ncols, nlines, bufferb, ncols, nlines, GDT_Float64, 0, 0);
-
-      // Close! GDAL is used only to read image data
-      GDALClose(gDatasetA);
-      GDALClose(gDatasetB);
-
-      // Encapsulate buffers
-      of::Image* imga = new of::Image(buffera, nlines, ncols);
-      of::Image* imgb = new of::Image(bufferb, nlines, ncols);
-
-      // Create specific method
-      of::OpticalFlow* of = 0;
-      if(method == OF_HS_METHOD)
-        of = new of::HornSchunck(imga, imgb);
-      else if(method == OF_LK_METHOD)
-        of = new of::LucasKanade(imga, imgb);
-      else // OF_LKC2F_METHOD
-        of = new of::LucasKanadeC2F(imga, imgb);
-      
-      // Execute!
-      of->compute();
-
-      std::string uvfile = outputDirArg.getValue() + "uv-" + Convert2String(i + 1) + ".flo";
-
-      std::cout << "- Result file (u,v): " << uvfile << std::endl;
+    if(!tracePath.empty())
+    {
+      of::Trace::setEnabled(true);
+      of::Trace::setThreadName("main");
+    }
 
-      // Save result as (.flo) file
-      of->save(uvfile);
+    if(settings.stream)
+    {
+      RunStreaming(paths, settings);
+    }
+    else
+    {
+      Pipeline pipeline(paths, settings);
+      pipeline.run();
+    }
 
-      delete of;
-      delete imga;
-      delete imgb;
+    if(!tracePath.empty())
+    {
+      of::Trace::save(tracePath);
+      std::cout << "- Trace file: " << tracePath << std::endl;
     }
   }
   catch(TCLAP::ArgException& e)
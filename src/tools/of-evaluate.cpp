@@ -0,0 +1,135 @@
+/*!
+  \file tools/of-evaluate.cpp
+  \brief Optical Flow Evaluation Command Line Tool.
+  \author Douglas Uba
+*/
+
+// Optical Flow
+#include "../of/Evaluation.h"
+#include "../of/Exception.h"
+#include "../of/FlowFile.h"
+#include "../of/Image.h"
+
+// TCLAP
+#include <tclap/CmdLine.h>
+
+// STL
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiter)
+{
+  std::size_t lastpos = str.find_first_not_of(delimiter, 0);
+
+  std::size_t pos = str.find_first_of(delimiter, lastpos);
+
+  while(std::string::npos != pos || std::string::npos != lastpos)
+  {
+    tokens.push_back(str.substr(lastpos, pos - lastpos));
+    lastpos = str.find_first_not_of(delimiter, pos);
+    pos = str.find_first_of(delimiter, lastpos);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("A tool to evaluate estimated optical flow against ground truth (average endpoint and angular errors)", ' ', "1.0.0");
+
+    TCLAP::ValueArg<std::string> estimatedArg("e", "estimated", "Estimated flow files (.flo or .ofz) comma separated", true, "", "string");
+
+    TCLAP::ValueArg<std::string> groundTruthArg("g", "ground-truth", "Ground truth flow files (.flo or .ofz) comma separated, in the same order",
+                                                true, "", "string");
+
+    TCLAP::ValueArg<std::size_t> borderArg("b", "border", "Number of border pixels that will be ignored", false, 0, "integer");
+
+    TCLAP::ValueArg<std::string> jsonArg("j", "json", "Path of the JSON results", false, "", "string");
+
+    cmd.add(jsonArg);
+    cmd.add(borderArg);
+    cmd.add(groundTruthArg);
+    cmd.add(estimatedArg);
+
+    cmd.parse(argc, argv);
+
+    std::vector<std::string> estimated, groundTruth;
+    Tokenize(estimatedArg.getValue(), estimated, ",");
+    Tokenize(groundTruthArg.getValue(), groundTruth, ",");
+
+    if(estimated.empty() || estimated.size() != groundTruth.size())
+      throw of::Exception("Wrong parameters: inform the same number of estimated and ground truth files");
+
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n  \"results\": [";
+
+    std::cout << std::left << std::setw(40) << "estimated" << std::right << std::setw(10) << "EPE"
+              << std::setw(10) << "AE (deg)" << std::setw(12) << "outliers" << std::endl;
+
+    double sumEPE = 0.0, sumAE = 0.0;
+
+    for(std::size_t i = 0; i < estimated.size(); ++i)
+    {
+      of::Image* u = 0;
+      of::Image* v = 0;
+      of::FlowFile::load(estimated[i], u, v);
+      std::unique_ptr<of::Image> eu(u), ev(v);
+
+      of::FlowFile::load(groundTruth[i], u, v);
+      std::unique_ptr<of::Image> gu(u), gv(v);
+
+      of::FlowError error = of::Evaluation::compare(eu.get(), ev.get(), gu.get(), gv.get(), borderArg.getValue());
+
+      sumEPE += error.epe;
+      sumAE += error.ae;
+
+      std::cout << std::left << std::setw(40) << estimated[i] << std::right << std::fixed << std::setprecision(4)
+                << std::setw(10) << error.epe << std::setw(10) << error.ae << std::setw(12) << error.outliers << std::endl;
+
+      json << (i == 0 ? "\n" : ",\n")
+           << "    {\"estimated\": \"" << estimated[i] << "\", \"ground_truth\": \"" << groundTruth[i] << "\""
+           << ", \"epe\": " << error.epe << ", \"ae\": " << error.ae << ", \"outliers\": " << error.outliers
+           << ", \"npixels\": " << error.npixels << "}";
+    }
+
+    std::cout << std::left << std::setw(40) << "mean" << std::right << std::setw(10) << sumEPE / estimated.size()
+              << std::setw(10) << sumAE / estimated.size() << std::endl;
+
+    json << "\n  ],\n  \"mean_epe\": " << sumEPE / estimated.size() << ",\n  \"mean_ae\": " << sumAE / estimated.size() << "\n}\n";
+
+    if(!jsonArg.getValue().empty())
+    {
+      std::ofstream file(jsonArg.getValue().c_str());
+      if(!file)
+        throw of::Exception("Could not create the JSON file: " + jsonArg.getValue());
+
+      file << json.str();
+    }
+  }
+  catch(TCLAP::ArgException& e)
+  {
+    std::cerr << std::endl << "Argument exception: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(const of::Exception& e)
+  {
+    std::cerr << std::endl << "An exception has occurred: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(...)
+  {
+    std::cerr << std::endl << "An unexpected exception has occurred!" << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
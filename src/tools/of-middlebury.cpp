@@ -0,0 +1,428 @@
+/*!
+  \file tools/of-middlebury.cpp
+  \brief Middlebury-style Optical Flow Evaluation Harness Command Line Tool.
+  \author Douglas Uba
+*/
+
+// Optical Flow
+#include "../of/Evaluation.h"
+#include "../of/Exception.h"
+#include "../of/FlowFile.h"
+#include "../of/Image.h"
+#include "../of/OpticalFlow.h"
+#include "../of/OpticalFlowFactory.h"
+#include "../of/Parallel.h"
+#include "../of/Stats.h"
+
+// GDAL/OGR
+#include <cpl_string.h>
+#include <cpl_vsi.h>
+#include <gdal_priv.h>
+
+// TCLAP
+#include <tclap/CmdLine.h>
+
+// STL
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiter)
+{
+  std::size_t lastpos = str.find_first_not_of(delimiter, 0);
+
+  std::size_t pos = str.find_first_of(delimiter, lastpos);
+
+  while(std::string::npos != pos || std::string::npos != lastpos)
+  {
+    tokens.push_back(str.substr(lastpos, pos - lastpos));
+    lastpos = str.find_first_not_of(delimiter, pos);
+    pos = str.find_first_of(delimiter, lastpos);
+  }
+}
+
+// Named set of method parameters
+struct Preset
+{
+  std::string name;      // The preset name.
+  of::Parameters params; // The method parameters.
+};
+
+/*
+  Parses a preset: 'name:key=value,key=value,...'. Keys are the of-estimation long argument names:
+  method, kernel-size, iterations, levels, alpha, threshold, tile-size, halo, dis-preset, block-size, search-radius,
+  bm-cost, bm-search, registration, data-term, precision, window and sigma.
+*/
+Preset ParsePreset(const std::string& str)
+{
+  std::size_t pos = str.find(':');
+  if(pos == std::string::npos || pos == 0)
+    throw of::Exception("Wrong preset (expected 'name:key=value,...'): " + str);
+
+  Preset preset;
+  preset.name = str.substr(0, pos);
+
+  std::vector<std::string> pairs;
+  Tokenize(str.substr(pos + 1), pairs, ",");
+
+  for(std::size_t i = 0; i < pairs.size(); ++i)
+  {
+    std::size_t eq = pairs[i].find('=');
+    if(eq == std::string::npos)
+      throw of::Exception("Wrong preset value (expected 'key=value'): " + pairs[i]);
+
+    std::string key = pairs[i].substr(0, eq);
+    std::istringstream is(pairs[i].substr(eq + 1));
+
+    bool ok = true;
+
+    if(key == "method")
+      ok = static_cast<bool>(is >> preset.params.method);
+    else if(key == "kernel-size")
+      ok = static_cast<bool>(is >> preset.params.kernelSize);
+    else if(key == "iterations")
+      ok = static_cast<bool>(is >> preset.params.maxIterations);
+    else if(key == "levels")
+      ok = static_cast<bool>(is >> preset.params.nLevels);
+    else if(key == "alpha")
+      ok = static_cast<bool>(is >> preset.params.alpha);
+    else if(key == "threshold")
+      ok = static_cast<bool>(is >> preset.params.autoStopThreshold);
+    else if(key == "tile-size")
+      ok = static_cast<bool>(is >> preset.params.tileSize);
+    else if(key == "halo")
+      ok = static_cast<bool>(is >> preset.params.halo);
+    else if(key == "dis-preset")
+      ok = static_cast<bool>(is >> preset.params.preset);
+    else if(key == "block-size")
+      ok = static_cast<bool>(is >> preset.params.blockSize);
+    else if(key == "search-radius")
+      ok = static_cast<bool>(is >> preset.params.searchRadius);
+    else if(key == "bm-cost")
+      ok = static_cast<bool>(is >> preset.params.cost);
+    else if(key == "bm-search")
+      ok = static_cast<bool>(is >> preset.params.search);
+    else if(key == "registration")
+      ok = static_cast<bool>(is >> preset.params.registration);
+    else if(key == "data-term")
+      ok = static_cast<bool>(is >> preset.params.dataTerm);
+    else if(key == "precision")
+      ok = static_cast<bool>(is >> preset.params.precision);
+    else if(key == "window")
+      ok = static_cast<bool>(is >> preset.params.window);
+    else if(key == "sigma")
+      ok = static_cast<bool>(is >> preset.params.sigma);
+    else
+      throw of::Exception("Unknown preset key: " + key);
+
+    if(!ok)
+      throw of::Exception("Wrong preset value: " + pairs[i]);
+  }
+
+  std::vector<std::string> methods = of::OpticalFlowFactory::getMethods();
+  if(std::find(methods.begin(), methods.end(), preset.params.method) == methods.end())
+    throw of::Exception("Wrong preset method: " + preset.params.method);
+
+  return preset;
+}
+
+// Returns the default presets: each method with its default parameters
+std::vector<Preset> GetDefaultPresets()
+{
+  std::vector<std::string> methods = of::OpticalFlowFactory::getMethods();
+
+  std::vector<Preset> presets;
+  for(std::size_t i = 0; i < methods.size(); ++i)
+  {
+    Preset preset;
+    preset.name = methods[i];
+    preset.params.method = methods[i];
+    presets.push_back(preset);
+  }
+
+  return presets;
+}
+
+// Checks if the given path exists
+bool Exists(const std::string& path)
+{
+  VSIStatBufL stat;
+  return VSIStatL(path.c_str(), &stat) == 0;
+}
+
+// Lists the sequences (sub-directories) that have both frames and the ground truth flow
+std::vector<std::string> FindSequences(const std::string& dataDir, const std::string& gtDir,
+                                       const std::vector<std::string>& frames, const std::string& gtFile)
+{
+  std::vector<std::string> sequences;
+
+  char** entries = VSIReadDir(dataDir.c_str());
+
+  for(int i = 0; entries != 0 && entries[i] != 0; ++i)
+  {
+    std::string name = entries[i];
+    if(name == "." || name == "..")
+      continue;
+
+    if(!Exists(dataDir + "/" + name + "/" + frames[0]) || !Exists(dataDir + "/" + name + "/" + frames[1]))
+      continue;
+
+    if(!Exists(gtDir + "/" + name + "/" + gtFile))
+      continue;
+
+    sequences.push_back(name);
+  }
+
+  CSLDestroy(entries);
+
+  std::sort(sequences.begin(), sequences.end());
+
+  return sequences;
+}
+
+// Reads an image as gray levels (i.e. the mean of the first three bands, for color images)
+of::Image* ReadGrayImage(const std::string& path)
+{
+  GDALDataset* dataset = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+  if(dataset == 0)
+    throw of::Exception("Could not open the image: " + path);
+
+  std::size_t nlines = dataset->GetRasterYSize();
+  std::size_t ncols = dataset->GetRasterXSize();
+  int nbands = std::min(dataset->GetRasterCount(), 3);
+
+  of::Image* image = new of::Image(nlines, ncols);
+  image->fill(0.0);
+
+  std::vector<double> band(nlines * ncols);
+
+  for(int b = 1; b <= nbands; ++b)
+  {
+    CPLErr err = dataset->GetRasterBand(b)->RasterIO(GF_Read, 0, 0, ncols, nlines, &band[0], ncols, nlines, GDT_Float64, 0, 0);
+    if(err != CE_None)
+    {
+      GDALClose(dataset);
+      delete image;
+      throw of::Exception("Could not read the image: " + path);
+    }
+
+    for(std::size_t i = 0; i < band.size(); ++i)
+      image->setPixel(i, image->getPixel(i) + band[i] / nbands);
+  }
+
+  GDALClose(dataset);
+
+  return image;
+}
+
+// Result of a preset over a sequence
+struct Result
+{
+  std::string sequence;  // The sequence name.
+  std::string preset;    // The preset name.
+  of::FlowError error;   // Error against the ground truth.
+  double seconds;        // Compute wall time.
+  std::size_t peakBytes; // Peak bytes of images during the computation (including the input frames).
+};
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("A tool to evaluate the optical flow methods over a Middlebury-like dataset (accuracy, runtime and memory)", ' ', "1.0.0");
+
+    TCLAP::ValueArg<std::string> rootArg("d", "dataset", "Dataset root directory, with the other-data and other-gt-flow directories",
+                                         true, "", "string");
+
+    TCLAP::ValueArg<std::string> dataDirArg("", "data-dir", "Name of the frames directory (relative to the dataset root)",
+                                            false, "other-data", "string");
+
+    TCLAP::ValueArg<std::string> gtDirArg("", "gt-dir", "Name of the ground truth directory (relative to the dataset root)",
+                                          false, "other-gt-flow", "string");
+
+    TCLAP::ValueArg<std::string> framesArg("", "frames", "The two frames of each sequence comma separated",
+                                           false, "frame10.png,frame11.png", "string");
+
+    TCLAP::ValueArg<std::string> gtFileArg("", "gt-file", "Ground truth flow file of each sequence", false, "flow10.flo", "string");
+
+    TCLAP::MultiArg<std::string> presetsArg("p", "preset", "A named set of parameters: 'name:key=value,...' (e.g. 'lk7:method=LK,kernel-size=7'). \
+                                                          Keys: method, kernel-size, iterations, levels, alpha, threshold, tile-size, halo, dis-preset, \
+                                                          block-size, search-radius, bm-cost, bm-search, registration, data-term, precision, window, sigma. \
+                                                          Can be repeated. Default: each method with its default parameters",
+                                                          false, "string");
+
+    TCLAP::ValueArg<std::size_t> borderArg("b", "border", "Number of border pixels that will be ignored", false, 0, "integer");
+
+    TCLAP::ValueArg<std::size_t> threadsArg("t", "threads", "Number of threads used by the library. 0: hardware threads", false, 0, "integer");
+
+    TCLAP::ValueArg<std::string> jsonArg("j", "json", "Path of the JSON results", false, "", "string");
+
+    cmd.add(jsonArg);
+    cmd.add(threadsArg);
+    cmd.add(borderArg);
+    cmd.add(presetsArg);
+    cmd.add(gtFileArg);
+    cmd.add(framesArg);
+    cmd.add(gtDirArg);
+    cmd.add(dataDirArg);
+    cmd.add(rootArg);
+
+    cmd.parse(argc, argv);
+
+    std::vector<std::string> frames;
+    Tokenize(framesArg.getValue(), frames, ",");
+    if(frames.size() != 2)
+      throw of::Exception("Wrong parameter 'frames': inform two frames");
+
+    std::vector<Preset> presets;
+    for(std::size_t i = 0; i < presetsArg.getValue().size(); ++i)
+      presets.push_back(ParsePreset(presetsArg.getValue()[i]));
+
+    if(presets.empty())
+      presets = GetDefaultPresets();
+
+    of::Parallel::setNumberOfThreads(threadsArg.getValue());
+
+    // GDAL initialization
+    GDALAllRegister();
+
+    std::string dataDir = rootArg.getValue() + "/" + dataDirArg.getValue();
+    std::string gtDir = rootArg.getValue() + "/" + gtDirArg.getValue();
+
+    std::vector<std::string> sequences = FindSequences(dataDir, gtDir, frames, gtFileArg.getValue());
+    if(sequences.empty())
+      throw of::Exception("No sequences found in " + dataDir + " with ground truth in " + gtDir);
+
+    std::cout << std::left << std::setw(16) << "sequence" << std::setw(16) << "preset" << std::right
+              << std::setw(10) << "EPE" << std::setw(10) << "AE (deg)" << std::setw(12) << "time (s)"
+              << std::setw(14) << "peak (MB)" << std::endl;
+
+    std::vector<Result> results;
+
+    for(std::size_t s = 0; s < sequences.size(); ++s)
+    {
+      std::string dir = dataDir + "/" + sequences[s] + "/";
+
+      std::unique_ptr<of::Image> a(ReadGrayImage(dir + frames[0]));
+      std::unique_ptr<of::Image> b(ReadGrayImage(dir + frames[1]));
+
+      of::Image* u = 0;
+      of::Image* v = 0;
+      of::FlowFile::load(gtDir + "/" + sequences[s] + "/" + gtFileArg.getValue(), u, v);
+      std::unique_ptr<of::Image> gu(u), gv(v);
+
+      if(gu->getSize() != a->getSize())
+        throw of::Exception("The ground truth and the frames of " + sequences[s] + " must be the same size");
+
+      for(std::size_t p = 0; p < presets.size(); ++p)
+      {
+        // Baseline: the frames only
+        of::Stats::resetPeakBytes();
+
+        Result r;
+        r.sequence = sequences[s];
+        r.preset = presets[p].name;
+
+        std::unique_ptr<of::OpticalFlow> of(of::OpticalFlowFactory::make(a.get(), b.get(), presets[p].params));
+
+        double start = of::Stats::now();
+        of->compute();
+        r.seconds = of::Stats::now() - start;
+
+        r.peakBytes = of::Stats::getPeakBytes();
+        r.error = of::Evaluation::compare(of->getU(), of->getV(), gu.get(), gv.get(), borderArg.getValue());
+
+        results.push_back(r);
+
+        std::cout << std::left << std::setw(16) << r.sequence << std::setw(16) << r.preset << std::right
+                  << std::fixed << std::setprecision(4) << std::setw(10) << r.error.epe << std::setw(10) << r.error.ae
+                  << std::setprecision(3) << std::setw(12) << r.seconds
+                  << std::setprecision(1) << std::setw(14) << r.peakBytes / 1048576.0 << std::endl;
+      }
+    }
+
+    // Averages of each preset over all sequences
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n  \"results\": [";
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+      const Result& r = results[i];
+
+      json << (i == 0 ? "\n" : ",\n")
+           << "    {\"sequence\": \"" << r.sequence << "\", \"preset\": \"" << r.preset << "\""
+           << ", \"epe\": " << r.error.epe << ", \"ae\": " << r.error.ae << ", \"outliers\": " << r.error.outliers
+           << ", \"seconds\": " << r.seconds << ", \"peak_bytes\": " << r.peakBytes << "}";
+    }
+
+    json << "\n  ],\n  \"averages\": [";
+
+    std::cout << std::endl;
+
+    for(std::size_t p = 0; p < presets.size(); ++p)
+    {
+      double epe = 0.0, ae = 0.0, seconds = 0.0;
+      std::size_t peak = 0;
+
+      for(std::size_t i = p; i < results.size(); i += presets.size())
+      {
+        epe += results[i].error.epe;
+        ae += results[i].error.ae;
+        seconds += results[i].seconds;
+        peak = std::max(peak, results[i].peakBytes);
+      }
+
+      epe /= sequences.size();
+      ae /= sequences.size();
+
+      std::cout << std::left << std::setw(16) << "average" << std::setw(16) << presets[p].name << std::right
+                << std::setprecision(4) << std::setw(10) << epe << std::setw(10) << ae
+                << std::setprecision(3) << std::setw(12) << seconds
+                << std::setprecision(1) << std::setw(14) << peak / 1048576.0 << std::endl;
+
+      json << (p == 0 ? "\n" : ",\n")
+           << "    {\"preset\": \"" << presets[p].name << "\", \"method\": \"" << presets[p].params.method << "\""
+           << ", \"epe\": " << epe << ", \"ae\": " << ae << ", \"total_seconds\": " << seconds
+           << ", \"max_peak_bytes\": " << peak << "}";
+    }
+
+    json << "\n  ]\n}\n";
+
+    if(!jsonArg.getValue().empty())
+    {
+      std::ofstream file(jsonArg.getValue().c_str());
+      if(!file)
+        throw of::Exception("Could not create the JSON file: " + jsonArg.getValue());
+
+      file << json.str();
+
+      std::cout << "- JSON results: " << jsonArg.getValue() << std::endl;
+    }
+  }
+  catch(TCLAP::ArgException& e)
+  {
+    std::cerr << std::endl << "Argument exception: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(const of::Exception& e)
+  {
+    std::cerr << std::endl << "An exception has occurred: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(...)
+  {
+    std::cerr << std::endl << "An unexpected exception has occurred!" << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
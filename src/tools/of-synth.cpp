@@ -0,0 +1,173 @@
+/*!
+  \file tools/of-synth.cpp
+  \brief Synthetic Optical Flow Ground Truth Generator Command Line Tool.
+  \author Douglas Uba
+*/
+
+// Optical Flow
+#include "../of/Exception.h"
+#include "../of/FlowFile.h"
+#include "../of/Image.h"
+#include "../of/Synthetic.h"
+
+// GDAL/OGR
+#include <gdal_priv.h>
+
+// TCLAP
+#include <tclap/CmdLine.h>
+
+// STL
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+void Tokenize(const std::string& str, std::vector<std::string>& tokens, const std::string& delimiter)
+{
+  std::size_t lastpos = str.find_first_not_of(delimiter, 0);
+
+  std::size_t pos = str.find_first_of(delimiter, lastpos);
+
+  while(std::string::npos != pos || std::string::npos != lastpos)
+  {
+    tokens.push_back(str.substr(lastpos, pos - lastpos));
+    lastpos = str.find_first_not_of(delimiter, pos);
+    pos = str.find_first_of(delimiter, lastpos);
+  }
+}
+
+// Reads the first band of the given image path
+of::Image* ReadImage(const std::string& path)
+{
+  GDALDataset* dataset = (GDALDataset*)GDALOpen(path.c_str(), GA_ReadOnly);
+  if(dataset == 0)
+    throw of::Exception("Could not open the image: " + path);
+
+  std::size_t nlines = dataset->GetRasterYSize();
+  std::size_t ncols = dataset->GetRasterXSize();
+
+  of::Image* image = new of::Image(nlines, ncols);
+  CPLErr err = dataset->GetRasterBand(1)->RasterIO(GF_Read, 0, 0, ncols, nlines, image->getBuffer(), ncols, nlines, GDT_Float64, 0, 0);
+
+  GDALClose(dataset);
+
+  if(err != CE_None)
+  {
+    delete image;
+    throw of::Exception("Could not read the image: " + path);
+  }
+
+  return image;
+}
+
+// Writes the given image to a single band Float32 GeoTIFF
+void WriteImage(const std::string& path, const of::Image* image)
+{
+  GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+
+  GDALDataset* dataset = driver ? driver->Create(path.c_str(), image->getNCols(), image->getNLines(), 1, GDT_Float32, 0) : 0;
+  if(dataset == 0)
+    throw of::Exception("Could not create the image: " + path);
+
+  CPLErr err = dataset->GetRasterBand(1)->RasterIO(GF_Write, 0, 0, image->getNCols(), image->getNLines(), image->getBuffer(),
+                                                   image->getNCols(), image->getNLines(), GDT_Float64, 0, 0);
+  GDALClose(dataset);
+
+  if(err != CE_None)
+    throw of::Exception("Could not write the image: " + path);
+}
+
+int main(int argc, char** argv)
+{
+  try
+  {
+    TCLAP::CmdLine cmd("A tool to generate image pairs with known (ground truth) optical flow", ' ', "1.0.0");
+
+    TCLAP::ValueArg<std::string> imageArg("i", "image", "Base image path (e.g. data/input/satellitea.tif). If not informed, a procedural texture is used",
+                                          false, "", "string");
+
+    TCLAP::ValueArg<std::size_t> sizeArg("s", "size", "Size (n x n) of the procedural texture", false, 512, "integer");
+
+    std::vector<std::string> models = of::Synthetic::getMotionModels();
+
+    std::string modelsDescription = "Motion models comma separated, or 'all'. Available:";
+    for(std::size_t i = 0; i < models.size(); ++i)
+      modelsDescription += " " + models[i];
+
+    TCLAP::ValueArg<std::string> modelsArg("m", "models", modelsDescription, false, "all", "string");
+
+    TCLAP::ValueArg<double> magnitudeArg("", "magnitude", "Largest displacement, in pixels", false, 2.0, "double");
+
+    TCLAP::ValueArg<std::string> outputDirArg("o", "output", "Output directory. For each model: <model>-a.tif, <model>-b.tif and <model>-gt.flo",
+                                              true, "", "string");
+
+    cmd.add(outputDirArg);
+    cmd.add(magnitudeArg);
+    cmd.add(modelsArg);
+    cmd.add(sizeArg);
+    cmd.add(imageArg);
+
+    cmd.parse(argc, argv);
+
+    std::vector<std::string> selected;
+    if(modelsArg.getValue() == "all")
+      selected = models;
+    else
+      Tokenize(modelsArg.getValue(), selected, ",");
+
+    for(std::size_t i = 0; i < selected.size(); ++i)
+      if(std::find(models.begin(), models.end(), selected[i]) == models.end())
+        throw of::Exception("Wrong parameter 'models': " + selected[i]);
+
+    // GDAL initialization
+    GDALAllRegister();
+
+    std::unique_ptr<of::Image> base;
+    if(!imageArg.getValue().empty())
+      base.reset(ReadImage(imageArg.getValue()));
+
+    of::Size size = base ? base->getSize() : of::Size(sizeArg.getValue(), sizeArg.getValue());
+
+    std::string dir = outputDirArg.getValue();
+
+    for(std::size_t i = 0; i < selected.size(); ++i)
+    {
+      of::Image* u = 0;
+      of::Image* v = 0;
+      of::Synthetic::makeFlow(selected[i], size, magnitudeArg.getValue(), u, v);
+
+      std::unique_ptr<of::Image> gu(u), gv(v);
+
+      // The procedural texture is sampled exactly at the displaced positions. Base images are interpolated.
+      std::unique_ptr<of::Image> a(base ? base->clone() : of::Synthetic::makeTexture(size));
+      std::unique_ptr<of::Image> b(base ? of::Synthetic::warp(base.get(), u, v) : of::Synthetic::makeTexture(size, u, v));
+
+      WriteImage(dir + selected[i] + "-a.tif", a.get());
+      WriteImage(dir + selected[i] + "-b.tif", b.get());
+      of::FlowFile::save(dir + selected[i] + "-gt.flo", u, v);
+
+      std::cout << "- " << selected[i] << ": " << dir + selected[i] + "-{a,b}.tif, " << dir + selected[i] + "-gt.flo" << std::endl;
+    }
+  }
+  catch(TCLAP::ArgException& e)
+  {
+    std::cerr << std::endl << "Argument exception: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(const of::Exception& e)
+  {
+    std::cerr << std::endl << "An exception has occurred: " << e.what() << std::endl;
+
+    return EXIT_FAILURE;
+  }
+  catch(...)
+  {
+    std::cerr << std::endl << "An unexpected exception has occurred!" << std::endl;
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}